@@ -0,0 +1,89 @@
+/*! $Id$
+ *  @file   AtlasBuilder.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Command line tool which packs the tileset images of a Tile Studio
+ *          map into a texture atlas ahead of time.
+ *
+ *  Usage:
+ *      AtlasBuilder <map.xml> [pageSize] [gutter]
+ *
+ *  The atlas is written beside the map as <map>.atlas.xml, with the pages as
+ *  <map>.atlas0.tga, <map>.atlas1.tga, etc.  When TileGameState loads the map,
+ *  it uses the prebuilt atlas instead of packing the images itself.
+ *
+ *  The tool is built by scripts/msvc/AtlasBuilder.vcproj, which compiles in
+ *  the engine sources it uses.
+ *
+ */
+
+#include <iostream>
+
+#include "PgeArchiveManager.h"
+#include "PgeTextureAtlas.h"
+#include "PgeXmlArchiveFile.h"
+#include "PgeStringUtil.h"
+
+using namespace PGE;
+
+int main( int argc, char** argv )
+{
+    if ( argc < 2 )
+    {
+        std::cout << "Usage: AtlasBuilder <map.xml> [pageSize] [gutter]" << std::endl;
+        return 1;
+    }
+
+    String mapFile  = StringUtil::FixPath( argv[ 1 ] );
+    UInt32 pageSize = ( argc > 2 ) ? StringUtil::ToInt( argv[ 2 ] ) : 1024;
+    UInt32 gutter   = ( argc > 3 ) ? StringUtil::ToInt( argv[ 3 ] ) : 1;
+
+    ArchiveManager archiveManager;
+    archiveManager.AddArchive( "." );
+
+    String baseDir, fileTitle, atlasBase, ext;
+    StringUtil::SplitFilename( mapFile, baseDir, fileTitle );
+    StringUtil::SplitFileExtension( mapFile, atlasBase, ext );
+    atlasBase += ".atlas";
+
+    XmlArchiveFile doc( archiveManager.CreateArchiveFile( mapFile ) );
+    if ( !doc.LoadFile() )
+    {
+        std::cout << "Unable to read " << mapFile << std::endl;
+        return 1;
+    }
+
+    // Add the image of each tileset in each project
+    TextureAtlas atlas( atlasBase, pageSize, gutter );
+    TiXmlNode* projNode = doc.FirstChild( "project" );
+    for ( projNode; projNode; projNode = projNode->NextSibling( "project" ) )
+    {
+        TiXmlNode* listNode = projNode->FirstChild( "tileSetList" );
+        TiXmlNode* tilesetNode = listNode ? listNode->FirstChild( "tileset" ) : 0;
+        for ( tilesetNode; tilesetNode; tilesetNode = tilesetNode->NextSibling( "tileset" ) )
+        {
+            String imageName = StringUtil::FixPath( baseDir + "/" + XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "tileBitmap" ) ) );
+            Point2D tileSize( StringUtil::ToInt( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "tileWidth" ) ) ),
+                              StringUtil::ToInt( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "tileHeight" ) ) ) );
+            Point2D gridSize( StringUtil::ToInt( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "horizontalTileCount" ) ) ),
+                              StringUtil::ToInt( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "verticalTileCount" ) ) ) );
+
+            ImageData image;
+            if ( !TextureItem::Decode( imageName, image ) )
+            {
+                std::cout << "Unable to read " << imageName << std::endl;
+                continue;
+            }
+            atlas.AddTileGrid( imageName, image, tileSize, gridSize );
+        }
+    }
+
+    if ( !atlas.Build() || !atlas.Save( atlasBase + ".xml" ) )
+    {
+        std::cout << "Unable to build the atlas" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << atlas.GetPageCount() << " page(s) to " << atlasBase << ".xml" << std::endl;
+    return 0;
+}
@@ -0,0 +1,71 @@
+/*! $Id$
+ *  @file   MapCompiler.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Command line tool which compiles a Tile Studio xml map into the
+ *          binary .pgemap format.
+ *
+ *  Usage:
+ *      MapCompiler <map.xml> [out.pgemap] [pageSize]
+ *
+ *  By default, the compiled map is written beside the xml file as
+ *  <map>.pgemap.  When TileGameState loads the xml map, it uses the compiled
+ *  map instead if it exists.
+ *
+ *  If a page size is given, maps larger than a page are stored as pages of
+ *  that many cells on a side, and are streamed in around the view rather than
+ *  loaded whole.
+ *
+ *  The tool is built by scripts/msvc/MapCompiler.vcproj, which compiles in
+ *  the engine sources it uses.
+ *
+ */
+
+#include <iostream>
+
+#include "PgeArchiveManager.h"
+#include "PgeTileMapFile.h"
+#include "PgeStringUtil.h"
+
+#include "cmd/LogFileManager.h"
+
+using namespace PGE;
+
+// The engine logs through the log file manager, whose one instance belongs
+// to the program
+cmd::LogFileManager cmd::LogFileManager::mInstance;
+
+int main( int argc, char** argv )
+{
+    if ( argc < 2 )
+    {
+        std::cout << "Usage: MapCompiler <map.xml> [out.pgemap] [pageSize]" << std::endl;
+        return 1;
+    }
+
+    String mapFile = StringUtil::FixPath( argv[ 1 ] );
+    String outFile, ext;
+    StringUtil::SplitFileExtension( mapFile, outFile, ext );
+    outFile = ( argc > 2 ) ? String( argv[ 2 ] ) : outFile + ".pgemap";
+    UInt32 pageSize = ( argc > 3 ) ? StringUtil::ToInt( argv[ 3 ] ) : 0;
+
+    ArchiveManager archiveManager;
+    archiveManager.AddArchive( "." );
+
+    if ( !TileMapFile::ConvertTileStudioXML( mapFile, outFile, pageSize ) )
+    {
+        std::cout << "Unable to compile " << mapFile << std::endl;
+        return 1;
+    }
+
+    // Read the file back, to make sure it is usable
+    TileMapFile file;
+    if ( !file.Load( outFile ) )
+    {
+        std::cout << "Unable to read back " << outFile << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << file.GetTileSetCount() << " tileset(s) to " << outFile << std::endl;
+    return 0;
+}
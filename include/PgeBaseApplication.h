@@ -27,6 +27,7 @@ namespace PGE
     class TextureManager;
     //class TileManager;
     class FontManager;
+    class WorkQueue;
 //    class LogFileManager;
 
 
@@ -101,6 +102,8 @@ namespace PGE
 
         typedef SharedPtr< PGE::OverlayManager >    OverlayManagerPtr;
         OverlayManagerPtr   mOverlayManager;
+        typedef SharedPtr< WorkQueue >          WorkQueuePtr;
+        WorkQueuePtr        mWorkQueue;         ///< Worker threads for background tasks
 
 
         /** Perform additional initialization for the application-specific
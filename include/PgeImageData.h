@@ -0,0 +1,59 @@
+/*! $Id$
+ *  @file   PgeImageData.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Decoded image pixels, and views of the levels of a texture.
+ *
+ */
+
+#ifndef PGEIMAGEDATA_H
+#define PGEIMAGEDATA_H
+
+#include <vector>
+#include "PgeTypes.h"
+
+namespace PGE
+{
+    /** @struct ImageData
+        Decoded image pixels, stored as 8-bit RGBA with the top row first.
+    */
+    struct ImageData
+    {
+        UInt32  width, height;          ///< Dimensions of the image
+        std::vector< UInt8 > pixels;    ///< Pixel data (width * height * 4 bytes)
+
+        /** Constructor */
+        ImageData()
+            : width( 0 ), height( 0 )
+        {
+        }
+
+        /** Set the image size, clearing all pixels to transparent black */
+        void Resize( UInt32 w, UInt32 h )
+        {
+            width  = w;
+            height = h;
+            pixels.assign( w * h * 4, 0 );
+        }
+
+        /** Get a pointer to a pixel */
+        UInt8* GetPixel( UInt32 x, UInt32 y )               { return &pixels[ ( y * width + x ) * 4 ]; }
+        /** Get a pointer to a pixel */
+        const UInt8* GetPixel( UInt32 x, UInt32 y ) const   { return &pixels[ ( y * width + x ) * 4 ]; }
+    };
+
+    /** @struct ImageLevel
+        One level of a texture, as 8-bit RGBA with the top row first.  The
+        pixels belong to something else, such as an ImageData or a mapped
+        file.
+    */
+    struct ImageLevel
+    {
+        UInt32          width, height;  ///< Dimensions of the level
+        const UInt8*    pixels;         ///< Pixel data (width * height * 4 bytes)
+    };
+    typedef std::vector< ImageLevel > ImageLevelArray;
+
+} // namespace PGE
+
+#endif // PGEIMAGEDATA_H
@@ -0,0 +1,90 @@
+/*! $Id$
+ *  @file   PgeMappedFile.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Read-only view of an entire resource file in memory.
+ *
+ */
+
+#ifndef PGEMAPPEDFILE_H
+#define PGEMAPPEDFILE_H
+
+#include <vector>
+#include "PgeTypes.h"
+#include "PgeSharedPtr.h"
+
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+#   include <windows.h>
+#endif
+
+namespace PGE
+{
+    /** @class MappedFile
+        Makes the contents of a resource file available as a block of memory.
+
+        @remarks
+            If the file is in a directory on the search path, it is memory
+            mapped, so the operating system only pages in the parts of the file
+            which are actually used.  If it is inside an archive, it can not be
+            mapped, and is read into memory instead.  Either way, the data is
+            read-only.
+    */
+    class _PgeExport MappedFile
+    {
+    private:
+        const UInt8*        mData;          ///< Start of the file contents
+        UInt32              mSize;          ///< Size of the file in bytes
+        bool                mIsMapped;      ///< Indicates the data is mapped, rather than in the buffer
+        std::vector< UInt8 > mBuffer;       ///< Contents of a file which could not be mapped
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        HANDLE              mFile;
+        HANDLE              mMapping;
+#else
+        int                 mFile;
+#endif
+
+        MappedFile( const MappedFile& );
+        MappedFile& operator=( const MappedFile& );
+
+        /** Map a file on disk */
+        bool _map( const String& path );
+
+    public:
+        /** Constructor */
+        MappedFile();
+        /** Destructor */
+        ~MappedFile();
+
+        /** Open a resource, searching the archive manager's search path
+            @param  resName     Name of the resource
+            @param  readSize    If the file can not be mapped, only this many
+                                bytes from the start of the file are read.  Use
+                                0 to read the whole file.
+        */
+        bool Open( const String& resName, UInt32 readSize = 0 );
+
+        /** Open a file on disk by its path, rather than through the search
+            path.  If the file can not be mapped, it is read into memory.
+        */
+        bool OpenPath( const String& path );
+
+        /** Release the file */
+        void Close();
+
+        /** Get the contents of the file */
+        const UInt8* GetData() const        { return mData; }
+
+        /** Get the size of the file in bytes */
+        UInt32 GetSize() const              { return mSize; }
+
+        /** Check if the file is memory mapped (as opposed to having been read
+            into memory.)
+        */
+        bool IsMapped() const               { return mIsMapped; }
+    };
+
+    typedef SharedPtr< MappedFile > MappedFilePtr;
+
+} // namespace PGE
+
+#endif // PGEMAPPEDFILE_H
@@ -127,6 +127,20 @@ namespace PGE
             return pData == 0;
         }
 
+        /** Exchange the data with another pointer.  The use counts are not
+            changed.
+        */
+        inline void Swap( SharedPtr& ptr )
+        {
+            T* data = pData;
+            pData = ptr.pData;
+            ptr.pData = data;
+
+            unsigned int* useCount = pUseCount;
+            pUseCount = ptr.pUseCount;
+            ptr.pUseCount = useCount;
+        }
+
         /** Clear the pointer and set it to null */
         inline void SetNull()
         {
@@ -177,13 +191,13 @@ namespace PGE
     /** Compare pointers for equality */
     template < class T, class U > inline bool operator==( SharedPtr<T> const& a, SharedPtr<U> const& b )
     {
-        return ( a.get() == b.get() );
+        return ( a.Get() == b.Get() );
     }
 
     /** Compare pointers for inequality */
     template < class T, class U > inline bool operator!=( SharedPtr<T> const& a, SharedPtr<U> const& b )
     {
-        return ( a.get() != b.get() );
+        return ( a.Get() != b.Get() );
     }
 
 } // namespace PGE
@@ -0,0 +1,126 @@
+/*! $Id$
+ *  @file   PgeTextureAtlas.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Packs the images of several tilesets into a few large textures, so
+ *          that a scene can be drawn without rebinding textures between layers.
+ *
+ */
+
+#ifndef PGETEXTUREATLAS_H
+#define PGETEXTUREATLAS_H
+
+#include <vector>
+#include "PgeTypes.h"
+#include "PgePoint2D.h"
+#include "PgeTextureManager.h"
+#include "PgeTileBatch.h"
+
+namespace PGE
+{
+    /** @class TextureAtlas
+        Combines grids of tiles from several source images into one or more
+        atlas pages.
+
+        @remarks
+            Each tile is copied into the page with a border of gutter texels
+            around it.  The gutter repeats the outer texels of the tile, so
+            filtering at the edge of a tile (GL_LINEAR, or GL_NEAREST with
+            rounding at fractional offsets) samples the tile's own colors
+            rather than those of its neighbor.
+
+        @remarks
+            The atlas may be built at load time (AddTileGrid, Build, Upload),
+            or built ahead of time and written with Save, in which case the
+            game only needs to Load the descriptor.
+    */
+    class _PgeExport TextureAtlas
+    {
+    public:
+        /** @struct Block
+            The tiles from one source image
+        */
+        struct Block
+        {
+            String      name;               ///< Name of the source image
+            Point2D     tileSize;           ///< Size of each tile, not including the gutter
+            Point2D     gridSize;           ///< Number of tiles horizontally and vertically
+            UInt32      page;               ///< Page the block was packed into
+            Point2D     position;           ///< Top-left corner of the block in the page
+        };
+
+    private:
+        String                  mName;          ///< Base name of the atlas pages
+        UInt32                  mPageSize;      ///< Maximum width and height of a page
+        UInt32                  mGutter;        ///< Number of texels repeated around each tile
+
+        typedef std::vector< Block > BlockArray;
+        BlockArray              mBlocks;
+        std::vector< ImageData > mSources;      ///< Source images of the blocks, until the atlas is built
+
+        std::vector< ImageData > mPages;        ///< Pixels of each page, when built in memory
+        std::vector< Point2D >  mPageSizes;     ///< Dimensions of each page
+        StringVector            mPageNames;     ///< Texture names of each page
+
+        /** Get the size a block occupies in a page, including the gutters */
+        Point2D _getBlockExtent( const Block& block ) const;
+
+        /** Copy the tiles of a block into its page */
+        void _copyBlock( const Block& block, const ImageData& source );
+
+    public:
+        /** Constructor
+            @param  name        Base name of the atlas.  Page textures are named
+                                by appending the page number and ".tga".
+            @param  pageSize    Maximum size of a page.  This should be a power
+                                of 2, and no larger than the maximum texture
+                                size of the video card.
+            @param  gutter      Number of texels to repeat around each tile.
+        */
+        TextureAtlas( const String& name = "", UInt32 pageSize = 1024, UInt32 gutter = 1 );
+
+        /** Add a grid of tiles from an image.  If an image has already been
+            added with the same name, it is not added again.
+        */
+        bool AddTileGrid( const String& name, const ImageData& image, const Point2D& tileSize, const Point2D& gridSize );
+
+        /** Pack all added images into pages */
+        bool Build();
+
+        /** Create the textures for the pages.  If the atlas was loaded from a
+            descriptor, the page images are loaded instead.
+        */
+        bool Upload( GLuint minFilter = GL_NEAREST, GLuint maxFilter = GL_NEAREST );
+
+        /** Write the pages and a descriptor to disk.  The pages are written as
+            TGA files beside the descriptor.
+        */
+        bool Save( const String& fileName ) const;
+
+        /** Read a descriptor written by Save */
+        bool Load( const String& fileName );
+
+        /** Find the index of a block by its image name.  Returns -1 if the
+            image is not in the atlas.
+        */
+        Int FindBlock( const String& name ) const;
+
+        /** Get the texture coordinates of each tile in a block, with the same
+            layout as the tileset (index 0 is the empty tile.)
+        */
+        bool GetTileTexCoords( const String& name, TileTexCoordArray& texCoords ) const;
+
+        /** Get the texture name of the page containing a block */
+        const String& GetBlockPageName( const String& name ) const;
+
+        /** Get the number of pages */
+        UInt32 GetPageCount() const                     { return mPageNames.size(); }
+
+        /** Get the texture name of a page */
+        const String& GetPageName( UInt32 page ) const  { return mPageNames[ page ]; }
+
+    }; // class TextureAtlas
+
+} // namespace PGE
+
+#endif // PGETEXTUREATLAS_H
@@ -0,0 +1,181 @@
+/*! $Id$
+ *  @file   PgeTextureCache.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Directory of decoded textures, keyed by the contents of their
+ *          image files, so later runs can skip decoding.
+ *
+ */
+
+#ifndef PGETEXTURECACHE_H
+#define PGETEXTURECACHE_H
+
+#include "PgeTypes.h"
+#include "PgeMappedFile.h"
+#include "PgeImageData.h"
+
+namespace PGE
+{
+    /** @class TextureCache
+        Keeps the pixels of decoded textures on disk, exactly as they are
+        uploaded, so an image which has not changed is never decoded again.
+
+        @remarks
+            Each entry is a file in the cache directory, named from a 64-bit
+            hash of the bytes of the image file and the options it was
+            prepared with (see Options.)  The entry holds every level of the
+            texture as 8-bit RGBA with the top row first: the image enlarged
+            to powers of 2 when asked, followed by its mipmaps when they were
+            built.  Opening an entry maps the file (see MappedFile), so the
+            levels are uploaded straight from it.  An entry may also be
+            shipped in place of an image file, as a precompiled texture (see
+            ReadHeader.)
+
+        @remarks
+            All values are 32-bit little-endian, and every block starts on a
+            4 byte boundary.  Offsets are in bytes from the start of the file.
+            The header repeats the key, so an entry is only used for the file
+            it was made from.  Entries are written under a temporary name and
+            renamed, so a crash never leaves half an entry behind.  Stale
+            entries are never removed; the directory may simply be deleted.
+
+        @remarks
+            The cache is safe to use from several threads at once.
+    */
+    class _PgeExport TextureCache
+    {
+    public:
+        static const UInt32 MAGIC;          ///< Identifies a cache entry ("PGET")
+        static const UInt32 VERSION;        ///< Version of the layout written by this build
+
+        /** Options the pixels of an entry were prepared with */
+        enum Options
+        {
+            RESIZE_TO_POWER_OF_2    = 1,    ///< The canvas was enlarged to powers of 2
+            BUILD_MIPMAPS           = 2     ///< Mipmaps were built
+        };
+
+        /** @struct Key
+            Identifies the pixels prepared from an image file
+        */
+        struct Key
+        {
+            UInt32  hashLow;                ///< Low 32 bits of the hash of the file
+            UInt32  hashHigh;               ///< High 32 bits of the hash of the file
+            UInt32  sourceSize;             ///< Size of the image file
+            UInt32  options;                ///< Combination of Options
+        };
+
+        /** @struct Header
+            Start of an entry
+        */
+        struct Header
+        {
+            UInt32  magic;                  ///< Always MAGIC
+            UInt32  version;                ///< Layout version
+            UInt32  fileSize;               ///< Size of the whole entry
+            Key     key;                    ///< Key the entry was stored under
+            UInt32  originalWidth;          ///< Width of the image before it was enlarged
+            UInt32  originalHeight;         ///< Height of the image before it was enlarged
+            UInt32  levelCount;             ///< Number of levels
+            UInt32  levelOffset;            ///< Offset of the level records
+        };
+
+        /** @struct LevelRecord
+            A level of the texture
+        */
+        struct LevelRecord
+        {
+            UInt32  width;
+            UInt32  height;
+            UInt32  dataOffset;             ///< Offset of the pixels
+            UInt32  dataSize;               ///< Size of the pixels (width * height * 4)
+        };
+
+        /** @class Entry
+            An entry of the cache, mapped into memory
+        */
+        class _PgeExport Entry
+        {
+            friend class TextureCache;
+
+        private:
+            MappedFile          mFile;      ///< Contents of the entry
+            const Header*       mHeader;    ///< Header at the start of the file, or null if not open
+
+            Entry( const Entry& );
+            Entry& operator=( const Entry& );
+
+        public:
+            /** Constructor */
+            Entry();
+
+            /** Check if the entry is open */
+            bool IsOpen() const                 { return mHeader != 0; }
+
+            /** Release the file */
+            void Close();
+
+            /** Get the header of the entry */
+            const Header* GetHeader() const     { return mHeader; }
+
+            /** Get a view of each level, pointing into the file */
+            void GetLevels( ImageLevelArray& levels ) const;
+        };
+
+    private:
+        String              mDirectory;     ///< Directory holding the entries
+
+    public:
+        /** Constructor
+            @param  directory   Directory on disk to keep the entries in.  It
+                                must already exist.
+        */
+        TextureCache( const String& directory );
+
+        /** Get the directory holding the entries */
+        const String& GetDirectory() const      { return mDirectory; }
+
+        /** Make the key of an image file
+            @param  data        Contents of the image file
+            @param  size        Size of the image file
+            @param  options     Combination of Options
+        */
+        static Key MakeKey( const UInt8* data, UInt32 size, UInt32 options );
+
+        /** Check that a block of memory holds a whole entry, and get its
+            header.  The levels are not copied; see GetLevels.
+            @param  data        Contents of the entry
+            @param  size        Size of the entry
+            @param  key         Key the entry must have been stored under, or
+                                null to accept any entry
+            @return Null if the memory does not hold a valid entry
+        */
+        static const Header* ReadHeader( const UInt8* data, UInt32 size, const Key* key = 0 );
+
+        /** Get a view of each level of an entry in memory
+            @param  data        Contents of the entry
+            @param  header      Header returned by ReadHeader
+            @param  levels      Receives the levels, pointing into data
+        */
+        static void GetLevels( const UInt8* data, const Header* header, ImageLevelArray& levels );
+
+        /** Get the path of the entry for a key */
+        String GetEntryPath( const Key& key ) const;
+
+        /** Open the entry for a key
+            @return False if there is no valid entry
+        */
+        bool Open( const Key& key, Entry& entry ) const;
+
+        /** Store the levels of a texture under a key, replacing any entry
+            already there
+            @return False if the entry could not be written
+        */
+        bool Store( const Key& key, UInt32 originalWidth, UInt32 originalHeight, const ImageLevelArray& levels ) const;
+
+    }; // class TextureCache
+
+} // namespace PGE
+
+#endif // PGETEXTURECACHE_H
@@ -12,9 +12,16 @@
 #define PGETEXTUREMANAGER_H
 
 #include <map>
+#include <vector>
+#include <deque>
 #include "PgeTypes.h"
 #include "PgeSingleton.h"
 #include "PgeSharedPtr.h"
+#include "PgePoint2D.h"
+#include "PgeColor.h"
+#include "PgeWorkQueue.h"
+#include "PgeImageData.h"
+#include "PgeTextureCache.h"
 
 #if PGE_PLATFORM == PGE_PLATFORM_WIN32
 #   include <windows.h>
@@ -24,6 +31,34 @@
 
 namespace PGE
 {
+    /** Compact identifier of a texture in the TextureManager.  Handles stay
+        valid for as long as the manager, and 0 is never a valid handle.
+    */
+    typedef UInt32 TextureHandle;
+
+    /** @struct TexturePixels
+        The pixels of a texture, ready to upload.  They are either decoded
+        into memory, or mapped straight from an entry of the disk cache or a
+        precompiled texture file (see TextureCache.)
+    */
+    struct TexturePixels
+    {
+        MappedFile                  source;         ///< Precompiled texture file the pixels are mapped from, if any
+        std::vector< ImageData >    images;         ///< Decoded image and its mipmaps, when not mapped
+        TextureCache::Entry         entry;          ///< Cache entry the pixels are mapped from, if any
+        Point2D                     originalSize;   ///< Size of the image before it was enlarged
+        ImageLevelArray             levels;         ///< Each level of the texture, wherever it is held
+
+        /** Get the total size of the levels in bytes */
+        UInt32 GetSize() const
+        {
+            UInt32 size = 0;
+            for ( ImageLevelArray::const_iterator level = levels.begin(); level != levels.end(); level++ )
+                size += level->width * level->height * 4;
+            return size;
+        }
+    };
+
     /** @class TextureItem
         The TextureItem class contains the actual image data (size, bpp, pixel
         information, etc.)  The class will take care of loading and unloading
@@ -31,15 +66,64 @@ namespace PGE
     */
     class _PgeExport TextureItem
     {
+        friend class TextureManager;
+
     private:
         bool    mIsLoaded;              /**< Indicates if the image exists in memory */
+        bool    mIsPending;             /**< Indicates the image is being loaded in the background */
+        GLuint  mPlaceholderID;         /**< Id of the texture to draw with until the image is loaded */
         String  mImageFileName;         /**< Name of the image file */
         UInt32  mWidth, mHeight;        /**< Dimensions of the texture */
         UInt32  mOriginalWidth, mOriginalHeight; /**< The image is resized to a power-of-2.  These store the original dimensions. */
         GLuint  mTextureID;             /**< Id of the loaded texture */
+        std::vector< Color > mColorBlocks;  /**< Average color of each block of COLOR_BLOCK_SIZE pixels, in row order */
+        UInt32  mColorBlocksWide, mColorBlocksHigh; /**< Number of color blocks horizontally and vertically */
+
+        TextureHandle mHandle;          /**< Handle of the texture in the manager */
+        UInt32  mRefCount;              /**< Number of holders of the handle (see TextureManager::AddTextureRef) */
+        UInt32  mLastUse;               /**< Stamp of the last TextureManager::UseTexture, or 0 if it was never used through its handle */
+        UInt32  mMemorySize;            /**< Bytes of texture memory held: width x height x bpp, and a third more for mipmaps */
+        bool    mIsReloadable;          /**< Indicates the texture comes from its image file, so it can be unloaded and loaded again */
+        GLuint  mMinFilter, mMaxFilter; /**< Filters the image was last loaded with */
+        bool    mForceMipmap, mResizeIfNeeded;  /**< Options the image was last loaded with */
+
+        /** Average the colors of each block of the pixels, while they are in
+            memory.  The pixels are 8-bit RGBA, with rowLength pixels from the
+            start of one row to the next.
+        */
+        void _sampleColors( const UInt8* pixels, UInt32 width, UInt32 height, UInt32 rowLength );
+
+        /** Create the texture from the levels of its pixels.  The first
+            level may have been enlarged from the original size.  If there is
+            only one level, and mipmaps are asked for or the size is not a
+            power of 2, the mipmaps are built by GLU.
+        */
+        bool _upload( const ImageLevelArray& levels, UInt32 originalWidth, UInt32 originalHeight,
+                      GLuint minFilter, GLuint maxFilter, bool buildMipmaps );
 
+        /** Decode an image file held in memory.  The pixels are copied out
+            of the decoder once, straight into the canvas.  The decoder is
+            not held while the canvas is allocated.
+            @param  data            Contents of the image file
+            @param  size            Size of the image file
+            @param  resizeToPowerOf2    Indicates the canvas should be enlarged
+                                    to powers of 2, with the image in the
+                                    top-left corner
+            @param  image           Receives the pixels
+            @param  originalSize    Receives the size of the image before it
+                                    was enlarged
+        */
+        static bool _decodeMemory( const UInt8* data, UInt32 size, bool resizeToPowerOf2,
+                                   ImageData& image, Point2D& originalSize );
+
+        /** Add the mipmaps of the last image, down to 1x1, by averaging
+            each 2x2 block of pixels.  Its size must be powers of 2.
+        */
+        static void _buildMipmaps( std::vector< ImageData >& images );
 
     public:
+        static const UInt32 COLOR_BLOCK_SIZE;   /**< Width and height of the blocks of pixels whose colors are kept */
+
         /** Constructor */
         TextureItem( const String& imageFileName );
 
@@ -56,12 +140,29 @@ namespace PGE
         /** Get the original image height */
         UInt32 GetOriginalHeight() const    { return mOriginalHeight; }
 
-        /** Get the texture ID */
-        GLuint GetID() const               { return mTextureID; }
+        /** Get the texture ID.  While the image is loading in the
+            background, this is the placeholder texture.
+        */
+        GLuint GetID() const                { return mIsPending ? mPlaceholderID : mTextureID; }
 
         /** Get the load state */
         bool IsLoaded() const               { return mIsLoaded; }
 
+        /** Get the handle of the texture in the manager */
+        TextureHandle GetHandle() const     { return mHandle; }
+
+        /** Get the number of holders of the handle */
+        UInt32 GetRefCount() const          { return mRefCount; }
+
+        /** Get the bytes of texture memory held, or 0 when unloaded */
+        UInt32 GetMemorySize() const        { return mMemorySize; }
+
+        /** Check if the image is loading in the background (see
+            TextureManager::LoadImageAsync.)  The size is not known until it
+            is loaded.
+        */
+        bool IsPending() const              { return mIsPending; }
+
         /** Load the image into memory.  If the image is already loaded, it does
             nothing.
 
@@ -75,11 +176,118 @@ namespace PGE
         */
         bool Load( GLuint minFilter, GLuint maxFilter, bool forceMipmap, bool resizeIfNeeded = true );
 
+        /** Create the texture from pixels already in memory, rather than
+            loading the image file.  The dimensions should be powers of 2.
+        */
+        bool Create( const ImageData& image, GLuint minFilter, GLuint maxFilter );
+
         /** Unload the image from memory */
         bool Unload();
 
+        /** Get the average color of an area of the texture.  The pixels are
+            gone once they are uploaded, so this works from the average of each
+            block of COLOR_BLOCK_SIZE pixels, kept when the texture was loaded
+            or created; areas made of whole blocks are exact.  The colors are
+            weighted by their alpha, so transparent pixels only lower the
+            alpha of the result.
+            @param  u0, v0  Top-left texture coordinate of the area
+            @param  u1, v1  Bottom-right texture coordinate of the area
+        */
+        Color GetAverageColor( Real u0, Real v0, Real u1, Real v1 ) const;
+
+        /** Decode an image file into memory without creating a texture.  This
+            does not touch the GL context, so it is safe to use from tools.
+        */
+        static bool Decode( const String& imageFileName, ImageData& image );
+
+        /** Decode an image file as it is to be uploaded: the canvas is
+            enlarged to powers of 2 if asked, with the image in the top-left
+            corner.  This is safe to call from worker threads.
+            @param  imageFileName   Name of the image file
+            @param  resizeToPowerOf2    Indicates the canvas should be enlarged
+            @param  image           Receives the pixels
+            @param  originalSize    Receives the size of the image before it
+                                    was enlarged
+        */
+        static bool DecodeForUpload( const String& imageFileName, bool resizeToPowerOf2, ImageData& image, Point2D& originalSize );
+
+        /** Read an image file as it is to be uploaded, with the options of
+            Load.  The file is mapped rather than copied when it is loose on
+            disk.  A precompiled texture (an entry of a TextureCache, shipped
+            in place of the image) is used as it is, ignoring the options, and
+            its levels point straight into the file.  Otherwise, if a disk
+            cache is given and holds the file, the levels are mapped from its
+            entry, or else the file is decoded and the result is stored in the
+            cache.  This is safe to call from worker threads.
+            @param  imageFileName   Name of the image file
+            @param  resizeToPowerOf2    Indicates the canvas should be enlarged
+            @param  buildMipmaps    Indicates mipmaps should be built.  They
+                                    are built here when the size is a power
+                                    of 2, and by GLU otherwise.
+            @param  cache           Disk cache to use, or null
+            @param  pixels          Receives the levels
+        */
+        static bool ReadForUpload( const String& imageFileName, bool resizeToPowerOf2, bool buildMipmaps,
+                                   const TextureCache* cache, TexturePixels& pixels );
+
     }; // class TextureItem
 
+    /** @struct TextureLoadOptions
+        Options for loading a texture, as given to LoadImage
+    */
+    struct TextureLoadOptions
+    {
+        GLuint  minFilter;              ///< Filter for downscaling
+        GLuint  maxFilter;              ///< Filter for upscaling
+        bool    forceMipmap;            ///< Indicates mipmaps should be built
+        bool    resizeIfNeeded;         ///< Indicates the canvas should be enlarged to powers of 2
+
+        /** Constructor.  The defaults are those of LoadImage. */
+        TextureLoadOptions( GLuint minFilter_ = GL_LINEAR, GLuint maxFilter_ = GL_LINEAR,
+                            bool forceMipmap_ = false, bool resizeIfNeeded_ = true )
+            : minFilter( minFilter_ ),
+              maxFilter( maxFilter_ ),
+              forceMipmap( forceMipmap_ ),
+              resizeIfNeeded( resizeIfNeeded_ )
+        {
+        }
+    };
+
+    /** @struct TextureLoadTiming
+        How long one image of TextureManager::LoadImages took, in milliseconds
+    */
+    struct TextureLoadTiming
+    {
+        String  imageFileName;          ///< Name of the image
+        bool    isLoaded;               ///< Indicates the texture is loaded
+        Real32  readTime;               ///< Time spent reading and decoding the image, including any wait for the decoder
+        Real32  uploadTime;             ///< Time spent creating the texture
+
+        /** Constructor */
+        TextureLoadTiming()
+            : isLoaded( false ), readTime( 0 ), uploadTime( 0 )
+        {
+        }
+    };
+
+    /** @struct TextureLoadReport
+        How long TextureManager::LoadImages took, in milliseconds
+    */
+    struct TextureLoadReport
+    {
+        Real32  totalTime;              ///< Time from the call until every texture was created
+        Real32  readTime;               ///< Sum of the read times of the images, across the threads
+        Real32  uploadTime;             ///< Sum of the upload times of the images
+        UInt32  loadedCount;            ///< Number of images loaded
+        std::vector< TextureLoadTiming > images;    ///< Timing of each image, in the order given
+
+        /** Constructor */
+        TextureLoadReport()
+            : totalTime( 0 ), readTime( 0 ), uploadTime( 0 ), loadedCount( 0 )
+        {
+        }
+    };
+
     /** @class TextureManager
         A singleton class which maintains the image files.  By using this class,
         images are only loaded if needed, and are loaded just once.  When an
@@ -88,6 +296,17 @@ namespace PGE
         will be automatically reloaded until it is again released.  Care should
         be taken so that images are not constantly loaded and unloaded, but at
         the same time, they shouldn't unnecessarily occupy memory.
+
+        @remarks
+            Each texture also has an integer handle (see GetTextureHandle),
+            which finds it without a string lookup.  Textures drawn through
+            UseTexture may be evicted when the textures held take more than
+            the memory budget (see SetMemoryBudget): the textures nobody
+            holds a reference to go first, then the least recently used.  An
+            evicted texture is loaded again the next time it is used.
+            Textures created from memory (see CreateTexture), and those only
+            ever loaded by name, are never evicted, so they do not count
+            against the budget.
     */
     class _PgeExport TextureManager : public Singleton< TextureManager >
     {
@@ -101,6 +320,73 @@ namespace PGE
         typedef TextureMap::iterator                TextureIter;
         typedef TextureMap::const_iterator          TextureIterConst;
 
+        GLuint                                      mBoundTexture;  ///< Texture last bound through BindTexture
+
+        typedef std::vector< TextureItem* >         HandleArray;
+        HandleArray                                 mHandles;       ///< Item of each handle; handle 0 is unused
+        UInt32                                      mMemoryBudget;  ///< Bytes of texture memory to stay within, or 0 for no limit
+        UInt32                                      mMemoryUsed;    ///< Bytes of texture memory held by the loaded textures
+        UInt32                                      mUseCounter;    ///< Stamp of the most recent UseTexture
+
+        /** @class TextureLoadJob
+            Reads and decodes an image on a worker thread, for
+            LoadImageAsync.  The texture is created from the pixels on the
+            main thread.
+        */
+        class TextureLoadJob : public WorkItem
+        {
+        public:
+            TextureItem*    item;               ///< Texture being loaded
+            GLuint          minFilter;          ///< Filter for downscaling
+            GLuint          maxFilter;          ///< Filter for upscaling
+            bool            forceMipmap;        ///< Indicates mipmaps should be built
+            bool            resizeIfNeeded;     ///< Indicates the canvas should be enlarged to powers of 2
+            const TextureCache* cache;          ///< Disk cache to read from, if any
+            TexturePixels   pixels;             ///< Resulting pixels
+            bool            isDecoded;          ///< Indicates the image was decoded
+            Real32          readTime;           ///< Milliseconds taken by Execute
+
+            /** Read and decode the image */
+            void Execute();
+        };
+        typedef std::deque< TextureLoadJob* >       LoadJobQueue;
+        LoadJobQueue                                mLoadJobs;      ///< Loads in progress, in the order they were started
+        bool                                        mIsAsync;       ///< Indicates textures missing from GetTextureItemPtr load in the background
+        GLuint                                      mPlaceholderID; ///< Texture drawn in place of images still loading
+        SharedPtr< TextureCache >                   mDiskCache;     ///< Decoded textures kept on disk, if any
+
+        /** Create the placeholder texture, if it has not been */
+        GLuint _getPlaceholder();
+
+        /** Finish a load, waiting for its job if needed, and create the
+            texture.  The job is deleted.
+            @param  job         Job of the load
+            @param  timing      Receives the read and upload times, if not null
+        */
+        void _finishLoad( TextureLoadJob* job, TextureLoadTiming* timing = 0 );
+
+        /** Start loading an item in the background, unless it is loaded or
+            loading already
+        */
+        void _startLoad( TextureItem* item, GLuint minFilter, GLuint maxFilter, bool forceMipmap, bool resizeIfNeeded );
+
+        /** Finish the background load of an item, if it has one */
+        void _waitForLoad( TextureItem* item );
+
+        /** Add an item to the map, and give it a handle */
+        TextureIter _addItem( const String& textureName );
+
+        /** Account for the change in the memory held by an item */
+        void _trackMemory( const TextureItem* item, UInt32 oldSize );
+
+        /** Evict textures until the memory held by the evictable textures is
+            within the budget.  The given item is kept.
+        */
+        void _enforceBudget( const TextureItem* keep );
+
+        /** Unload an item, if it is loaded */
+        void _unloadItem( TextureItem* item );
+
     public:
         /** Constructor */
         TextureManager();
@@ -125,8 +411,133 @@ namespace PGE
         */
         bool LoadImage( const String& imageFileName, GLuint minFilter = GL_LINEAR, GLuint maxFilter = GL_LINEAR, bool forceMipmap = false, bool resizeIfNeeded = true );
 
+        /** Start loading an image in the background.  The file is read and
+            decoded on a worker thread (see WorkQueue), and the texture is
+            created by UploadLoadedTextures.  Until then, the item reports
+            IsPending, and its ID is a placeholder texture.  If the image is
+            already loaded, or loading, nothing is done.  The arguments are
+            those of LoadImage.
+        */
+        bool LoadImageAsync( const String& imageFileName, GLuint minFilter = GL_LINEAR, GLuint maxFilter = GL_LINEAR, bool forceMipmap = false, bool resizeIfNeeded = true );
+
+        /** Create the textures of the images which have finished decoding,
+            oldest first, until a budget of pixel bytes has
+            been uploaded.  At least one texture is created if any is ready,
+            so a large image is never held back.  Call once per frame.
+            @param  byteBudget      Bytes of pixels to upload
+            @return Number of textures created
+        */
+        UInt32 UploadLoadedTextures( UInt32 byteBudget = 4 * 1024 * 1024 );
+
+        /** Wait for every background load, and create the textures */
+        void FinishLoads();
+
+        /** Load a batch of images, such as the textures of a level.  The
+            files are read and decoded on the worker threads (see WorkQueue)
+            while this thread creates the textures of the images which are
+            ready, and helps with the rest.  Images which are already loaded
+            are not loaded again.
+            @remarks
+                DevIL can only decode one image at a time, so decoding, and
+                copying the pixels out of DevIL, are not spread across
+                threads.  Reading, hashing, the disk cache (see SetDiskCache),
+                allocating the canvas and mipmap building are.  With the disk
+                cache warm, nothing is decoded.
+            @param  imageFileNames  Names of the image files
+            @param  options         Options for every image
+            @param  report          Receives the timings, if not null
+            @return Number of the images which are loaded
+        */
+        UInt32 LoadImages( const StringVector& imageFileNames, const TextureLoadOptions& options = TextureLoadOptions(),
+                           TextureLoadReport* report = 0 );
+
+        /** Get the number of images loading in the background */
+        UInt32 GetPendingLoadCount() const          { return mLoadJobs.size(); }
+
+        /** Load the textures which GetTextureItemPtr does not find in the
+            background, rather than before it returns
+        */
+        void SetAsyncLoading( bool async )          { mIsAsync = async; }
+
+        /** Check if missing textures are loaded in the background */
+        bool IsAsyncLoading() const                 { return mIsAsync; }
+
+        /** Keep decoded textures in a directory on disk, so images which
+            have not changed are not decoded again (see TextureCache.)
+            Background loads are finished first.
+            @param  directory   Existing directory for the cache, or an empty
+                                string to stop using one
+        */
+        void SetDiskCache( const String& directory );
+
+        /** Get the disk cache, or null */
+        const TextureCache* GetDiskCache() const    { return mDiskCache.Get(); }
+
+        /** Create a texture from pixels in memory, and add it to the manager
+            under the given name.  If a texture already exists with the name,
+            it is replaced.
+        */
+        bool CreateTexture( const String& textureName, const ImageData& image, GLuint minFilter = GL_NEAREST, GLuint maxFilter = GL_NEAREST );
+
         /** Get a pointer to the texture item */
         TextureItem* GetTextureItemPtr( const String& textureName );
+
+        /** Get the handle of a texture, adding the image to the manager if
+            it is not found.  The image is not loaded until it is used.
+            @return The handle, or 0 if the image could not be added
+        */
+        TextureHandle GetTextureHandle( const String& textureName );
+
+        /** Get the item of a handle, or null.  This does not load it. */
+        TextureItem* GetTextureItem( TextureHandle handle ) const;
+
+        /** Add a reference to a texture.  Referenced textures are evicted
+            only after every texture without references.
+        */
+        void AddTextureRef( TextureHandle handle );
+
+        /** Release a reference to a texture.  The texture stays loaded until
+            it is evicted, or UnloadUnreferenced is called.
+        */
+        void ReleaseTexture( TextureHandle handle );
+
+        /** Unload every texture used through UseTexture which nobody holds a
+            reference to, such as between levels.
+            @return Number of textures unloaded
+        */
+        UInt32 UnloadUnreferenced();
+
+        /** Bind a texture by handle, loading it first if it is not loaded
+            (in the background when SetAsyncLoading is on.)  The texture
+            becomes the most recently used, and may be evicted later.
+            @return True if a texture was bound, false if it was already
+                    bound, or the handle is not valid
+        */
+        bool UseTexture( TextureHandle handle );
+
+        /** Set the bytes of texture memory to stay within, or 0 for no
+            limit.  Textures are evicted at once if they take more.  Only
+            the textures which can be evicted count against the budget.
+        */
+        void SetMemoryBudget( UInt32 bytes );
+
+        /** Get the bytes of texture memory to stay within */
+        UInt32 GetMemoryBudget() const              { return mMemoryBudget; }
+
+        /** Get the bytes of texture memory held by the loaded textures */
+        UInt32 GetMemoryUsed() const                { return mMemoryUsed; }
+
+        /** Bind a texture, unless it is already the texture bound through the
+            manager.
+            @return True if the texture was bound, false if it was already bound.
+        */
+        bool BindTexture( GLuint textureID );
+
+        /** Forget which texture is bound.  This should be called when other
+            code may have bound a texture without going through the manager
+            (for instance, at the start of rendering a scene.)
+        */
+        void ResetBinding();
     };
 
 } // namespace PGE;
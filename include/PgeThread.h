@@ -0,0 +1,148 @@
+/*! $Id$
+ *  @file   PgeThread.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Cross platform threads and synchronization objects.
+ *
+ */
+
+#ifndef PGETHREAD_H
+#define PGETHREAD_H
+
+#include "PgeTypes.h"
+
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+#   include <windows.h>
+#else
+#   include <pthread.h>
+#   include <semaphore.h>
+#endif
+
+namespace PGE
+{
+    /** @class Mutex
+        A mutual exclusion lock.  Only one thread at a time may hold the lock.
+    */
+    class _PgeExport Mutex
+    {
+    private:
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        CRITICAL_SECTION    mHandle;
+#else
+        pthread_mutex_t     mHandle;
+#endif
+
+        /** Mutexes can not be copied */
+        Mutex( const Mutex& );
+        Mutex& operator=( const Mutex& );
+
+    public:
+        /** Constructor */
+        Mutex();
+        /** Destructor */
+        ~Mutex();
+
+        /** Acquire the lock, waiting for it if another thread holds it */
+        void Lock();
+
+        /** Release the lock */
+        void Unlock();
+    };
+
+    /** @class MutexLock
+        Holds a mutex for the lifetime of the object.
+    */
+    class _PgeExport MutexLock
+    {
+    private:
+        Mutex&  mMutex;
+
+        MutexLock( const MutexLock& );
+        MutexLock& operator=( const MutexLock& );
+
+    public:
+        /** Constructor.  Acquires the lock. */
+        explicit MutexLock( Mutex& mutex ) : mMutex( mutex )    { mMutex.Lock(); }
+        /** Destructor.  Releases the lock. */
+        ~MutexLock()                                            { mMutex.Unlock(); }
+    };
+
+    /** @class Semaphore
+        A counting semaphore.  Waiting decrements the count, blocking while it
+        is zero, and posting increments it.
+    */
+    class _PgeExport Semaphore
+    {
+    private:
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        HANDLE  mHandle;
+#else
+        sem_t   mHandle;
+#endif
+
+        Semaphore( const Semaphore& );
+        Semaphore& operator=( const Semaphore& );
+
+    public:
+        /** Constructor */
+        Semaphore( UInt32 initialCount = 0 );
+        /** Destructor */
+        ~Semaphore();
+
+        /** Increment the count, releasing a waiting thread */
+        void Post();
+
+        /** Wait until the count is non-zero, then decrement it */
+        void Wait();
+    };
+
+    /** @class Thread
+        Base class for a thread of execution.  Derived classes implement Run,
+        which is executed on the new thread once Start is called.
+    */
+    class _PgeExport Thread
+    {
+    private:
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        HANDLE      mHandle;
+        static DWORD WINAPI _threadProc( LPVOID param );
+#else
+        pthread_t   mHandle;
+        static void* _threadProc( void* param );
+#endif
+        bool        mIsStarted;     ///< Indicates if the thread has been started and not yet joined
+
+        Thread( const Thread& );
+        Thread& operator=( const Thread& );
+
+    protected:
+        /** The work performed by the thread */
+        virtual void Run() = 0;
+
+    public:
+        /** Constructor */
+        Thread();
+        /** Destructor.  The thread must have been joined before it is destroyed. */
+        virtual ~Thread();
+
+        /** Start executing the thread */
+        bool Start();
+
+        /** Wait for the thread to finish */
+        void Join();
+
+        /** Check if the thread has been started and not yet joined */
+        bool IsStarted() const              { return mIsStarted; }
+
+        /** Suspend the calling thread for a number of milliseconds.  A value
+            of 0 simply yields the remainder of the time slice.
+        */
+        static void Sleep( UInt32 ms );
+
+        /** Get the number of processors available to the application */
+        static UInt32 GetProcessorCount();
+    };
+
+} // namespace PGE
+
+#endif // PGETHREAD_H
@@ -0,0 +1,187 @@
+/*! $Id$
+ *  @file   PgeTileBatch.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Collects tile quads into a single vertex array so that a whole
+ *          region of a tile map can be drawn with one call.
+ *
+ */
+
+#ifndef PGETILEBATCH_H
+#define PGETILEBATCH_H
+
+#include <vector>
+#include "PgeTypes.h"
+#include "PgeColor.h"
+
+#if PGE_PLATFORM == PGE_PLATFORM_WIN32
+#   include <windows.h>
+#endif
+
+#include <gl/gl.h>
+
+namespace PGE
+{
+    /** @struct TileTexCoords
+        Texture coordinates of a single tile within its source texture.
+    */
+    struct TileTexCoords
+    {
+        Real    u0, v0;                 ///< Top-left texture coordinate
+        Real    u1, v1;                 ///< Bottom-right texture coordinate
+
+        /** Constructor */
+        TileTexCoords()
+            : u0( 0 ), v0( 0 ), u1( 0 ), v1( 0 )
+        {
+        }
+    };
+
+    /** @typedef TileTexCoordArray
+        Texture coordinates for each tile in a set.  Tile 0 is the empty tile,
+        and its coordinates are never used.
+    */
+    typedef std::vector< TileTexCoords > TileTexCoordArray;
+
+    /** @struct TileRenderStats
+        Counters gathered while rendering tiles.  These make it possible to
+        verify how much work is actually being sent to the driver each frame.
+    */
+    struct TileRenderStats
+    {
+        UInt32  drawCalls;              ///< Number of draw calls issued
+        UInt32  vertexCount;            ///< Number of vertices submitted
+        UInt32  tileCount;              ///< Number of tiles (quads) submitted
+        UInt32  textureBinds;           ///< Number of times a texture was bound
+
+        /** Constructor */
+        TileRenderStats()
+            : drawCalls( 0 ), vertexCount( 0 ), tileCount( 0 ), textureBinds( 0 )
+        {
+        }
+
+        /** Reset the counters */
+        void Reset()
+        {
+            drawCalls   = 0;
+            vertexCount = 0;
+            tileCount   = 0;
+            textureBinds = 0;
+        }
+
+        /** Accumulate another set of counters */
+        TileRenderStats& operator+=( const TileRenderStats& src )
+        {
+            drawCalls   += src.drawCalls;
+            vertexCount += src.vertexCount;
+            tileCount   += src.tileCount;
+            textureBinds += src.textureBinds;
+            return *this;
+        }
+    };
+
+    /** @class TileBatch
+        A batch of textured quads stored as one interleaved vertex array.
+
+        @remarks
+            Tiles used to be rendered through one display list per cell, which
+            meant a driver call for every visible tile.  The batch instead
+            collects the quads for a whole region, and submits them with a
+            single <code>glDrawArrays</code>.  Client-side vertex arrays are
+            used (rather than buffer objects) so that no extension loading is
+            required; the interleaved layout matches <code>GL_T2F_V3F</code>.
+
+        @remarks
+            Colors may be given to the vertices of the quads (see
+            SetQuadColors), for lighting.  They are kept in a separate array,
+            which is only allocated once a color is set, so unlit batches use
+            no more memory than before.
+
+        @note
+            The batch does not bind a texture.  The caller is expected to bind
+            the texture for the tiles before calling Render.
+    */
+    class _PgeExport TileBatch
+    {
+    public:
+        /** @struct Vertex
+            Interleaved vertex, laid out to match GL_T2F_V3F.
+        */
+        struct Vertex
+        {
+            GLfloat u, v;               ///< Texture coordinate
+            GLfloat x, y, z;            ///< Position
+        };
+
+    private:
+        typedef std::vector< Vertex > VertexArray;
+        VertexArray mVertices;          ///< Four vertices per quad
+        std::vector< Color > mColors;   ///< Color of each vertex, or empty if the quads are drawn white
+
+    public:
+        /** Constructor */
+        TileBatch();
+
+        /** Remove all quads from the batch.  The allocated memory is kept so
+            that the batch can be refilled without reallocating.
+        */
+        void Clear();
+
+        /** Remove all quads from the batch, and free the memory used by them */
+        void Release();
+
+        /** Reserve space for a number of quads */
+        void Reserve( UInt32 quadCount );
+
+        /** Exchange the contents of two batches */
+        void Swap( TileBatch& other );
+
+        /** Add a quad to the batch
+            @param  x           Left edge of the quad
+            @param  y           Top edge of the quad
+            @param  w           Width of the quad
+            @param  h           Height of the quad
+            @param  tex         Texture coordinates of the tile
+        */
+        void AddQuad( Real x, Real y, Real w, Real h, const TileTexCoords& tex );
+
+        /** Replace a quad already in the batch.  This allows a single tile to
+            be changed without rebuilding the batch.
+            @param  quadIndex   Index of the quad, in the order they were added
+        */
+        void SetQuad( UInt32 quadIndex, Real x, Real y, Real w, Real h, const TileTexCoords& tex );
+
+        /** Set the colors of the corners of a quad.  Until a color is set,
+            every quad is drawn white; once one is, quads added later are
+            white until given their own colors.
+        */
+        void SetQuadColors( UInt32 quadIndex, const Color& topLeft, const Color& bottomLeft,
+                            const Color& bottomRight, const Color& topRight );
+
+        /** Remove the colors of the vertices, so the quads are drawn white */
+        void ClearColors();
+
+        /** Check if the vertices have colors */
+        bool HasColors() const              { return !mColors.empty(); }
+
+        /** Get the number of quads in the batch */
+        UInt32 GetQuadCount() const         { return mVertices.size() / 4; }
+
+        /** Get the number of vertices in the batch */
+        UInt32 GetVertexCount() const       { return mVertices.size(); }
+
+        /** Check if the batch contains any quads */
+        bool IsEmpty() const                { return mVertices.empty(); }
+
+        /** Draw the batch.  All transformations should have already been
+            performed, and the texture should be bound.
+            @param  stats       If not null, the draw call and vertex counts are
+                                added to these counters.
+        */
+        void Render( TileRenderStats* stats = 0 ) const;
+
+    }; // class TileBatch
+
+} // namespace PGE
+
+#endif // PGETILEBATCH_H
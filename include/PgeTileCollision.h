@@ -0,0 +1,282 @@
+/*! $Id$
+ *  @file   PgeTileCollision.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Collision queries against the bounds of a tile map, using one bit
+ *          per cell for each kind of boundary.
+ *
+ */
+
+#ifndef PGETILECOLLISION_H
+#define PGETILECOLLISION_H
+
+#include <vector>
+#include "PgeTypes.h"
+#include "PgePoint2D.h"
+#include "PgeRect.h"
+#include "PgeWorkQueue.h"
+#include "PgeTileSet.h"
+
+namespace PGE
+{
+
+    /** @class TileCollisionMap
+        Holds the bounds codes of a tile map as bit planes, and answers
+        movement and contact queries against them.
+
+        @remarks
+            Each plane holds one bit per cell, packed 32 cells to a word along
+            the rows.  A query covering a range of columns tests a whole word
+            of cells at a time, so the cost of a query depends on the number of
+            rows and words it spans rather than the number of cells.
+
+        @remarks
+            The bounds code follows Tile Studio: bit 0 is the upper edge of the
+            cell, bit 1 the left, bit 2 the lower and bit 3 the right.  A cell
+            with all four edges is solid.  An edge only blocks movement into
+            the cell across it, so a cell with just an upper edge is a platform
+            which can be jumped through from below.
+
+        @remarks
+            All positions are in pixels, relative to the top-left of the map.
+            Cells outside the map are empty.
+
+        @remarks
+            The queries only read the planes, so they may be made from any
+            number of threads at once.  Large batches of rays are split across
+            the work queue (see CastRays.)
+    */
+    class _PgeExport TileCollisionMap
+    {
+    public:
+        /** Kinds of boundary held in the planes */
+        enum Plane
+        {
+            PLANE_TOP,                      ///< Upper edge; blocks movement down into the cell
+            PLANE_LEFT,                     ///< Left edge; blocks movement right into the cell
+            PLANE_BOTTOM,                   ///< Lower edge; blocks movement up into the cell
+            PLANE_RIGHT,                    ///< Right edge; blocks movement left into the cell
+            PLANE_SOLID,                    ///< All four edges
+            PLANE_SPECIAL,                  ///< Cells with a non-zero map code
+            PLANE_COUNT
+        };
+
+        /** Sides of a box which were stopped by a sweep */
+        enum HitFlags
+        {
+            HIT_NONE    = 0,
+            HIT_LEFT    = 1 << 0,           ///< Stopped moving left
+            HIT_RIGHT   = 1 << 1,           ///< Stopped moving right
+            HIT_TOP     = 1 << 2,           ///< Stopped moving up
+            HIT_BOTTOM  = 1 << 3            ///< Stopped moving down (landed)
+        };
+
+        /** @struct SweepQuery
+            A box to move through the map
+        */
+        struct SweepQuery
+        {
+            RectF       box;                ///< Current bounds of the box
+            Point2Df    delta;              ///< Requested movement
+        };
+
+        /** @struct SweepResult
+            Outcome of a sweep
+        */
+        struct SweepResult
+        {
+            Point2Df    delta;              ///< Movement allowed by the map
+            UInt32      hits;               ///< Combination of HitFlags
+        };
+
+        /** @struct GroundProbe
+            A horizontal line (usually the feet of an actor) to test for ground
+            below it
+        */
+        struct GroundProbe
+        {
+            Point2Df    position;           ///< Left end of the line
+            Real        width;              ///< Length of the line
+            Real        maxDistance;        ///< Distance below the line to search
+        };
+
+        /** @struct RayQuery
+            A ray to cast through the map
+        */
+        struct RayQuery
+        {
+            Point2Df    origin;             ///< Start of the ray
+            Point2Df    direction;          ///< Direction of the ray; need not be a unit vector
+            Real        maxDistance;        ///< Length of the ray
+        };
+
+        /** @struct RayHit
+            Outcome of a ray
+        */
+        struct RayHit
+        {
+            bool        isHit;              ///< Indicates the ray struck an edge
+            Point2D     cell;               ///< Cell whose edge was struck
+            Plane       face;               ///< Edge which was struck (PLANE_TOP, PLANE_LEFT, PLANE_BOTTOM or PLANE_RIGHT)
+            Real        distance;           ///< Distance to the edge, or the length of the ray if nothing was struck
+            Point2Df    point;              ///< Point where the ray stopped
+        };
+
+        /** @struct SightQuery
+            Two points to test for line of sight
+        */
+        struct SightQuery
+        {
+            Point2Df    from;
+            Point2Df    to;
+        };
+
+    private:
+        static const UInt32 WORD_BITS;      ///< Number of cells packed into each word
+
+        /** @class QueryJob
+            Answers a slice of a batch of rays or sight lines on a worker
+            thread
+        */
+        class QueryJob : public WorkItem
+        {
+        public:
+            const TileCollisionMap* map;
+            const RayQuery*         rays;       ///< Rays to cast, or null for sight lines
+            RayHit*                 hits;
+            const SightQuery*       sights;
+            UInt8*                  visible;
+            UInt32                  first;      ///< First query of the slice
+            UInt32                  count;      ///< Number of queries in the slice
+
+            /** Answer the queries */
+            void Execute();
+        };
+
+        Point2D                 mGridSize;  ///< Number of cells horizontally and vertically
+        Point2D                 mTileSize;  ///< Size of a cell, in pixels
+        UInt32                  mRowWords;  ///< Number of words in each row of a plane
+        std::vector< UInt32 >   mPlanes[ PLANE_COUNT ];
+
+        /** Get the first word of a row of a plane */
+        const UInt32* _getRow( Plane plane, Int row ) const
+        {
+            return &mPlanes[ plane ][ row * mRowWords ];
+        }
+
+        /** Check if any cell in a range of columns of a row is set */
+        bool _anyInRow( const UInt32* row, Int firstCol, Int lastCol ) const;
+
+        /** Get the first set cell in a range of columns of a row, or -1 */
+        Int _firstInRow( const UInt32* row, Int firstCol, Int lastCol ) const;
+
+        /** Get the last set cell in a range of columns of a row, or -1 */
+        Int _lastInRow( const UInt32* row, Int firstCol, Int lastCol ) const;
+
+        /** Set the bits of a cell from its codes */
+        void _setCell( Int x, Int y, SInt32 boundsCode, SInt32 mapCode );
+
+        /** Get the first and last columns covered by a horizontal range,
+            which may be outside the map
+        */
+        void _getColumns( Real left, Real right, Int& firstCol, Int& lastCol ) const;
+
+        /** Get the first and last rows covered by a vertical range, which may
+            be outside the map
+        */
+        void _getRows( Real top, Real bottom, Int& firstRow, Int& lastRow ) const;
+
+        /** Answer a batch of rays or sight lines, split across the work queue
+            when it is large enough.  The calling thread answers a slice too,
+            and returns once the whole batch is answered.
+        */
+        void _runBatch( const RayQuery* rays, RayHit* hits, const SightQuery* sights, UInt8* visible, UInt32 count ) const;
+
+    public:
+        /** Constructor */
+        TileCollisionMap();
+
+        /** Build the planes from the map of a tileset.  For a streamed map,
+            only the cells of the resident pages are seen; call Update as the
+            pages arrive.
+        */
+        void Build( const TileSet& tileSet );
+
+        /** Rebuild the planes for a block of cells, after the cells of the
+            tileset have changed
+        */
+        void Update( const TileSet& tileSet, Int x, Int y, Int w, Int h );
+
+        /** Apply the edits made to the cells of the tileset (see
+            TileSet::ApplyEdits.)  Only the word holding each cell is changed
+            in each plane.  Where a cell is edited more than once, the last
+            edit is kept.
+        */
+        void ApplyEdits( const TileSet::CellEdit* edits, UInt32 count );
+
+        /** Release the planes */
+        void Clear();
+
+        /** Get the number of cells horizontally and vertically */
+        const Point2D& GetGridSize() const      { return mGridSize; }
+
+        /** Get the size of a cell, in pixels */
+        const Point2D& GetTileSize() const      { return mTileSize; }
+
+        /** Check if a cell is set in a plane */
+        bool IsSet( Plane plane, Int x, Int y ) const;
+
+        /** Check if a point lies inside a solid cell */
+        bool IsSolid( const Point2Df& point ) const;
+
+        /** Check a batch of points against a plane
+            @param  points      Positions to test
+            @param  count       Number of points
+            @param  plane       Plane to test
+            @param  results     Receives 1 for each point in a set cell, or 0
+        */
+        void TestPoints( const Point2Df* points, UInt32 count, Plane plane, UInt8* results ) const;
+
+        /** Move a box through the map, stopping it at the first edge in its
+            way.  The horizontal movement is resolved first, then the vertical
+            movement from the new position.
+        */
+        SweepResult SweepBox( const RectF& box, const Point2Df& delta ) const;
+
+        /** Move a batch of boxes through the map (see SweepBox) */
+        void SweepBoxes( const SweepQuery* queries, UInt32 count, SweepResult* results ) const;
+
+        /** Find the distance from a horizontal line down to the nearest upper
+            edge below it.
+            @return The distance, or a negative value if there is no ground
+                    within the probe's maximum distance
+        */
+        Real ProbeGround( const GroundProbe& probe ) const;
+
+        /** Probe a batch of lines for ground (see ProbeGround) */
+        void ProbeGround( const GroundProbe* probes, UInt32 count, Real* distances ) const;
+
+        /** Cast a ray through the map, stepping from cell to cell (Amanatides
+            and Woo.)  The ray stops at the first edge which blocks movement
+            into a cell along it; the cell it starts in is not tested.
+        */
+        RayHit CastRay( const RayQuery& ray ) const;
+
+        /** Cast a batch of rays (see CastRay).  Large batches are shared
+            between the calling thread and the worker threads.
+        */
+        void CastRays( const RayQuery* rays, UInt32 count, RayHit* hits ) const;
+
+        /** Check if nothing blocks the line between two points */
+        bool HasLineOfSight( const Point2Df& from, const Point2Df& to ) const;
+
+        /** Test a batch of lines of sight (see CastRays)
+            @param  results     Receives 1 for each clear line, or 0
+        */
+        void TestSight( const SightQuery* queries, UInt32 count, UInt8* results ) const;
+
+    }; // class TileCollisionMap
+
+} // namespace PGE
+
+#endif // PGETILECOLLISION_H
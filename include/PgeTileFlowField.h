@@ -0,0 +1,228 @@
+/*! $Id$
+ *  @file   PgeTileFlowField.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Flow fields over a tile map, which lead every cell to a shared goal.
+ *
+ */
+
+#ifndef PGETILEFLOWFIELD_H
+#define PGETILEFLOWFIELD_H
+
+#include <vector>
+#include "PgeTypes.h"
+#include "PgePoint2D.h"
+#include "PgeWorkQueue.h"
+#include "PgeTileSet.h"
+
+namespace PGE
+{
+    /** @class TileFlowField
+        The cost from every cell of a map to a goal, and the step each cell
+        should take towards it.  Fields are made by TileFlowFieldCache.
+
+        @remarks
+            Any number of units heading for the same goal read the same field,
+            so moving a crowd costs one integration of the map rather than a
+            path search for each unit.
+    */
+    class _PgeExport TileFlowField
+    {
+        friend class TileFlowFieldCache;
+
+    public:
+        static const UInt32 NO_PATH;        ///< Cost of a cell which can not reach the goal
+
+    private:
+        Point2D                 mGoal;      ///< Cell the field leads to
+        Point2D                 mGridSize;  ///< Number of cells horizontally and vertically
+        std::vector< UInt32 >   mCosts;     ///< Cost from each cell to the goal
+        std::vector< UInt8 >    mSteps;     ///< Direction of the step from each cell, or STEP_NONE
+        std::vector< UInt8 >    mChunks;    ///< 1 for each chunk the field reached
+
+        static const Int    STEP_X[ 9 ];
+        static const Int    STEP_Y[ 9 ];
+        static const UInt8  STEP_NONE;
+
+        TileFlowField( const Point2D& goal, const Point2D& gridSize );
+
+    public:
+        /** Get the cell the field leads to */
+        const Point2D& GetGoal() const          { return mGoal; }
+
+        /** Get the cost from a cell to the goal, or NO_PATH */
+        UInt32 GetCost( Int x, Int y ) const
+        {
+            if ( x < 0 || y < 0 || x >= mGridSize.x || y >= mGridSize.y )
+                return NO_PATH;
+            return mCosts[ y * mGridSize.x + x ];
+        }
+
+        /** Get the offset of the neighbour a cell should move to, or (0, 0)
+            at the goal and in cells which can not reach it
+        */
+        Point2D GetStep( Int x, Int y ) const
+        {
+            if ( x < 0 || y < 0 || x >= mGridSize.x || y >= mGridSize.y )
+                return Point2D( 0, 0 );
+            UInt8 step = mSteps[ y * mGridSize.x + x ];
+            return Point2D( STEP_X[ step ], STEP_Y[ step ] );
+        }
+
+        /** Get the direction a cell should move in, as a unit vector, or
+            (0, 0) at the goal and in cells which can not reach it
+        */
+        Point2Df GetDirection( Int x, Int y ) const;
+
+        /** Check if the field reached any cell of a chunk (see
+            TileSet::CHUNK_SIZE)
+        */
+        bool IsChunkReached( UInt32 chunk ) const   { return chunk < mChunks.size() && mChunks[ chunk ]; }
+
+    }; // class TileFlowField
+
+    /** @class TileFlowFieldCache
+        Makes flow fields for the goals units are heading to, and keeps the
+        most recently used of them.
+
+        @remarks
+            Each field is integrated with a Dijkstra wavefront from the goal,
+            which records, for each cell, the neighbour it was reached from.
+            Moves may be diagonal, but never across the corner of a solid cell
+            (a cell whose bounds code has all four edges.)  The cost of moving
+            into a cell is the straight or diagonal cost times the cost of the
+            cell's map code (see SetCodeCost), so roads and swamps can be made
+            cheaper or dearer to cross.
+
+        @remarks
+            Once the cache is full, the field used least recently is released
+            to make room.  A field takes five bytes per cell of the map.
+
+        @remarks
+            Cell edits (see ApplyEdits) mark the chunks holding the cells.  Only
+            the fields which reached those chunks are made again, the next time
+            they are requested.  Fields may be made on the work queue (see
+            RequestField), in which case edits first wait for them.
+    */
+    class _PgeExport TileFlowFieldCache
+    {
+    public:
+        static const UInt32 STRAIGHT_COST;  ///< Cost of moving to a horizontal or vertical neighbour
+        static const UInt32 DIAGONAL_COST;  ///< Cost of moving to a diagonal neighbour
+
+    private:
+        /** @class FieldJob
+            Integrates a field on a worker thread
+        */
+        class FieldJob : public WorkItem
+        {
+        public:
+            const TileFlowFieldCache*   cache;
+            TileFlowField*              field;  ///< Field being made
+
+            /** Integrate the field */
+            void Execute();
+        };
+
+        /** @struct FieldSlot
+            A goal held in the cache
+        */
+        struct FieldSlot
+        {
+            Point2D         goal;
+            TileFlowField*  field;          ///< Finished field, if any
+            FieldJob*       job;            ///< Field being made, if any
+            UInt32          lastUsed;       ///< Use serial when the field was last requested
+            bool            isStale;        ///< Indicates the cells under the field have changed
+        };
+        typedef std::vector< FieldSlot > SlotArray;
+
+        UInt32                  mCapacity;  ///< Number of fields kept
+        Point2D                 mGridSize;  ///< Number of cells horizontally and vertically
+        Point2D                 mChunkGridSize; ///< Number of chunks horizontally and vertically
+        std::vector< UInt8 >    mCodes;     ///< Map code of each cell
+        std::vector< UInt8 >    mSolid;     ///< 1 for each solid cell
+        UInt8                   mCodeCosts[ 256 ];  ///< Cost of crossing a cell of each map code; 0 is impassable
+        SlotArray               mSlots;
+        UInt32                  mNextUse;
+
+        TileFlowFieldCache( const TileFlowFieldCache& );
+        TileFlowFieldCache& operator=( const TileFlowFieldCache& );
+
+        /** Integrate a field from its goal */
+        void _integrate( TileFlowField& field ) const;
+
+        /** Find the slot of a goal, or -1 */
+        Int _findSlot( const Point2D& goal ) const;
+
+        /** Get a slot for a new goal, releasing the least recently used field
+            if the cache is full
+        */
+        FieldSlot& _addSlot( const Point2D& goal );
+
+        /** Take the field from a finished job */
+        void _collectJob( FieldSlot& slot );
+
+        /** Wait for a job, or cancel it if it has not started */
+        void _finishJob( FieldSlot& slot, bool isCancelled );
+
+        /** Wait for every field being made, and take the results */
+        void _finishJobs();
+
+        /** Set a cell.  If it changed, the fields which reached its chunk,
+            or the chunk of any of its neighbours, are marked out of date.
+        */
+        void _setCell( Int x, Int y, SInt32 boundsCode, SInt32 mapCode );
+
+    public:
+        /** Constructor
+            @param  capacity    Number of fields to keep
+        */
+        TileFlowFieldCache( UInt32 capacity = 8 );
+        /** Destructor.  Waits for any fields being made. */
+        ~TileFlowFieldCache();
+
+        /** Set the cost of crossing cells with a map code.  The default is 1
+            for every code; 0 makes the cells impassable.  Fields already made
+            are made again when next requested.
+        */
+        void SetCodeCost( UInt8 mapCode, UInt8 cost );
+
+        /** Read the cells of the map of a tileset, and release every field */
+        void Build( const TileSet& tileSet );
+
+        /** Read a block of cells again, after the cells of the tileset have
+            changed
+        */
+        void Update( const TileSet& tileSet, Int x, Int y, Int w, Int h );
+
+        /** Apply the edits made to the cells of the tileset (see
+            TileSet::ApplyEdits)
+        */
+        void ApplyEdits( const TileSet::CellEdit* edits, UInt32 count );
+
+        /** Release every field and the cells */
+        void Clear();
+
+        /** Get the field leading to a goal, making it on the calling thread if
+            it is not in the cache, or is out of date.  The field remains
+            valid until the cache is next changed or asked for another field.
+            @return The field, or null if the goal is outside the map
+        */
+        const TileFlowField* GetField( const Point2D& goal );
+
+        /** Get the field leading to a goal without waiting.  If it is not in
+            the cache, or is out of date, it is made on the work queue.
+            @return The field; the out of date field while it is being made
+                    again; or null until it is first ready.
+        */
+        const TileFlowField* RequestField( const Point2D& goal );
+
+        /** Get the number of goals in the cache */
+        UInt32 GetFieldCount() const            { return mSlots.size(); }
+
+    }; // class TileFlowFieldCache
+
+} // namespace PGE
+
+#endif // PGETILEFLOWFIELD_H
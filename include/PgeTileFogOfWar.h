@@ -0,0 +1,222 @@
+/*! $Id$
+ *  @file   PgeTileFogOfWar.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Field of view of observers on a tile map, merged into the cells
+ *          each team can see and has seen.
+ *
+ */
+
+#ifndef PGETILEFOGOFWAR_H
+#define PGETILEFOGOFWAR_H
+
+#include <vector>
+#include "PgeTypes.h"
+#include "PgePoint2D.h"
+#include "PgeTileSet.h"
+
+namespace PGE
+{
+    /** @class TileFogOfWar
+        Finds the cells each observer can see, and keeps, for each team, the
+        cells seen by any of its observers and the cells it has ever seen.
+
+        @remarks
+            Each observer's view is found with symmetric shadowcasting, within
+            a circle of its radius.  Solid cells (bounds codes with all four
+            edges) block sight, but are seen themselves, so walls show at the
+            edge of the view.  Sight is symmetric: an observer at A sees B
+            exactly when one at B would see A.
+
+        @remarks
+            The views and the team maps are bitsets of one bit per cell,
+            packed 32 cells to a word along the rows as in TileCollisionMap.
+            An observer's view covers only the words around it, so merging the
+            observers of a team is a word-wide OR of their rows, and only the
+            area around the observers which changed is merged again.
+
+        @remarks
+            Observers are only cast again when they move to another cell or
+            change radius, or when a cell within their reach changes between
+            solid and open.  The changes are gathered until Refresh, which
+            should be called once per frame.
+
+        @remarks
+            The map is drawn hiding the cells a team has never seen by giving
+            it to TileSet::SetFogOfWar.  Each chunk (see TileSet::CHUNK_SIZE)
+            carries a serial which changes whenever more of its cells are
+            seen, so the tileset rebuilds only those chunks.
+    */
+    class _PgeExport TileFogOfWar
+    {
+    public:
+        static const UInt32 NO_OBSERVER;    ///< Handle which refers to no observer
+
+    private:
+        static const UInt32 WORD_BITS;      ///< Number of cells packed into each word
+
+        /** @struct Observer
+            A unit which sees the cells around it
+        */
+        struct Observer
+        {
+            Point2D                 cell;       ///< Cell holding the observer
+            UInt32                  radius;     ///< Furthest distance seen, in cells
+            UInt32                  team;       ///< Team the observer belongs to
+            bool                    isActive;   ///< Indicates the handle is in use
+            bool                    isDirty;    ///< Indicates the view must be cast again
+            bool                    isCast;     ///< Indicates the view below has been cast
+            Int                     top;        ///< Map row of the first row of the view
+            Int                     bottom;     ///< Map row of the last row of the view
+            Int                     firstWord;  ///< Map word of the first word of each row of the view
+            UInt32                  rowWords;   ///< Number of words in each row of the view
+            std::vector< UInt32 >   bits;       ///< Cells seen, in 2 * radius + 1 rows
+        };
+        typedef std::vector< Observer > ObserverArray;
+
+        /** @struct Team
+            The merged view of a team's observers
+        */
+        struct Team
+        {
+            std::vector< UInt32 >   visible;    ///< Cells seen by any observer now
+            std::vector< UInt32 >   explored;   ///< Cells ever seen
+            std::vector< UInt32 >   chunkSerials;   ///< Serial of the last change of the explored cells of each chunk
+            bool                    isDirty;    ///< Indicates the area below must be merged again
+            Int                     dirtyTop;   ///< First row to merge
+            Int                     dirtyBottom;    ///< Last row to merge
+            Int                     dirtyFirst; ///< First word of each row to merge
+            Int                     dirtyLast;  ///< Last word of each row to merge
+        };
+        typedef std::vector< Team > TeamArray;
+
+        /** @struct ScanRow
+            A row of a quadrant being scanned, between two slopes.  The slopes
+            are kept as fractions so the scan is exact.
+        */
+        struct ScanRow
+        {
+            Int         depth;              ///< Distance of the row from the observer
+            Int         startNum;           ///< Slope of the start of the row
+            Int         startDen;
+            Int         endNum;             ///< Slope of the end of the row
+            Int         endDen;
+        };
+
+        Point2D                 mGridSize;      ///< Number of cells horizontally and vertically
+        Point2D                 mChunkGridSize; ///< Number of chunks horizontally and vertically
+        UInt32                  mRowWords;      ///< Number of words in each row of a bitset of the map
+        std::vector< UInt32 >   mOpaque;        ///< Cells which block sight
+        ObserverArray           mObservers;
+        std::vector< UInt32 >   mFreeObservers; ///< Handles which may be reused
+        TeamArray               mTeams;
+        UInt32                  mSerial;
+        std::vector< ScanRow >  mScanRows;      ///< Working storage of the shadowcasting
+        std::vector< UInt8 >    mChunkTouched;  ///< Working storage of Refresh
+        std::vector< UInt32 >   mTouchedChunks;
+
+        TileFogOfWar( const TileFogOfWar& );
+        TileFogOfWar& operator=( const TileFogOfWar& );
+
+        /** Check if a cell blocks sight.  Cells outside the map do. */
+        bool _isOpaque( Int x, Int y ) const
+        {
+            if ( x < 0 || y < 0 || x >= mGridSize.x || y >= mGridSize.y )
+                return true;
+            return ( mOpaque[ y * mRowWords + x / WORD_BITS ] >> ( x % WORD_BITS ) ) & 1;
+        }
+
+        /** Set whether a cell blocks sight, marking the observers which can
+            reach it if it changed
+        */
+        void _setCell( Int x, Int y, SInt32 boundsCode );
+
+        /** Add the view of an observer to the area its team must merge */
+        void _touchTeam( const Observer& observer );
+
+        /** Find the cells an observer sees */
+        void _castObserver( Observer& observer );
+
+        /** Merge the views of a team's observers over its dirty area */
+        void _mergeTeam( Team& team, UInt32 teamIndex );
+
+    public:
+        /** Constructor
+            @param  teamCount   Number of teams
+        */
+        TileFogOfWar( UInt32 teamCount = 1 );
+
+        /** Read the cells of the map of a tileset.  Every team's explored
+            cells are forgotten, and the observers already added are cast.
+            For a streamed map, only the cells of the resident pages are seen;
+            call Update as the pages arrive.
+        */
+        void Build( const TileSet& tileSet );
+
+        /** Read a block of cells again, after the cells of the tileset have
+            changed.  The views change at the next Refresh.
+        */
+        void Update( const TileSet& tileSet, Int x, Int y, Int w, Int h );
+
+        /** Apply the edits made to the cells of the tileset (see
+            TileSet::ApplyEdits.)  The views change at the next Refresh.
+        */
+        void ApplyEdits( const TileSet::CellEdit* edits, UInt32 count );
+
+        /** Release the cells, the team maps and every observer */
+        void Clear();
+
+        /** Get the number of cells horizontally and vertically */
+        const Point2D& GetGridSize() const      { return mGridSize; }
+
+        /** Get the number of teams */
+        UInt32 GetTeamCount() const             { return mTeams.size(); }
+
+        /** Add an observer
+            @param  team    Team the observer belongs to
+            @param  cell    Cell holding the observer
+            @param  radius  Furthest distance seen, in cells
+            @return Handle of the observer, or NO_OBSERVER if there is no such
+                    team
+        */
+        UInt32 AddObserver( UInt32 team, const Point2D& cell, UInt32 radius );
+
+        /** Move an observer to another cell */
+        void MoveObserver( UInt32 observer, const Point2D& cell );
+
+        /** Change how far an observer sees */
+        void SetObserverRadius( UInt32 observer, UInt32 radius );
+
+        /** Remove an observer.  Its handle may be reused by a later observer. */
+        void RemoveObserver( UInt32 observer );
+
+        /** Cast the observers which have changed, and merge them into their
+            teams' maps.  Call once per frame, after moving the observers.
+        */
+        void Refresh();
+
+        /** Check if an observer saw a cell at the last Refresh */
+        bool CanSee( UInt32 observer, Int x, Int y ) const;
+
+        /** Check if any observer of a team saw a cell at the last Refresh */
+        bool IsVisible( UInt32 team, Int x, Int y ) const;
+
+        /** Check if a team has ever seen a cell */
+        bool IsExplored( UInt32 team, Int x, Int y ) const;
+
+        /** Get the cells a team has ever seen in a block, as bitsets of
+            (size.x + 31) / 32 words for each row, with the first cell of each
+            row in the lowest bit of its first word
+        */
+        void GetExploredBits( UInt32 team, const Point2D& origin, const Point2D& size, std::vector< UInt32 >& bits ) const;
+
+        /** Get the serial of the last change of the cells a team has seen in
+            a chunk (see TileSet::CHUNK_SIZE), or 0 if it has seen none of them
+        */
+        UInt32 GetChunkSerial( UInt32 team, UInt32 chunk ) const;
+
+    }; // class TileFogOfWar
+
+} // namespace PGE
+
+#endif // PGETILEFOGOFWAR_H
@@ -58,9 +58,15 @@ namespace PGE
         /** Set the position and size of the display */
         virtual void SetWindowSize( PGE::UInt32 w, PGE::UInt32 h );
 
-        /** Load data from an xml file generated by TileStudio */
+        /** Load data from an xml file generated by TileStudio.  If the map
+            has been compiled (a .pgemap file beside the xml file), the
+            compiled map is loaded instead.
+        */
         virtual void LoadTileStudioXML( const String& fileName );
 
+        /** Load a compiled (.pgemap) map file */
+        virtual bool LoadTileMapFile( const String& fileName );
+
     protected:
 
         String      mTextureName;
@@ -74,6 +80,12 @@ namespace PGE
         /** Read a project block from a tile map file */
         void ReadProject( TiXmlNode* projNode, const String& baseDir );
 
+        /** Log the map statistics and set up the texture atlas once the
+            scene has been read.
+            @param  fileName    Name of the map file, which the atlas is named after
+        */
+        void PrepareScene( const String& fileName );
+
     private:
         GLuint      mTexID;
     };
@@ -0,0 +1,225 @@
+/*! $Id$
+ *  @file   PgeTileLightMap.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Colored light spread from point lights through the open cells of a
+ *          tile map, kept up to date as lights move and cells change.
+ *
+ */
+
+#ifndef PGETILELIGHTMAP_H
+#define PGETILELIGHTMAP_H
+
+#include <vector>
+#include <map>
+#include "PgeTypes.h"
+#include "PgePoint2D.h"
+#include "PgeColor.h"
+#include "PgeTileSet.h"
+
+namespace PGE
+{
+    /** @class TileLightMap
+        The light reaching each cell of a map from a set of point lights, for
+        the red, green and blue channels separately.
+
+        @remarks
+            Light spreads from each light's cell to the horizontal and vertical
+            neighbours, losing the falloff (see SetFalloff) with each step, so
+            a light of level 255 with a falloff of 16 reaches 15 cells.  Where
+            light from several lights meets, each channel keeps the brightest.
+            Solid cells (bounds codes with all four edges) are lit, so walls
+            show the light falling on them, but the light does not pass
+            through them.  A light inside a solid cell only lights its own cell.
+
+        @remarks
+            Changes to the lights and cells are gathered until Propagate, which
+            updates only the cells they affect.  Light is first removed
+            outwards from each changed cell, as far as the cells it lit, then
+            spread back in from the edge of the removed area and from the
+            lights inside it.  Moving a light costs the cells within its reach
+            rather than the whole map, so Propagate can be called every frame.
+
+        @remarks
+            The map is drawn lit by giving it to TileSet::SetLightMap.  Each
+            chunk (see TileSet::CHUNK_SIZE) carries a serial which changes
+            whenever the light of its cells changes, so the tileset recolors
+            only those chunks.
+    */
+    class _PgeExport TileLightMap
+    {
+    public:
+        static const UInt32 NO_LIGHT;       ///< Handle which refers to no light
+
+    private:
+        /** Flags of each cell */
+        enum CellFlags
+        {
+            CELL_SOLID      = 1 << 0,       ///< Light does not pass through the cell
+            CELL_PENDING    = 1 << 1,       ///< The cell changed since the last Propagate
+            CELL_WAS_SOLID  = 1 << 2        ///< The cell was solid at the last Propagate
+        };
+
+        /** @struct LightSource
+            A point light
+        */
+        struct LightSource
+        {
+            Point2D     cell;               ///< Cell holding the light
+            Color       color;              ///< Level of the light in each channel
+            bool        isActive;           ///< Indicates the handle is in use
+        };
+        typedef std::vector< LightSource > LightArray;
+        typedef std::multimap< UInt32, UInt32 > CellLightMap;
+
+        /** @struct DarkenEntry
+            A cell whose light is being removed, and the level it had
+        */
+        struct DarkenEntry
+        {
+            UInt32      cell;
+            UInt8       level;
+        };
+
+        Point2D                 mGridSize;      ///< Number of cells horizontally and vertically
+        Point2D                 mChunkGridSize; ///< Number of chunks horizontally and vertically
+        UInt8                   mFalloff;       ///< Level lost with each step
+        Color                   mAmbient;       ///< Least light of every cell
+        std::vector< UInt8 >    mFlags;         ///< CellFlags of each cell
+        std::vector< UInt8 >    mLevels[ 3 ];   ///< Light of each cell, in each channel
+        std::vector< UInt8 >    mEmitted[ 3 ];  ///< Level given off in each cell by its lights, in each channel
+        LightArray              mLights;
+        std::vector< UInt32 >   mFreeLights;    ///< Handles which may be reused
+        CellLightMap            mCellLights;    ///< Lights held in each cell
+        std::vector< UInt32 >   mPending;       ///< Cells which changed since the last Propagate
+        std::vector< UInt32 >   mChunkSerials;  ///< Serial of the last change of light in each chunk
+        std::vector< UInt8 >    mChunkTouched;  ///< 1 for each chunk whose light changed in this Propagate
+        std::vector< UInt32 >   mTouchedChunks;
+        UInt32                  mSerial;
+
+        // Working storage of Propagate
+        std::vector< DarkenEntry >  mDarkenQueue;
+        std::vector< UInt32 >   mSpreadQueue;
+        std::vector< UInt8 >    mPendingLevels; ///< New emitted level of each pending cell, in each channel
+
+        TileLightMap( const TileLightMap& );
+        TileLightMap& operator=( const TileLightMap& );
+
+        /** Mark a cell as changed */
+        void _markCell( UInt32 cell );
+
+        /** Mark the cell holding a light as changed, if it is inside the map */
+        void _markLight( const LightSource& light );
+
+        /** Set whether a cell is solid */
+        void _setCell( Int x, Int y, SInt32 boundsCode );
+
+        /** Set the light of a cell in a channel, and note the chunks whose
+            corners it touches
+        */
+        void _setLevel( std::vector< UInt8 >& levels, UInt32 cell, UInt8 level );
+
+        /** Bring one channel up to date with the pending cells */
+        void _propagateChannel( UInt32 channel );
+
+        /** Remove the light of every cell, and spread it again from all of
+            the lights
+        */
+        void _relightAll();
+
+    public:
+        /** Constructor */
+        TileLightMap();
+
+        /** Read the cells of the map of a tileset, and light them from the
+            lights already added.  For a streamed map, only the cells of the
+            resident pages are seen; call Update as the pages arrive.
+        */
+        void Build( const TileSet& tileSet );
+
+        /** Read a block of cells again, after the cells of the tileset have
+            changed.  The light changes at the next Propagate.
+        */
+        void Update( const TileSet& tileSet, Int x, Int y, Int w, Int h );
+
+        /** Apply the edits made to the cells of the tileset (see
+            TileSet::ApplyEdits.)  The light changes at the next Propagate.
+        */
+        void ApplyEdits( const TileSet::CellEdit* edits, UInt32 count );
+
+        /** Release the cells and every light */
+        void Clear();
+
+        /** Get the number of cells horizontally and vertically */
+        const Point2D& GetGridSize() const      { return mGridSize; }
+
+        /** Set the level each channel loses with each step from a light.  All
+            of the light is spread again.
+        */
+        void SetFalloff( UInt8 falloff );
+
+        /** Get the level each channel loses with each step from a light */
+        UInt8 GetFalloff() const                { return mFalloff; }
+
+        /** Set the least light of every cell, so that unlit areas are not
+            black.  Only the red, green and blue are used.
+        */
+        void SetAmbient( const Color& ambient );
+
+        /** Get the least light of every cell */
+        const Color& GetAmbient() const         { return mAmbient; }
+
+        /** Add a light
+            @param  cell    Cell holding the light
+            @param  color   Level of the light in the cell, in each channel
+            @return Handle of the light
+        */
+        UInt32 AddLight( const Point2D& cell, const Color& color );
+
+        /** Move a light to another cell */
+        void MoveLight( UInt32 light, const Point2D& cell );
+
+        /** Change the color of a light */
+        void SetLightColor( UInt32 light, const Color& color );
+
+        /** Remove a light.  Its handle may be reused by a later light. */
+        void RemoveLight( UInt32 light );
+
+        /** Get the number of lights */
+        UInt32 GetLightCount() const            { return mLights.size() - mFreeLights.size(); }
+
+        /** Update the light of the cells affected by the changes made since
+            the last call.  Call once per frame, after moving the lights and
+            before drawing.
+        */
+        void Propagate();
+
+        /** Get the light of a cell, including the ambient light, as of the
+            last Propagate.  Cells outside the map have only the ambient light.
+        */
+        Color GetLight( Int x, Int y ) const;
+
+        /** Get the light at the corners of a block of cells, each the average
+            of the four cells sharing the corner, so that the light is smoothed
+            across the tiles when used as vertex colors.
+            @param  origin  First cell of the block
+            @param  size    Number of cells in the block
+            @param  corners Receives (size.x + 1) * (size.y + 1) colors, in
+                            row order
+        */
+        void GetCornerLights( const Point2D& origin, const Point2D& size, std::vector< Color >& corners ) const;
+
+        /** Get the serial of the last change of light at the corners of the
+            cells of a chunk (see TileSet::CHUNK_SIZE), or 0 if there is no
+            such chunk
+        */
+        UInt32 GetChunkSerial( UInt32 chunk ) const
+        {
+            return chunk < mChunkSerials.size() ? mChunkSerials[ chunk ] : 0;
+        }
+
+    }; // class TileLightMap
+
+} // namespace PGE
+
+#endif // PGETILELIGHTMAP_H
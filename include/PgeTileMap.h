@@ -99,13 +99,22 @@ namespace PGE
         friend class TileMapScene;
 
         /** @struct Tile
-            Store values pertaining to the tile.
+            Store values pertaining to the tile.  The fields are packed the
+            same way as the cells of a TileSet (see TileSet::TileCellArray), so
+            a tile takes 4 bytes.
         */
         struct Tile
         {
-            SInt32  tileIndex;              ///< Index to the tile in the display list
-            UInt32  boundsCode;             ///< Code defining boundary of the cell
-            UInt32  mapCode;                ///< Indicates special tiles in the map
+            SInt16  tileIndex;              ///< Index to the tile in the display list
+            UInt8   boundsCode;             ///< Code defining boundary of the cell
+            UInt8   mapCode;                ///< Indicates special tiles in the map
+
+            /** Set the values of the tile.  Values which can not be stored
+                are clamped.
+                @return False if the tile had to be clamped
+            */
+            bool Set( SInt32 tile, SInt32 bounds, SInt32 map );
+
             //UInt32  vertexIndices[ 4 ];     ///< Indices for the posiions of the tile corners
             //UInt32  colorIndices[ 4 ];      ///< Indices for the colors of the tile corners
             //UInt32  textureIndices[ 4 ];    ///< Indices for the texture coordinates of the tile corners
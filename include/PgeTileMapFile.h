@@ -0,0 +1,256 @@
+/*! $Id$
+ *  @file   PgeTileMapFile.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Compiled binary form of a Tile Studio map, which can be used in
+ *          place instead of being parsed.
+ *
+ */
+
+#ifndef PGETILEMAPFILE_H
+#define PGETILEMAPFILE_H
+
+#include "PgeTypes.h"
+#include "PgeMappedFile.h"
+#include "PgeTileSet.h"
+
+namespace PGE
+{
+    /** @class TileMapFile
+        Reads a compiled tile map (.pgemap) file.
+
+        @remarks
+            The file holds the same information as the Tile Studio xml export,
+            but the maps are already stored as runs of cells (see
+            TileSet::EncodeCells), laid out exactly as the tileset keeps them in
+            memory.  Loading the file is just mapping it and checking the
+            header; the tilesets then point straight into the file.
+
+        @remarks
+            All values are 32-bit little-endian, and every block starts on a
+            4 byte boundary.  Offsets are in bytes from the start of the file.
+            The header records the size of a packed cell and of the span
+            structure, so a file written by a build with different type sizes
+            is rejected rather than misread.  The cells are stored as two
+            arrays, the tiles and the codes (see TileSet::TileCellArray.)
+
+        @remarks
+            A large map may be stored as pages (square blocks of cells, each
+            encoded as runs of its own), so that it can be streamed in around
+            the view rather than held in memory (see TileMapPager.)  The page
+            data follows everything else in the file, and only the part before
+            it, the index, is kept in memory when the file can not be mapped.
+
+        @remarks
+            Files are written from the xml export with ConvertTileStudioXML, or
+            with the MapCompiler tool.
+    */
+    class _PgeExport TileMapFile
+    {
+    public:
+        static const UInt32 MAGIC;          ///< Identifies a compiled map file ("PGEM")
+        static const UInt32 VERSION;        ///< Version of the layout written by this build
+
+        /** @struct Header
+            Start of the file
+        */
+        struct Header
+        {
+            UInt32  magic;                  ///< Always MAGIC
+            UInt32  version;                ///< Layout version
+            UInt32  fileSize;               ///< Size of the whole file
+            UInt32  indexSize;              ///< Size of the start of the file holding everything but the page data
+            UInt32  cellSize;               ///< Bytes per packed cell (a tile and its codes)
+            UInt32  spanSize;               ///< Size of a TileSet::TileSpan
+            UInt32  tileSetCount;           ///< Number of tileset records
+            UInt32  tileSetOffset;          ///< Offset of the tileset records
+        };
+
+        /** @struct TileSetRecord
+            Settings of a tileset, and where to find its sequences and maps
+        */
+        struct TileSetRecord
+        {
+            UInt32  index;                  ///< Index of the tileset
+            UInt32  identifierOffset;       ///< Offset of the ID name
+            UInt32  imageNameOffset;        ///< Offset of the image name, relative to the map file
+            UInt32  tileWidth;
+            UInt32  tileHeight;
+            UInt32  gridWidth;              ///< Number of tiles horizontally in the image
+            UInt32  gridHeight;             ///< Number of tiles vertically in the image
+            UInt32  overlap;
+            UInt32  tileCount;
+            UInt32  sequenceCount;          ///< Number of sequence slots in the tileset
+            UInt32  sequenceListCount;      ///< Number of sequence records
+            UInt32  sequenceOffset;         ///< Offset of the sequence records
+            UInt32  mapCount;               ///< Number of map records
+            UInt32  mapOffset;              ///< Offset of the map records
+        };
+
+        /** @struct SequenceRecord
+            A tile sequence
+        */
+        struct SequenceRecord
+        {
+            UInt32  index;                  ///< Index of the sequence
+            UInt32  frameCount;             ///< Number of frames
+            UInt32  frameOffset;            ///< Offset of the frame records
+        };
+
+        /** @struct FrameRecord
+            A frame of a sequence
+        */
+        struct FrameRecord
+        {
+            SInt32  delay;
+            SInt32  tileNumber;             ///< Index of the tile used for the frame
+        };
+
+        /** @struct MapRecord
+            A map, stored as runs of cells
+        */
+        struct MapRecord
+        {
+            UInt32  width;                  ///< Number of columns
+            UInt32  height;                 ///< Number of rows
+            UInt32  emptyCells;             ///< Number of cells with no tile
+            UInt32  rowSpanOffset;          ///< Offset of the first span of each row (height + 1 values)
+            UInt32  spanCount;              ///< Number of spans
+            UInt32  spanOffset;             ///< Offset of the spans
+            UInt32  cellCount;              ///< Number of stored cells
+            UInt32  tileOffset;             ///< Offset of the tiles of the stored cells
+            UInt32  codeOffset;             ///< Offset of the codes of the stored cells
+            UInt32  pageSize;               ///< Number of cells along each side of a page, a multiple of TileSet::CHUNK_SIZE, or 0 if the map is not paged
+            UInt32  pageOffset;             ///< Offset of the page records, in row order
+        };
+
+        /** @struct PageRecord
+            A page of a paged map.  The page data holds the first span of each
+            row of the page, then the spans, then the tiles and codes of the
+            cells (see PageLayout.)  Columns in the spans are relative to the
+            left edge of the page.
+        */
+        struct PageRecord
+        {
+            UInt32  dataOffset;             ///< Offset of the page data
+            UInt32  dataSize;               ///< Size of the page data
+            UInt32  spanCount;              ///< Number of spans in the page
+            UInt32  cellCount;              ///< Number of stored cells in the page
+        };
+
+        /** @struct PageLayout
+            Offsets of the blocks in the data of a page, from the start of the
+            page data
+        */
+        struct PageLayout
+        {
+            UInt32  spanOffset;             ///< Offset of the spans
+            UInt32  tileOffset;             ///< Offset of the tiles
+            UInt32  codeOffset;             ///< Offset of the codes
+            UInt32  size;                   ///< Size of the page data
+        };
+
+    private:
+        MappedFilePtr   mFile;
+        const Header*   mHeader;
+        String          mFileName;
+
+        /** Get an array in the file, or null if it does not fit */
+        template < class T >
+        const T* _getArray( UInt32 offset, UInt32 count ) const
+        {
+            if ( !mHeader || offset % 4 || offset > mHeader->indexSize ||
+                 count > ( mHeader->indexSize - offset ) / sizeof( T ) )
+                return 0;
+            return reinterpret_cast< const T* >( mFile->GetData() + offset );
+        }
+
+    public:
+        /** Constructor */
+        TileMapFile();
+        /** Destructor */
+        ~TileMapFile();
+
+        /** Open a compiled map file and check its header */
+        bool Load( const String& fileName );
+
+        /** Release the file.  Tilesets read from the file keep it open until
+            they are finished with it.
+        */
+        void Close();
+
+        /** Check if a file is loaded */
+        bool IsLoaded() const                   { return mHeader != 0; }
+
+        /** Get the number of tilesets */
+        UInt32 GetTileSetCount() const;
+
+        /** Get a tileset record, or null if it is out of range */
+        const TileSetRecord* GetTileSet( UInt32 tileSetNum ) const;
+
+        /** Get the sequence records of a tileset */
+        const SequenceRecord* GetSequences( const TileSetRecord& tileSet ) const;
+
+        /** Get the frames of a sequence */
+        const FrameRecord* GetFrames( const SequenceRecord& seq ) const;
+
+        /** Get a map of a tileset, or null if the tileset does not have the
+            map, or its data is not valid.
+        */
+        const MapRecord* GetMap( const TileSetRecord& tileSet, UInt32 mapIndex ) const;
+
+        /** Get the number of pages horizontally and vertically in a paged map */
+        static Point2D GetPageGridSize( const MapRecord& map );
+
+        /** Get the page records of a paged map */
+        const PageRecord* GetPages( const MapRecord& map ) const;
+
+        /** Get the layout of the data of a page
+            @param  rows        Number of rows in the page
+            @param  page        Page record
+        */
+        static PageLayout GetPageLayout( UInt32 rows, const PageRecord& page );
+
+        /** Check that a set of runs stays inside the grid and the cell array
+            @param  rowSpans    First span of each row, followed by the span count
+            @param  size        Number of columns and rows
+            @param  spans       Runs of cells
+            @param  spanCount   Number of runs
+            @param  cellCount   Number of stored cells
+        */
+        static bool ValidateRuns( const UInt32* rowSpans, const Point2D& size, const TileSet::TileSpan* spans, UInt32 spanCount, UInt32 cellCount );
+
+        /** Get the first span of each row of a map */
+        const UInt32* GetRowSpans( const MapRecord& map ) const;
+        /** Get the spans of a map */
+        const TileSet::TileSpan* GetSpans( const MapRecord& map ) const;
+        /** Get the stored cells of a map.  The arrays are null if they do not
+            fit in the file.
+        */
+        TileSet::TileCellList GetCells( const MapRecord& map ) const;
+
+        /** Get a string from the file */
+        String GetString( UInt32 offset ) const;
+
+        /** Get the resource name of the file */
+        const String& GetFileName() const           { return mFileName; }
+
+        /** Get the underlying file, which the tilesets share */
+        const MappedFilePtr& GetMappedFile() const  { return mFile; }
+
+        /** Compile a Tile Studio xml export into a map file
+            @param  xmlFileName     Resource name of the xml export
+            @param  outFileName     Path of the file to write
+            @param  pageSize        Store maps larger than this many cells on
+                                    a side as pages of this size, for
+                                    streaming.  The size is rounded up to a
+                                    multiple of TileSet::CHUNK_SIZE.  Use 0 to
+                                    keep every map whole.
+        */
+        static bool ConvertTileStudioXML( const String& xmlFileName, const String& outFileName, UInt32 pageSize = 0 );
+
+    }; // class TileMapFile
+
+} // namespace PGE
+
+#endif // PGETILEMAPFILE_H
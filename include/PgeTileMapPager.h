@@ -0,0 +1,155 @@
+/*! $Id$
+ *  @file   PgeTileMapPager.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Streams the pages of a large tile map in and out of memory around
+ *          the view.
+ *
+ */
+
+#ifndef PGETILEMAPPAGER_H
+#define PGETILEMAPPAGER_H
+
+#include <vector>
+#include "PgeTypes.h"
+#include "PgePoint2D.h"
+#include "PgeSharedPtr.h"
+#include "PgeWorkQueue.h"
+#include "PgeTileSet.h"
+#include "PgeTileMapFile.h"
+
+namespace PGE
+{
+    /** @class TileMapPager
+        Keeps the pages of a paged map (see TileMapFile) resident around the
+        visible area, loading them on the work queue and releasing those which
+        have been left behind.
+
+        @remarks
+            Pages within the load radius of the visible pages are requested.  A
+            resident page is only released once it is outside the load radius
+            plus the hysteresis, so a view sitting on a page border does not
+            load and release the same pages over and over.  The number of
+            resident pages therefore depends only on the view size and the two
+            radii, not on the size of the world.
+
+        @remarks
+            Pages are read through the archive manager, so paged maps may live
+            in an archive.  Each load opens its own file handle.
+    */
+    class _PgeExport TileMapPager
+    {
+    public:
+        /** @struct TilePage
+            The runs and cells of a resident page.  Columns in the spans are
+            relative to the left edge of the page.
+        */
+        struct TilePage
+        {
+            Point2D                 origin;     ///< First cell of the page in the map
+            Point2D                 size;       ///< Number of cells in the page
+            TileSet::TileCellArray  cells;      ///< Stored cells, in row order
+            TileSet::TileSpanArray  spans;      ///< Runs of stored cells, in row order
+            std::vector< UInt32 >   rowSpans;   ///< Index of the first span in each row, followed by the total number of spans
+        };
+
+    private:
+        /** @class PageLoadJob
+            Reads a page from the map file on a worker thread
+        */
+        class PageLoadJob : public WorkItem
+        {
+        public:
+            String                  fileName;   ///< Resource name of the map file
+            TileMapFile::PageRecord record;     ///< Location of the page in the file
+            TilePage                page;       ///< Resulting page
+            bool                    isValid;    ///< Indicates the page was read and checked
+
+            /** Read the page */
+            void Execute();
+        };
+
+        /** @struct PageSlot
+            State of one page of the map
+        */
+        struct PageSlot
+        {
+            TilePage*       page;               ///< Resident page, if any
+            PageLoadJob*    job;                ///< Load in progress, if any
+            UInt32          serial;             ///< Changes each time the page is loaded or released; 0 when not resident
+        };
+
+        String                  mFileName;
+        std::vector< TileMapFile::PageRecord > mRecords;
+        Point2D                 mMapSize;       ///< Number of cells in the map
+        UInt32                  mPageSize;      ///< Number of cells along each side of a page
+        Point2D                 mPageGridSize;  ///< Number of pages horizontally and vertically
+        std::vector< PageSlot > mSlots;
+        std::vector< UInt32 >   mActivePages;   ///< Indices of the pages which are resident or loading
+        UInt32                  mNextSerial;
+        UInt32                  mLoadRadius;    ///< Pages around the view which are loaded
+        UInt32                  mHysteresis;    ///< Additional pages beyond the load radius which are kept
+        UInt32                  mResidentBytes; ///< Memory used by the resident pages
+
+        TileMapPager( const TileMapPager& );
+        TileMapPager& operator=( const TileMapPager& );
+
+        /** Take the page from a finished load */
+        void _collectJob( UInt32 pageIndex );
+
+        /** Release a page, or cancel its load */
+        void _releasePage( UInt32 pageIndex );
+
+    public:
+        /** Constructor
+            @param  file        Map file containing the map
+            @param  map         Paged map to stream
+        */
+        TileMapPager( const TileMapFile& file, const TileMapFile::MapRecord& map );
+        /** Destructor.  Waits for any loads in progress. */
+        ~TileMapPager();
+
+        /** Set how far around the view pages are kept
+            @param  loadRadius  Number of pages around the visible pages to load
+            @param  hysteresis  Number of pages beyond the load radius before a
+                                resident page is released
+        */
+        void SetRadius( UInt32 loadRadius, UInt32 hysteresis );
+
+        /** Get the number of pages around the visible pages which are loaded */
+        UInt32 GetLoadRadius() const            { return mLoadRadius; }
+
+        /** Get the number of pages beyond the load radius which are kept */
+        UInt32 GetHysteresis() const            { return mHysteresis; }
+
+        /** Request the pages around a block of visible cells, release those
+            which are too far away, and pick up finished loads.
+        */
+        void Update( const Point2D& firstCell, const Point2D& lastCell );
+
+        /** Get the number of cells along each side of a page */
+        UInt32 GetPageSize() const              { return mPageSize; }
+
+        /** Get the index of the page containing a cell */
+        UInt32 GetPageIndex( Int x, Int y ) const;
+
+        /** Get a resident page, or null if it is not loaded
+            @param  pageIndex   Index of the page
+            @param  serial      Receives the load serial of the page, which
+                                changes whenever the page is loaded or released
+        */
+        const TilePage* GetPage( UInt32 pageIndex, UInt32* serial = 0 ) const;
+
+        /** Get the number of pages which are resident or being loaded */
+        UInt32 GetActivePageCount() const       { return mActivePages.size(); }
+
+        /** Get the memory used by the resident pages */
+        UInt32 GetResidentBytes() const         { return mResidentBytes; }
+
+    }; // class TileMapPager
+
+    typedef SharedPtr< TileMapPager > TileMapPagerPtr;
+
+} // namespace PGE
+
+#endif // PGETILEMAPPAGER_H
@@ -17,6 +17,9 @@
 
 namespace PGE
 {
+    class TextureAtlas;
+    class TileMapFile;
+
     /** @class TileMapScene
         A collection of tile maps which compose a scene, such as a multi-layered
         level.
@@ -26,12 +29,20 @@ namespace PGE
         will have a negative depth, and those behind it are positive.
 
         @remarks
-            While the scene will read the tile sets from the data file, it only
-            needs to store the appropriate map from within each tileset.  When
+            The scene holds its tilesets through shared pointers, indexed by
+            depth.  Adding a layer moves or shares the tileset rather than
+            copying it, and the tileset stays where it is as other layers are
+            added or removed, so a pointer to it remains valid until it is
+            removed from the scene.
+
+        @remarks
+            Each tileset is read once, with all of its maps, but the scene
+            only draws the appropriate map from within each tileset.  When
             reading the scene, the necessary map index should be given (default
             is 0.)  It will then iterate over each tileset, and attempt to
             retrieve the requested map.  If there is no map with the desired
-            index, then it proceeds to the next tileset, skipping the map.
+            index, that layer is left empty.  SelectMap moves the whole scene
+            to another map without reading the tilesets again.
 
         @note
             Scrolling is done by calculating a ratio of the current level's size
@@ -58,15 +69,33 @@ namespace PGE
     class TileMapScene
     {
     private:
-        typedef std::multiset< TileSet, std::greater< TileSet > > TileSetMultiSet;
-        TileSetMultiSet mTileSets;
+        /** @typedef TileSetMap
+            The tilesets of the scene by depth, in drawing order (deepest
+            first.)  The handles are not copied as layers come and go.
+        */
+        typedef std::multimap< UInt32, TileSetPtr, std::greater< UInt32 > > TileSetMap;
+        TileSetMap      mTileSets;
         TileSet*        mPrimaryTileSet;
+        TileRenderStats mRenderStats;   ///< Counters from the most recent render
+
+        /** Get the offset of a layer, scrolled relative to the primary map */
+        Point2Df _getLayerOffset( const TileSet& layer, const Point2Df& offset, const Viewport& viewport ) const;
+
+        /** Pick the primary map: the tileset at depth 0, or else the first
+            tileset which was added
+        */
+        void _updatePrimaryTileSet( TileSet* added );
+
+        /** Give the scene a new tileset as a layer */
+        TileSet* _insertTileSet( TileSet* set );
 
     public:
         /** Constructor */
         TileMapScene();
         /** Constructor */
         TileMapScene( TiXmlNode* projectNode, const String& baseDir, UInt32 mapNum = 0 );
+        /** Destructor */
+        ~TileMapScene();
 
         /** Read the maps that compose this scene
             @param  projectNode         Pointer to the 'project' node of the map file
@@ -80,16 +109,96 @@ namespace PGE
         /** Render the scene */
         void Render( Point2Df& offset, const Viewport& viewport );
 
-        /** Read a tileset block from a tile map file */
-        void ReadTileset( TiXmlNode* tilesetNode, const String& baseDir, UInt32 mapNum = 0 );
+        /** Read a tileset block from a tile map file
+            @return The new layer, or null if the tileset could not be read
+        */
+        TileSet* ReadTileset( TiXmlNode* tilesetNode, const String& baseDir, UInt32 mapNum = 0 );
+
+        /** Read every tileset of a compiled map file
+            @param  file        Compiled map file
+            @param  baseDir     Directory the tileset images are relative to
+            @param  mapNum      Number (index) of the map to read for this scene.
+        */
+        void ReadTileMapFile( const TileMapFile& file, const String& baseDir, UInt32 mapNum = 0 );
+
+        /** Switch every layer to another map of its tileset, such as the next
+            level.  The tilesets are not read again; the maps and tiles were
+            all read with the scene.  A layer whose tileset has no such map
+            is left empty.
+        */
+        void SelectMap( UInt32 mapNum );
+
+        /** Get the largest number of maps in any tileset of the scene */
+        UInt32 GetMapCount() const;
 
         /** Generate a default tile set for demo purposes.  This tileset may
             or may not have a texture applied to it.
         */
         void GenerateDefaultTileset( const String& textureName, const Point2Df& tileSize, const Point2D& tileCount );
 
-        /** Add a tile set to the manager */
-        void AddTileSet( TileSet& set );
+        /** Add a tile set to the manager.  The contents of the tileset are
+            moved into the scene (see TileSet::Swap), leaving it empty.
+            @return The new layer
+        */
+        TileSet* AddTileSet( TileSet& set );
+
+        /** Add a tile set to the manager, sharing it with the caller */
+        void AddTileSet( const TileSetPtr& set );
+
+        /** Remove a tile set from the manager
+            @return False if the tileset is not in the scene
+        */
+        bool RemoveTileSet( const TileSet* set );
+
+        /** Get the number of layers in the scene */
+        UInt32 GetTileSetCount() const;
+
+        /** Get a layer by its position in drawing order */
+        TileSet* GetTileSet( UInt32 layerIndex ) const;
+
+        /** Get the layer the other layers scroll relative to */
+        TileSet* GetPrimaryTileSet() const;
+
+        /** Pack the images of all tilesets in the scene into a texture atlas,
+            so that the layers can be drawn without rebinding textures.
+            @param  atlasName   Base name of the atlas page textures
+            @param  pageSize    Maximum size of an atlas page
+            @param  gutter      Number of texels repeated around each tile
+        */
+        bool BuildAtlas( const String& atlasName, UInt32 pageSize = 1024, UInt32 gutter = 1 );
+
+        /** Load a texture atlas built ahead of time, and draw the tilesets from it */
+        bool LoadAtlas( const String& descriptorFileName );
+
+        /** Draw each tileset whose image is in the atlas from the atlas.  The
+            atlas must have been uploaded.
+        */
+        void ApplyAtlas( const TextureAtlas& atlas );
+
+        /** Set how far around the view the pages of streamed layers are kept
+            (see TileSet::SetStreamingRadius.)  Layers which are not streamed
+            are not affected.
+        */
+        void SetStreamingRadius( UInt32 loadRadius, UInt32 hysteresis );
+
+        /** Draw a layer from an offscreen copy of the area around the view
+            (see TileSet::SetRenderCache.)  This suits distant parallax layers
+            which scroll slowly and have few animated cells.
+            @param  layerIndex  Position of the layer in drawing order
+            @param  enable      Use the cache, or draw the layer from its tiles
+            @param  margin      Pixels cached beyond each side of the view
+        */
+        void SetLayerCache( UInt32 layerIndex, bool enable, UInt32 margin = 256 );
+
+        /** Get the draw call and vertex counts for all layers from the most
+            recent render.
+        */
+        const TileRenderStats& GetRenderStats() const;
+
+        /** Write the empty cell ratio and memory use of each layer to the
+            default log file.
+        */
+        void LogMapStats() const;
 
     }; // class TileMapScene
 
@@ -0,0 +1,129 @@
+/*! $Id$
+ *  @file   PgeTileMinimap.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Small overview image of a tile map, with one pixel for each block
+ *          of cells, kept up to date as the cells change.
+ *
+ */
+
+#ifndef PGETILEMINIMAP_H
+#define PGETILEMINIMAP_H
+
+#include <vector>
+#include "PgeTypes.h"
+#include "PgePoint2D.h"
+#include "PgeColor.h"
+#include "PgeTextureManager.h"
+#include "PgeTileSet.h"
+
+namespace PGE
+{
+    /** @class TileMinimap
+        An overview of a map, drawn on the CPU from one color for each tile,
+        rather than by drawing the map at a small scale.
+
+        @remarks
+            The color of each tile is the average of its pixels, found from the
+            block colors its texture keeps from when it was loaded (see
+            TextureItem::GetAverageColor), so no pixels are read back or
+            decoded again.  Each pixel of the image is the average of the
+            colors of a square of cells (see SetScale); empty cells count as
+            transparent.  Cells holding a sequence show the first frame.
+
+        @remarks
+            Edits only mark the chunks (see TileSet::CHUNK_SIZE) holding the
+            cells, and Refresh draws the pixels of those chunks again.  Upload
+            copies only the pixels which changed since the last upload into
+            the texture.
+    */
+    class _PgeExport TileMinimap
+    {
+    private:
+        Point2D                 mGridSize;      ///< Number of cells horizontally and vertically
+        Point2D                 mChunkGridSize; ///< Number of chunks horizontally and vertically
+        UInt32                  mScale;         ///< Number of cells across each pixel
+        std::vector< Color >    mTileColors;    ///< Average color of each tile
+        ImageData               mImage;         ///< One pixel for each square of cells
+        std::vector< UInt8 >    mDirty;         ///< 1 for each chunk to draw again
+        std::vector< UInt32 >   mDirtyChunks;
+        bool                    mHasChanges;    ///< Indicates pixels changed since the last upload
+        Point2D                 mChangeStart;   ///< First pixel changed since the last upload
+        Point2D                 mChangeEnd;     ///< Last pixel changed since the last upload
+        String                  mTextureName;   ///< Name of the texture the image was uploaded to
+        TextureItem*            mTexture;       ///< Texture the image was uploaded to, if any
+
+        TileMinimap( const TileMinimap& );
+        TileMinimap& operator=( const TileMinimap& );
+
+        /** Mark the chunk holding a cell as needing to be drawn again */
+        void _markCell( Int x, Int y );
+
+        /** Draw a block of pixels from the cells of the map */
+        void _drawPixels( const TileSet& tileSet, Int startX, Int startY, Int endX, Int endY );
+
+    public:
+        /** Constructor */
+        TileMinimap();
+
+        /** Destructor.  The texture is released. */
+        ~TileMinimap();
+
+        /** Read the tile colors and the cells of a tileset, and draw the
+            whole image.  For a streamed map, only the cells of the resident
+            pages are seen; call Update as the pages arrive.
+        */
+        void Build( const TileSet& tileSet );
+
+        /** Read the tile colors again, after the texture of the tileset has
+            changed (as when an atlas is applied), and draw the whole image.
+        */
+        void ReadTileColors( const TileSet& tileSet );
+
+        /** Draw a block of cells again, after the cells of the tileset have
+            changed.
+        */
+        void Update( const TileSet& tileSet, Int x, Int y, Int w, Int h );
+
+        /** Apply the edits made to the cells of the tileset (see
+            TileSet::ApplyEdits.)  The image changes at the next Refresh.
+        */
+        void ApplyEdits( const TileSet::CellEdit* edits, UInt32 count );
+
+        /** Draw the chunks changed since the last call again */
+        void Refresh( const TileSet& tileSet );
+
+        /** Release the image, the tile colors and the texture */
+        void Clear();
+
+        /** Set the number of cells across each pixel, from 1 up to
+            TileSet::CHUNK_SIZE.  The image is drawn again at the next Build.
+        */
+        void SetScale( UInt32 scale );
+
+        /** Get the number of cells across each pixel */
+        UInt32 GetScale() const                 { return mScale; }
+
+        /** Get the image, as 8-bit RGBA with the top row first */
+        const ImageData& GetImage() const       { return mImage; }
+
+        /** Get the average color of a tile */
+        Color GetTileColor( SInt32 tileIndex ) const;
+
+        /** Copy the image into a texture, creating it the first time.  The
+            texture is enlarged to powers of 2 as needed, with the image in
+            its top-left corner.  After the first upload, only the pixels
+            which changed are copied.
+            @param  textureName     Name of the texture in the TextureManager
+            @return False if the texture could not be created
+        */
+        bool Upload( const String& textureName );
+
+        /** Get the texture the image was uploaded to, or null */
+        TextureItem* GetTexture() const         { return mTexture; }
+
+    }; // class TileMinimap
+
+} // namespace PGE
+
+#endif // PGETILEMINIMAP_H
@@ -0,0 +1,349 @@
+/*! $Id$
+ *  @file   PgeTilePathfinder.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Hierarchical path finding through the open cells of a tile map,
+ *          with queries answered in batches on the work queue.
+ *
+ */
+
+#ifndef PGETILEPATHFINDER_H
+#define PGETILEPATHFINDER_H
+
+#include <vector>
+#include "PgeTypes.h"
+#include "PgePoint2D.h"
+#include "PgeWorkQueue.h"
+#include "PgeTileSet.h"
+#include "PgeTileRegionMap.h"
+
+namespace PGE
+{
+    /** @class TilePathfinder
+        Finds paths between cells of a tile map, around the solid cells.
+
+        @remarks
+            The map is divided into square clusters.  Wherever two neighbouring
+            clusters have open cells facing each other across their border, an
+            entrance is placed on the border, and the cost of travelling
+            between each pair of entrances of a cluster is kept.  A query first
+            searches this much smaller graph of entrances (HPA*), then finds
+            the cells of each step inside its cluster with Jump Point Search.
+            The cost of a query therefore grows with the number of clusters
+            crossed rather than the number of cells.
+
+        @remarks
+            A cell is solid when its bounds code has all four edges (the same
+            as TileCollisionMap::PLANE_SOLID.)  Paths may move diagonally, but
+            never across the corner of a solid cell.  Moving straight costs
+            STRAIGHT_COST, and diagonally DIAGONAL_COST.
+
+        @remarks
+            Queries are made in batches (see SubmitBatch), which are split
+            across the worker threads of the work queue, so the main thread
+            does not wait for them.  Cell edits (see ApplyEdits) first wait for
+            any batches still running, then mark the clusters holding the cells.
+            Only those clusters, and the neighbours whose shared border changed,
+            are rebuilt, when the next query is made.
+
+        @remarks
+            The connected regions of the map are kept as well (see
+            TileRegionMap), so a request between cells which can not reach
+            each other fails at once, instead of searching every entrance the
+            start can reach.
+    */
+    class _PgeExport TilePathfinder
+    {
+    public:
+        static const UInt32 STRAIGHT_COST;  ///< Cost of moving to a horizontal or vertical neighbour
+        static const UInt32 DIAGONAL_COST;  ///< Cost of moving to a diagonal neighbour
+        static const UInt32 NO_PATH;        ///< Cost of an unreachable cell
+
+        /** @struct PathRequest
+            Cells to find a path between
+        */
+        struct PathRequest
+        {
+            Point2D     start;              ///< Cell the path starts from
+            Point2D     goal;               ///< Cell the path ends at
+        };
+
+        /** @struct PathResult
+            A path found for a request
+        */
+        struct PathResult
+        {
+            bool                    isFound;    ///< Indicates a path was found
+            UInt32                  cost;       ///< Total cost of the path
+            std::vector< Point2D >  waypoints;  ///< Start, goal, and each cell where the path changes direction
+        };
+
+        class PathBatch;
+
+    private:
+        /** Sides of a cluster */
+        enum Side
+        {
+            SIDE_TOP,
+            SIDE_LEFT,
+            SIDE_BOTTOM,
+            SIDE_RIGHT,
+            SIDE_COUNT
+        };
+
+        /** @struct Cluster
+            A block of cells, and the entrances on its borders
+        */
+        struct Cluster
+        {
+            Point2D                 origin;     ///< First cell of the cluster
+            Point2D                 size;       ///< Number of cells in the cluster
+            UInt32                  sideStart[ SIDE_COUNT + 1 ];    ///< First entrance on each side, followed by the number of entrances
+            std::vector< UInt32 >   nodeCells;  ///< Map cell index of each entrance
+            std::vector< UInt32 >   costs;      ///< Cost between each pair of entrances, or NO_PATH
+        };
+
+        /** @struct GraphNode
+            An entrance in the whole graph
+        */
+        struct GraphNode
+        {
+            Int         x;                  ///< Column of the cell of the entrance
+            Int         y;                  ///< Row of the cell of the entrance
+            UInt32      cluster;            ///< Cluster the entrance belongs to
+        };
+
+        /** @struct OpenEntry
+            A cell or entrance waiting to be expanded by a search
+        */
+        struct OpenEntry
+        {
+            UInt32      score;              ///< Cost so far plus the estimate to the goal
+            UInt32      cost;               ///< Cost so far
+            UInt32      index;              ///< Cell or entrance
+
+            /** Order the heap so the lowest score is on top, and of those, the
+                one furthest from the start
+            */
+            bool operator<( const OpenEntry& rhs ) const
+            {
+                return ( score > rhs.score ) || ( score == rhs.score && cost < rhs.cost );
+            }
+        };
+
+        /** @struct SearchContext
+            Working storage of the searches.  Each thread needs its own.
+        */
+        struct SearchContext
+        {
+            std::vector< UInt32 >       cellCost;   ///< Cost of each cell of a cluster
+            std::vector< UInt32 >       cellParent; ///< Cell each cell of a cluster was reached from
+            std::vector< UInt32 >       cellSeen;   ///< Search serial in which each cell was reached
+            std::vector< UInt32 >       cellDone;   ///< Search serial in which each cell was expanded
+            UInt32                      cellSerial;
+            std::vector< UInt32 >       nodeCost;   ///< Cost of each entrance, then the start and goal
+            std::vector< UInt32 >       nodeParent;
+            std::vector< UInt32 >       nodeSeen;
+            UInt32                      nodeSerial;
+            std::vector< OpenEntry >    open;
+            std::vector< UInt32 >       startCosts; ///< Cost from the start to each entrance of its cluster
+            std::vector< UInt32 >       goalCosts;  ///< Cost from each entrance of the goal's cluster to the goal
+            std::vector< Point2D >      points;     ///< Turning points of the refined path
+        };
+
+        /** @class PathJob
+            Answers a slice of the requests of a batch on a worker thread
+        */
+        class PathJob : public WorkItem
+        {
+        public:
+            const TilePathfinder*   pathfinder;
+            PathBatch*              batch;
+            UInt32                  first;      ///< First request of the slice
+            UInt32                  count;      ///< Number of requests in the slice
+
+            /** Answer the requests */
+            void Execute();
+        };
+
+        typedef std::vector< UInt16 > TransitionArray;  ///< Offsets of the entrances along a border
+        typedef std::vector< PathBatch* > BatchArray;
+
+        Int                     mClusterSize;       ///< Number of cells along each side of a cluster
+        Point2D                 mGridSize;          ///< Number of cells horizontally and vertically
+        Point2D                 mClusterGridSize;   ///< Number of clusters horizontally and vertically
+        std::vector< UInt8 >    mSolid;             ///< 1 for each solid cell
+        std::vector< Cluster >  mClusters;
+        std::vector< TransitionArray > mBorders[ 2 ];   ///< Entrances on the lower and right border of each cluster
+        std::vector< UInt32 >   mNodeBase;          ///< Index of the first entrance of each cluster in the whole graph
+        std::vector< GraphNode > mNodes;            ///< Every entrance, in order of cluster
+        std::vector< UInt8 >    mDirty;             ///< 1 for each cluster whose cells changed
+        std::vector< UInt32 >   mDirtyClusters;
+        TileRegionMap           mRegions;           ///< Connected regions of the open cells
+        SearchContext           mContext;           ///< Working storage of the main thread
+        BatchArray              mBatches;           ///< Batches which have not been released
+
+        TilePathfinder( const TilePathfinder& );
+        TilePathfinder& operator=( const TilePathfinder& );
+
+        /** Get the octile distance between two cells */
+        static UInt32 _distance( const Point2D& a, const Point2D& b );
+
+        /** Check if a cell is inside a cluster and open */
+        bool _isOpen( const Cluster& cluster, Int x, Int y ) const;
+
+        /** Get the cluster holding a cell */
+        UInt32 _getCluster( const Point2D& cell ) const;
+
+        /** Get the cluster across a side of a cluster, or -1 */
+        Int _getNeighbour( UInt32 cluster, Side side ) const;
+
+        /** Get the entrances on a side of a cluster, or null on the edge of
+            the map
+        */
+        const TransitionArray* _getBorder( UInt32 cluster, Side side ) const;
+
+        /** Get the cell of a cluster at an offset along one of its sides */
+        Point2D _getSideCell( const Cluster& cluster, Side side, UInt32 offset ) const;
+
+        /** Get the cell of an entrance of the whole graph */
+        Point2D _getNodeCell( UInt32 node ) const;
+
+        /** Place the entrances on the lower or right border of a cluster
+            @return True if the entrances changed
+        */
+        bool _buildBorder( UInt32 cluster, Side side );
+
+        /** Gather the entrances of a cluster, and find the cost between each
+            pair of them
+        */
+        void _buildNodes( UInt32 cluster );
+
+        /** Number the entrances of the whole graph */
+        void _indexNodes();
+
+        /** Rebuild the clusters whose cells have changed */
+        void _repair();
+
+        /** Mark the cluster holding a cell for rebuilding */
+        void _markCell( Int x, Int y );
+
+        /** Wait for the batches which are still running */
+        void _waitForBatches();
+
+        /** Size the working storage of a search for the current graph */
+        void _prepareContext( SearchContext& context ) const;
+
+        /** Start a new search of the cells of a cluster */
+        static void _beginCellSearch( SearchContext& context );
+
+        /** Find the cost from a cell to every other cell of its cluster.  The
+            costs are left in the cells of the context.
+        */
+        void _flood( SearchContext& context, const Cluster& cluster, const Point2D& from ) const;
+
+        /** Look for the next jump point from a cell, moving in a direction
+            @return True if a jump point was found
+        */
+        bool _jump( const Cluster& cluster, Int x, Int y, Int dx, Int dy, const Point2D& goal, Point2D& result ) const;
+
+        /** Find the turning points of a path between two cells of a cluster,
+            using Jump Point Search.  The points after the start are appended.
+        */
+        bool _jumpSearch( SearchContext& context, const Cluster& cluster, const Point2D& start, const Point2D& goal, std::vector< Point2D >& points ) const;
+
+        /** Answer a request */
+        void _findPath( SearchContext& context, const PathRequest& request, PathResult& result ) const;
+
+    public:
+        /** @class PathBatch
+            A set of requests being answered on the work queue.  Batches are
+            created by SubmitBatch, and belong to the pathfinder.
+        */
+        class _PgeExport PathBatch
+        {
+            friend class TilePathfinder;
+
+        private:
+            std::vector< PathRequest >  mRequests;
+            std::vector< PathResult >   mResults;
+            std::vector< PathJob* >     mJobs;
+
+            PathBatch()                         { }
+            ~PathBatch();
+
+        public:
+            /** Check if every request of the batch has been answered */
+            bool IsComplete() const;
+
+            /** Get the number of requests in the batch */
+            UInt32 GetCount() const                 { return mRequests.size(); }
+
+            /** Get a request of the batch */
+            const PathRequest& GetRequest( UInt32 index ) const { return mRequests[ index ]; }
+
+            /** Get the answer to a request.  Only valid once the batch is
+                complete.
+            */
+            const PathResult& GetResult( UInt32 index ) const   { return mResults[ index ]; }
+        };
+
+        /** Constructor
+            @param  clusterSize Number of cells along each side of a cluster
+        */
+        TilePathfinder( UInt32 clusterSize = 16 );
+        /** Destructor.  Waits for any batches which are still running. */
+        ~TilePathfinder();
+
+        /** Build the graph from the map of a tileset.  For a streamed map,
+            only the cells of the resident pages are seen; call Update as the
+            pages arrive.
+        */
+        void Build( const TileSet& tileSet );
+
+        /** Read a block of cells again, after the cells of the tileset have
+            changed
+        */
+        void Update( const TileSet& tileSet, Int x, Int y, Int w, Int h );
+
+        /** Apply the edits made to the cells of the tileset (see
+            TileSet::ApplyEdits.)  Where a cell is edited more than once, the
+            last edit is kept.
+        */
+        void ApplyEdits( const TileSet::CellEdit* edits, UInt32 count );
+
+        /** Release the graph.  Waits for any batches which are still running,
+            and releases them.
+        */
+        void Clear();
+
+        /** Get the number of cells horizontally and vertically */
+        const Point2D& GetGridSize() const      { return mGridSize; }
+
+        /** Get the connected regions of the map */
+        const TileRegionMap& GetRegionMap() const   { return mRegions; }
+
+        /** Get the number of entrances in the graph */
+        UInt32 GetNodeCount() const             { return mNodes.size(); }
+
+        /** Check if a cell is solid.  Cells outside the map are solid. */
+        bool IsSolid( Int x, Int y ) const;
+
+        /** Find a path on the calling thread */
+        bool FindPath( const Point2D& start, const Point2D& goal, PathResult& result );
+
+        /** Queue a batch of requests on the work queue.  Without a work queue,
+            the requests are answered before returning.
+            @return The batch, which must be released (see ReleaseBatch) once
+                    the results have been read
+        */
+        PathBatch* SubmitBatch( const PathRequest* requests, UInt32 count );
+
+        /** Release a batch, waiting for it if it is still running */
+        void ReleaseBatch( PathBatch* batch );
+
+    }; // class TilePathfinder
+
+} // namespace PGE
+
+#endif // PGETILEPATHFINDER_H
@@ -0,0 +1,201 @@
+/*! $Id$
+ *  @file   PgeTileRegionMap.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  Labels the connected regions of open cells of a tile map, so that
+ *          reachability can be answered without a search.
+ *
+ */
+
+#ifndef PGETILEREGIONMAP_H
+#define PGETILEREGIONMAP_H
+
+#include <utility>
+#include <vector>
+#include "PgeTypes.h"
+#include "PgePoint2D.h"
+#include "PgeTileSet.h"
+
+namespace PGE
+{
+    /** @class TileRegionMap
+        Gives every open cell of a map the label of the region it belongs to.
+        Two cells can reach each other exactly when they have the same label.
+
+        @remarks
+            A cell is solid when its bounds code has all four edges, the same
+            as for TileCollisionMap::PLANE_SOLID and TilePathfinder.  Since
+            diagonal moves may not cut the corner of a solid cell, cells are
+            connected through their horizontal and vertical neighbours only.
+
+        @remarks
+            The cells are first labelled within each chunk (see
+            TileSet::CHUNK_SIZE.)  The pieces are then joined across the chunk
+            borders with a union-find, and the regions are kept between edits
+            along with the list of their pieces.  When cells change, only their
+            chunks are labelled again, and only the borders of those chunks are
+            joined.  Opening cells can only join regions, which moves the
+            pieces of the smaller region into the larger one.  Closing cells
+            may split a region, so the pieces left in the regions those chunks
+            touched are joined again as well; such an edit costs the size of
+            those regions rather than the whole map.
+
+        @remarks
+            Labels may change whenever cells change, so they should not be kept
+            across edits.
+    */
+    class _PgeExport TileRegionMap
+    {
+    private:
+        /** Flags of each chunk */
+        enum ChunkFlags
+        {
+            CHUNK_DIRTY     = 1 << 0,       ///< Cells of the chunk changed
+            CHUNK_CLOSED    = 1 << 1,       ///< A cell of the chunk was closed
+            CHUNK_SCANNED   = 1 << 2        ///< The borders of the chunk are being joined
+        };
+
+        /** Flags of each region */
+        enum RegionFlags
+        {
+            REGION_TOUCHED  = 1 << 0,       ///< The region had pieces in a dirty chunk
+            REGION_SPLIT    = 1 << 1,       ///< The region may have been split
+            REGION_FREE     = 1 << 2        ///< The label is not in use
+        };
+
+        typedef std::vector< UInt32 > PieceList;
+        typedef std::vector< std::pair< UInt32, UInt32 > > PieceLinkArray;
+
+        Point2D                 mGridSize;      ///< Number of cells horizontally and vertically
+        Point2D                 mChunkGridSize; ///< Number of chunks horizontally and vertically
+        std::vector< UInt8 >    mOpen;          ///< 1 for each open cell
+        std::vector< UInt16 >   mPieces;        ///< Piece of each cell within its chunk, from 1; 0 for solid cells
+        std::vector< PieceList > mChunkPieces;  ///< Index of each piece of each chunk among all pieces
+        std::vector< UInt32 >   mPieceSizes;    ///< Number of cells in each piece
+        std::vector< UInt32 >   mPieceChunks;   ///< Chunk holding each piece
+        std::vector< UInt32 >   mPieceRegions;  ///< Region of each piece; 0 while the piece is being joined
+        std::vector< UInt32 >   mPieceSlots;    ///< Position of each piece in the list of its region
+        std::vector< UInt32 >   mParents;       ///< Union-find over the pieces being joined
+        PieceList               mFreePieces;    ///< Pieces which are not in use
+        std::vector< UInt32 >   mRegionSizes;   ///< Number of cells in each region; the first entry is unused
+        std::vector< PieceList > mRegionPieces; ///< Pieces of each region
+        std::vector< UInt8 >    mRegionFlags;   ///< RegionFlags of each region
+        std::vector< UInt32 >   mFreeRegions;   ///< Labels which are not in use
+        UInt32                  mRegionCount;   ///< Number of labels in use
+        std::vector< UInt8 >    mDirty;         ///< ChunkFlags of each chunk
+        std::vector< UInt32 >   mDirtyChunks;
+
+        /** Get a piece for a chunk */
+        UInt32 _newPiece( UInt32 chunk );
+
+        /** Get an empty region */
+        UInt32 _newRegion();
+
+        /** Release the label of a region */
+        void _freeRegion( UInt32 region );
+
+        /** Add a piece to a region */
+        void _addPiece( UInt32 region, UInt32 piece );
+
+        /** Take a piece out of its region */
+        void _removePiece( UInt32 piece );
+
+        /** Join two regions, moving the pieces of the smaller one into the
+            larger one
+            @return The label of the joined region
+        */
+        UInt32 _joinRegions( UInt32 a, UInt32 b );
+
+        /** Label the pieces of a chunk, adding the new pieces to a list */
+        void _labelChunk( UInt32 chunk, PieceList& newPieces );
+
+        /** Get the cells on the border of a chunk which touch a piece of the
+            chunk next to it
+        */
+        void _getContacts( UInt32 chunk, std::vector< UInt32 >& contacts ) const;
+
+        /** Join a piece being joined to the piece across a chunk border */
+        void _joinAcross( UInt32 chunk, UInt32 cell, UInt32 nextChunk, UInt32 nextCell, PieceLinkArray& links );
+
+        /** Label the dirty chunks again, and join their pieces into the
+            regions around them
+        */
+        void _repair();
+
+        /** Get the index of a piece of a cell among all pieces */
+        UInt32 _getPiece( UInt32 chunk, UInt32 cell ) const
+        {
+            return mChunkPieces[ chunk ][ mPieces[ cell ] - 1 ];
+        }
+
+        /** Get the chunk holding a cell */
+        UInt32 _getChunk( Int x, Int y ) const
+        {
+            return ( y / TileSet::CHUNK_SIZE ) * mChunkGridSize.x + x / TileSet::CHUNK_SIZE;
+        }
+
+        /** Set a cell, marking its chunk if it changed */
+        void _setCell( Int x, Int y, SInt32 boundsCode );
+
+    public:
+        /** Constructor */
+        TileRegionMap();
+
+        /** Label the cells of the map of a tileset.  For a streamed map, only
+            the cells of the resident pages are seen; call Update as the pages
+            arrive.
+        */
+        void Build( const TileSet& tileSet );
+
+        /** Read a block of cells again, after the cells of the tileset have
+            changed
+        */
+        void Update( const TileSet& tileSet, Int x, Int y, Int w, Int h );
+
+        /** Apply the edits made to the cells of the tileset (see
+            TileSet::ApplyEdits)
+        */
+        void ApplyEdits( const TileSet::CellEdit* edits, UInt32 count );
+
+        /** Release the labels */
+        void Clear();
+
+        /** Get the number of cells horizontally and vertically */
+        const Point2D& GetGridSize() const      { return mGridSize; }
+
+        /** Get the label of the region holding a cell, or 0 for solid cells
+            and cells outside the map
+        */
+        UInt32 GetRegion( Int x, Int y ) const
+        {
+            if ( x < 0 || y < 0 || x >= mGridSize.x || y >= mGridSize.y )
+                return 0;
+            UInt32 cell = y * mGridSize.x + x;
+            if ( !mPieces[ cell ] )
+                return 0;
+            return mPieceRegions[ _getPiece( _getChunk( x, y ), cell ) ];
+        }
+
+        /** Check if one cell can be reached from another */
+        bool IsReachable( const Point2D& from, const Point2D& to ) const
+        {
+            UInt32 region = GetRegion( from.x, from.y );
+            return region && region == GetRegion( to.x, to.y );
+        }
+
+        /** Get the number of regions.  Labels are reused as regions are
+            split and joined, so they do not simply run from 1 to this number.
+        */
+        UInt32 GetRegionCount() const           { return mRegionCount; }
+
+        /** Get the number of cells in a region */
+        UInt32 GetRegionSize( UInt32 region ) const
+        {
+            return ( region && region < mRegionSizes.size() ) ? mRegionSizes[ region ] : 0;
+        }
+
+    }; // class TileRegionMap
+
+} // namespace PGE
+
+#endif // PGETILEREGIONMAP_H
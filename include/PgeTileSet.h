@@ -11,14 +11,47 @@
 #ifndef PgeTileSet_H_
 #define PgeTileSet_H_
 
+#include <queue>
+#include <map>
 #include "PgeTypes.h"
 #include "PgeViewport.h"
 #include "PgeStringUtil.h"
+#include "PgeTileBatch.h"
+#include "PgeWorkQueue.h"
+#include "PgeMappedFile.h"
 
 class TiXmlNode;
 
 namespace PGE
 {
+    class TextureItem;
+    class TileMapFile;
+    class TileMapPager;
+    class TileLightMap;
+    class TileFogOfWar;
+
+    /** @struct TileMapStats
+        Describes how much of a tile map is empty, and how much memory is used
+        to store it.
+    */
+    struct TileMapStats
+    {
+        UInt32  cellCount;              ///< Number of cells in the map
+        UInt32  emptyCells;             ///< Number of cells with no tile (tile 0)
+        UInt32  storedCells;            ///< Number of cells actually stored (those with a tile, bounds or map code)
+        UInt32  spanCount;              ///< Number of runs of stored cells
+        UInt32  memoryBytes;            ///< Bytes used to store the cells and runs
+
+        /** Constructor */
+        TileMapStats()
+            : cellCount( 0 ), emptyCells( 0 ), storedCells( 0 ), spanCount( 0 ), memoryBytes( 0 )
+        {
+        }
+
+        /** Get the fraction of the cells which have no tile */
+        Real GetEmptyRatio() const      { return cellCount ? emptyCells / Real( cellCount ) : 0; }
+    };
+
     /** @class TileSet
 
         The tileset contains all tiles from a given source texture, and anything
@@ -29,26 +62,22 @@ namespace PGE
     public:
         UInt32      mIndex;                 ///< Index of the tileset
 
-    protected:
-        String      mIdentifier;            ///< ID name of the tileset
-        Point2D     mTileSize;              ///< Size of the tiles in the tileset
-
-        String      mImageName;             ///< Name of the texture image file
-        Point2D     mImageSize;             ///< Dimensions of the texture image file
-        Point2D     mGridSize;              ///< Horizontal and vertical size of the grid containing the tiles (source image)
-        UInt32      mOverlap;               ///< Amount which the tiles overlap each other
-        UInt32      mTileCount;             ///< Number of tiles in the set
-
-        UInt32      mDisplayListBase;       ///< Base index of the display list for this tile set
+        static const UInt32 CHUNK_SIZE;             ///< Number of cells along each side of a render chunk
+        static const UInt32 MAX_RESIDENT_CHUNKS;    ///< Number of chunks which may hold geometry before the least recently drawn are released
 
         /** @struct TileMapItem
             Defines an item in a tile map (a single tile)
+
+            @remarks
+                This is the unpacked form of a cell, used when reading and
+                querying cells.  The map itself stores its cells packed (see
+                TileCellArray.)
         */
         struct TileMapItem
         {
-            Int     tileIndex;              ///< Index of the tile to display
-            Int     boundsCode;             ///< Indicates which sides of the tile are a boundary
-            Int     mapCode;                ///< Indicates special tiles
+            SInt32  tileIndex;              ///< Index of the tile to display
+            SInt32  boundsCode;             ///< Indicates which sides of the tile are a boundary
+            SInt32  mapCode;                ///< Indicates special tiles
 
             /** Constructor */
             TileMapItem()
@@ -61,8 +90,179 @@ namespace PGE
             Defines an array of tile map items as the tile map
         */
         typedef std::vector< TileMapItem >  TileMap;
-        mutable TileMap     mTileMap;
+
+        /** Largest bounds code or map code which can be stored */
+        static const SInt32 MAX_CELL_CODE;
+
+        /** @struct TileCellArray
+            Stored cells, packed into separate arrays of tiles and codes.
+
+            @remarks
+                The tile is a 16-bit value, negative for a sequence as in the
+                Tile Studio map.  The bounds code and map code take a byte each
+                of the second array.  Drawing only needs the tiles, so it reads
+                2 bytes per cell rather than a whole cell, and collision only
+                reads the codes.
+        */
+        struct TileCellArray
+        {
+            std::vector< SInt16 >   tiles;      ///< Tile of each cell; negative values are sequences
+            std::vector< UInt16 >   codes;      ///< Bounds code (low byte) and map code (high byte) of each cell
+
+            /** Get the number of cells */
+            UInt32 Size() const                 { return tiles.size(); }
+            /** Check if there are no cells */
+            bool IsEmpty() const                { return tiles.empty(); }
+            /** Remove all cells */
+            void Clear()                        { tiles.clear(); codes.clear(); }
+            /** Exchange the cells with another array */
+            void Swap( TileCellArray& src )     { tiles.swap( src.tiles ); codes.swap( src.codes ); }
+            /** Reserve space for a number of cells */
+            void Reserve( UInt32 count )        { tiles.reserve( count ); codes.reserve( count ); }
+
+            /** Add a cell to the end of the array.  Values which can not be
+                stored are clamped.
+                @return False if the cell had to be clamped
+            */
+            bool Append( const TileMapItem& item );
+
+            /** Replace a cell.  Values which can not be stored are clamped.
+                @return False if the cell had to be clamped
+            */
+            bool Set( UInt32 index, const TileMapItem& item );
+        };
+
+        /** @struct TileCellList
+            The packed arrays of a set of stored cells, which may be owned by
+            a TileCellArray or lie in a compiled map file
+        */
+        struct TileCellList
+        {
+            const SInt16*   tiles;              ///< Tile of each cell
+            const UInt16*   codes;              ///< Bounds and map codes of each cell
+
+            /** Constructor */
+            TileCellList() : tiles( 0 ), codes( 0 ) { }
+            /** Constructor */
+            TileCellList( const SInt16* cellTiles, const UInt16* cellCodes ) : tiles( cellTiles ), codes( cellCodes ) { }
+            /** Constructor */
+            TileCellList( const TileCellArray& cells )
+                : tiles( cells.IsEmpty() ? 0 : &cells.tiles[ 0 ] ), codes( cells.IsEmpty() ? 0 : &cells.codes[ 0 ] ) { }
+
+            /** Get the unpacked form of a cell */
+            TileMapItem GetItem( UInt32 index ) const;
+        };
+
+        /** @struct TileSpan
+            A run of consecutive cells in a row which are stored in the tile
+            map.  The cells between spans are empty (tile 0, with no bounds or
+            map code), and take no memory.
+        */
+        struct TileSpan
+        {
+            UInt32  start;                  ///< Column of the first cell in the run
+            UInt32  count;                  ///< Number of cells in the run
+            UInt32  firstCell;              ///< Index of the first cell of the run in the cell array
+        };
+        typedef std::vector< TileSpan > TileSpanArray;
+
+        /** @struct CellEdit
+            A change to one cell of the map (see ApplyEdits)
+        */
+        struct CellEdit
+        {
+            Int         x;                  ///< Column of the cell
+            Int         y;                  ///< Row of the cell
+            TileMapItem cell;               ///< New contents of the cell
+        };
+        typedef std::vector< CellEdit > CellEditArray;
+
+        /** Store a full grid of cells as runs, dropping the empty cells.
+            @param  cells       Every cell of the map, in row order
+            @param  size        Number of columns and rows in the map
+            @param  outCells    Receives the cells which are kept, packed
+            @param  outSpans    Receives the runs of kept cells
+            @param  outRowSpans Receives the index of the first run in each
+                                row, followed by the total number of runs
+            @param  outStats    Receives the empty cell and memory counts
+            @return False if any cell had a tile or code too large to store
+                    (see TileCellArray), in which case it was clamped
+        */
+        static bool EncodeCells( const TileMap& cells, const Point2D& size, TileCellArray& outCells, TileSpanArray& outSpans,
+                                 std::vector< UInt32 >& outRowSpans, TileMapStats& outStats );
+
+        /** Store one more row of cells as runs, after the rows already
+            stored, so that a map can be encoded as it is read without holding
+            the full grid.  Start from empty arrays and stats, and call
+            FinishEncoding after the last row.
+            @param  cells       The cells of the row
+            @param  width       Number of cells in the row
+            @return False if any cell had to be clamped (see EncodeCells)
+        */
+        static bool EncodeRow( const TileMapItem* cells, Int width, TileCellArray& outCells, TileSpanArray& outSpans,
+                               std::vector< UInt32 >& outRowSpans, TileMapStats& outStats );
+
+        /** Finish a map stored with EncodeRow, adding the total number of runs
+            after the last row and trimming the arrays
+        */
+        static void FinishEncoding( TileCellArray& outCells, TileSpanArray& outSpans, std::vector< UInt32 >& outRowSpans,
+                                    TileMapStats& outStats );
+
+    protected:
+        String      mIdentifier;            ///< ID name of the tileset
+        Point2D     mTileSize;              ///< Size of the tiles in the tileset
+
+        String      mImageName;             ///< Name of the texture image file
+        Point2D     mImageSize;             ///< Dimensions of the texture image file
+        Point2D     mGridSize;              ///< Horizontal and vertical size of the grid containing the tiles (source image)
+        UInt32      mOverlap;               ///< Amount which the tiles overlap each other
+        UInt32      mTileCount;             ///< Number of tiles in the set
+
+        typedef TileTexCoordArray TexCoordArray;
+        mutable TexCoordArray mTileTexCoords;   ///< Texture coordinates of each tile in the bound texture
+        String      mTextureName;           ///< Name of the texture the tiles are drawn from (the image, or an atlas page)
+        TextureItem* mTextureItem;          ///< Texture the tiles are drawn from, referenced through its handle
+        mutable bool mIsTexturePending;     ///< Indicates the texture is still loading in the background (see TextureManager::LoadImageAsync)
+
+        mutable TileRenderStats mRenderStats;   ///< Counters from the most recent render
+
+        /** @struct SourceMap
+            A map read from the xml of a tileset.  Every map of a tileset is
+            read at once, and shared by all copies of the tileset.
+        */
+        struct SourceMap
+        {
+            Point2D                 size;       ///< Number of cells horizontally and vertically
+            TileCellArray           cells;      ///< Stored cells, in row order
+            TileSpanArray           spans;      ///< Runs of stored cells, in row order
+            std::vector< UInt32 >   rowSpans;   ///< Index of the first span in each row, followed by the total number of spans
+            TileMapStats            stats;      ///< Empty cell and memory counts
+        };
+        typedef std::vector< SourceMap > SourceMapArray;
+
+        // The map is read through the pointers below.  They point either at
+        // the arrays owned by the tileset, at one of the shared source maps,
+        // or into a compiled map file.
+        // The shared maps hold the rows in order, so the end of each row is
+        // the start of the next.  In the owned arrays, an edited row is moved
+        // to the end, leaving its old runs unused until the arrays are
+        // compacted (see _storeRow.)
+        TileCellArray       mTileMap;       ///< Cells in the spans (when owned)
+        TileSpanArray       mSpans;         ///< Runs of stored cells (when owned)
+        std::vector< UInt32 > mRowSpans;    ///< Index of the first span in each row (when owned)
+        std::vector< UInt32 > mRowSpanEnds; ///< Index past the last span in each row (when owned)
+        TileCellList        mCells;         ///< Cells in the spans
+        const TileSpan*     mSpanList;      ///< Runs of stored cells
+        const UInt32*       mRowSpanList;   ///< Index of the first span in each row
+        const UInt32*       mRowSpanEndList;    ///< Index past the last span in each row
+        SharedPtr< SourceMapArray > mSourceMaps;    ///< Every map read from the xml, when the cells are not owned
+        SharedPtr< TileMapFile > mSourceFile;       ///< Compiled map file holding the cells, when they are not owned
+        UInt32              mSourceRecord;  ///< Index of the tileset record in the compiled file
+        UInt32              mMapIndex;      ///< Index of the map in use
+        bool                mIsSharedMap;   ///< Indicates the pointers refer to a source map or the compiled file, rather than the owned arrays
+        SharedPtr< TileMapPager > mPager;   ///< Streams the pages of a paged map.  When set, the pointers above are not used.
         Point2D     mTileMapSize;           ///< Dimensions of the tile map
+        TileMapStats        mMapStats;      ///< Empty cell and memory counts of the map
 
         /** @class Sequence
             Defines a tile sequence.  A tile sequence is a collection of
@@ -114,10 +314,20 @@ namespace PGE
             */
             void Prepare( Real32 elapsedMS );
 
-            /** Render the current frame in the sequence.  All transformations
-                should have already been performed.
-            */
-            void Render( UInt32 displayListBase );
+            /** Go back to the first frame */
+            void Restart();
+
+            /** Move forward a number of frames */
+            void AdvanceFrames( Int count );
+
+            /** Get the number of frames in the sequence */
+            UInt32 GetFrameCount() const        { return mSequence.size(); }
+
+            /** Get the length of time each frame is held */
+            Real GetFrameDuration() const       { return secondsPerFrame; }
+
+            /** Get the index of the tile used by the current frame */
+            Int GetCurrentTile() const;
         };
 
         /** @typedef SequenceArray
@@ -127,29 +337,320 @@ namespace PGE
         typedef std::vector< Sequence > SequenceArray;
         mutable SequenceArray mSequences;
 
+        /** @struct ScheduledSequence
+            The time at which a sequence next changes frames
+        */
+        struct ScheduledSequence
+        {
+            Real32  time;                   ///< Time of the next frame change
+            UInt32  seqIndex;               ///< Index of the sequence
+
+            /** Greater-than operator, so that the earliest change is at the top of the schedule */
+            bool operator>( const ScheduledSequence& src ) const    { return time > src.time; }
+        };
+        typedef std::priority_queue< ScheduledSequence, std::vector< ScheduledSequence >, std::greater< ScheduledSequence > > SequenceSchedule;
+        mutable SequenceSchedule mSchedule;     ///< Upcoming frame changes, earliest first
+        mutable Real32      mSequenceTime;      ///< Total time, in seconds, the sequences have been running
+
+        /** @struct AnimatedCell
+            A cell in a chunk which references a sequence.  These have a quad
+            in the chunk geometry like any other cell, but the quad is patched
+            each time the sequence changes frames.
+        */
+        struct AnimatedCell
+        {
+            UInt32  x, y;                   ///< Position of the cell within the chunk
+            UInt32  seqIndex;               ///< Index of the sequence
+            UInt32  quad;                   ///< Index of the cell's quad in the chunk geometry
+        };
+        typedef std::vector< AnimatedCell > AnimatedCellArray;
+
+        /** @typedef SequenceChunkArray
+            For each sequence, the chunks which contain cells referencing it.
+        */
+        typedef std::vector< std::vector< UInt32 > > SequenceChunkArray;
+        mutable SequenceChunkArray mSequenceChunks;     ///< Filled in as chunks are built when the map is streamed
+
+        /** @class ChunkBuildJob
+            Builds the geometry for a chunk.  The job works from its own copy of
+            the chunk's cells, so it may run on a worker thread while the map
+            continues to be used (or changed) on the main thread.
+        */
+        class ChunkBuildJob : public WorkItem
+        {
+        public:
+            std::vector< SInt16 >   tiles;      ///< Copy of the tiles of the stored cells in the chunk
+            TileSpanArray           spans;      ///< Runs of the cells, relative to the chunk
+            std::vector< UInt32 >   rowSpans;   ///< Index of the first span in each row of the chunk
+            Point2D                 size;       ///< Number of cells in the chunk
+            Point2D                 tileSize;   ///< Size of a tile
+            const TexCoordArray*    texCoords;  ///< Texture coordinates of the tiles
+            TileBatch               geometry;   ///< Resulting quads for the cells
+            AnimatedCellArray       animated;   ///< Resulting list of animated cells, sorted by sequence
+            std::vector< UInt16 >   quadCells;  ///< Resulting cell of each quad (see TileChunk::quadCells)
+            std::vector< UInt32 >   explored;   ///< Cells which may be drawn, as (size.x + 31) / 32 words per row, or empty to draw every cell
+
+            /** Build the chunk geometry */
+            void Execute();
+        };
+
+        /** @struct TileChunk
+            A fixed-size block of the map whose geometry is built once and
+            cached until one of its cells changes.
+        */
+        struct TileChunk
+        {
+            UInt32              index;          ///< Index of the chunk in the chunk grid
+            Point2D             origin;         ///< First cell in the chunk
+            Point2D             size;           ///< Number of cells in the chunk
+            TileBatch           geometry;       ///< Quads for the cells, relative to the top-left of the chunk
+            AnimatedCellArray   animated;       ///< Cells in the chunk which reference a sequence, sorted by sequence
+            std::vector< UInt16 > quadCells;    ///< Cell of each quad, as y * CHUNK_SIZE + x within the chunk
+            bool                isDirty;        ///< Indicates the geometry needs to be rebuilt
+            bool                isBuilt;        ///< Indicates the geometry has been built (it may be stale if dirty)
+            bool                isResident;     ///< Indicates the chunk is in the list of chunks holding geometry
+            UInt32              lastFrame;      ///< Frame in which the chunk was last drawn
+            UInt32              pageSerial;     ///< Load serial of the page the chunk was built from, when the map is streamed
+            UInt32              lightSerial;    ///< Serial of the light map chunk the colors were taken from, or 0 if unlit
+            UInt32              fogSerial;      ///< Serial of the fog of war chunk the geometry was built from
+            ChunkBuildJob*      job;            ///< Rebuild in progress, if any
+
+            /** Constructor */
+            TileChunk();
+            /** Copy constructor.  A rebuild in progress is not copied; the copy
+                is simply marked dirty instead.
+            */
+            TileChunk( const TileChunk& src );
+            /** Assignment operator */
+            TileChunk& operator=( const TileChunk& src );
+        };
+        typedef std::map< UInt32, TileChunk > ChunkMap;
+        mutable ChunkMap    mChunks;            ///< Chunks holding geometry (or being built), by index.  Others are created as they are drawn.
+        Point2D             mChunkGridSize;     ///< Number of chunks horizontally and vertically
+        mutable std::vector< UInt32 > mResidentChunks;  ///< Indices of the chunks holding geometry
+        mutable UInt32      mFrameCount;        ///< Number of times the tileset has been rendered
+
+        /** @struct RenderCache
+            Offscreen copy of the part of the layer around the view, so that
+            the layer can be drawn as a single textured quad.
+        */
+        struct RenderCache
+        {
+            bool        isEnabled;          ///< Indicates the layer should be drawn from the cache
+            UInt32      margin;             ///< Pixels cached beyond each side of the view
+            String      textureName;        ///< Name of the cache texture
+            TextureItem* texture;           ///< Cache texture, once created
+            Point2D     size;               ///< Size of the cache texture
+            Point2D     origin;             ///< Position in the map (in pixels) of the top-left of the cached area
+            Point2D     area;               ///< Size of the cached area, which may be less than the texture
+            bool        isValid;            ///< Indicates the texture holds the current contents of the area
+            TileBatch   quad;               ///< Quad for drawing the cache
+
+            /** Constructor */
+            RenderCache();
+        };
+        mutable RenderCache mCache;
+
+        const TileLightMap* mLightMap;      ///< Light applied to the tiles, if any
+        mutable std::vector< Color > mCornerLights; ///< Working storage for the light of a chunk
+        const TileFogOfWar* mFogOfWar;      ///< Hides the cells a team has not seen, if any
+        UInt32              mFogTeam;       ///< Team whose explored cells are drawn
+
         /** Generate the tiles in the tileset */
         bool _generateTiles();
 
-        /** Read a tile map */
-        bool _readTileMap( TiXmlNode* mapNode );
+        /** Calculate the texture coordinates of each tile from the size of
+            the texture.  Until the texture is loaded, they are all zero.
+        */
+        void _generateTexCoords() const;
+
+        /** Once a texture loading in the background arrives, calculate the
+            texture coordinates again and rebuild every chunk
+        */
+        void _refreshTexCoords() const;
+
+        /** Set the texture the tiles are drawn from, moving the reference to
+            its handle (see TextureManager::AddTextureRef)
+        */
+        void _setTextureItem( TextureItem* textureItem );
+
+        /** Read a tile map
+            @return False if any cell had to be clamped (see EncodeCells)
+        */
+        static bool _readTileMap( TiXmlNode* mapNode, SourceMap& map );
+
+        /** Point the map at the arrays owned by the tileset */
+        void _useOwnedCells();
+
+        /** Empty the map, leaving the tileset's sources in place */
+        void _clearMap();
+
+        /** Copy a shared map into the arrays owned by the tileset, so that
+            it can be edited
+        */
+        void _makeCellsEditable();
+
+        /** @struct CellEditLess
+            Orders cell edits by row, then column
+        */
+        struct CellEditLess
+        {
+            bool operator()( const CellEdit& a, const CellEdit& b ) const
+            {
+                return a.y < b.y || ( a.y == b.y && a.x < b.x );
+            }
+        };
+
+        /** Merge edits of cells which are not stored into the runs.  Where a
+            cell is edited more than once, the last edit is kept.  Only the
+            rows being edited are rebuilt.
+            @param  edits   Edits of cells which are not stored; these are
+                            sorted by the merge
+        */
+        void _insertCells( CellEditArray& edits );
+
+        /** Replace the runs of a row of the owned arrays.  The new runs are
+            put at the end of the arrays, so the cost depends only on the
+            row.
+            @param  y       Row to replace
+            @param  cells   Stored cells of the row, ordered by column
+        */
+        void _storeRow( Int y, const CellEditArray& cells );
+
+        /** Put the rows of the owned arrays back in order, dropping the runs
+            left behind by rows which were moved
+        */
+        void _compactCells();
+
+        /** Update the memory counts of the owned arrays */
+        void _countOwnedMemory();
+
+        /** Add the chunk holding a cell to the chunks of the cell's sequence,
+            if the cell references one
+        */
+        void _indexSequenceCell( Int x, Int y, SInt32 tileIndex );
+
+        /** Find the first span in a row which ends after a column */
+        UInt32 _findSpan( Int row, Int column ) const;
+
+        /** Find the first span in a row of a set of runs which ends after a
+            column.  Where the rows are in order, rowEnds is rowSpans + 1.
+        */
+        static UInt32 _findSpan( const UInt32* rowSpans, const UInt32* rowEnds, const TileSpan* spans, Int row, Int column );
+
+        /** Get a cell from a set of runs
+            @return True if the cell is stored; otherwise the cell is empty
+        */
+        static bool _findCell( const UInt32* rowSpans, const UInt32* rowEnds, const TileSpan* spans, const TileCellList& cells,
+                               Int row, Int column, TileMapItem& cell );
+
+        /** Get a cell of the map
+            @return True if the cell is stored; otherwise the cell is empty (or,
+                    for a streamed map, its page is not resident)
+        */
+        bool _findCell( Int x, Int y, TileMapItem& cell ) const;
+
+        /** Copy the cells of a chunk from a set of runs into a build job
+            @param  job         Job receiving the cells
+            @param  chunk       Chunk being built
+            @param  rowSpans    First span of each row of the runs, or null if
+                                there are no cells to copy
+            @param  rowEnds     Index past the last span of each row
+            @param  spans       Runs of cells
+            @param  tiles       Tiles of the stored cells
+            @param  origin      Cell in the map at the top-left of the runs
+        */
+        void _copyChunkCells( ChunkBuildJob* job, const TileChunk& chunk, const UInt32* rowSpans, const UInt32* rowEnds,
+                              const TileSpan* spans, const SInt16* tiles, const Point2D& origin ) const;
 
         /** Read a sequence */
         bool _readSequence( TiXmlNode* seqNode );
 
-        /** Render a span of consecutive tiles in the same row */
-        void _renderTileSpan( TileMap::const_iterator& tileIter, const UInt32& displayListBase, UInt32 count ) const;
+        /** Divide the map into chunks.  The chunks themselves are created as
+            they are drawn (see _getChunk), so a large streamed map only holds
+            those around the view.
+        */
+        void _createChunks();
+
+        /** Get a chunk, creating it if it does not exist */
+        TileChunk& _getChunk( UInt32 chunkIndex ) const;
+
+        /** Get a chunk, or null if it does not exist */
+        TileChunk* _findChunk( UInt32 chunkIndex ) const;
+
+        /** Release all chunks, waiting for any rebuilds in progress */
+        void _releaseChunks();
+
+        /** Make sure a chunk's geometry is ready to be drawn.  Finished
+            rebuilds are collected, and dirty chunks are rebuilt, either
+            immediately or on a worker thread.
+        */
+        void _prepareChunk( UInt32 chunkIndex ) const;
+
+        /** Release the least recently drawn chunks once there are more than
+            MAX_RESIDENT_CHUNKS holding geometry.  The chunks of a streamed
+            map whose pages have been released go as well.
+        */
+        void _evictChunks() const;
+
+        /** Draw the chunks in view */
+        void _renderChunks( const Point2Df& offset, const Viewport& viewport ) const;
+
+        /** Check if the cache holds the part of the map in view */
+        bool _cacheCovers( const Point2Df& offset, const Viewport& viewport ) const;
+
+        /** Draw the layer from the cache, if the cache holds the part of the
+            map in view.
+        */
+        bool _renderCache( const Point2Df& offset, const Viewport& viewport ) const;
+
+        /** Mark the cache as out of date if it overlaps a chunk */
+        void _touchCache( const TileChunk& chunk ) const;
+
+        /** Release the cache texture */
+        void _releaseCache() const;
+
+        /** Take the geometry from a finished build job */
+        void _collectChunkJob( TileChunk& chunk, ChunkBuildJob* job ) const;
+
+        /** Color the quads of a chunk from the light map, if its light has
+            changed since they were last colored
+        */
+        void _lightChunk( UInt32 chunkIndex ) const;
+
+        /** Check if the fog of war is set, and matches the size of the map */
+        bool _hasFog() const;
+
+        /** Find the chunks containing cells which reference each sequence */
+        void _indexSequenceCells();
+
+        /** Restart the sequences, and schedule their first frame changes */
+        void _scheduleSequences();
+
+        /** Point the quads of animated cells at the current frames of their
+            sequences.
+        */
+        void _patchAnimatedCells( TileChunk& chunk, AnimatedCellArray::const_iterator begin, AnimatedCellArray::const_iterator end ) const;
 
     public:
         /** Constructor */
         TileSet();
         /** Constructor */
         TileSet( TiXmlNode* tilesetNode, const String& baseDir, UInt32 mapIndex );
+        /** Copy constructor */
+        TileSet( const TileSet& src );
         /** Destructor */
         ~TileSet();
 
         /** Assignment operator */
         TileSet& operator=( const TileSet& src );
 
+        /** Exchange the contents of two tilesets.  Nothing is copied, so this
+            is how a tileset is moved into a scene.  Both tilesets rebuild
+            their cached geometry.
+        */
+        void Swap( TileSet& src );
+
         /** Less-than operator */
         bool operator<( const TileSet& src ) const;
 
@@ -163,12 +664,103 @@ namespace PGE
         /** Get the size of the map grid (number of horizontal/vertical cells.) */
         const Point2D& GetMapGridSize() const;
 
-        /** Read a tileset */
+        /** Get a cell of the map.  Cells outside the map, and those of a
+            streamed map whose page is not resident, are empty.
+        */
+        TileMapItem GetCell( Int x, Int y ) const;
+
+        /** Change a cell of the map (see ApplyEdits)
+            @return False if the cell is outside the map, or the map can not
+                    be edited
+        */
+        bool SetCell( Int x, Int y, SInt32 tileIndex, SInt32 boundsCode, SInt32 mapCode );
+
+        /** Change a batch of cells of the map.
+
+            Only the chunks holding the cells are marked for rebuilding, and
+            they are rebuilt when next drawn.  Cells which are already stored
+            are changed in place.  Cells which were empty are merged into the
+            runs in one pass for the whole batch, so a large batch costs much
+            less than the same edits made one at a time.  If the map is shared
+            with copies of the tileset, it is copied before it is changed.
+            Values which can not be stored are clamped (see TileCellArray.)
+
+            Streamed maps can not be edited.  A TileCollisionMap,
+            TilePathfinder, TileLightMap or TileFogOfWar built from the map is
+            not changed; give it the same edits.
+            @return Number of edits applied (those inside the map)
+        */
+        UInt32 ApplyEdits( const CellEdit* edits, UInt32 count );
+
+        /** Get the name of the source image of the tiles */
+        const String& GetImageName() const;
+        /** Get the number of tiles horizontally and vertically in the source image */
+        const Point2D& GetTileGridSize() const;
+
+        /** Draw the tiles from a texture atlas rather than the source image.
+            @param  textureName     Name of the atlas page containing the tiles
+            @param  texCoords       Coordinates of each tile in the page
+        */
+        void SetAtlas( const String& textureName, const TileTexCoordArray& texCoords );
+
+        /** Get the texture the tiles are drawn from (the image, or an atlas
+            page), or null if it could not be loaded
+        */
+        TextureItem* GetTextureItem() const;
+
+        /** Get the coordinates of each tile in the texture.  Tile 0 is empty. */
+        const TileTexCoordArray& GetTileTexCoords() const;
+
+        /** Get the tile which stands for a cell in a still picture of the map:
+            the tile itself, or the first frame of a sequence.
+            @return The tile, or 0 if the cell is empty or there is no such
+                    sequence
+        */
+        SInt32 GetStillTile( SInt32 tileIndex ) const;
+
+        /** Read a tileset.  Every map in the tileset is read, and the tiles
+            are generated once; copies of the tileset share both, so other
+            maps can be used through SelectMap on a copy without reading the
+            tileset again.
+            @param  tilesetNode     Pointer to the 'tileset' node
+            @param  baseDir         Directory the image names are relative to
+            @param  mapIndex        Index of the map to use from the tileset
+        */
         bool ReadTileSet( TiXmlNode* tilesetNode, const String& baseDir, UInt32 mapIndex );
 
+        /** Read a tileset from a compiled map file.  The cells are used where
+            they lie in the file, so the file stays open for as long as the
+            tileset uses it.  As with the xml, the other maps of the tileset
+            are available through SelectMap.
+            @param  file            Compiled map file
+            @param  tileSetNum      Index of the tileset record in the file
+            @param  baseDir         Directory the image names are relative to
+            @param  mapIndex        Index of the map to use from the tileset
+        */
+        bool ReadTileSet( const TileMapFile& file, UInt32 tileSetNum, const String& baseDir, UInt32 mapIndex );
+
         /** Release all data allocated by the tileset */
         void Release();
 
+        /** Get the number of maps in the tileset */
+        UInt32 GetMapCount() const;
+
+        /** Get the index of the map in use */
+        UInt32 GetMapIndex() const;
+
+        /** Use another map of the tileset.  The map, tiles and texture are
+            shared with any copies of the tileset, so nothing is read again;
+            only the cached geometry is rebuilt.
+            @return False if the tileset has no such map, in which case the
+                    map is left empty
+        */
+        bool SelectMap( UInt32 mapIndex );
+
+        /** Mark the chunks covering a block of cells as needing to be rebuilt.
+            This must be called whenever cells in the map are changed.
+        */
+        void InvalidateCells( Int x, Int y, Int w, Int h );
+
         /** Update the scene based on elapsed time (prepare any sequences) */
         void Update( PGE::Real32 elapsedMS ) const;
 
@@ -179,8 +771,80 @@ namespace PGE
         */
         void Render( const Point2Df& offset, const Viewport& viewport ) const;
 
+        /** Get the draw call and vertex counts from the most recent render */
+        const TileRenderStats& GetRenderStats() const;
+
+        /** Draw the layer from an offscreen copy of the area around the view,
+            rather than from its tiles.  This suits distant parallax layers,
+            which change rarely and scroll slowly.  The copy is redrawn only
+            when the view leaves the cached area, or a cell in the area
+            changes (including animated cells changing frames.)
+            @param  enable      Indicates the layer should be cached
+            @param  margin      Number of pixels to cache beyond each side of
+                                the view
+        */
+        void SetRenderCache( bool enable, UInt32 margin = 256 );
+
+        /** Check if the layer is drawn from an offscreen copy */
+        bool IsRenderCached() const;
+
+        /** Redraw the offscreen copy of the layer if it no longer covers the
+            view.  The copy is drawn in the back buffer, so this must be done
+            before anything else is drawn in the frame, and the back buffer
+            must be cleared afterwards.
+            @return True if the back buffer was used
+        */
+        bool RefreshRenderCache( const Point2Df& offset, const Viewport& viewport ) const;
+
+        /** Get the empty cell ratio and memory use of the map.  For a streamed
+            map, the memory is what the map would use if every page were
+            resident.
+        */
+        const TileMapStats& GetMapStats() const;
+
+        /** Check if the map is streamed in pages (see TileMapPager) */
+        bool IsStreaming() const;
+
+        /** Get the pager streaming the map, or null if the map is not paged */
+        const TileMapPager* GetPager() const;
+
+        /** Set how far around the view the pages of a streamed map are kept
+            @param  loadRadius  Number of pages around the visible pages to load
+            @param  hysteresis  Number of pages beyond the load radius before a
+                                page is released
+        */
+        void SetStreamingRadius( UInt32 loadRadius, UInt32 hysteresis );
+
+        /** Draw the tiles lit by a light map.  The light at the corners of
+            each tile is given to its vertices, and the chunks are recolored
+            as their light changes.  The light map is not owned, and must be
+            built from the same map; it is only used while its size matches
+            the map.  A layer drawn from its render cache shows changes of
+            light when the cache is next drawn.
+            @param  lightMap    Light map, or null to draw the tiles unlit
+        */
+        void SetLightMap( const TileLightMap* lightMap );
+
+        /** Get the light map the tiles are drawn with, or null */
+        const TileLightMap* GetLightMap() const;
+
+        /** Draw only the cells a team has explored.  Chunks the team has not
+            seen at all are skipped, and the others are rebuilt as more of
+            their cells are seen.  The fog of war is not owned, and must be
+            built from the same map; it is only used while its size matches
+            the map.
+            @param  fogOfWar    Fog of war, or null to draw every cell
+            @param  team        Team whose explored cells are drawn
+        */
+        void SetFogOfWar( const TileFogOfWar* fogOfWar, UInt32 team = 0 );
+
+        /** Get the fog of war hiding the cells, or null */
+        const TileFogOfWar* GetFogOfWar() const;
+
     }; // class TileSet
 
+    typedef SharedPtr< TileSet > TileSetPtr;
+
 } // namespace PGE
 
 #endif  // PgeTileSet_H_
@@ -0,0 +1,155 @@
+/*! $Id$
+ *  @file   PgeWorkQueue.h
+ *  @author agent
+ *  @date   October 17, 2026
+ *  @brief  A pool of worker threads which execute queued work items.
+ *
+ */
+
+#ifndef PGEWORKQUEUE_H
+#define PGEWORKQUEUE_H
+
+#include <deque>
+#include <vector>
+#include "PgeTypes.h"
+#include "PgeSingleton.h"
+#include "PgeThread.h"
+
+namespace PGE
+{
+    /** @class WorkItem
+        A unit of work which can be executed by the work queue.  Derived
+        classes implement Execute.
+
+        @remarks
+            The queue does not take ownership of the items.  Whoever submits an
+            item must keep it alive until it is complete (or cancelled), and is
+            responsible for deleting it.
+    */
+    class _PgeExport WorkItem
+    {
+        friend class WorkQueue;
+
+    public:
+        /** @enum State
+            The states an item goes through on its way through the queue
+        */
+        enum State
+        {
+            Idle,               ///< Not submitted to a queue
+            Pending,            ///< Waiting for a worker thread
+            Running,            ///< Being executed
+            Complete            ///< Finished executing
+        };
+
+    private:
+        mutable Mutex   mMutex;
+        State           mState;
+
+        /** Set the state of the item */
+        void _setState( State state );
+
+    public:
+        /** Constructor */
+        WorkItem();
+        /** Destructor */
+        virtual ~WorkItem();
+
+        /** Perform the work.  This is called from a worker thread, so it must
+            not touch the GL context, or any data that is being modified by
+            other threads.
+        */
+        virtual void Execute() = 0;
+
+        /** Get the current state of the item */
+        State GetState() const;
+
+        /** Check if the item has finished executing */
+        bool IsComplete() const             { return GetState() == Complete; }
+
+        /** Check if the item is waiting for, or being executed by, a worker */
+        bool IsBusy() const;
+    };
+
+    /** @class WorkQueue
+        Maintains a set of worker threads, and feeds them items to execute.
+
+        @remarks
+            When the queue is created with no worker threads, items are executed
+            immediately on the thread which submits them.  This makes it safe to
+            write code against the queue even on single processor machines.
+    */
+    class _PgeExport WorkQueue : public Singleton< WorkQueue >
+    {
+    private:
+        /** @class WorkerThread
+            Thread which pulls items from the queue until the queue shuts down.
+        */
+        class WorkerThread : public Thread
+        {
+        private:
+            WorkQueue*  mQueue;
+
+        protected:
+            void Run();
+
+        public:
+            WorkerThread( WorkQueue* queue ) : mQueue( queue )  { }
+        };
+
+        typedef std::deque< WorkItem* >         ItemQueue;
+        ItemQueue                               mPending;
+        typedef std::vector< WorkerThread* >    ThreadArray;
+        ThreadArray                             mThreads;
+        Mutex                                   mMutex;
+        Semaphore                               mSignal;    ///< Posted once for each submitted item, and once for each thread on shut down
+        bool                                    mQuit;
+
+        /** Get the next item to execute, waiting for one if needed.  Returns
+            null when the queue is shutting down.
+        */
+        WorkItem* _nextItem();
+
+        /** Remove an item from the pending queue.  The mutex must be held. */
+        bool _removePending( WorkItem* item );
+
+    public:
+        /** Constructor
+            @param  threadCount     Number of worker threads.  Use -1 to create
+                                    one fewer thread than there are processors,
+                                    which leaves a processor free for the main
+                                    thread.
+        */
+        WorkQueue( Int threadCount = -1 );
+
+        /** Destructor.  Items still pending are discarded, and the worker
+            threads are stopped.
+        */
+        virtual ~WorkQueue();
+
+        /** Override singleton retrieval to avoid link errors */
+        static WorkQueue& GetSingleton();
+        /** Override singleton pointer retrieval to avoid link errors */
+        static WorkQueue* GetSingletonPtr();
+
+        /** Get the number of worker threads */
+        UInt32 GetThreadCount() const       { return mThreads.size(); }
+
+        /** Add an item to the queue */
+        void Submit( WorkItem* item );
+
+        /** Remove an item from the queue before it starts executing.
+            @return True if the item was removed, false if it had already
+                    been started (or was never submitted.)
+        */
+        bool Cancel( WorkItem* item );
+
+        /** Wait for an item to complete.  If it has not been started yet, it
+            is executed on the calling thread.
+        */
+        void Wait( WorkItem* item );
+    };
+
+} // namespace PGE
+
+#endif // PGEWORKQUEUE_H
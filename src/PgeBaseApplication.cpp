@@ -16,6 +16,7 @@
 #include "PgeArchiveManager.h"
 #include "PgeTextureManager.h"
 #include "PgeFontManager.h"
+#include "PgeWorkQueue.h"
 //#include "PgeLogFileManager.h"
 //#include "PgeTileMap.h"
 //#include "PgeStringUtil.h"
@@ -47,6 +48,7 @@ namespace PGE
         mArchiveManager.SetNull();
         mFontManager.SetNull();
         mOverlayManager.SetNull();
+        mWorkQueue.SetNull();
     }
 
     //Init----------------------------------------------------------------------
@@ -78,6 +80,7 @@ namespace PGE
         mTextureManager = TextureManagerPtr( new TextureManager() );
         mFontManager    = FontManagerPtr( new FontManager() );
         mOverlayManager = OverlayManagerPtr( new OverlayManager() );
+        mWorkQueue      = WorkQueuePtr( new WorkQueue() );
 
         // Perform additional initialization:
         AdditionalInit();
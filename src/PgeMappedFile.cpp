@@ -0,0 +1,155 @@
+/*! $Id$
+ *  @file   PgeMappedFile.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeMappedFile.h"
+#include "PgeArchiveFile.h"
+#include "PgeArchiveManager.h"
+#include "PgeStringUtil.h"
+#include "physfs.h"
+
+#include <fstream>
+
+#if ( PGE_PLATFORM != PGE_PLATFORM_WIN32 )
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+namespace PGE
+{
+    //Constructor
+    MappedFile::MappedFile()
+        : mData( 0 ),
+          mSize( 0 ),
+          mIsMapped( false ),
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+          mFile( INVALID_HANDLE_VALUE ),
+          mMapping( 0 )
+#else
+          mFile( -1 )
+#endif
+    {
+    }
+
+    //Destructor
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+    //_map----------------------------------------------------------------------
+    bool MappedFile::_map( const String& path )
+    {
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        mFile = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0 );
+        if ( mFile == INVALID_HANDLE_VALUE )
+            return false;
+
+        mSize = GetFileSize( mFile, 0 );
+        if ( mSize == 0 || mSize == INVALID_FILE_SIZE )
+            return false;
+        mMapping = CreateFileMapping( mFile, 0, PAGE_READONLY, 0, 0, 0 );
+        if ( !mMapping )
+            return false;
+        mData = static_cast< const UInt8* >( MapViewOfFile( mMapping, FILE_MAP_READ, 0, 0, 0 ) );
+#else
+        mFile = open( path.c_str(), O_RDONLY );
+        if ( mFile < 0 )
+            return false;
+
+        struct stat info;
+        if ( fstat( mFile, &info ) != 0 || info.st_size == 0 )
+            return false;
+        mSize = info.st_size;
+        void* data = mmap( 0, mSize, PROT_READ, MAP_PRIVATE, mFile, 0 );
+        mData = ( data != MAP_FAILED ) ? static_cast< const UInt8* >( data ) : 0;
+#endif
+        mIsMapped = ( mData != 0 );
+        return mIsMapped;
+    }
+
+    //Open----------------------------------------------------------------------
+    bool MappedFile::Open( const String& resName, UInt32 readSize )
+    {
+        Close();
+
+        // Map the file if it is loose in a directory on the search path
+        String fileName = StringUtil::FixPath( resName );
+        const char* realDir = PHYSFS_getRealDir( fileName.c_str() );
+        if ( realDir && _map( String( realDir ) + PHYSFS_getDirSeparator() + fileName ) )
+            return true;
+        Close();
+
+        // Otherwise, read the file (or as much of it as was asked for)
+        if ( !ArchiveManager::GetSingleton().Exists( fileName ) )
+            return false;
+        ArchiveFile* file = ArchiveManager::GetSingleton().CreateArchiveFile( fileName );
+        if ( !file )
+            return false;
+        UInt32 length = file->Length();
+        mBuffer.resize( ( readSize > 0 && readSize < length ) ? readSize : length );
+        if ( !mBuffer.empty() )
+            mBuffer.resize( file->Read( &mBuffer[ 0 ], mBuffer.size() ) );
+        delete file;
+
+        mSize = mBuffer.size();
+        mData = mSize ? &mBuffer[ 0 ] : 0;
+        return ( mData != 0 );
+    }
+
+    //OpenPath------------------------------------------------------------------
+    bool MappedFile::OpenPath( const String& path )
+    {
+        Close();
+        if ( _map( path ) )
+            return true;
+        Close();
+
+        std::ifstream file( path.c_str(), std::ios::in | std::ios::binary );
+        if ( !file )
+            return false;
+        file.seekg( 0, std::ios::end );
+        std::streamoff length = file.tellg();
+        file.seekg( 0, std::ios::beg );
+        if ( length <= 0 )
+            return false;
+        mBuffer.resize( length );
+        file.read( reinterpret_cast< char* >( &mBuffer[ 0 ] ), length );
+        mBuffer.resize( file.gcount() );
+
+        mSize = mBuffer.size();
+        mData = mSize ? &mBuffer[ 0 ] : 0;
+        return ( mData != 0 );
+    }
+
+    //Close---------------------------------------------------------------------
+    void MappedFile::Close()
+    {
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        if ( mIsMapped )
+            UnmapViewOfFile( mData );
+        if ( mMapping )
+            CloseHandle( mMapping );
+        if ( mFile != INVALID_HANDLE_VALUE )
+            CloseHandle( mFile );
+        mMapping = 0;
+        mFile = INVALID_HANDLE_VALUE;
+#else
+        if ( mIsMapped )
+            munmap( const_cast< UInt8* >( mData ), mSize );
+        if ( mFile >= 0 )
+            close( mFile );
+        mFile = -1;
+#endif
+        std::vector< UInt8 >().swap( mBuffer );
+        mData = 0;
+        mSize = 0;
+        mIsMapped = false;
+    }
+
+} // namespace PGE
@@ -0,0 +1,405 @@
+/*! $Id$
+ *  @file   PgeTextureAtlas.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeTextureAtlas.h"
+#include "PgeMath.h"
+#include "PgeStringUtil.h"
+#include "PgeArchiveManager.h"
+#include "PgeXmlArchiveFile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string.h>
+
+namespace PGE
+{
+    /** Sorts block indices so that the tallest blocks are packed first */
+    struct BlockHeightGreater
+    {
+        const std::vector< Point2D >* extents;
+
+        bool operator()( UInt32 a, UInt32 b ) const
+        {
+            return ( *extents )[ a ].y > ( *extents )[ b ].y;
+        }
+    };
+
+    //Constructor
+    TextureAtlas::TextureAtlas( const String& name, UInt32 pageSize, UInt32 gutter )
+        : mName( name ),
+          mPageSize( pageSize ),
+          mGutter( gutter )
+    {
+    }
+
+    //_getBlockExtent-----------------------------------------------------------
+    Point2D TextureAtlas::_getBlockExtent( const Block& block ) const
+    {
+        return Point2D( block.gridSize.x * ( block.tileSize.x + 2 * mGutter ),
+                        block.gridSize.y * ( block.tileSize.y + 2 * mGutter ) );
+    }
+
+    //_copyBlock----------------------------------------------------------------
+    void TextureAtlas::_copyBlock( const Block& block, const ImageData& source )
+    {
+        ImageData& page = mPages[ block.page ];
+        Int gutter = mGutter;
+        Int cellWidth  = block.tileSize.x + 2 * gutter;
+        Int cellHeight = block.tileSize.y + 2 * gutter;
+
+        for ( Int row = 0; row < block.gridSize.y; row++ )
+        {
+            for ( Int col = 0; col < block.gridSize.x; col++ )
+            {
+                // The part of the tile which actually exists in the source
+                // image (the grid may extend past a clipped image)
+                Int srcX = col * block.tileSize.x;
+                Int srcY = row * block.tileSize.y;
+                Int srcWidth  = Math::IMin( block.tileSize.x, Int( source.width ) - srcX );
+                Int srcHeight = Math::IMin( block.tileSize.y, Int( source.height ) - srcY );
+                if ( srcWidth <= 0 || srcHeight <= 0 )
+                    continue;
+
+                Int destX = block.position.x + col * cellWidth;
+                Int destY = block.position.y + row * cellHeight;
+                for ( Int y = 0; y < cellHeight; y++ )
+                {
+                    // Rows in the gutter repeat the nearest edge row of the tile
+                    Int tileY = Math::IClamp( y - gutter, 0, srcHeight - 1 );
+                    const UInt8* srcRow = source.GetPixel( srcX, srcY + tileY );
+                    UInt8* destRow = page.GetPixel( destX, destY + y );
+
+                    for ( Int x = 0; x < gutter; x++ )
+                        memcpy( destRow + x * 4, srcRow, 4 );
+                    memcpy( destRow + gutter * 4, srcRow, srcWidth * 4 );
+                    for ( Int x = gutter + srcWidth; x < cellWidth; x++ )
+                        memcpy( destRow + x * 4, srcRow + ( srcWidth - 1 ) * 4, 4 );
+                }
+            }
+        }
+    }
+
+    //AddTileGrid---------------------------------------------------------------
+    bool TextureAtlas::AddTileGrid( const String& name, const ImageData& image, const Point2D& tileSize, const Point2D& gridSize )
+    {
+        if ( FindBlock( name ) >= 0 )
+            return true;
+        if ( image.pixels.empty() || tileSize.x <= 0 || tileSize.y <= 0 || gridSize.x <= 0 || gridSize.y <= 0 )
+            return false;
+
+        Block block;
+        block.name      = name;
+        block.tileSize  = tileSize;
+        block.gridSize  = gridSize;
+        block.page      = 0;
+        mBlocks.push_back( block );
+        mSources.push_back( image );
+        return true;
+    }
+
+    //Build---------------------------------------------------------------------
+    bool TextureAtlas::Build()
+    {
+        if ( mBlocks.empty() || mSources.size() != mBlocks.size() )
+            return false;
+
+        mPages.clear();
+        mPageSizes.clear();
+        mPageNames.clear();
+
+        std::vector< Point2D > extents( mBlocks.size() );
+        std::vector< UInt32 > order( mBlocks.size() );
+        for ( UInt32 i = 0; i < mBlocks.size(); i++ )
+        {
+            extents[ i ] = _getBlockExtent( mBlocks[ i ] );
+            order[ i ] = i;
+        }
+        BlockHeightGreater compare;
+        compare.extents = &extents;
+        std::stable_sort( order.begin(), order.end(), compare );
+
+        // Pack the blocks onto shelves.  A new shelf is started when a block
+        // does not fit at the end of the current one, and a new page when the
+        // shelf would not fit on the page.  A block too big for a page gets a
+        // page of its own.
+        std::vector< Point2D > used;        // Extent of the packed blocks on each page
+        Int page = -1;
+        Point2D cursor;
+        Int shelfHeight = 0;
+        Int pageSize = mPageSize;
+        for ( UInt32 i = 0; i < order.size(); i++ )
+        {
+            Block& block = mBlocks[ order[ i ] ];
+            const Point2D& extent = extents[ order[ i ] ];
+            if ( extent.x > pageSize || extent.y > pageSize )
+            {
+                block.page      = used.size();
+                block.position  = Point2D( 0, 0 );
+                used.push_back( extent );
+                page = -1;
+                continue;
+            }
+
+            if ( page >= 0 && cursor.x + extent.x > pageSize )
+            {
+                cursor.x = 0;
+                cursor.y += shelfHeight;
+                shelfHeight = 0;
+            }
+            if ( page < 0 || cursor.y + extent.y > pageSize )
+            {
+                page = used.size();
+                used.push_back( Point2D( 0, 0 ) );
+                cursor = Point2D( 0, 0 );
+                shelfHeight = 0;
+            }
+
+            block.page      = page;
+            block.position  = cursor;
+            cursor.x += extent.x;
+            shelfHeight = Math::IMax( shelfHeight, extent.y );
+            used[ page ].x = Math::IMax( used[ page ].x, cursor.x );
+            used[ page ].y = Math::IMax( used[ page ].y, cursor.y + extent.y );
+        }
+
+        // Each page only needs to be big enough for what was packed into it
+        mPages.resize( used.size() );
+        for ( UInt32 i = 0; i < used.size(); i++ )
+        {
+            Point2D size( Math::FindNextPowerOf2( used[ i ].x ), Math::FindNextPowerOf2( used[ i ].y ) );
+            mPages[ i ].Resize( size.x, size.y );
+            mPageSizes.push_back( size );
+            mPageNames.push_back( mName + StringUtil::ToString( i ) + ".tga" );
+        }
+
+        for ( UInt32 i = 0; i < mBlocks.size(); i++ )
+            _copyBlock( mBlocks[ i ], mSources[ i ] );
+        mSources.clear();
+
+        return true;
+    }
+
+    //Upload--------------------------------------------------------------------
+    bool TextureAtlas::Upload( GLuint minFilter, GLuint maxFilter )
+    {
+        TextureManager& textureManager = TextureManager::GetSingleton();
+        bool result = true;
+        for ( UInt32 i = 0; i < mPageNames.size(); i++ )
+        {
+            if ( i < mPages.size() )
+                result &= textureManager.CreateTexture( mPageNames[ i ], mPages[ i ], minFilter, maxFilter );
+            else
+                result &= textureManager.LoadImage( mPageNames[ i ], minFilter, maxFilter, false, true );
+        }
+
+        // The pixels are in video memory now
+        mPages.clear();
+        return result;
+    }
+
+    //Save----------------------------------------------------------------------
+    bool TextureAtlas::Save( const String& fileName ) const
+    {
+        if ( mPages.size() != mPageNames.size() )
+            return false;
+
+        String baseDir, title;
+        StringUtil::SplitFilename( fileName, baseDir, title );
+
+        TiXmlDocument doc;
+        TiXmlElement* atlasNode = new TiXmlElement( "atlas" );
+        doc.LinkEndChild( atlasNode );
+
+        TiXmlElement* node = new TiXmlElement( "gutter" );
+        node->LinkEndChild( new TiXmlText( StringUtil::ToString( mGutter ).c_str() ) );
+        atlasNode->LinkEndChild( node );
+
+        TiXmlElement* pageList = new TiXmlElement( "pageList" );
+        atlasNode->LinkEndChild( pageList );
+        for ( UInt32 i = 0; i < mPages.size(); i++ )
+        {
+            // Write the page as an uncompressed 32 bit TGA, with the top row
+            // first so that it matches the in-memory layout.
+            String pageFile = mName + StringUtil::ToString( i ) + ".tga";
+            String pageTitle, pagePath;
+            StringUtil::SplitFilename( pageFile, pagePath, pageTitle );
+            std::ofstream file( ( baseDir.empty() ? pageTitle : baseDir + "/" + pageTitle ).c_str(), std::ios::binary );
+            if ( !file )
+                return false;
+
+            const ImageData& image = mPages[ i ];
+            UInt8 header[ 18 ] = { 0 };
+            header[ 2 ]  = 2;
+            header[ 12 ] = image.width & 0xff;
+            header[ 13 ] = ( image.width >> 8 ) & 0xff;
+            header[ 14 ] = image.height & 0xff;
+            header[ 15 ] = ( image.height >> 8 ) & 0xff;
+            header[ 16 ] = 32;
+            header[ 17 ] = 0x28;
+            file.write( reinterpret_cast< const char* >( header ), sizeof( header ) );
+
+            std::vector< UInt8 > row( image.width * 4 );
+            for ( UInt32 y = 0; y < image.height; y++ )
+            {
+                const UInt8* src = image.GetPixel( 0, y );
+                for ( UInt32 x = 0; x < image.width * 4; x += 4 )
+                {
+                    row[ x + 0 ] = src[ x + 2 ];
+                    row[ x + 1 ] = src[ x + 1 ];
+                    row[ x + 2 ] = src[ x + 0 ];
+                    row[ x + 3 ] = src[ x + 3 ];
+                }
+                file.write( reinterpret_cast< const char* >( &row[ 0 ] ), row.size() );
+            }
+
+            TiXmlElement* pageNode = new TiXmlElement( "page" );
+            pageList->LinkEndChild( pageNode );
+            node = new TiXmlElement( "file" );
+            node->LinkEndChild( new TiXmlText( pageTitle.c_str() ) );
+            pageNode->LinkEndChild( node );
+            node = new TiXmlElement( "width" );
+            node->LinkEndChild( new TiXmlText( StringUtil::ToString( image.width ).c_str() ) );
+            pageNode->LinkEndChild( node );
+            node = new TiXmlElement( "height" );
+            node->LinkEndChild( new TiXmlText( StringUtil::ToString( image.height ).c_str() ) );
+            pageNode->LinkEndChild( node );
+        }
+
+        TiXmlElement* blockList = new TiXmlElement( "blockList" );
+        atlasNode->LinkEndChild( blockList );
+        BlockArray::const_iterator iter = mBlocks.begin();
+        for ( iter; iter != mBlocks.end(); iter++ )
+        {
+            TiXmlElement* blockNode = new TiXmlElement( "block" );
+            blockList->LinkEndChild( blockNode );
+
+            const char* names[] = { "name", "page", "x", "y", "tileWidth", "tileHeight", "horizontalTileCount", "verticalTileCount" };
+            String values[] = { iter->name,
+                                StringUtil::ToString( iter->page ),
+                                StringUtil::ToString( iter->position.x ),
+                                StringUtil::ToString( iter->position.y ),
+                                StringUtil::ToString( iter->tileSize.x ),
+                                StringUtil::ToString( iter->tileSize.y ),
+                                StringUtil::ToString( iter->gridSize.x ),
+                                StringUtil::ToString( iter->gridSize.y ) };
+            for ( UInt32 i = 0; i < 8; i++ )
+            {
+                node = new TiXmlElement( names[ i ] );
+                node->LinkEndChild( new TiXmlText( values[ i ].c_str() ) );
+                blockNode->LinkEndChild( node );
+            }
+        }
+
+        return doc.SaveFile( fileName.c_str() );
+    }
+
+    //Load----------------------------------------------------------------------
+    bool TextureAtlas::Load( const String& fileName )
+    {
+        XmlArchiveFile doc( ArchiveManager::GetSingleton().CreateArchiveFile( fileName ) );
+        if ( !doc.LoadFile() )
+            return false;
+        TiXmlNode* atlasNode = doc.FirstChild( "atlas" );
+        if ( !atlasNode )
+            return false;
+
+        String baseDir, title;
+        StringUtil::SplitFilename( fileName, baseDir, title );
+
+        mBlocks.clear();
+        mSources.clear();
+        mPages.clear();
+        mPageSizes.clear();
+        mPageNames.clear();
+        mGutter = StringUtil::ToInt( XmlArchiveFile::GetItemValue( atlasNode->FirstChild( "gutter" ) ) );
+
+        TiXmlNode* listNode = atlasNode->FirstChild( "pageList" );
+        TiXmlNode* node = listNode ? listNode->FirstChild( "page" ) : 0;
+        while ( node )
+        {
+            String pageFile = XmlArchiveFile::GetItemValue( node->FirstChild( "file" ) );
+            mPageNames.push_back( StringUtil::FixPath( baseDir + "/" + pageFile ) );
+            mPageSizes.push_back( Point2D( StringUtil::ToInt( XmlArchiveFile::GetItemValue( node->FirstChild( "width" ) ) ),
+                                           StringUtil::ToInt( XmlArchiveFile::GetItemValue( node->FirstChild( "height" ) ) ) ) );
+            node = node->NextSibling( "page" );
+        }
+
+        listNode = atlasNode->FirstChild( "blockList" );
+        node = listNode ? listNode->FirstChild( "block" ) : 0;
+        while ( node )
+        {
+            Block block;
+            block.name          = XmlArchiveFile::GetItemValue( node->FirstChild( "name" ) );
+            block.page          = StringUtil::ToInt( XmlArchiveFile::GetItemValue( node->FirstChild( "page" ) ) );
+            block.position.x    = StringUtil::ToInt( XmlArchiveFile::GetItemValue( node->FirstChild( "x" ) ) );
+            block.position.y    = StringUtil::ToInt( XmlArchiveFile::GetItemValue( node->FirstChild( "y" ) ) );
+            block.tileSize.x    = StringUtil::ToInt( XmlArchiveFile::GetItemValue( node->FirstChild( "tileWidth" ) ) );
+            block.tileSize.y    = StringUtil::ToInt( XmlArchiveFile::GetItemValue( node->FirstChild( "tileHeight" ) ) );
+            block.gridSize.x    = StringUtil::ToInt( XmlArchiveFile::GetItemValue( node->FirstChild( "horizontalTileCount" ) ) );
+            block.gridSize.y    = StringUtil::ToInt( XmlArchiveFile::GetItemValue( node->FirstChild( "verticalTileCount" ) ) );
+            if ( block.page < mPageNames.size() )
+                mBlocks.push_back( block );
+            node = node->NextSibling( "block" );
+        }
+
+        return !mPageNames.empty();
+    }
+
+    //FindBlock-----------------------------------------------------------------
+    Int TextureAtlas::FindBlock( const String& name ) const
+    {
+        for ( UInt32 i = 0; i < mBlocks.size(); i++ )
+        {
+            if ( mBlocks[ i ].name == name )
+                return i;
+        }
+        return -1;
+    }
+
+    //GetTileTexCoords----------------------------------------------------------
+    bool TextureAtlas::GetTileTexCoords( const String& name, TileTexCoordArray& texCoords ) const
+    {
+        Int index = FindBlock( name );
+        if ( index < 0 || mBlocks[ index ].page >= mPageSizes.size() )
+            return false;
+
+        const Block& block = mBlocks[ index ];
+        const Point2D& pageSize = mPageSizes[ block.page ];
+        Int cellWidth  = block.tileSize.x + 2 * mGutter;
+        Int cellHeight = block.tileSize.y + 2 * mGutter;
+
+        texCoords.clear();
+        texCoords.resize( block.gridSize.x * block.gridSize.y + 1 );
+        UInt32 count = 1;
+        for ( Int row = 0; row < block.gridSize.y; row++ )
+        {
+            for ( Int col = 0; col < block.gridSize.x; col++ )
+            {
+                Int x = block.position.x + col * cellWidth + mGutter;
+                Int y = block.position.y + row * cellHeight + mGutter;
+
+                TileTexCoords& tex = texCoords[ count++ ];
+                tex.u0 = x / Real( pageSize.x );
+                tex.v0 = y / Real( pageSize.y );
+                tex.u1 = ( x + block.tileSize.x ) / Real( pageSize.x );
+                tex.v1 = ( y + block.tileSize.y ) / Real( pageSize.y );
+            }
+        }
+
+        return true;
+    }
+
+    //GetBlockPageName----------------------------------------------------------
+    const String& TextureAtlas::GetBlockPageName( const String& name ) const
+    {
+        Int index = FindBlock( name );
+        if ( index < 0 )
+            return StringUtil::BLANK;
+        return mPageNames[ mBlocks[ index ].page ];
+    }
+
+} // namespace PGE
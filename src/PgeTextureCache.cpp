@@ -0,0 +1,202 @@
+/*! $Id$
+ *  @file   PgeTextureCache.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeTextureCache.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace PGE
+{
+    const UInt32 TextureCache::MAGIC    = 0x54454750;   // "PGET"
+    const UInt32 TextureCache::VERSION  = 1;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // TextureCache::Entry
+    ////////////////////////////////////////////////////////////////////////////
+
+    //Constructor
+    TextureCache::Entry::Entry()
+        : mHeader( 0 )
+    {
+    }
+
+    //Close---------------------------------------------------------------------
+    void TextureCache::Entry::Close()
+    {
+        mHeader = 0;
+        mFile.Close();
+    }
+
+    //GetLevels-----------------------------------------------------------------
+    void TextureCache::Entry::GetLevels( ImageLevelArray& levels ) const
+    {
+        if ( mHeader )
+            TextureCache::GetLevels( mFile.GetData(), mHeader, levels );
+        else
+            levels.clear();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // TextureCache
+    ////////////////////////////////////////////////////////////////////////////
+
+    //Constructor
+    TextureCache::TextureCache( const String& directory )
+        : mDirectory( directory )
+    {
+    }
+
+    //MakeKey-------------------------------------------------------------------
+    TextureCache::Key TextureCache::MakeKey( const UInt8* data, UInt32 size, UInt32 options )
+    {
+        // 64-bit FNV-1a
+        UInt64 hash = 14695981039346656037ULL;
+        for ( const UInt8* byte = data; byte != data + size; byte++ )
+        {
+            hash ^= *byte;
+            hash *= 1099511628211ULL;
+        }
+
+        Key key;
+        key.hashLow     = UInt32( hash & 0xFFFFFFFF );
+        key.hashHigh    = UInt32( hash >> 32 );
+        key.sourceSize  = size;
+        key.options     = options;
+        return key;
+    }
+
+    //GetEntryPath--------------------------------------------------------------
+    String TextureCache::GetEntryPath( const Key& key ) const
+    {
+        char name[ 64 ];
+        sprintf( name, "%08lx%08lx-%lx.pgetex", ( unsigned long )key.hashHigh, ( unsigned long )key.hashLow, ( unsigned long )key.options );
+        if ( mDirectory.empty() )
+            return name;
+        return mDirectory + "/" + name;
+    }
+
+    //ReadHeader----------------------------------------------------------------
+    const TextureCache::Header* TextureCache::ReadHeader( const UInt8* data, UInt32 size, const Key* key )
+    {
+        if ( !data || size < sizeof( Header ) )
+            return 0;
+
+        // Check everything the levels are read from, so a damaged or stale
+        // entry is ignored rather than misread
+        const Header* header = reinterpret_cast< const Header* >( data );
+        bool isValid = ( header->magic == MAGIC && header->version == VERSION && header->fileSize == size &&
+                         header->levelCount > 0 && header->levelOffset >= sizeof( Header ) &&
+                         header->levelOffset <= size &&
+                         header->levelCount <= ( size - header->levelOffset ) / sizeof( LevelRecord ) );
+        if ( isValid && key )
+        {
+            isValid = ( header->key.hashLow == key->hashLow && header->key.hashHigh == key->hashHigh &&
+                        header->key.sourceSize == key->sourceSize && header->key.options == key->options );
+        }
+        const LevelRecord* records = reinterpret_cast< const LevelRecord* >( data + header->levelOffset );
+        for ( UInt32 i = 0; isValid && i < header->levelCount; i++ )
+        {
+            const LevelRecord& level = records[ i ];
+            isValid = ( level.width > 0 && level.height > 0 && level.dataSize == level.width * level.height * 4 &&
+                        level.dataOffset <= size && level.dataSize <= size - level.dataOffset );
+        }
+        return isValid ? header : 0;
+    }
+
+    //GetLevels-----------------------------------------------------------------
+    void TextureCache::GetLevels( const UInt8* data, const Header* header, ImageLevelArray& levels )
+    {
+        const LevelRecord* records = reinterpret_cast< const LevelRecord* >( data + header->levelOffset );
+        levels.resize( header->levelCount );
+        for ( UInt32 i = 0; i < header->levelCount; i++ )
+        {
+            levels[ i ].width   = records[ i ].width;
+            levels[ i ].height  = records[ i ].height;
+            levels[ i ].pixels  = data + records[ i ].dataOffset;
+        }
+    }
+
+    //Open----------------------------------------------------------------------
+    bool TextureCache::Open( const Key& key, Entry& entry ) const
+    {
+        entry.Close();
+        if ( entry.mFile.OpenPath( GetEntryPath( key ) ) )
+            entry.mHeader = ReadHeader( entry.mFile.GetData(), entry.mFile.GetSize(), &key );
+        if ( !entry.mHeader )
+        {
+            entry.Close();
+            return false;
+        }
+        return true;
+    }
+
+    //Store---------------------------------------------------------------------
+    bool TextureCache::Store( const Key& key, UInt32 originalWidth, UInt32 originalHeight, const ImageLevelArray& levels ) const
+    {
+        if ( levels.empty() )
+            return false;
+
+        Header header;
+        header.magic            = MAGIC;
+        header.version          = VERSION;
+        header.key              = key;
+        header.originalWidth    = originalWidth;
+        header.originalHeight   = originalHeight;
+        header.levelCount       = levels.size();
+        header.levelOffset      = sizeof( Header );
+
+        // The pixels follow the level records, in order
+        std::vector< LevelRecord > records( levels.size() );
+        UInt32 offset = header.levelOffset + records.size() * sizeof( LevelRecord );
+        for ( UInt32 i = 0; i < levels.size(); i++ )
+        {
+            records[ i ].width      = levels[ i ].width;
+            records[ i ].height     = levels[ i ].height;
+            records[ i ].dataOffset = offset;
+            records[ i ].dataSize   = levels[ i ].width * levels[ i ].height * 4;
+            offset += records[ i ].dataSize;
+        }
+        header.fileSize = offset;
+
+        // Write under a name of its own, so two threads storing the same
+        // image never write the same file
+        String path = GetEntryPath( key );
+        char suffix[ 32 ];
+        sprintf( suffix, ".%p.tmp", static_cast< const void* >( &levels ) );
+        String tempPath = path + suffix;
+        {
+            std::ofstream out( tempPath.c_str(), std::ios::out | std::ios::binary );
+            if ( !out )
+                return false;
+            out.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+            out.write( reinterpret_cast< const char* >( &records[ 0 ] ), records.size() * sizeof( LevelRecord ) );
+            for ( UInt32 i = 0; i < levels.size(); i++ )
+                out.write( reinterpret_cast< const char* >( levels[ i ].pixels ), records[ i ].dataSize );
+            if ( !out.good() )
+            {
+                out.close();
+                std::remove( tempPath.c_str() );
+                return false;
+            }
+        }
+
+        // Some systems will not rename over an existing file.  An entry
+        // written by another thread in the meantime is just as good.
+        if ( std::rename( tempPath.c_str(), path.c_str() ) != 0 )
+        {
+            std::remove( path.c_str() );
+            if ( std::rename( tempPath.c_str(), path.c_str() ) != 0 )
+            {
+                std::remove( tempPath.c_str() );
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // namespace PGE
@@ -6,10 +6,13 @@
  *
  */
 
+#include <algorithm>
 #include "PgeTextureManager.h"
 #include "PgeMath.h"
 #include "PgeArchiveFile.h"
 #include "PgeArchiveManager.h"
+#include "PgeMappedFile.h"
+#include "PgeTimer.h"
 
 #include "PgeStringUtil.h"
 //using cmd::StringUtil;
@@ -36,153 +39,351 @@
 
 namespace PGE
 {
+    /** DevIL works on one bound image for the whole process, so only one
+        thread may use it at a time.
+    */
+    static Mutex DecoderMutex;
+    static bool IsDecoderReady = false;
+
+    /** Initialize DevIL the first time it is used.  The decoder mutex must be
+        held.
+        @return False if the DevIL version is too old
+    */
+    static bool InitDecoder()
+    {
+        if ( !IsDecoderReady )
+        {
+            ilInit();
+            iluInit();
+            IsDecoderReady = true;
+        }
+        return ilGetInteger( IL_VERSION_NUM ) >= IL_VERSION && iluGetInteger( ILU_VERSION_NUM ) >= ILU_VERSION;
+    }
+
     ////////////////////////////////////////////////////////////////////////////
     // TextureItem
     ////////////////////////////////////////////////////////////////////////////
 
+    const UInt32 TextureItem::COLOR_BLOCK_SIZE = 8;
+
     TextureItem::TextureItem( const String& imageFileName )
         : mIsLoaded( false ),
+          mIsPending( false ),
+          mPlaceholderID( 0 ),
           mImageFileName( imageFileName ),
           mWidth( 0 ), mHeight( 0 ),
-          mTextureID( 0 )
+          mTextureID( 0 ),
+          mColorBlocksWide( 0 ), mColorBlocksHigh( 0 ),
+          mHandle( 0 ),
+          mRefCount( 0 ),
+          mLastUse( 0 ),
+          mMemorySize( 0 ),
+          mIsReloadable( true ),
+          mMinFilter( GL_LINEAR ), mMaxFilter( GL_LINEAR ),
+          mForceMipmap( false ), mResizeIfNeeded( true )
     {
     }
 
+    //_sampleColors-------------------------------------------------------------
+    void TextureItem::_sampleColors( const UInt8* pixels, UInt32 width, UInt32 height, UInt32 rowLength )
+    {
+        mColorBlocksWide = ( width + COLOR_BLOCK_SIZE - 1 ) / COLOR_BLOCK_SIZE;
+        mColorBlocksHigh = ( height + COLOR_BLOCK_SIZE - 1 ) / COLOR_BLOCK_SIZE;
+        mColorBlocks.assign( mColorBlocksWide * mColorBlocksHigh, Color() );
+
+        // Sum each row of blocks, with the colors weighted by their alpha
+        std::vector< UInt32 > sums( mColorBlocksWide * 4 );
+        for ( UInt32 blockY = 0; blockY < mColorBlocksHigh; blockY++ )
+        {
+            std::fill( sums.begin(), sums.end(), 0 );
+            UInt32 endY = std::min( ( blockY + 1 ) * COLOR_BLOCK_SIZE, height );
+            for ( UInt32 y = blockY * COLOR_BLOCK_SIZE; y < endY; y++ )
+            {
+                const UInt8* pixel = pixels + y * rowLength * 4;
+                for ( UInt32 x = 0; x < width; x++, pixel += 4 )
+                {
+                    UInt32* sum = &sums[ ( x / COLOR_BLOCK_SIZE ) * 4 ];
+                    sum[ 0 ] += pixel[ 0 ] * pixel[ 3 ];
+                    sum[ 1 ] += pixel[ 1 ] * pixel[ 3 ];
+                    sum[ 2 ] += pixel[ 2 ] * pixel[ 3 ];
+                    sum[ 3 ] += pixel[ 3 ];
+                }
+            }
+
+            UInt32 rows = endY - blockY * COLOR_BLOCK_SIZE;
+            for ( UInt32 blockX = 0; blockX < mColorBlocksWide; blockX++ )
+            {
+                const UInt32* sum = &sums[ blockX * 4 ];
+                if ( !sum[ 3 ] )
+                    continue;
+                UInt32 columns = std::min( ( blockX + 1 ) * COLOR_BLOCK_SIZE, width ) - blockX * COLOR_BLOCK_SIZE;
+                Color& color = mColorBlocks[ blockY * mColorBlocksWide + blockX ];
+                color.r = ( sum[ 0 ] + sum[ 3 ] / 2 ) / sum[ 3 ];
+                color.g = ( sum[ 1 ] + sum[ 3 ] / 2 ) / sum[ 3 ];
+                color.b = ( sum[ 2 ] + sum[ 3 ] / 2 ) / sum[ 3 ];
+                color.a = ( sum[ 3 ] + rows * columns / 2 ) / ( rows * columns );
+            }
+        }
+    }
+
     //Load----------------------------------------------------------------------
     bool TextureItem::Load( GLuint minFilter, GLuint maxFilter, bool forceMipmap, bool resizeIfNeeded )
     {
-        /** NOTE: This is a test of using an archive file.  This will need to
-            be modified to allow direct file access, or archived file access.
-        */
-        ArchiveFile* file = ArchiveManager::GetSingleton().CreateArchiveFile( mImageFileName );
-        if ( file )
+        // Keep the options, so the texture can be loaded the same way after
+        // it is evicted
+        mMinFilter      = minFilter;
+        mMaxFilter      = maxFilter;
+        mForceMipmap    = forceMipmap;
+        mResizeIfNeeded = resizeIfNeeded;
+        mIsReloadable   = true;
+
+        // OpenGL will work better with textures that have dimensions
+        // that are a power of 2.  If doing a scrolling tile map, then
+        // this is pretty much a necessity.  However, there are times
+        // when using a mipmap instead is perfectly fine (ie, when NOT
+        // doing tiles, or in cases where we might be running out of
+        // video memory...
+        TextureManager* manager = TextureManager::GetSingletonPtr();
+        TexturePixels pixels;
+        if ( !ReadForUpload( mImageFileName, resizeIfNeeded && !forceMipmap, forceMipmap,
+                             manager ? manager->GetDiskCache() : 0, pixels ) )
+            return false;
+        return _upload( pixels.levels, pixels.originalSize.x, pixels.originalSize.y, minFilter, maxFilter, forceMipmap );
+    }
+
+    //_upload-------------------------------------------------------------------
+    bool TextureItem::_upload( const ImageLevelArray& levels, UInt32 originalWidth, UInt32 originalHeight,
+                               GLuint minFilter, GLuint maxFilter, bool buildMipmaps )
+    {
+        if ( levels.empty() || !levels[ 0 ].pixels )
+            return false;
+
+        if ( mIsLoaded )
+            Unload();
+
+        const ImageLevel& base = levels[ 0 ];
+        mWidth          = base.width;
+        mHeight         = base.height;
+        mOriginalWidth  = originalWidth;
+        mOriginalHeight = originalHeight;
+
+        // Only the pixels of the original image are sampled
+        _sampleColors( base.pixels, std::min( originalWidth, base.width ), std::min( originalHeight, base.height ), base.width );
+
+        glGenTextures( 1, &mTextureID );
+        glBindTexture( GL_TEXTURE_2D, mTextureID );
+        mMemorySize = 0;
+        if ( levels.size() > 1 )
         {
-            UInt32 fileSize = file->Length();
-            unsigned char* buf = new unsigned char [ fileSize ];
-            if ( !buf )
+            // The mipmaps were built already (or read from the disk cache)
+            for ( UInt32 i = 0; i < levels.size(); i++ )
             {
-                delete file;
-                return false;
+                glTexImage2D( GL_TEXTURE_2D, i, GL_RGBA, levels[ i ].width, levels[ i ].height, 0,
+                              GL_RGBA, GL_UNSIGNED_BYTE, levels[ i ].pixels );
+                mMemorySize += levels[ i ].width * levels[ i ].height * 4;
             }
-            file->Read( buf, fileSize );
+        }
+        else if ( buildMipmaps || !Math::IsPowerOf2( mWidth ) || !Math::IsPowerOf2( mHeight ) )
+        {
+            // If forcing mipmap generation, or if the size is not a power of
+            // 2, generate as mipmaps.  They take a third more memory.
+            mMemorySize = mWidth * mHeight * 4;
+            mMemorySize += mMemorySize / 3;
+            gluBuild2DMipmaps( GL_TEXTURE_2D, GL_RGBA, mWidth, mHeight, GL_RGBA, GL_UNSIGNED_BYTE, base.pixels );
+        }
+        else
+        {
+            mMemorySize = mWidth * mHeight * 4;
+            glTexImage2D(   GL_TEXTURE_2D,
+                            0,
+                            GL_RGBA,
+                            mWidth,
+                            mHeight,
+                            0,
+                            GL_RGBA,
+                            GL_UNSIGNED_BYTE,
+                            base.pixels );
+        }
 
-            // Load the texture:
+        // Set the minification and magnification filters
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, maxFilter );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
 
-            //****
-            ilInit();
-            iluInit();
+        mIsLoaded = true;
+        return true;
+    }
+
+    //Create--------------------------------------------------------------------
+    bool TextureItem::Create( const ImageData& image, GLuint minFilter, GLuint maxFilter )
+    {
+        if ( image.pixels.empty() )
+            return false;
+
+        // There is no file to load the pixels from again
+        mIsReloadable = false;
+        ImageLevelArray levels( 1 );
+        levels[ 0 ].width   = image.width;
+        levels[ 0 ].height  = image.height;
+        levels[ 0 ].pixels  = &image.pixels[ 0 ];
+        return _upload( levels, image.width, image.height, minFilter, maxFilter, false );
+    }
+
+    //_decodeMemory-------------------------------------------------------------
+    bool TextureItem::_decodeMemory( const UInt8* data, UInt32 size, bool resizeToPowerOf2,
+                                     ImageData& image, Point2D& originalSize )
+    {
+        // The decoder mutex is only held while DevIL is in use.  The canvas
+        // is allocated and cleared between the decode and the copy, so other
+        // threads may decode in the meantime.
+        ILuint imageID;
+        UInt32 width, height;
+        {
+            MutexLock lock( DecoderMutex );
+            if ( !InitDecoder() )
+                return false;
 
-            // Make sure the DevIL version is valid:
-            if ( ilGetInteger( IL_VERSION_NUM ) < IL_VERSION || iluGetInteger( ILU_VERSION_NUM ) < ILU_VERSION )
+            ilGenImages( 1, &imageID );
+            ilBindImage( imageID );
+            if ( !ilLoadL( IL_TYPE_UNKNOWN, data, size ) )
             {
-                // Invalid version...
-                delete file;
-                delete buf;
+                ilDeleteImages( 1, &imageID );
                 return false;
             }
+            ilConvertImage( IL_RGBA, IL_UNSIGNED_BYTE );
+            width  = ilGetInteger( IL_IMAGE_WIDTH );
+            height = ilGetInteger( IL_IMAGE_HEIGHT );
+        }
 
+        originalSize = Point2D( width, height );
+        if ( resizeToPowerOf2 )
+            image.Resize( Math::FindNextPowerOf2( width ), Math::FindNextPowerOf2( height ) );
+        else
+            image.Resize( width, height );
 
-            // Get the decompressed data
-            ILuint imageID;
-            ilGenImages( 1, &imageID );
-            ilBindImage( imageID );
-            //if ( ilLoadImage( const_cast< char* >( mImageFileName.c_str() ) ) )
-            if ( ilLoadL( IL_TYPE_UNKNOWN, buf, fileSize ) )
+        MutexLock lock( DecoderMutex );
+        ilBindImage( imageID );
+
+        // DevIL stores images bottom row first unless told otherwise, so the
+        // rows are copied back into the same order as the file.
+        bool isFlipped = ( ilGetInteger( IL_IMAGE_ORIGIN ) == IL_ORIGIN_LOWER_LEFT );
+        const UInt8* pixels = ilGetData();
+        for ( UInt32 y = 0; y < height; y++ )
+        {
+            const UInt8* row = pixels + ( isFlipped ? height - 1 - y : y ) * width * 4;
+            std::copy( row, row + width * 4, image.GetPixel( 0, y ) );
+        }
+        ilDeleteImages( 1, &imageID );
+
+        return true;
+    }
+
+    //Decode--------------------------------------------------------------------
+    bool TextureItem::Decode( const String& imageFileName, ImageData& image )
+    {
+        MappedFile file;
+        Point2D originalSize;
+        if ( !file.Open( imageFileName ) )
+            return false;
+        return _decodeMemory( file.GetData(), file.GetSize(), false, image, originalSize );
+    }
+
+    //_buildMipmaps-------------------------------------------------------------
+    void TextureItem::_buildMipmaps( std::vector< ImageData >& images )
+    {
+        while ( images.back().width > 1 || images.back().height > 1 )
+        {
+            images.push_back( ImageData() );
+            const ImageData& source = images[ images.size() - 2 ];
+            ImageData& level = images.back();
+            level.Resize( std::max( source.width / 2, UInt32( 1 ) ), std::max( source.height / 2, UInt32( 1 ) ) );
+
+            // Where the source is a single pixel wide or high, the same
+            // pixels are averaged twice
+            UInt32 stepX = ( source.width > 1 ) ? 4 : 0;
+            UInt32 stepY = ( source.height > 1 ) ? source.width * 4 : 0;
+            for ( UInt32 y = 0; y < level.height; y++ )
             {
-                // Convert the image to unsigned bytes:
-                ilConvertImage( IL_RGBA, IL_UNSIGNED_BYTE );
-
-                // Generate the GL texture
-                glGenTextures( 1, &mTextureID );
-                glBindTexture( GL_TEXTURE_2D, mTextureID );
-                mWidth  = ilGetInteger( IL_IMAGE_WIDTH );
-                mHeight = ilGetInteger( IL_IMAGE_HEIGHT );
-                mOriginalWidth  = mWidth;
-                mOriginalHeight = mHeight;
-
-                // OpenGL will work better with textures that have dimensions
-                // that are a power of 2.  If doing a scrolling tile map, then
-                // this is pretty much a necessity.  However, there are times
-                // when using a mipmap instead is perfectly fine (ie, when NOT
-                // doing tiles, or in cases where we might be running out of
-                // video memory...
-                if ( resizeIfNeeded && !forceMipmap )
+                const UInt8* row = source.GetPixel( 0, y * source.height / level.height );
+                UInt8* pixel = level.GetPixel( 0, y );
+                for ( UInt32 x = 0; x < level.width; x++ )
                 {
-                    UInt32 newWidth = mWidth, newHeight = mHeight;
-                    if ( !Math::IsPowerOf2( mWidth ) )
-                    {
-                        // Find the next power of 2:
-                        newWidth = Math::FindNextPowerOf2( mWidth );
-                    }
-
-                    if ( !Math::IsPowerOf2( mHeight ) )
-                    {
-                        // Find the next power of 2:
-                        newHeight = Math::FindNextPowerOf2( mHeight );
-                    }
-
-                    if ( newWidth != mWidth || newHeight != mHeight )
-                    {
-                        // Resize the canvas:
-                        ilClearColor( 0, 0, 0, 0 );
-                        iluImageParameter( ILU_PLACEMENT, ILU_UPPER_LEFT );
-                        iluEnlargeCanvas( newWidth, newHeight, ilGetInteger( IL_IMAGE_DEPTH ) );
-                        mWidth  = ilGetInteger( IL_IMAGE_WIDTH );
-                        mHeight = ilGetInteger( IL_IMAGE_HEIGHT );
-                    }
+                    const UInt8* block = row + x * ( stepX ? 8 : 0 );
+                    for ( UInt32 channel = 0; channel < 4; channel++, pixel++, block++ )
+                        *pixel = ( block[ 0 ] + block[ stepX ] + block[ stepY ] + block[ stepX + stepY ] + 2 ) / 4;
                 }
+            }
+        }
+    }
 
-                // If forcing mipmap generation, or if the size is not a power of 2,
-                // generate as mipmaps
-                if ( forceMipmap || !Math::IsPowerOf2( mWidth ) || !Math::IsPowerOf2( mHeight ) )
-                {
-                    gluBuild2DMipmaps( GL_TEXTURE_2D,
-                                    ilGetInteger( IL_IMAGE_BPP ),
-                                    mWidth,
-                                    mHeight,
-                                    ilGetInteger( IL_IMAGE_FORMAT ),
-                                    GL_UNSIGNED_BYTE,
-                                    ilGetData() );
-                }
-                else
-                {
-                    glTexImage2D(   GL_TEXTURE_2D,
-                                    0,
-                                    ilGetInteger( IL_IMAGE_BPP ),
-                                    mWidth,
-                                    mHeight,
-                                    0,
-                                    ilGetInteger( IL_IMAGE_FORMAT ),
-                                    GL_UNSIGNED_BYTE,
-                                    ilGetData() );
-                }
+    //DecodeForUpload-----------------------------------------------------------
+    bool TextureItem::DecodeForUpload( const String& imageFileName, bool resizeToPowerOf2, ImageData& image, Point2D& originalSize )
+    {
+        MappedFile file;
+        if ( !file.Open( imageFileName ) )
+            return false;
+        return _decodeMemory( file.GetData(), file.GetSize(), resizeToPowerOf2, image, originalSize );
+    }
 
-                // Set the minification and magnification filters
-                glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter );
-                glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, maxFilter );
-                glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP );
-                glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP );
+    //ReadForUpload-------------------------------------------------------------
+    bool TextureItem::ReadForUpload( const String& imageFileName, bool resizeToPowerOf2, bool buildMipmaps,
+                                     const TextureCache* cache, TexturePixels& pixels )
+    {
+        // A loose file is mapped, so its bytes are not copied before they
+        // reach the decoder
+        MappedFile& source = pixels.source;
+        if ( !source.Open( imageFileName ) )
+            return false;
 
-                mIsLoaded = true;
-            }
-            else
+        // A precompiled texture is uploaded straight from the file
+        const TextureCache::Header* header = TextureCache::ReadHeader( source.GetData(), source.GetSize() );
+        if ( header )
+        {
+            pixels.originalSize = Point2D( header->originalWidth, header->originalHeight );
+            TextureCache::GetLevels( source.GetData(), header, pixels.levels );
+            return true;
+        }
+
+        // An entry made from the same bytes with the same options is mapped,
+        // and nothing is decoded
+        TextureCache::Key key;
+        if ( cache )
+        {
+            UInt32 options = ( resizeToPowerOf2 ? TextureCache::RESIZE_TO_POWER_OF_2 : 0 ) |
+                             ( buildMipmaps ? TextureCache::BUILD_MIPMAPS : 0 );
+            key = TextureCache::MakeKey( source.GetData(), source.GetSize(), options );
+            if ( cache->Open( key, pixels.entry ) )
             {
-                ILenum error;
-                error = ilGetError();
-                //std::string errString = iluErrorString( error );
+                source.Close();
+                header = pixels.entry.GetHeader();
+                pixels.originalSize = Point2D( header->originalWidth, header->originalHeight );
+                pixels.entry.GetLevels( pixels.levels );
+                return true;
             }
+        }
 
-            ilDeleteImages( 1, &imageID );
+        pixels.images.resize( 1 );
+        bool isDecoded = _decodeMemory( source.GetData(), source.GetSize(), resizeToPowerOf2, pixels.images[ 0 ], pixels.originalSize );
+        source.Close();
+        if ( !isDecoded )
+            return false;
 
-            //***
+        // Mipmaps of other sizes are left to GLU, which scales the image first
+        const ImageData& base = pixels.images[ 0 ];
+        if ( buildMipmaps && Math::IsPowerOf2( base.width ) && Math::IsPowerOf2( base.height ) )
+            _buildMipmaps( pixels.images );
 
-            // Free memory:
-            delete buf;
-            delete file;
+        pixels.levels.resize( pixels.images.size() );
+        for ( UInt32 i = 0; i < pixels.images.size(); i++ )
+        {
+            pixels.levels[ i ].width    = pixels.images[ i ].width;
+            pixels.levels[ i ].height   = pixels.images[ i ].height;
+            pixels.levels[ i ].pixels   = &pixels.images[ i ].pixels[ 0 ];
         }
-        else
-            return false;
 
+        if ( cache )
+            cache->Store( key, pixels.originalSize.x, pixels.originalSize.y, pixels.levels );
         return true;
     }
 
@@ -192,10 +393,50 @@ namespace PGE
         glDeleteTextures( 1, &mTextureID );
         mTextureID = 0;
         mIsLoaded = false;
+        mMemorySize = 0;
 
         return false;
     }
 
+    //GetAverageColor-----------------------------------------------------------
+    Color TextureItem::GetAverageColor( Real u0, Real v0, Real u1, Real v1 ) const
+    {
+        Real left   = std::min( u0, u1 ) * mWidth;
+        Real right  = std::max( u0, u1 ) * mWidth;
+        Real top    = std::min( v0, v1 ) * mHeight;
+        Real bottom = std::max( v0, v1 ) * mHeight;
+        Real area = ( right - left ) * ( bottom - top );
+        if ( mColorBlocks.empty() || area <= 0 )
+            return Color( 0, 0, 0, 0 );
+
+        // Weight each block by how much of it lies in the area, and by its
+        // alpha.  Blocks past the original image (on a canvas enlarged to a
+        // power of 2) are transparent.
+        Int startX = Math::IMax( Int( left / COLOR_BLOCK_SIZE ), 0 );
+        Int startY = Math::IMax( Int( top / COLOR_BLOCK_SIZE ), 0 );
+        Int endX   = Math::IMin( Int( Math::Ceil( right / COLOR_BLOCK_SIZE ) ), mColorBlocksWide );
+        Int endY   = Math::IMin( Int( Math::Ceil( bottom / COLOR_BLOCK_SIZE ) ), mColorBlocksHigh );
+        Real red = 0, green = 0, blue = 0, alpha = 0;
+        for ( Int blockY = startY; blockY < endY; blockY++ )
+        {
+            Real height = std::min( bottom, Real( ( blockY + 1 ) * COLOR_BLOCK_SIZE ) ) - std::max( top, Real( blockY * COLOR_BLOCK_SIZE ) );
+            for ( Int blockX = startX; blockX < endX; blockX++ )
+            {
+                Real width = std::min( right, Real( ( blockX + 1 ) * COLOR_BLOCK_SIZE ) ) - std::max( left, Real( blockX * COLOR_BLOCK_SIZE ) );
+                const Color& color = mColorBlocks[ blockY * mColorBlocksWide + blockX ];
+                Real weight = width * height * color.a;
+                red     += weight * color.r;
+                green   += weight * color.g;
+                blue    += weight * color.b;
+                alpha   += weight;
+            }
+        }
+        if ( alpha <= 0 )
+            return Color( 0, 0, 0, 0 );
+        return Color( UInt8( red / alpha + 0.5f ), UInt8( green / alpha + 0.5f ), UInt8( blue / alpha + 0.5f ),
+                      UInt8( std::min( alpha / area + 0.5f, 255.0f ) ) );
+    }
+
     ////////////////////////////////////////////////////////////////////////////
     // TextureManager
     ////////////////////////////////////////////////////////////////////////////
@@ -214,14 +455,169 @@ namespace PGE
     }
 
     TextureManager::TextureManager()
+        : mBoundTexture( 0 ),
+          mHandles( 1, static_cast< TextureItem* >( 0 ) ),
+          mMemoryBudget( 0 ),
+          mMemoryUsed( 0 ),
+          mUseCounter( 0 ),
+          mIsAsync( false ),
+          mPlaceholderID( 0 )
     {
     }
 
     TextureManager::~TextureManager()
     {
+        // Background loads still refer to their items, so they must stop
+        // before the items are released
+        WorkQueue* queue = WorkQueue::GetSingletonPtr();
+        for ( LoadJobQueue::iterator jobIter = mLoadJobs.begin(); jobIter != mLoadJobs.end(); jobIter++ )
+        {
+            if ( queue && ( *jobIter )->IsBusy() && !queue->Cancel( *jobIter ) )
+                queue->Wait( *jobIter );
+            delete *jobIter;
+        }
+        mLoadJobs.clear();
         mTextureMap.clear();
     }
 
+    //Execute
+    void TextureManager::TextureLoadJob::Execute()
+    {
+        Real32 startTime = Timer::GetTicks();
+        isDecoded = TextureItem::ReadForUpload( item->GetImageName(), resizeIfNeeded && !forceMipmap, forceMipmap, cache, pixels );
+        readTime = Timer::GetTicks() - startTime;
+    }
+
+    //_getPlaceholder-----------------------------------------------------------
+    GLuint TextureManager::_getPlaceholder()
+    {
+        if ( !mPlaceholderID )
+        {
+            // A plain grey, so the shapes drawn with it show without standing
+            // out
+            static const UInt8 pixels[ 2 * 2 * 4 ] = { 128, 128, 128, 255, 128, 128, 128, 255,
+                                                       128, 128, 128, 255, 128, 128, 128, 255 };
+            glGenTextures( 1, &mPlaceholderID );
+            glBindTexture( GL_TEXTURE_2D, mPlaceholderID );
+            glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
+            glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+            glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+            mBoundTexture = mPlaceholderID;
+        }
+        return mPlaceholderID;
+    }
+
+    //_finishLoad---------------------------------------------------------------
+    void TextureManager::_finishLoad( TextureLoadJob* job, TextureLoadTiming* timing )
+    {
+        // A load which has not started yet is run here instead
+        WorkQueue* queue = WorkQueue::GetSingletonPtr();
+        if ( queue && job->IsBusy() )
+            queue->Wait( job );
+
+        Real32 startTime = Timer::GetTicks();
+        TextureItem* item = job->item;
+        item->mIsPending = false;
+        if ( job->isDecoded )
+        {
+            UInt32 oldSize = item->GetMemorySize();
+            item->_upload( job->pixels.levels, job->pixels.originalSize.x, job->pixels.originalSize.y,
+                           job->minFilter, job->maxFilter, job->forceMipmap );
+            mBoundTexture = 0;
+            _trackMemory( item, oldSize );
+            _enforceBudget( item );
+        }
+        else
+        {
+            // A missing image is not tried again by UseTexture
+            item->mIsReloadable = false;
+        }
+
+        if ( timing )
+        {
+            timing->readTime    = job->readTime;
+            timing->uploadTime  = Timer::GetTicks() - startTime;
+        }
+        delete job;
+    }
+
+    //_waitForLoad--------------------------------------------------------------
+    void TextureManager::_waitForLoad( TextureItem* item )
+    {
+        if ( !item->IsPending() )
+            return;
+        for ( LoadJobQueue::iterator jobIter = mLoadJobs.begin(); jobIter != mLoadJobs.end(); jobIter++ )
+        {
+            if ( ( *jobIter )->item == item )
+            {
+                TextureLoadJob* job = *jobIter;
+                mLoadJobs.erase( jobIter );
+                _finishLoad( job );
+                return;
+            }
+        }
+    }
+
+    //_addItem------------------------------------------------------------------
+    TextureManager::TextureIter TextureManager::_addItem( const String& textureName )
+    {
+        TextureIter iter = mTextureMap.insert( std::make_pair( textureName, TextureItemPtr( new TextureItem( textureName ) ) ) ).first;
+        iter->second->mHandle = mHandles.size();
+        mHandles.push_back( iter->second.Get() );
+        return iter;
+    }
+
+    //_trackMemory--------------------------------------------------------------
+    void TextureManager::_trackMemory( const TextureItem* item, UInt32 oldSize )
+    {
+        mMemoryUsed = mMemoryUsed - oldSize + item->GetMemorySize();
+    }
+
+    //_unloadItem---------------------------------------------------------------
+    void TextureManager::_unloadItem( TextureItem* item )
+    {
+        if ( !item->IsLoaded() )
+            return;
+        if ( item->mTextureID == mBoundTexture )
+            mBoundTexture = 0;
+        UInt32 oldSize = item->GetMemorySize();
+        item->Unload();
+        _trackMemory( item, oldSize );
+    }
+
+    //_enforceBudget------------------------------------------------------------
+    void TextureManager::_enforceBudget( const TextureItem* keep )
+    {
+        if ( !mMemoryBudget || mMemoryUsed <= mMemoryBudget )
+            return;
+
+        // Only textures drawn through UseTexture are evicted, since that is
+        // where they are loaded again.  The others can never be freed here,
+        // so they do not count against the budget.  The unreferenced ones go
+        // first, then the least recently used.
+        typedef std::pair< std::pair< bool, UInt32 >, TextureItem* > Candidate;
+        std::vector< Candidate > candidates;
+        UInt32 memoryUsed = mMemoryUsed;
+        for ( HandleArray::iterator handleIter = mHandles.begin(); handleIter != mHandles.end(); handleIter++ )
+        {
+            TextureItem* item = *handleIter;
+            if ( !item || !item->IsLoaded() )
+                continue;
+            if ( !item->mIsReloadable || !item->mLastUse )
+                memoryUsed -= item->GetMemorySize();
+            else if ( item != keep && !item->IsPending() )
+                candidates.push_back( Candidate( std::make_pair( item->mRefCount > 0, item->mLastUse ), item ) );
+        }
+        std::sort( candidates.begin(), candidates.end() );
+
+        for ( std::vector< Candidate >::iterator candidateIter = candidates.begin();
+              candidateIter != candidates.end() && memoryUsed > mMemoryBudget; candidateIter++ )
+        {
+            memoryUsed -= candidateIter->second->GetMemorySize();
+            _unloadItem( candidateIter->second );
+        }
+    }
+
     //AddImage------------------------------------------------------------------
     bool TextureManager::AddImage( const String& imageFileName )
     {
@@ -231,7 +627,7 @@ namespace PGE
 
         // Add the new item only if it is not found
         if ( iter == mTextureMap.end() )
-            mTextureMap[ imageName ] = TextureItemPtr( new TextureItem( imageName ) );
+            _addItem( imageName );
 
         // Check if the item is in the map now:
         iter = mTextureMap.find( imageName );
@@ -249,11 +645,17 @@ namespace PGE
         // Add the new item only if it is not found
         if ( iter != mTextureMap.end() )
         {
+            _waitForLoad( iter->second.Get() );
+
             // Unload the image
-            if ( !iter->second->Unload() )
+            UInt32 oldSize = iter->second->GetMemorySize();
+            bool isUnloaded = iter->second->Unload();
+            _trackMemory( iter->second.Get(), oldSize );
+            if ( !isUnloaded )
                 return false;
 
-            // Remove the image from the map
+            // Remove the image from the map.  Its handle is never reused.
+            mHandles[ iter->second->GetHandle() ] = 0;
             mTextureMap.erase( iter );
         }
 
@@ -266,11 +668,213 @@ namespace PGE
         // Make sure the image is in the map:
         AddImage( imageFileName );
 
-        // Load the image:
+        // Load the image.  If it is loading in the background, the load is
+        // finished instead.
         TextureIter iter = mTextureMap.find( imageFileName );
-        if ( iter != mTextureMap.end() )
-            return iter->second->Load( minFilter, maxFilter, forceMipmap, resizeIfNeeded );
-        return false;
+        if ( iter == mTextureMap.end() )
+            return false;
+        if ( iter->second->IsPending() )
+        {
+            _waitForLoad( iter->second.Get() );
+            return iter->second->IsLoaded();
+        }
+        if ( iter->second->IsLoaded() )
+            return true;
+
+        // Loading the image binds it
+        UInt32 oldSize = iter->second->GetMemorySize();
+        bool result = iter->second->Load( minFilter, maxFilter, forceMipmap, resizeIfNeeded );
+        mBoundTexture = 0;
+        _trackMemory( iter->second.Get(), oldSize );
+        _enforceBudget( iter->second.Get() );
+        return result;
+    }
+
+    //LoadImageAsync------------------------------------------------------------
+    bool TextureManager::LoadImageAsync( const String& imageFileName, GLuint minFilter, GLuint maxFilter, bool forceMipmap, bool resizeIfNeeded )
+    {
+        AddImage( imageFileName );
+        TextureIter iter = mTextureMap.find( imageFileName );
+        if ( iter == mTextureMap.end() )
+            return false;
+        _startLoad( iter->second.Get(), minFilter, maxFilter, forceMipmap, resizeIfNeeded );
+        return true;
+    }
+
+    //_startLoad----------------------------------------------------------------
+    void TextureManager::_startLoad( TextureItem* item, GLuint minFilter, GLuint maxFilter, bool forceMipmap, bool resizeIfNeeded )
+    {
+        if ( item->IsLoaded() || item->IsPending() )
+            return;
+
+        // Keep the options, so the texture can be loaded the same way after
+        // it is evicted
+        item->mMinFilter        = minFilter;
+        item->mMaxFilter        = maxFilter;
+        item->mForceMipmap      = forceMipmap;
+        item->mResizeIfNeeded   = resizeIfNeeded;
+        item->mIsReloadable     = true;
+
+        TextureLoadJob* job = new TextureLoadJob();
+        job->item           = item;
+        job->minFilter      = minFilter;
+        job->maxFilter      = maxFilter;
+        job->forceMipmap    = forceMipmap;
+        job->resizeIfNeeded = resizeIfNeeded;
+        job->cache          = mDiskCache.Get();
+        job->isDecoded      = false;
+        job->readTime       = 0;
+        item->mIsPending    = true;
+        item->mPlaceholderID = _getPlaceholder();
+        mLoadJobs.push_back( job );
+
+        // Without a work queue, the image is decoded now, but the texture is
+        // still created by UploadLoadedTextures
+        WorkQueue* queue = WorkQueue::GetSingletonPtr();
+        if ( queue && queue->GetThreadCount() > 0 )
+            queue->Submit( job );
+        else
+            job->Execute();
+    }
+
+    //UploadLoadedTextures------------------------------------------------------
+    UInt32 TextureManager::UploadLoadedTextures( UInt32 byteBudget )
+    {
+        UInt32 count = 0;
+        UInt32 bytes = 0;
+        LoadJobQueue::iterator jobIter = mLoadJobs.begin();
+        while ( jobIter != mLoadJobs.end() )
+        {
+            TextureLoadJob* job = *jobIter;
+            if ( job->IsBusy() )
+            {
+                jobIter++;
+                continue;
+            }
+
+            UInt32 size = job->pixels.GetSize();
+            if ( count > 0 && bytes + size > byteBudget )
+                break;
+            jobIter = mLoadJobs.erase( jobIter );
+            _finishLoad( job );
+            bytes += size;
+            count++;
+        }
+        return count;
+    }
+
+    //FinishLoads---------------------------------------------------------------
+    void TextureManager::FinishLoads()
+    {
+        while ( !mLoadJobs.empty() )
+        {
+            TextureLoadJob* job = mLoadJobs.front();
+            mLoadJobs.pop_front();
+            _finishLoad( job );
+        }
+    }
+
+    //LoadImages----------------------------------------------------------------
+    UInt32 TextureManager::LoadImages( const StringVector& imageFileNames, const TextureLoadOptions& options, TextureLoadReport* report )
+    {
+        Real32 startTime = Timer::GetTicks();
+        TextureLoadReport batch;
+        batch.images.resize( imageFileNames.size() );
+
+        // Initialize the decoder before the workers need it
+        {
+            MutexLock lock( DecoderMutex );
+            InitDecoder();
+        }
+
+        // Start every load, so the workers are busy while the textures are
+        // created below.  Each item is timed by its first place in the list.
+        typedef std::map< TextureItem*, TextureLoadTiming* > TimingMap;
+        TimingMap timings;
+        std::vector< TextureItem* > items( imageFileNames.size(), 0 );
+        for ( UInt32 i = 0; i < imageFileNames.size(); i++ )
+        {
+            batch.images[ i ].imageFileName = imageFileNames[ i ];
+            AddImage( imageFileNames[ i ] );
+            TextureIter iter = mTextureMap.find( imageFileNames[ i ] );
+            if ( iter == mTextureMap.end() )
+                continue;
+            items[ i ] = iter->second.Get();
+            timings.insert( std::make_pair( items[ i ], &batch.images[ i ] ) );
+            _startLoad( items[ i ], options.minFilter, options.maxFilter, options.forceMipmap, options.resizeIfNeeded );
+        }
+
+        // Create the textures in the order their images become ready.  When
+        // none is ready, the first is waited for, which runs it on this
+        // thread if no worker has started it.
+        UInt32 remaining = 0;
+        for ( LoadJobQueue::iterator jobIter = mLoadJobs.begin(); jobIter != mLoadJobs.end(); jobIter++ )
+        {
+            if ( timings.find( ( *jobIter )->item ) != timings.end() )
+                remaining++;
+        }
+        while ( remaining > 0 )
+        {
+            LoadJobQueue::iterator waitIter = mLoadJobs.end();
+            UInt32 finished = 0;
+            LoadJobQueue::iterator jobIter = mLoadJobs.begin();
+            while ( jobIter != mLoadJobs.end() )
+            {
+                TextureLoadJob* job = *jobIter;
+                TimingMap::iterator timing = timings.find( job->item );
+                if ( timing == timings.end() || job->IsBusy() )
+                {
+                    if ( timing != timings.end() && waitIter == mLoadJobs.end() )
+                        waitIter = jobIter;
+                    jobIter++;
+                    continue;
+                }
+                jobIter = mLoadJobs.erase( jobIter );
+                _finishLoad( job, timing->second );
+                finished++;
+            }
+
+            // Nothing was erased, so the iterator is still valid
+            if ( !finished )
+            {
+                TextureLoadJob* job = *waitIter;
+                mLoadJobs.erase( waitIter );
+                _finishLoad( job, timings[ job->item ] );
+                finished++;
+            }
+            remaining -= finished;
+        }
+
+        for ( UInt32 i = 0; i < items.size(); i++ )
+        {
+            TextureLoadTiming& timing = batch.images[ i ];
+            timing.isLoaded = ( items[ i ] && items[ i ]->IsLoaded() );
+            batch.readTime += timing.readTime;
+            batch.uploadTime += timing.uploadTime;
+            if ( timing.isLoaded )
+                batch.loadedCount++;
+        }
+        batch.totalTime = Timer::GetTicks() - startTime;
+        if ( report )
+            *report = batch;
+        return batch.loadedCount;
+    }
+
+    //CreateTexture-------------------------------------------------------------
+    bool TextureManager::CreateTexture( const String& textureName, const ImageData& image, GLuint minFilter, GLuint maxFilter )
+    {
+        TextureIter iter = mTextureMap.find( textureName );
+        if ( iter == mTextureMap.end() )
+            iter = _addItem( textureName );
+        _waitForLoad( iter->second.Get() );
+
+        // Creating the texture binds it
+        UInt32 oldSize = iter->second->GetMemorySize();
+        bool result = iter->second->Create( image, minFilter, maxFilter );
+        mBoundTexture = 0;
+        _trackMemory( iter->second.Get(), oldSize );
+        _enforceBudget( iter->second.Get() );
+        return result;
     }
 
     //GetTextureItemPtr---------------------------------------------------------
@@ -282,7 +886,10 @@ namespace PGE
             return iter->second.Get();
 
         // The texture wasn't found, so attempt to add and load the image:
-        LoadImage( textureName );
+        if ( mIsAsync )
+            LoadImageAsync( textureName );
+        else
+            LoadImage( textureName );
 
         // Now see if the texture data can be returned:
         iter = mTextureMap.find( textureName );
@@ -291,4 +898,130 @@ namespace PGE
         return 0;
     }
 
+    //SetDiskCache--------------------------------------------------------------
+    void TextureManager::SetDiskCache( const String& directory )
+    {
+        // Background loads refer to the current cache
+        FinishLoads();
+        mDiskCache.SetNull();
+        if ( !directory.empty() )
+            mDiskCache.Bind( new TextureCache( directory ) );
+    }
+
+    //GetTextureHandle----------------------------------------------------------
+    TextureHandle TextureManager::GetTextureHandle( const String& textureName )
+    {
+        TextureIter iter = mTextureMap.find( textureName );
+        if ( iter == mTextureMap.end() )
+        {
+            AddImage( textureName );
+            iter = mTextureMap.find( StringUtil::FixPath( textureName ) );
+        }
+        if ( iter != mTextureMap.end() )
+            return iter->second->GetHandle();
+        return 0;
+    }
+
+    //GetTextureItem------------------------------------------------------------
+    TextureItem* TextureManager::GetTextureItem( TextureHandle handle ) const
+    {
+        if ( handle < mHandles.size() )
+            return mHandles[ handle ];
+        return 0;
+    }
+
+    //AddTextureRef-------------------------------------------------------------
+    void TextureManager::AddTextureRef( TextureHandle handle )
+    {
+        TextureItem* item = GetTextureItem( handle );
+        if ( item )
+            ++item->mRefCount;
+    }
+
+    //ReleaseTexture------------------------------------------------------------
+    void TextureManager::ReleaseTexture( TextureHandle handle )
+    {
+        TextureItem* item = GetTextureItem( handle );
+        if ( item && item->mRefCount > 0 )
+            --item->mRefCount;
+    }
+
+    //UnloadUnreferenced--------------------------------------------------------
+    UInt32 TextureManager::UnloadUnreferenced()
+    {
+        UInt32 count = 0;
+        for ( HandleArray::iterator handleIter = mHandles.begin(); handleIter != mHandles.end(); handleIter++ )
+        {
+            TextureItem* item = *handleIter;
+            if ( item && !item->mRefCount && item->mLastUse && item->mIsReloadable && item->IsLoaded() && !item->IsPending() )
+            {
+                _unloadItem( item );
+                count++;
+            }
+        }
+        return count;
+    }
+
+    //UseTexture----------------------------------------------------------------
+    bool TextureManager::UseTexture( TextureHandle handle )
+    {
+        TextureItem* item = GetTextureItem( handle );
+        if ( !item )
+            return false;
+
+        // The stamps are renumbered on the rare wrap of the counter
+        if ( ++mUseCounter == 0 )
+        {
+            for ( HandleArray::iterator handleIter = mHandles.begin(); handleIter != mHandles.end(); handleIter++ )
+            {
+                if ( *handleIter && ( *handleIter )->mLastUse )
+                    ( *handleIter )->mLastUse = 1;
+            }
+            mUseCounter = 2;
+        }
+        item->mLastUse = mUseCounter;
+
+        // An evicted texture, or one never loaded, is loaded the way it was
+        // last loaded
+        if ( !item->IsLoaded() && !item->IsPending() && item->mIsReloadable )
+        {
+            if ( mIsAsync )
+                _startLoad( item, item->mMinFilter, item->mMaxFilter, item->mForceMipmap, item->mResizeIfNeeded );
+            else
+            {
+                UInt32 oldSize = item->GetMemorySize();
+                item->Load( item->mMinFilter, item->mMaxFilter, item->mForceMipmap, item->mResizeIfNeeded );
+                mBoundTexture = 0;
+                _trackMemory( item, oldSize );
+                _enforceBudget( item );
+                item->mIsReloadable = item->IsLoaded();
+            }
+        }
+        return BindTexture( item->GetID() );
+    }
+
+    //SetMemoryBudget-----------------------------------------------------------
+    void TextureManager::SetMemoryBudget( UInt32 bytes )
+    {
+        mMemoryBudget = bytes;
+        _enforceBudget( 0 );
+    }
+
+    //BindTexture---------------------------------------------------------------
+    bool TextureManager::BindTexture( GLuint textureID )
+    {
+        if ( textureID == mBoundTexture )
+            return false;
+
+        glBindTexture( GL_TEXTURE_2D, textureID );
+        mBoundTexture = textureID;
+        return true;
+    }
+
+    //ResetBinding--------------------------------------------------------------
+    void TextureManager::ResetBinding()
+    {
+        mBoundTexture = 0;
+    }
+
 } // namespace PGE
@@ -0,0 +1,190 @@
+/*! $Id$
+ *  @file   PgeThread.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeThread.h"
+#include <assert.h>
+
+#if ( PGE_PLATFORM != PGE_PLATFORM_WIN32 )
+#   include <unistd.h>
+#   include <sched.h>
+#endif
+
+namespace PGE
+{
+    ////////////////////////////////////////////////////////////////////////////
+    // Mutex
+    ////////////////////////////////////////////////////////////////////////////
+
+    Mutex::Mutex()
+    {
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        InitializeCriticalSection( &mHandle );
+#else
+        pthread_mutex_init( &mHandle, 0 );
+#endif
+    }
+
+    Mutex::~Mutex()
+    {
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        DeleteCriticalSection( &mHandle );
+#else
+        pthread_mutex_destroy( &mHandle );
+#endif
+    }
+
+    //Lock----------------------------------------------------------------------
+    void Mutex::Lock()
+    {
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        EnterCriticalSection( &mHandle );
+#else
+        pthread_mutex_lock( &mHandle );
+#endif
+    }
+
+    //Unlock--------------------------------------------------------------------
+    void Mutex::Unlock()
+    {
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        LeaveCriticalSection( &mHandle );
+#else
+        pthread_mutex_unlock( &mHandle );
+#endif
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Semaphore
+    ////////////////////////////////////////////////////////////////////////////
+
+    Semaphore::Semaphore( UInt32 initialCount )
+    {
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        mHandle = CreateSemaphore( 0, initialCount, 0x7fffffff, 0 );
+#else
+        sem_init( &mHandle, 0, initialCount );
+#endif
+    }
+
+    Semaphore::~Semaphore()
+    {
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        CloseHandle( mHandle );
+#else
+        sem_destroy( &mHandle );
+#endif
+    }
+
+    //Post----------------------------------------------------------------------
+    void Semaphore::Post()
+    {
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        ReleaseSemaphore( mHandle, 1, 0 );
+#else
+        sem_post( &mHandle );
+#endif
+    }
+
+    //Wait----------------------------------------------------------------------
+    void Semaphore::Wait()
+    {
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        WaitForSingleObject( mHandle, INFINITE );
+#else
+        // Retry if the wait was interrupted by a signal
+        while ( sem_wait( &mHandle ) != 0 )
+        {
+        }
+#endif
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Thread
+    ////////////////////////////////////////////////////////////////////////////
+
+    Thread::Thread()
+        : mIsStarted( false )
+    {
+    }
+
+    Thread::~Thread()
+    {
+        // Deleting a running thread would leave it executing a destroyed object
+        assert( !mIsStarted );
+    }
+
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+    DWORD WINAPI Thread::_threadProc( LPVOID param )
+    {
+        static_cast< Thread* >( param )->Run();
+        return 0;
+    }
+#else
+    void* Thread::_threadProc( void* param )
+    {
+        static_cast< Thread* >( param )->Run();
+        return 0;
+    }
+#endif
+
+    //Start---------------------------------------------------------------------
+    bool Thread::Start()
+    {
+        if ( mIsStarted )
+            return false;
+
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        mHandle = CreateThread( 0, 0, _threadProc, this, 0, 0 );
+        mIsStarted = ( mHandle != 0 );
+#else
+        mIsStarted = ( pthread_create( &mHandle, 0, _threadProc, this ) == 0 );
+#endif
+        return mIsStarted;
+    }
+
+    //Join----------------------------------------------------------------------
+    void Thread::Join()
+    {
+        if ( !mIsStarted )
+            return;
+
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        WaitForSingleObject( mHandle, INFINITE );
+        CloseHandle( mHandle );
+#else
+        pthread_join( mHandle, 0 );
+#endif
+        mIsStarted = false;
+    }
+
+    //Sleep---------------------------------------------------------------------
+    void Thread::Sleep( UInt32 ms )
+    {
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        ::Sleep( ms );
+#else
+        if ( ms == 0 )
+            sched_yield();
+        else
+            usleep( ms * 1000 );
+#endif
+    }
+
+    //GetProcessorCount---------------------------------------------------------
+    UInt32 Thread::GetProcessorCount()
+    {
+#if ( PGE_PLATFORM == PGE_PLATFORM_WIN32 )
+        SYSTEM_INFO info;
+        GetSystemInfo( &info );
+        return info.dwNumberOfProcessors;
+#else
+        long count = sysconf( _SC_NPROCESSORS_ONLN );
+        return ( count > 0 ) ? count : 1;
+#endif
+    }
+
+} // namespace PGE
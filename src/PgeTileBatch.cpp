@@ -0,0 +1,132 @@
+/*! $Id$
+ *  @file   PgeTileBatch.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeTileBatch.h"
+#include <assert.h>
+
+namespace PGE
+{
+    //Constructor
+    TileBatch::TileBatch()
+    {
+    }
+
+    //Clear---------------------------------------------------------------------
+    void TileBatch::Clear()
+    {
+        mVertices.clear();
+        mColors.clear();
+    }
+
+    //Release-------------------------------------------------------------------
+    void TileBatch::Release()
+    {
+        VertexArray().swap( mVertices );
+        std::vector< Color >().swap( mColors );
+    }
+
+    //Reserve-------------------------------------------------------------------
+    void TileBatch::Reserve( UInt32 quadCount )
+    {
+        mVertices.reserve( quadCount * 4 );
+    }
+
+    //Swap----------------------------------------------------------------------
+    void TileBatch::Swap( TileBatch& other )
+    {
+        mVertices.swap( other.mVertices );
+        mColors.swap( other.mColors );
+    }
+
+    //AddQuad-------------------------------------------------------------------
+    void TileBatch::AddQuad( Real x, Real y, Real w, Real h, const TileTexCoords& tex )
+    {
+        mVertices.resize( mVertices.size() + 4 );
+        if ( !mColors.empty() )
+            mColors.resize( mVertices.size(), Color( 255, 255, 255, 255 ) );
+        SetQuad( GetQuadCount() - 1, x, y, w, h, tex );
+    }
+
+    //SetQuad-------------------------------------------------------------------
+    void TileBatch::SetQuad( UInt32 quadIndex, Real x, Real y, Real w, Real h, const TileTexCoords& tex )
+    {
+        assert( quadIndex < GetQuadCount() );
+
+        // The corners are emitted in the same order the display lists used, so
+        // the winding (and therefore back face culling) is unchanged.
+        Vertex* vert = &mVertices[ quadIndex * 4 ];
+
+        vert->u = tex.u0;   vert->v = tex.v0;
+        vert->x = x;        vert->y = y;        vert->z = 0.0f;
+        ++vert;
+
+        vert->u = tex.u0;   vert->v = tex.v1;
+        vert->x = x;        vert->y = y + h;    vert->z = 0.0f;
+        ++vert;
+
+        vert->u = tex.u1;   vert->v = tex.v1;
+        vert->x = x + w;    vert->y = y + h;    vert->z = 0.0f;
+        ++vert;
+
+        vert->u = tex.u1;   vert->v = tex.v0;
+        vert->x = x + w;    vert->y = y;        vert->z = 0.0f;
+    }
+
+    //SetQuadColors-------------------------------------------------------------
+    void TileBatch::SetQuadColors( UInt32 quadIndex, const Color& topLeft, const Color& bottomLeft,
+                                   const Color& bottomRight, const Color& topRight )
+    {
+        assert( quadIndex < GetQuadCount() );
+        if ( mColors.empty() )
+            mColors.resize( mVertices.size(), Color( 255, 255, 255, 255 ) );
+
+        // The same corner order as SetQuad
+        Color* color = &mColors[ quadIndex * 4 ];
+        color[ 0 ] = topLeft;
+        color[ 1 ] = bottomLeft;
+        color[ 2 ] = bottomRight;
+        color[ 3 ] = topRight;
+    }
+
+    //ClearColors---------------------------------------------------------------
+    void TileBatch::ClearColors()
+    {
+        std::vector< Color >().swap( mColors );
+    }
+
+    //Render--------------------------------------------------------------------
+    void TileBatch::Render( TileRenderStats* stats ) const
+    {
+        if ( mVertices.empty() )
+            return;
+
+        glColor4f( 1.0f, 1.0f, 1.0f, 1.0f );
+        glInterleavedArrays( GL_T2F_V3F, 0, &mVertices[ 0 ] );
+        if ( !mColors.empty() )
+        {
+            glEnableClientState( GL_COLOR_ARRAY );
+            glColorPointer( 4, GL_UNSIGNED_BYTE, 0, &mColors[ 0 ] );
+        }
+        glDrawArrays( GL_QUADS, 0, mVertices.size() );
+        glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+        glDisableClientState( GL_VERTEX_ARRAY );
+        if ( !mColors.empty() )
+        {
+            // The current color is left undefined by the color array
+            glDisableClientState( GL_COLOR_ARRAY );
+            glColor4f( 1.0f, 1.0f, 1.0f, 1.0f );
+        }
+
+        if ( stats )
+        {
+            ++stats->drawCalls;
+            stats->vertexCount += mVertices.size();
+            stats->tileCount   += mVertices.size() / 4;
+        }
+    }
+
+} // namespace PGE
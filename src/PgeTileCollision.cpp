@@ -0,0 +1,587 @@
+/*! $Id$
+ *  @file   PgeTileCollision.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeTileCollision.h"
+#include "PgeTileSet.h"
+#include "PgeMath.h"
+
+#include <algorithm>
+
+#if ( PGE_COMPILER == PGE_COMPILER_MSVC )
+#   include <intrin.h>
+#endif
+
+namespace PGE
+{
+    /** All 32 bits of a plane word.  (UInt32 may be wider than 32 bits, so
+        the masks are limited to the bits which are used.)
+    */
+    static const UInt32 ALL_BITS = 0xFFFFFFFF;
+
+    /** Get the mask of the bits of a word from a bit to the end */
+    static inline UInt32 MaskFrom( UInt32 bit )
+    {
+        return ( ALL_BITS << bit ) & ALL_BITS;
+    }
+
+    /** Get the mask of the bits of a word up to and including a bit */
+    static inline UInt32 MaskTo( UInt32 bit )
+    {
+        return ALL_BITS >> ( 31 - bit );
+    }
+
+    /** Get the index of the lowest set bit of a non-zero word */
+    static inline Int LowestBit( UInt32 word )
+    {
+#if ( PGE_COMPILER == PGE_COMPILER_GNUC )
+        return __builtin_ctzl( word );
+#elif ( PGE_COMPILER == PGE_COMPILER_MSVC )
+        unsigned long index;
+        _BitScanForward( &index, word );
+        return index;
+#else
+        Int index = 0;
+        while ( !( word & 1 ) )
+        {
+            word >>= 1;
+            ++index;
+        }
+        return index;
+#endif
+    }
+
+    /** Get the index of the highest set bit of a non-zero word */
+    static inline Int HighestBit( UInt32 word )
+    {
+#if ( PGE_COMPILER == PGE_COMPILER_GNUC )
+        return sizeof( unsigned long ) * 8 - 1 - __builtin_clzl( word );
+#elif ( PGE_COMPILER == PGE_COMPILER_MSVC )
+        unsigned long index;
+        _BitScanReverse( &index, word );
+        return index;
+#else
+        Int index = 0;
+        while ( word >>= 1 )
+            ++index;
+        return index;
+#endif
+    }
+
+    /** Fewest queries in each slice of a batch shared across the work queue */
+    static const UInt32 MIN_BATCH_SLICE = 256;
+
+    const UInt32 TileCollisionMap::WORD_BITS = 32;
+
+    //Execute
+    void TileCollisionMap::QueryJob::Execute()
+    {
+        for ( UInt32 i = first; i < first + count; i++ )
+        {
+            if ( rays )
+                hits[ i ] = map->CastRay( rays[ i ] );
+            else
+                visible[ i ] = map->HasLineOfSight( sights[ i ].from, sights[ i ].to );
+        }
+    }
+
+    //Constructor
+    TileCollisionMap::TileCollisionMap()
+        : mGridSize( 0, 0 ),
+          mTileSize( 0, 0 ),
+          mRowWords( 0 )
+    {
+    }
+
+    //_anyInRow-----------------------------------------------------------------
+    bool TileCollisionMap::_anyInRow( const UInt32* row, Int firstCol, Int lastCol ) const
+    {
+        firstCol = Math::IMax( firstCol, 0 );
+        lastCol  = Math::IMin( lastCol, mGridSize.x - 1 );
+        if ( firstCol > lastCol )
+            return false;
+
+        UInt32 firstWord = firstCol / WORD_BITS;
+        UInt32 lastWord  = lastCol / WORD_BITS;
+        UInt32 firstMask = MaskFrom( firstCol % WORD_BITS );
+        UInt32 lastMask  = MaskTo( lastCol % WORD_BITS );
+        if ( firstWord == lastWord )
+            return ( row[ firstWord ] & firstMask & lastMask ) != 0;
+
+        if ( row[ firstWord ] & firstMask )
+            return true;
+        for ( UInt32 word = firstWord + 1; word < lastWord; word++ )
+        {
+            if ( row[ word ] )
+                return true;
+        }
+        return ( row[ lastWord ] & lastMask ) != 0;
+    }
+
+    //_firstInRow---------------------------------------------------------------
+    Int TileCollisionMap::_firstInRow( const UInt32* row, Int firstCol, Int lastCol ) const
+    {
+        firstCol = Math::IMax( firstCol, 0 );
+        lastCol  = Math::IMin( lastCol, mGridSize.x - 1 );
+        if ( firstCol > lastCol )
+            return -1;
+
+        UInt32 firstWord = firstCol / WORD_BITS;
+        UInt32 lastWord  = lastCol / WORD_BITS;
+        for ( UInt32 word = firstWord; word <= lastWord; word++ )
+        {
+            UInt32 bits = row[ word ];
+            if ( word == firstWord )
+                bits &= MaskFrom( firstCol % WORD_BITS );
+            if ( word == lastWord )
+                bits &= MaskTo( lastCol % WORD_BITS );
+            if ( bits )
+                return word * WORD_BITS + LowestBit( bits );
+        }
+        return -1;
+    }
+
+    //_lastInRow----------------------------------------------------------------
+    Int TileCollisionMap::_lastInRow( const UInt32* row, Int firstCol, Int lastCol ) const
+    {
+        firstCol = Math::IMax( firstCol, 0 );
+        lastCol  = Math::IMin( lastCol, mGridSize.x - 1 );
+        if ( firstCol > lastCol )
+            return -1;
+
+        Int firstWord = firstCol / WORD_BITS;
+        Int lastWord  = lastCol / WORD_BITS;
+        for ( Int word = lastWord; word >= firstWord; word-- )
+        {
+            UInt32 bits = row[ word ];
+            if ( word == firstWord )
+                bits &= MaskFrom( firstCol % WORD_BITS );
+            if ( word == lastWord )
+                bits &= MaskTo( lastCol % WORD_BITS );
+            if ( bits )
+                return word * WORD_BITS + HighestBit( bits );
+        }
+        return -1;
+    }
+
+    //_setCell------------------------------------------------------------------
+    void TileCollisionMap::_setCell( Int x, Int y, SInt32 boundsCode, SInt32 mapCode )
+    {
+        bool flags[ PLANE_COUNT ];
+        flags[ PLANE_TOP ]      = ( boundsCode & 1 ) != 0;
+        flags[ PLANE_LEFT ]     = ( boundsCode & 2 ) != 0;
+        flags[ PLANE_BOTTOM ]   = ( boundsCode & 4 ) != 0;
+        flags[ PLANE_RIGHT ]    = ( boundsCode & 8 ) != 0;
+        flags[ PLANE_SOLID ]    = ( boundsCode & 15 ) == 15;
+        flags[ PLANE_SPECIAL ]  = mapCode != 0;
+
+        UInt32 index = y * mRowWords + x / WORD_BITS;
+        UInt32 bit   = 1UL << ( x % WORD_BITS );
+        for ( UInt32 plane = 0; plane < PLANE_COUNT; plane++ )
+        {
+            if ( flags[ plane ] )
+                mPlanes[ plane ][ index ] |= bit;
+            else
+                mPlanes[ plane ][ index ] &= ~bit;
+        }
+    }
+
+    //_getColumns---------------------------------------------------------------
+    void TileCollisionMap::_getColumns( Real left, Real right, Int& firstCol, Int& lastCol ) const
+    {
+        firstCol = Int( Math::Floor( left / mTileSize.x ) );
+        lastCol  = Int( Math::Ceil( right / mTileSize.x ) ) - 1;
+    }
+
+    //_getRows------------------------------------------------------------------
+    void TileCollisionMap::_getRows( Real top, Real bottom, Int& firstRow, Int& lastRow ) const
+    {
+        firstRow = Math::IMax( Int( Math::Floor( top / mTileSize.y ) ), 0 );
+        lastRow  = Math::IMin( Int( Math::Ceil( bottom / mTileSize.y ) ) - 1, mGridSize.y - 1 );
+    }
+
+    //Build---------------------------------------------------------------------
+    void TileCollisionMap::Build( const TileSet& tileSet )
+    {
+        Clear();
+        Point2D gridSize = tileSet.GetMapGridSize();
+        Point2D tileSize = tileSet.GetTileSize();
+        if ( gridSize.x <= 0 || gridSize.y <= 0 || tileSize.x <= 0 || tileSize.y <= 0 )
+            return;
+
+        mGridSize = gridSize;
+        mTileSize = tileSize;
+        mRowWords = ( mGridSize.x + WORD_BITS - 1 ) / WORD_BITS;
+        for ( UInt32 plane = 0; plane < PLANE_COUNT; plane++ )
+            mPlanes[ plane ].assign( mRowWords * mGridSize.y, 0 );
+        Update( tileSet, 0, 0, mGridSize.x, mGridSize.y );
+    }
+
+    //Update--------------------------------------------------------------------
+    void TileCollisionMap::Update( const TileSet& tileSet, Int x, Int y, Int w, Int h )
+    {
+        Int startX = Math::IMax( x, 0 );
+        Int startY = Math::IMax( y, 0 );
+        Int endX   = Math::IMin( x + w, mGridSize.x );
+        Int endY   = Math::IMin( y + h, mGridSize.y );
+        for ( Int row = startY; row < endY; row++ )
+        {
+            for ( Int col = startX; col < endX; col++ )
+            {
+                TileSet::TileMapItem cell = tileSet.GetCell( col, row );
+                _setCell( col, row, cell.boundsCode, cell.mapCode );
+            }
+        }
+    }
+
+    //ApplyEdits----------------------------------------------------------------
+    void TileCollisionMap::ApplyEdits( const TileSet::CellEdit* edits, UInt32 count )
+    {
+        for ( const TileSet::CellEdit* edit = edits; edit != edits + count; edit++ )
+        {
+            if ( edit->x >= 0 && edit->y >= 0 && edit->x < mGridSize.x && edit->y < mGridSize.y )
+                _setCell( edit->x, edit->y, edit->cell.boundsCode, edit->cell.mapCode );
+        }
+    }
+
+    //Clear---------------------------------------------------------------------
+    void TileCollisionMap::Clear()
+    {
+        for ( UInt32 plane = 0; plane < PLANE_COUNT; plane++ )
+            std::vector< UInt32 >().swap( mPlanes[ plane ] );
+        mGridSize = Point2D( 0, 0 );
+        mRowWords = 0;
+    }
+
+    //IsSet---------------------------------------------------------------------
+    bool TileCollisionMap::IsSet( Plane plane, Int x, Int y ) const
+    {
+        if ( x < 0 || y < 0 || x >= mGridSize.x || y >= mGridSize.y )
+            return false;
+        return ( _getRow( plane, y )[ x / WORD_BITS ] >> ( x % WORD_BITS ) ) & 1;
+    }
+
+    //IsSolid-------------------------------------------------------------------
+    bool TileCollisionMap::IsSolid( const Point2Df& point ) const
+    {
+        if ( mGridSize.x <= 0 )
+            return false;
+        return IsSet( PLANE_SOLID, Int( Math::Floor( point.x / mTileSize.x ) ), Int( Math::Floor( point.y / mTileSize.y ) ) );
+    }
+
+    //TestPoints----------------------------------------------------------------
+    void TileCollisionMap::TestPoints( const Point2Df* points, UInt32 count, Plane plane, UInt8* results ) const
+    {
+        for ( UInt32 i = 0; i < count; i++ )
+        {
+            results[ i ] = mGridSize.x > 0 &&
+                           IsSet( plane, Int( Math::Floor( points[ i ].x / mTileSize.x ) ), Int( Math::Floor( points[ i ].y / mTileSize.y ) ) );
+        }
+    }
+
+    //SweepBox------------------------------------------------------------------
+    TileCollisionMap::SweepResult TileCollisionMap::SweepBox( const RectF& box, const Point2Df& delta ) const
+    {
+        SweepResult result;
+        result.delta    = delta;
+        result.hits     = HIT_NONE;
+        if ( mGridSize.x <= 0 )
+            return result;
+
+        // Horizontal movement.  Each row the box covers is searched for the
+        // nearest edge in the columns it moves into; the search range shrinks
+        // to the nearest edge found so far.
+        Int firstRow, lastRow;
+        _getRows( box.GetTop(), box.GetBottom(), firstRow, lastRow );
+        if ( delta.x > 0 )
+        {
+            Real edge = box.GetRight();
+            Int firstCol = Int( Math::Ceil( edge / mTileSize.x ) );
+            Int lastCol  = Int( Math::Ceil( ( edge + delta.x ) / mTileSize.x ) ) - 1;
+            Int stop = -1;
+            for ( Int row = firstRow; row <= lastRow && firstCol <= lastCol; row++ )
+            {
+                Int col = _firstInRow( _getRow( PLANE_LEFT, row ), firstCol, lastCol );
+                if ( col >= 0 )
+                {
+                    stop    = col;
+                    lastCol = col - 1;
+                }
+            }
+            if ( stop >= 0 )
+            {
+                result.delta.x  = stop * mTileSize.x - edge;
+                result.hits    |= HIT_RIGHT;
+            }
+        }
+        else if ( delta.x < 0 )
+        {
+            Real edge = box.GetLeft();
+            Int firstCol = Int( Math::Floor( ( edge + delta.x ) / mTileSize.x ) );
+            Int lastCol  = Int( Math::Floor( edge / mTileSize.x ) ) - 1;
+            Int stop = -1;
+            for ( Int row = firstRow; row <= lastRow && firstCol <= lastCol; row++ )
+            {
+                Int col = _lastInRow( _getRow( PLANE_RIGHT, row ), firstCol, lastCol );
+                if ( col >= 0 )
+                {
+                    stop     = col;
+                    firstCol = col + 1;
+                }
+            }
+            if ( stop >= 0 )
+            {
+                result.delta.x  = ( stop + 1 ) * mTileSize.x - edge;
+                result.hits    |= HIT_LEFT;
+            }
+        }
+
+        // Vertical movement, from the new horizontal position.  The rows the
+        // box moves into are tested nearest first, a word of columns at a time.
+        Int firstCol, lastCol;
+        Real left = box.GetLeft() + result.delta.x;
+        _getColumns( left, left + box.width, firstCol, lastCol );
+        if ( delta.y > 0 )
+        {
+            Real edge = box.GetBottom();
+            Int startRow = Math::IMax( Int( Math::Ceil( edge / mTileSize.y ) ), 0 );
+            Int endRow   = Math::IMin( Int( Math::Ceil( ( edge + delta.y ) / mTileSize.y ) ) - 1, mGridSize.y - 1 );
+            for ( Int row = startRow; row <= endRow; row++ )
+            {
+                if ( _anyInRow( _getRow( PLANE_TOP, row ), firstCol, lastCol ) )
+                {
+                    result.delta.y  = row * mTileSize.y - edge;
+                    result.hits    |= HIT_BOTTOM;
+                    break;
+                }
+            }
+        }
+        else if ( delta.y < 0 )
+        {
+            Real edge = box.GetTop();
+            Int startRow = Math::IMin( Int( Math::Floor( edge / mTileSize.y ) ) - 1, mGridSize.y - 1 );
+            Int endRow   = Math::IMax( Int( Math::Floor( ( edge + delta.y ) / mTileSize.y ) ), 0 );
+            for ( Int row = startRow; row >= endRow; row-- )
+            {
+                if ( _anyInRow( _getRow( PLANE_BOTTOM, row ), firstCol, lastCol ) )
+                {
+                    result.delta.y  = ( row + 1 ) * mTileSize.y - edge;
+                    result.hits    |= HIT_TOP;
+                    break;
+                }
+            }
+        }
+
+        return result;
+    }
+
+    //SweepBoxes----------------------------------------------------------------
+    void TileCollisionMap::SweepBoxes( const SweepQuery* queries, UInt32 count, SweepResult* results ) const
+    {
+        for ( UInt32 i = 0; i < count; i++ )
+            results[ i ] = SweepBox( queries[ i ].box, queries[ i ].delta );
+    }
+
+    //ProbeGround---------------------------------------------------------------
+    Real TileCollisionMap::ProbeGround( const GroundProbe& probe ) const
+    {
+        if ( mGridSize.x <= 0 )
+            return -1;
+
+        // A line resting exactly on an edge is at distance 0 from it
+        Int firstCol, lastCol;
+        _getColumns( probe.position.x, probe.position.x + probe.width, firstCol, lastCol );
+        Int startRow = Math::IMax( Int( Math::Ceil( probe.position.y / mTileSize.y ) ), 0 );
+        Int endRow   = Math::IMin( Int( Math::Floor( ( probe.position.y + probe.maxDistance ) / mTileSize.y ) ), mGridSize.y - 1 );
+        for ( Int row = startRow; row <= endRow; row++ )
+        {
+            if ( _anyInRow( _getRow( PLANE_TOP, row ), firstCol, lastCol ) )
+                return row * mTileSize.y - probe.position.y;
+        }
+        return -1;
+    }
+
+    //ProbeGround---------------------------------------------------------------
+    void TileCollisionMap::ProbeGround( const GroundProbe* probes, UInt32 count, Real* distances ) const
+    {
+        for ( UInt32 i = 0; i < count; i++ )
+            distances[ i ] = ProbeGround( probes[ i ] );
+    }
+
+    //_runBatch-----------------------------------------------------------------
+    void TileCollisionMap::_runBatch( const RayQuery* rays, RayHit* hits, const SightQuery* sights, UInt8* visible, UInt32 count ) const
+    {
+        WorkQueue* queue = WorkQueue::GetSingletonPtr();
+        UInt32 sliceCount = queue ? Math::IMin( queue->GetThreadCount() + 1, count / MIN_BATCH_SLICE ) : 0;
+        if ( sliceCount < 2 )
+        {
+            for ( UInt32 i = 0; i < count; i++ )
+            {
+                if ( rays )
+                    hits[ i ] = CastRay( rays[ i ] );
+                else
+                    visible[ i ] = HasLineOfSight( sights[ i ].from, sights[ i ].to );
+            }
+            return;
+        }
+
+        // The first slice is answered here while the workers take the rest;
+        // waiting answers any slice no worker has started yet.
+        QueryJob* jobs = new QueryJob[ sliceCount ];
+        UInt32 first = 0;
+        for ( UInt32 i = 0; i < sliceCount; i++ )
+        {
+            jobs[ i ].map       = this;
+            jobs[ i ].rays      = rays;
+            jobs[ i ].hits      = hits;
+            jobs[ i ].sights    = sights;
+            jobs[ i ].visible   = visible;
+            jobs[ i ].first     = first;
+            jobs[ i ].count     = ( count - first ) / ( sliceCount - i );
+            first              += jobs[ i ].count;
+            if ( i > 0 )
+                queue->Submit( &jobs[ i ] );
+        }
+        jobs[ 0 ].Execute();
+        for ( UInt32 i = 1; i < sliceCount; i++ )
+            queue->Wait( &jobs[ i ] );
+        delete[] jobs;
+    }
+
+    //CastRay-------------------------------------------------------------------
+    TileCollisionMap::RayHit TileCollisionMap::CastRay( const RayQuery& ray ) const
+    {
+        RayHit hit;
+        hit.isHit       = false;
+        hit.cell        = Point2D( -1, -1 );
+        hit.face        = PLANE_COUNT;
+        hit.distance    = ray.maxDistance;
+        hit.point       = ray.origin;
+
+        Real length = Math::Sqrt( ray.direction.x * ray.direction.x + ray.direction.y * ray.direction.y );
+        if ( mGridSize.x <= 0 || length <= 0 || ray.maxDistance < 0 )
+            return hit;
+        Real dirX = ray.direction.x / length;
+        Real dirY = ray.direction.y / length;
+        hit.point = Point2Df( ray.origin.x + dirX * ray.maxDistance, ray.origin.y + dirY * ray.maxDistance );
+
+        // Clip the ray to the map, so that a ray starting outside does not
+        // step through the empty cells on the way in
+        Real mapWidth  = Real( mGridSize.x * mTileSize.x );
+        Real mapHeight = Real( mGridSize.y * mTileSize.y );
+        Real enter = 0;
+        Real leave = ray.maxDistance;
+        bool isEnteredX = false;
+        if ( dirX != 0 )
+        {
+            Real t0 = ( 0 - ray.origin.x ) / dirX;
+            Real t1 = ( mapWidth - ray.origin.x ) / dirX;
+            if ( t0 > t1 )
+                std::swap( t0, t1 );
+            if ( t0 > enter )
+            {
+                enter = t0;
+                isEnteredX = true;
+            }
+            leave = Math::Min( leave, t1 );
+        }
+        else if ( ray.origin.x < 0 || ray.origin.x >= mapWidth )
+            return hit;
+        if ( dirY != 0 )
+        {
+            Real t0 = ( 0 - ray.origin.y ) / dirY;
+            Real t1 = ( mapHeight - ray.origin.y ) / dirY;
+            if ( t0 > t1 )
+                std::swap( t0, t1 );
+            if ( t0 > enter )
+            {
+                enter = t0;
+                isEnteredX = false;
+            }
+            leave = Math::Min( leave, t1 );
+        }
+        else if ( ray.origin.y < 0 || ray.origin.y >= mapHeight )
+            return hit;
+        if ( enter > leave )
+            return hit;
+
+        Int stepX = ( dirX > 0 ) ? 1 : ( ( dirX < 0 ) ? -1 : 0 );
+        Int stepY = ( dirY > 0 ) ? 1 : ( ( dirY < 0 ) ? -1 : 0 );
+        Int col = Math::IClamp( Int( Math::Floor( ( ray.origin.x + dirX * enter ) / mTileSize.x ) ), 0, mGridSize.x - 1 );
+        Int row = Math::IClamp( Int( Math::Floor( ( ray.origin.y + dirY * enter ) / mTileSize.y ) ), 0, mGridSize.y - 1 );
+
+        // Distance along the ray to the next column and row boundaries, and
+        // between boundaries
+        static const Real NEVER = 1e30f;
+        Real nextX  = ( stepX > 0 ) ? ( ( col + 1 ) * mTileSize.x - ray.origin.x ) / dirX :
+                      ( stepX < 0 ) ? ( col * mTileSize.x - ray.origin.x ) / dirX : NEVER;
+        Real nextY  = ( stepY > 0 ) ? ( ( row + 1 ) * mTileSize.y - ray.origin.y ) / dirY :
+                      ( stepY < 0 ) ? ( row * mTileSize.y - ray.origin.y ) / dirY : NEVER;
+        Real deltaX = stepX ? mTileSize.x / Math::Abs( dirX ) : NEVER;
+        Real deltaY = stepY ? mTileSize.y / Math::Abs( dirY ) : NEVER;
+
+        // A ray entering from outside crosses an edge of its first cell
+        Plane face = PLANE_COUNT;
+        Real distance = enter;
+        if ( enter > 0 )
+            face = isEnteredX ? ( ( stepX > 0 ) ? PLANE_LEFT : PLANE_RIGHT ) : ( ( stepY > 0 ) ? PLANE_TOP : PLANE_BOTTOM );
+
+        while ( true )
+        {
+            if ( face != PLANE_COUNT && IsSet( face, col, row ) )
+            {
+                hit.isHit       = true;
+                hit.cell        = Point2D( col, row );
+                hit.face        = face;
+                hit.distance    = distance;
+                hit.point       = Point2Df( ray.origin.x + dirX * distance, ray.origin.y + dirY * distance );
+                return hit;
+            }
+
+            // An edge blocks movement into its cell, so moving right is
+            // stopped by the left edge of the next cell, and so on
+            if ( nextX < nextY )
+            {
+                distance = nextX;
+                col     += stepX;
+                nextX   += deltaX;
+                face     = ( stepX > 0 ) ? PLANE_LEFT : PLANE_RIGHT;
+            }
+            else
+            {
+                distance = nextY;
+                row     += stepY;
+                nextY   += deltaY;
+                face     = ( stepY > 0 ) ? PLANE_TOP : PLANE_BOTTOM;
+            }
+            if ( distance > leave || col < 0 || row < 0 || col >= mGridSize.x || row >= mGridSize.y )
+                return hit;
+        }
+    }
+
+    //CastRays------------------------------------------------------------------
+    void TileCollisionMap::CastRays( const RayQuery* rays, UInt32 count, RayHit* hits ) const
+    {
+        _runBatch( rays, hits, 0, 0, count );
+    }
+
+    //HasLineOfSight------------------------------------------------------------
+    bool TileCollisionMap::HasLineOfSight( const Point2Df& from, const Point2Df& to ) const
+    {
+        RayQuery ray;
+        ray.origin      = from;
+        ray.direction   = Point2Df( to.x - from.x, to.y - from.y );
+        ray.maxDistance = Math::Sqrt( ray.direction.x * ray.direction.x + ray.direction.y * ray.direction.y );
+        return !CastRay( ray ).isHit;
+    }
+
+    //TestSight-----------------------------------------------------------------
+    void TileCollisionMap::TestSight( const SightQuery* queries, UInt32 count, UInt8* results ) const
+    {
+        _runBatch( 0, 0, queries, results, count );
+    }
+
+} // namespace PGE
@@ -0,0 +1,380 @@
+/*! $Id$
+ *  @file   PgeTileFlowField.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeTileFlowField.h"
+#include "PgeMath.h"
+
+namespace PGE
+{
+    /** Direction from each neighbour back to the cell it was reached from */
+    static const UInt8 OPPOSITE_STEP[ 8 ] = { 2, 3, 0, 1, 7, 6, 5, 4 };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // class TileFlowField
+    ////////////////////////////////////////////////////////////////////////////
+
+    const UInt32 TileFlowField::NO_PATH     = 0xFFFFFFFF;
+    const UInt8  TileFlowField::STEP_NONE   = 8;
+
+    // Straight steps first, then diagonals, then no step
+    const Int TileFlowField::STEP_X[ 9 ] = { 0, -1, 0, 1, -1, 1, -1, 1, 0 };
+    const Int TileFlowField::STEP_Y[ 9 ] = { -1, 0, 1, 0, -1, -1, 1, 1, 0 };
+
+    //Constructor
+    TileFlowField::TileFlowField( const Point2D& goal, const Point2D& gridSize )
+        : mGoal( goal ),
+          mGridSize( gridSize )
+    {
+    }
+
+    //GetDirection--------------------------------------------------------------
+    Point2Df TileFlowField::GetDirection( Int x, Int y ) const
+    {
+        static const Real DIAGONAL = 0.70710678f;
+        Point2D step = GetStep( x, y );
+        if ( step.x && step.y )
+            return Point2Df( step.x * DIAGONAL, step.y * DIAGONAL );
+        return Point2Df( Real( step.x ), Real( step.y ) );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // class TileFlowFieldCache::FieldJob
+    ////////////////////////////////////////////////////////////////////////////
+
+    //Execute
+    void TileFlowFieldCache::FieldJob::Execute()
+    {
+        cache->_integrate( *field );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // class TileFlowFieldCache
+    ////////////////////////////////////////////////////////////////////////////
+
+    const UInt32 TileFlowFieldCache::STRAIGHT_COST = 10;
+    const UInt32 TileFlowFieldCache::DIAGONAL_COST = 14;
+
+    //Constructor
+    TileFlowFieldCache::TileFlowFieldCache( UInt32 capacity )
+        : mCapacity( Math::IMax( capacity, 1 ) ),
+          mGridSize( 0, 0 ),
+          mChunkGridSize( 0, 0 ),
+          mNextUse( 0 )
+    {
+        for ( UInt32 code = 0; code < 256; code++ )
+            mCodeCosts[ code ] = 1;
+    }
+
+    //Destructor
+    TileFlowFieldCache::~TileFlowFieldCache()
+    {
+        Clear();
+    }
+
+    //_integrate----------------------------------------------------------------
+    void TileFlowFieldCache::_integrate( TileFlowField& field ) const
+    {
+        UInt32 cellCount = mGridSize.x * mGridSize.y;
+        field.mGridSize = mGridSize;
+        field.mCosts.assign( cellCount, TileFlowField::NO_PATH );
+        field.mSteps.assign( cellCount, TileFlowField::STEP_NONE );
+        field.mChunks.assign( mChunkGridSize.x * mChunkGridSize.y, 0 );
+
+        const Point2D& goal = field.mGoal;
+        UInt32 goalCell = goal.y * mGridSize.x + goal.x;
+        if ( mSolid[ goalCell ] || !mCodeCosts[ mCodes[ goalCell ] ] )
+            return;
+
+        // The costs are small whole numbers, so the wavefront is kept in a
+        // ring of buckets, one for each cost, rather than a heap.  No move
+        // costs more than the ring holds, so a bucket is never reused while
+        // it still has cells waiting.
+        UInt32 bucketCount = DIAGONAL_COST * 255 + 1;
+        std::vector< std::vector< UInt32 > > buckets( bucketCount );
+        field.mCosts[ goalCell ] = 0;
+        buckets[ 0 ].push_back( goalCell );
+        UInt32 waiting = 1;
+
+        for ( UInt32 cost = 0; waiting > 0; cost++ )
+        {
+            std::vector< UInt32 >& bucket = buckets[ cost % bucketCount ];
+            for ( UInt32 i = 0; i < bucket.size(); i++ )
+            {
+                waiting--;
+                UInt32 cell = bucket[ i ];
+                if ( field.mCosts[ cell ] != cost )
+                    continue;
+
+                Int x = cell % mGridSize.x;
+                Int y = cell / mGridSize.x;
+                field.mChunks[ ( y / TileSet::CHUNK_SIZE ) * mChunkGridSize.x + x / TileSet::CHUNK_SIZE ] = 1;
+
+                // Neighbours step into this cell, so they pay for crossing it
+                UInt32 cellCost = mCodeCosts[ mCodes[ cell ] ];
+                for ( UInt32 step = 0; step < 8; step++ )
+                {
+                    Int nx = x + TileFlowField::STEP_X[ step ];
+                    Int ny = y + TileFlowField::STEP_Y[ step ];
+                    if ( nx < 0 || ny < 0 || nx >= mGridSize.x || ny >= mGridSize.y )
+                        continue;
+                    UInt32 next = ny * mGridSize.x + nx;
+                    if ( mSolid[ next ] || !mCodeCosts[ mCodes[ next ] ] )
+                        continue;
+                    if ( step >= 4 && ( mSolid[ y * mGridSize.x + nx ] || mSolid[ ny * mGridSize.x + x ] ) )
+                        continue;
+
+                    UInt32 nextCost = cost + cellCost * ( ( step >= 4 ) ? DIAGONAL_COST : STRAIGHT_COST );
+                    if ( nextCost >= field.mCosts[ next ] )
+                        continue;
+                    field.mCosts[ next ] = nextCost;
+                    field.mSteps[ next ] = OPPOSITE_STEP[ step ];
+                    buckets[ nextCost % bucketCount ].push_back( next );
+                    waiting++;
+                }
+            }
+            bucket.clear();
+        }
+    }
+
+    //_findSlot-----------------------------------------------------------------
+    Int TileFlowFieldCache::_findSlot( const Point2D& goal ) const
+    {
+        for ( UInt32 i = 0; i < mSlots.size(); i++ )
+        {
+            if ( mSlots[ i ].goal.x == goal.x && mSlots[ i ].goal.y == goal.y )
+                return i;
+        }
+        return -1;
+    }
+
+    //_addSlot------------------------------------------------------------------
+    TileFlowFieldCache::FieldSlot& TileFlowFieldCache::_addSlot( const Point2D& goal )
+    {
+        FieldSlot empty = { goal, 0, 0, 0, false };
+        if ( mSlots.size() < mCapacity )
+        {
+            mSlots.push_back( empty );
+            return mSlots.back();
+        }
+
+        // Replace the field used least recently
+        UInt32 oldest = 0;
+        for ( UInt32 i = 1; i < mSlots.size(); i++ )
+        {
+            if ( mSlots[ i ].lastUsed < mSlots[ oldest ].lastUsed )
+                oldest = i;
+        }
+        FieldSlot& slot = mSlots[ oldest ];
+        _finishJob( slot, true );
+        delete slot.field;
+        slot = empty;
+        return slot;
+    }
+
+    //_collectJob---------------------------------------------------------------
+    void TileFlowFieldCache::_collectJob( FieldSlot& slot )
+    {
+        delete slot.field;
+        slot.field = slot.job->field;
+        delete slot.job;
+        slot.job = 0;
+    }
+
+    //_finishJob----------------------------------------------------------------
+    void TileFlowFieldCache::_finishJob( FieldSlot& slot, bool isCancelled )
+    {
+        if ( !slot.job )
+            return;
+
+        WorkQueue* queue = WorkQueue::GetSingletonPtr();
+        if ( queue && slot.job->IsBusy() && !( isCancelled && queue->Cancel( slot.job ) ) )
+            queue->Wait( slot.job );
+        if ( isCancelled )
+        {
+            delete slot.job->field;
+            delete slot.job;
+            slot.job = 0;
+        }
+        else
+            _collectJob( slot );
+    }
+
+    //_finishJobs---------------------------------------------------------------
+    void TileFlowFieldCache::_finishJobs()
+    {
+        for ( UInt32 i = 0; i < mSlots.size(); i++ )
+            _finishJob( mSlots[ i ], false );
+    }
+
+    //_setCell------------------------------------------------------------------
+    void TileFlowFieldCache::_setCell( Int x, Int y, SInt32 boundsCode, SInt32 mapCode )
+    {
+        UInt32 cell = y * mGridSize.x + x;
+        UInt8 solid = ( boundsCode & 15 ) == 15;
+        UInt8 code = UInt8( Math::IClamp( mapCode, 0, 255 ) );
+        if ( mSolid[ cell ] == solid && mCodes[ cell ] == code )
+            return;
+        mSolid[ cell ] = solid;
+        mCodes[ cell ] = code;
+
+        // A cell which opens beside a reached cell can change the field, even
+        // if the field never reached the cell's own chunk
+        Int firstX = Math::IMax( x - 1, 0 ) / TileSet::CHUNK_SIZE;
+        Int firstY = Math::IMax( y - 1, 0 ) / TileSet::CHUNK_SIZE;
+        Int lastX  = Math::IMin( x + 1, mGridSize.x - 1 ) / TileSet::CHUNK_SIZE;
+        Int lastY  = Math::IMin( y + 1, mGridSize.y - 1 ) / TileSet::CHUNK_SIZE;
+        for ( UInt32 i = 0; i < mSlots.size(); i++ )
+        {
+            FieldSlot& slot = mSlots[ i ];
+            if ( !slot.field || slot.isStale )
+                continue;
+            for ( Int chunkY = firstY; chunkY <= lastY && !slot.isStale; chunkY++ )
+            {
+                for ( Int chunkX = firstX; chunkX <= lastX; chunkX++ )
+                {
+                    if ( slot.field->IsChunkReached( chunkY * mChunkGridSize.x + chunkX ) )
+                    {
+                        slot.isStale = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    //SetCodeCost---------------------------------------------------------------
+    void TileFlowFieldCache::SetCodeCost( UInt8 mapCode, UInt8 cost )
+    {
+        if ( mCodeCosts[ mapCode ] == cost )
+            return;
+        _finishJobs();
+        mCodeCosts[ mapCode ] = cost;
+        for ( UInt32 i = 0; i < mSlots.size(); i++ )
+            mSlots[ i ].isStale = true;
+    }
+
+    //Build---------------------------------------------------------------------
+    void TileFlowFieldCache::Build( const TileSet& tileSet )
+    {
+        Clear();
+        Point2D gridSize = tileSet.GetMapGridSize();
+        if ( gridSize.x <= 0 || gridSize.y <= 0 )
+            return;
+
+        mGridSize = gridSize;
+        mChunkGridSize = Point2D( ( mGridSize.x + TileSet::CHUNK_SIZE - 1 ) / TileSet::CHUNK_SIZE,
+                                  ( mGridSize.y + TileSet::CHUNK_SIZE - 1 ) / TileSet::CHUNK_SIZE );
+        mSolid.assign( mGridSize.x * mGridSize.y, 0 );
+        mCodes.assign( mGridSize.x * mGridSize.y, 0 );
+        for ( Int row = 0; row < mGridSize.y; row++ )
+        {
+            for ( Int col = 0; col < mGridSize.x; col++ )
+            {
+                TileSet::TileMapItem cell = tileSet.GetCell( col, row );
+                mSolid[ row * mGridSize.x + col ] = ( cell.boundsCode & 15 ) == 15;
+                mCodes[ row * mGridSize.x + col ] = UInt8( Math::IClamp( cell.mapCode, 0, 255 ) );
+            }
+        }
+    }
+
+    //Update--------------------------------------------------------------------
+    void TileFlowFieldCache::Update( const TileSet& tileSet, Int x, Int y, Int w, Int h )
+    {
+        _finishJobs();
+        Int startX = Math::IMax( x, 0 );
+        Int startY = Math::IMax( y, 0 );
+        Int endX   = Math::IMin( x + w, mGridSize.x );
+        Int endY   = Math::IMin( y + h, mGridSize.y );
+        for ( Int row = startY; row < endY; row++ )
+        {
+            for ( Int col = startX; col < endX; col++ )
+            {
+                TileSet::TileMapItem cell = tileSet.GetCell( col, row );
+                _setCell( col, row, cell.boundsCode, cell.mapCode );
+            }
+        }
+    }
+
+    //ApplyEdits----------------------------------------------------------------
+    void TileFlowFieldCache::ApplyEdits( const TileSet::CellEdit* edits, UInt32 count )
+    {
+        _finishJobs();
+        for ( const TileSet::CellEdit* edit = edits; edit != edits + count; edit++ )
+        {
+            if ( edit->x >= 0 && edit->y >= 0 && edit->x < mGridSize.x && edit->y < mGridSize.y )
+                _setCell( edit->x, edit->y, edit->cell.boundsCode, edit->cell.mapCode );
+        }
+    }
+
+    //Clear---------------------------------------------------------------------
+    void TileFlowFieldCache::Clear()
+    {
+        for ( UInt32 i = 0; i < mSlots.size(); i++ )
+        {
+            _finishJob( mSlots[ i ], true );
+            delete mSlots[ i ].field;
+        }
+        mSlots.clear();
+        std::vector< UInt8 >().swap( mSolid );
+        std::vector< UInt8 >().swap( mCodes );
+        mGridSize = Point2D( 0, 0 );
+        mChunkGridSize = Point2D( 0, 0 );
+    }
+
+    //GetField------------------------------------------------------------------
+    const TileFlowField* TileFlowFieldCache::GetField( const Point2D& goal )
+    {
+        if ( goal.x < 0 || goal.y < 0 || goal.x >= mGridSize.x || goal.y >= mGridSize.y )
+            return 0;
+
+        Int index = _findSlot( goal );
+        FieldSlot& slot = ( index < 0 ) ? _addSlot( goal ) : mSlots[ index ];
+        _finishJob( slot, false );
+        if ( !slot.field || slot.isStale )
+        {
+            // The field is made again in place, so it stays at the same address
+            if ( !slot.field )
+                slot.field = new TileFlowField( goal, mGridSize );
+            _integrate( *slot.field );
+            slot.isStale = false;
+        }
+        slot.lastUsed = ++mNextUse;
+        return slot.field;
+    }
+
+    //RequestField--------------------------------------------------------------
+    const TileFlowField* TileFlowFieldCache::RequestField( const Point2D& goal )
+    {
+        if ( goal.x < 0 || goal.y < 0 || goal.x >= mGridSize.x || goal.y >= mGridSize.y )
+            return 0;
+
+        Int index = _findSlot( goal );
+        FieldSlot& slot = ( index < 0 ) ? _addSlot( goal ) : mSlots[ index ];
+        if ( slot.job && !slot.job->IsBusy() )
+            _collectJob( slot );
+        if ( !slot.job && ( !slot.field || slot.isStale ) )
+        {
+            FieldJob* job = new FieldJob();
+            job->cache = this;
+            job->field = new TileFlowField( goal, mGridSize );
+            slot.job = job;
+            slot.isStale = false;
+
+            // Without worker threads, the field is made right away
+            WorkQueue* queue = WorkQueue::GetSingletonPtr();
+            if ( queue )
+                queue->Submit( job );
+            else
+                job->Execute();
+            if ( !job->IsBusy() )
+                _collectJob( slot );
+        }
+        slot.lastUsed = ++mNextUse;
+        return slot.field;
+    }
+
+} // namespace PGE
@@ -0,0 +1,484 @@
+/*! $Id$
+ *  @file   PgeTileFogOfWar.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeTileFogOfWar.h"
+#include "PgeMath.h"
+
+namespace PGE
+{
+    /** All 32 bits of a word.  (UInt32 may be wider than 32 bits, so the
+        masks are limited to the bits which are used.)
+    */
+    static const UInt32 ALL_BITS = 0xFFFFFFFF;
+
+    /** Direction of the columns and rows of each quadrant of a view: north,
+        east, south and west
+    */
+    static const Int QUADRANT_COL_X[ 4 ]    = { 1, 0, 1, 0 };
+    static const Int QUADRANT_COL_Y[ 4 ]    = { 0, 1, 0, 1 };
+    static const Int QUADRANT_DEPTH_X[ 4 ]  = { 0, 1, 0, -1 };
+    static const Int QUADRANT_DEPTH_Y[ 4 ]  = { -1, 0, 1, 0 };
+
+    /** Divide, rounding towards negative infinity */
+    static inline Int FloorDiv( Int a, Int b )
+    {
+        return ( a >= 0 ) ? a / b : -( ( -a + b - 1 ) / b );
+    }
+
+    /** Divide, rounding towards positive infinity */
+    static inline Int CeilDiv( Int a, Int b )
+    {
+        return -FloorDiv( -a, b );
+    }
+
+    const UInt32 TileFogOfWar::NO_OBSERVER  = 0xFFFFFFFF;
+    const UInt32 TileFogOfWar::WORD_BITS    = 32;
+
+    //Constructor
+    TileFogOfWar::TileFogOfWar( UInt32 teamCount )
+        : mGridSize( 0, 0 ),
+          mChunkGridSize( 0, 0 ),
+          mRowWords( 0 ),
+          mTeams( teamCount ),
+          mSerial( 0 )
+    {
+        for ( UInt32 i = 0; i < mTeams.size(); i++ )
+            mTeams[ i ].isDirty = false;
+    }
+
+    //_setCell------------------------------------------------------------------
+    void TileFogOfWar::_setCell( Int x, Int y, SInt32 boundsCode )
+    {
+        bool isOpaque = ( boundsCode & 15 ) == 15;
+        if ( isOpaque == _isOpaque( x, y ) )
+            return;
+        UInt32& word = mOpaque[ y * mRowWords + x / WORD_BITS ];
+        word ^= UInt32( 1 ) << ( x % WORD_BITS );
+
+        for ( ObserverArray::iterator observer = mObservers.begin(); observer != mObservers.end(); observer++ )
+        {
+            if ( observer->isActive && Math::IAbs( x - observer->cell.x ) <= Int( observer->radius ) &&
+                 Math::IAbs( y - observer->cell.y ) <= Int( observer->radius ) )
+                observer->isDirty = true;
+        }
+    }
+
+    //_touchTeam----------------------------------------------------------------
+    void TileFogOfWar::_touchTeam( const Observer& observer )
+    {
+        if ( !observer.isCast )
+            return;
+
+        Int top     = Math::IMax( observer.top, 0 );
+        Int bottom  = Math::IMin( observer.bottom, mGridSize.y - 1 );
+        Int first   = Math::IMax( observer.firstWord, 0 );
+        Int last    = Math::IMin( observer.firstWord + observer.rowWords - 1, Int( mRowWords ) - 1 );
+        if ( top > bottom || first > last )
+            return;
+
+        Team& team = mTeams[ observer.team ];
+        if ( !team.isDirty )
+        {
+            team.isDirty        = true;
+            team.dirtyTop       = top;
+            team.dirtyBottom    = bottom;
+            team.dirtyFirst     = first;
+            team.dirtyLast      = last;
+        }
+        else
+        {
+            team.dirtyTop       = Math::IMin( team.dirtyTop, top );
+            team.dirtyBottom    = Math::IMax( team.dirtyBottom, bottom );
+            team.dirtyFirst     = Math::IMin( team.dirtyFirst, first );
+            team.dirtyLast      = Math::IMax( team.dirtyLast, last );
+        }
+    }
+
+    //_castObserver-------------------------------------------------------------
+    void TileFogOfWar::_castObserver( Observer& observer )
+    {
+        Int radius = observer.radius;
+        Int lastWord = FloorDiv( observer.cell.x + radius, WORD_BITS );
+        observer.top        = observer.cell.y - radius;
+        observer.bottom     = observer.cell.y + radius;
+        observer.firstWord  = FloorDiv( observer.cell.x - radius, WORD_BITS );
+        observer.rowWords   = lastWord - observer.firstWord + 1;
+        observer.bits.assign( ( 2 * radius + 1 ) * observer.rowWords, 0 );
+        observer.isCast     = true;
+
+        Int firstColumn = observer.firstWord * Int( WORD_BITS );
+        Int limit = radius * ( radius + 1 );
+        if ( observer.cell.x >= 0 && observer.cell.y >= 0 && observer.cell.x < mGridSize.x && observer.cell.y < mGridSize.y )
+        {
+            Int col = observer.cell.x - firstColumn;
+            observer.bits[ radius * observer.rowWords + col / WORD_BITS ] |= UInt32( 1 ) << ( col % WORD_BITS );
+        }
+
+        // Symmetric shadowcasting, one quadrant at a time.  Each row of a
+        // quadrant lies between a start and end slope; walls narrow the
+        // slopes of the next row, or split it in two.  A floor is only seen
+        // if its centre lies between the slopes, which makes sight symmetric;
+        // walls are seen if any part of them is.
+        for ( UInt32 quadrant = 0; quadrant < 4; quadrant++ )
+        {
+            ScanRow first = { 1, -1, 1, 1, 1 };
+            mScanRows.clear();
+            mScanRows.push_back( first );
+            while ( !mScanRows.empty() )
+            {
+                ScanRow row = mScanRows.back();
+                mScanRows.pop_back();
+                if ( row.depth > radius )
+                    continue;
+
+                Int minCol = FloorDiv( 2 * row.depth * row.startNum + row.startDen, 2 * row.startDen );
+                Int maxCol = CeilDiv( 2 * row.depth * row.endNum - row.endDen, 2 * row.endDen );
+                Int prevWall = -1;
+                for ( Int col = minCol; col <= maxCol; col++ )
+                {
+                    Int x = observer.cell.x + col * QUADRANT_COL_X[ quadrant ] + row.depth * QUADRANT_DEPTH_X[ quadrant ];
+                    Int y = observer.cell.y + col * QUADRANT_COL_Y[ quadrant ] + row.depth * QUADRANT_DEPTH_Y[ quadrant ];
+                    Int isWall = _isOpaque( x, y ) ? 1 : 0;
+                    bool isSymmetric = col * row.startDen >= row.depth * row.startNum &&
+                                       col * row.endDen <= row.depth * row.endNum;
+                    if ( ( isWall || isSymmetric ) && col * col + row.depth * row.depth <= limit &&
+                         x >= 0 && y >= 0 && x < mGridSize.x && y < mGridSize.y )
+                    {
+                        Int bit = x - firstColumn;
+                        observer.bits[ ( y - observer.top ) * observer.rowWords + bit / WORD_BITS ] |= UInt32( 1 ) << ( bit % WORD_BITS );
+                    }
+
+                    if ( prevWall == 1 && !isWall )
+                    {
+                        row.startNum = 2 * col - 1;
+                        row.startDen = 2 * row.depth;
+                    }
+                    else if ( prevWall == 0 && isWall )
+                    {
+                        ScanRow next = { row.depth + 1, row.startNum, row.startDen, 2 * col - 1, 2 * row.depth };
+                        mScanRows.push_back( next );
+                    }
+                    prevWall = isWall;
+                }
+                if ( prevWall == 0 )
+                {
+                    ScanRow next = { row.depth + 1, row.startNum, row.startDen, row.endNum, row.endDen };
+                    mScanRows.push_back( next );
+                }
+            }
+        }
+    }
+
+    //_mergeTeam----------------------------------------------------------------
+    void TileFogOfWar::_mergeTeam( Team& team, UInt32 teamIndex )
+    {
+        for ( Int row = team.dirtyTop; row <= team.dirtyBottom; row++ )
+        {
+            UInt32* visible = &team.visible[ row * mRowWords ];
+            for ( Int word = team.dirtyFirst; word <= team.dirtyLast; word++ )
+                visible[ word ] = 0;
+        }
+
+        // OR the rows of each observer over the dirty area
+        for ( ObserverArray::const_iterator observer = mObservers.begin(); observer != mObservers.end(); observer++ )
+        {
+            if ( !observer->isActive || !observer->isCast || observer->team != teamIndex )
+                continue;
+            Int top     = Math::IMax( team.dirtyTop, observer->top );
+            Int bottom  = Math::IMin( team.dirtyBottom, observer->bottom );
+            Int first   = Math::IMax( team.dirtyFirst, observer->firstWord );
+            Int last    = Math::IMin( team.dirtyLast, observer->firstWord + observer->rowWords - 1 );
+            for ( Int row = top; row <= bottom; row++ )
+            {
+                UInt32* visible = &team.visible[ row * mRowWords ];
+                const UInt32* bits = &observer->bits[ ( row - observer->top ) * observer->rowWords ];
+                for ( Int word = first; word <= last; word++ )
+                    visible[ word ] |= bits[ word - observer->firstWord ];
+            }
+        }
+
+        // Add what is seen now to what has been seen, noting the chunks which
+        // gained cells
+        for ( Int row = team.dirtyTop; row <= team.dirtyBottom; row++ )
+        {
+            const UInt32* visible = &team.visible[ row * mRowWords ];
+            UInt32* explored = &team.explored[ row * mRowWords ];
+            for ( Int word = team.dirtyFirst; word <= team.dirtyLast; word++ )
+            {
+                if ( !( visible[ word ] & ~explored[ word ] ) )
+                    continue;
+                explored[ word ] |= visible[ word ];
+
+                Int chunkY = row / TileSet::CHUNK_SIZE;
+                Int startX = ( word * WORD_BITS ) / TileSet::CHUNK_SIZE;
+                Int endX   = Math::IMin( word * WORD_BITS + WORD_BITS - 1, mGridSize.x - 1 ) / TileSet::CHUNK_SIZE;
+                for ( Int chunkX = startX; chunkX <= endX; chunkX++ )
+                {
+                    UInt32 chunk = chunkY * mChunkGridSize.x + chunkX;
+                    if ( !mChunkTouched[ chunk ] )
+                    {
+                        mChunkTouched[ chunk ] = 1;
+                        mTouchedChunks.push_back( chunk );
+                    }
+                }
+            }
+        }
+
+        if ( !mTouchedChunks.empty() )
+        {
+            ++mSerial;
+            for ( UInt32 i = 0; i < mTouchedChunks.size(); i++ )
+            {
+                team.chunkSerials[ mTouchedChunks[ i ] ] = mSerial;
+                mChunkTouched[ mTouchedChunks[ i ] ] = 0;
+            }
+            mTouchedChunks.clear();
+        }
+        team.isDirty = false;
+    }
+
+    //Build---------------------------------------------------------------------
+    void TileFogOfWar::Build( const TileSet& tileSet )
+    {
+        mGridSize = tileSet.GetMapGridSize();
+        if ( mGridSize.x <= 0 || mGridSize.y <= 0 )
+            mGridSize = Point2D( 0, 0 );
+        mChunkGridSize = Point2D( ( mGridSize.x + TileSet::CHUNK_SIZE - 1 ) / TileSet::CHUNK_SIZE,
+                                  ( mGridSize.y + TileSet::CHUNK_SIZE - 1 ) / TileSet::CHUNK_SIZE );
+        mRowWords = ( mGridSize.x + WORD_BITS - 1 ) / WORD_BITS;
+
+        mOpaque.assign( mGridSize.y * mRowWords, 0 );
+        for ( Int row = 0; row < mGridSize.y; row++ )
+        {
+            for ( Int col = 0; col < mGridSize.x; col++ )
+            {
+                if ( ( tileSet.GetCell( col, row ).boundsCode & 15 ) == 15 )
+                    mOpaque[ row * mRowWords + col / WORD_BITS ] |= UInt32( 1 ) << ( col % WORD_BITS );
+            }
+        }
+
+        UInt32 chunkCount = mChunkGridSize.x * mChunkGridSize.y;
+        for ( TeamArray::iterator team = mTeams.begin(); team != mTeams.end(); team++ )
+        {
+            team->visible.assign( mGridSize.y * mRowWords, 0 );
+            team->explored.assign( mGridSize.y * mRowWords, 0 );
+            team->chunkSerials.assign( chunkCount, 0 );
+            team->isDirty = false;
+        }
+        mChunkTouched.assign( chunkCount, 0 );
+        mTouchedChunks.clear();
+
+        for ( ObserverArray::iterator observer = mObservers.begin(); observer != mObservers.end(); observer++ )
+        {
+            observer->isDirty = observer->isActive;
+            observer->isCast = false;
+        }
+        Refresh();
+    }
+
+    //Update--------------------------------------------------------------------
+    void TileFogOfWar::Update( const TileSet& tileSet, Int x, Int y, Int w, Int h )
+    {
+        Int startX = Math::IMax( x, 0 );
+        Int startY = Math::IMax( y, 0 );
+        Int endX   = Math::IMin( x + w, mGridSize.x );
+        Int endY   = Math::IMin( y + h, mGridSize.y );
+        for ( Int row = startY; row < endY; row++ )
+        {
+            for ( Int col = startX; col < endX; col++ )
+                _setCell( col, row, tileSet.GetCell( col, row ).boundsCode );
+        }
+    }
+
+    //ApplyEdits----------------------------------------------------------------
+    void TileFogOfWar::ApplyEdits( const TileSet::CellEdit* edits, UInt32 count )
+    {
+        for ( const TileSet::CellEdit* edit = edits; edit != edits + count; edit++ )
+        {
+            if ( edit->x >= 0 && edit->y >= 0 && edit->x < mGridSize.x && edit->y < mGridSize.y )
+                _setCell( edit->x, edit->y, edit->cell.boundsCode );
+        }
+    }
+
+    //Clear---------------------------------------------------------------------
+    void TileFogOfWar::Clear()
+    {
+        std::vector< UInt32 >().swap( mOpaque );
+        mObservers.clear();
+        mFreeObservers.clear();
+        for ( TeamArray::iterator team = mTeams.begin(); team != mTeams.end(); team++ )
+        {
+            std::vector< UInt32 >().swap( team->visible );
+            std::vector< UInt32 >().swap( team->explored );
+            std::vector< UInt32 >().swap( team->chunkSerials );
+            team->isDirty = false;
+        }
+        mChunkTouched.clear();
+        mTouchedChunks.clear();
+        mGridSize = Point2D( 0, 0 );
+        mChunkGridSize = Point2D( 0, 0 );
+        mRowWords = 0;
+    }
+
+    //AddObserver---------------------------------------------------------------
+    UInt32 TileFogOfWar::AddObserver( UInt32 team, const Point2D& cell, UInt32 radius )
+    {
+        if ( team >= mTeams.size() )
+            return NO_OBSERVER;
+
+        UInt32 handle = mObservers.size();
+        if ( !mFreeObservers.empty() )
+        {
+            handle = mFreeObservers.back();
+            mFreeObservers.pop_back();
+        }
+        else
+            mObservers.resize( handle + 1 );
+
+        Observer& observer = mObservers[ handle ];
+        observer.cell       = cell;
+        observer.radius     = radius;
+        observer.team       = team;
+        observer.isActive   = true;
+        observer.isDirty    = true;
+        observer.isCast     = false;
+        return handle;
+    }
+
+    //MoveObserver--------------------------------------------------------------
+    void TileFogOfWar::MoveObserver( UInt32 observer, const Point2D& cell )
+    {
+        if ( observer >= mObservers.size() || !mObservers[ observer ].isActive )
+            return;
+        Observer& target = mObservers[ observer ];
+        if ( target.cell.x == cell.x && target.cell.y == cell.y )
+            return;
+        target.cell = cell;
+        target.isDirty = true;
+    }
+
+    //SetObserverRadius---------------------------------------------------------
+    void TileFogOfWar::SetObserverRadius( UInt32 observer, UInt32 radius )
+    {
+        if ( observer >= mObservers.size() || !mObservers[ observer ].isActive )
+            return;
+        Observer& target = mObservers[ observer ];
+        if ( target.radius == radius )
+            return;
+        target.radius = radius;
+        target.isDirty = true;
+    }
+
+    //RemoveObserver------------------------------------------------------------
+    void TileFogOfWar::RemoveObserver( UInt32 observer )
+    {
+        if ( observer >= mObservers.size() || !mObservers[ observer ].isActive )
+            return;
+        Observer& target = mObservers[ observer ];
+        _touchTeam( target );
+        target.isActive = false;
+        target.isCast = false;
+        std::vector< UInt32 >().swap( target.bits );
+        mFreeObservers.push_back( observer );
+    }
+
+    //Refresh-------------------------------------------------------------------
+    void TileFogOfWar::Refresh()
+    {
+        // The area an observer saw before, and the area it sees now, are both
+        // merged again
+        for ( ObserverArray::iterator observer = mObservers.begin(); observer != mObservers.end(); observer++ )
+        {
+            if ( !observer->isActive || !observer->isDirty )
+                continue;
+            _touchTeam( *observer );
+            _castObserver( *observer );
+            _touchTeam( *observer );
+            observer->isDirty = false;
+        }
+
+        for ( UInt32 team = 0; team < mTeams.size(); team++ )
+        {
+            if ( mTeams[ team ].isDirty )
+                _mergeTeam( mTeams[ team ], team );
+        }
+    }
+
+    //CanSee--------------------------------------------------------------------
+    bool TileFogOfWar::CanSee( UInt32 observer, Int x, Int y ) const
+    {
+        if ( observer >= mObservers.size() || !mObservers[ observer ].isCast )
+            return false;
+        const Observer& source = mObservers[ observer ];
+        Int row = y - source.top;
+        Int col = x - source.firstWord * Int( WORD_BITS );
+        if ( row < 0 || y > source.bottom || col < 0 || col >= Int( source.rowWords * WORD_BITS ) )
+            return false;
+        return ( source.bits[ row * source.rowWords + col / WORD_BITS ] >> ( col % WORD_BITS ) ) & 1;
+    }
+
+    //IsVisible-----------------------------------------------------------------
+    bool TileFogOfWar::IsVisible( UInt32 team, Int x, Int y ) const
+    {
+        if ( team >= mTeams.size() || x < 0 || y < 0 || x >= mGridSize.x || y >= mGridSize.y )
+            return false;
+        return ( mTeams[ team ].visible[ y * mRowWords + x / WORD_BITS ] >> ( x % WORD_BITS ) ) & 1;
+    }
+
+    //IsExplored----------------------------------------------------------------
+    bool TileFogOfWar::IsExplored( UInt32 team, Int x, Int y ) const
+    {
+        if ( team >= mTeams.size() || x < 0 || y < 0 || x >= mGridSize.x || y >= mGridSize.y )
+            return false;
+        return ( mTeams[ team ].explored[ y * mRowWords + x / WORD_BITS ] >> ( x % WORD_BITS ) ) & 1;
+    }
+
+    //GetExploredBits-----------------------------------------------------------
+    void TileFogOfWar::GetExploredBits( UInt32 team, const Point2D& origin, const Point2D& size, std::vector< UInt32 >& bits ) const
+    {
+        UInt32 outWords = ( size.x + WORD_BITS - 1 ) / WORD_BITS;
+        bits.assign( size.y * outWords, 0 );
+        if ( team >= mTeams.size() )
+            return;
+
+        const std::vector< UInt32 >& explored = mTeams[ team ].explored;
+        for ( Int y = 0; y < size.y; y++ )
+        {
+            Int row = origin.y + y;
+            if ( row < 0 || row >= mGridSize.y )
+                continue;
+            const UInt32* source = &explored[ row * mRowWords ];
+            for ( UInt32 word = 0; word < outWords; word++ )
+            {
+                // Gather the 32 cells from this column, which may straddle two
+                // words of the map
+                Int col = origin.x + word * WORD_BITS;
+                Int sourceWord = FloorDiv( col, WORD_BITS );
+                Int shift = col - sourceWord * WORD_BITS;
+                UInt32 value = 0;
+                if ( sourceWord >= 0 && sourceWord < Int( mRowWords ) )
+                    value = source[ sourceWord ] >> shift;
+                if ( shift && sourceWord + 1 >= 0 && sourceWord + 1 < Int( mRowWords ) )
+                    value |= ( source[ sourceWord + 1 ] << ( WORD_BITS - shift ) ) & ALL_BITS;
+
+                Int count = Math::IMin( size.x - word * WORD_BITS, WORD_BITS );
+                if ( count < Int( WORD_BITS ) )
+                    value &= ( UInt32( 1 ) << count ) - 1;
+                bits[ y * outWords + word ] = value;
+            }
+        }
+    }
+
+    //GetChunkSerial------------------------------------------------------------
+    UInt32 TileFogOfWar::GetChunkSerial( UInt32 team, UInt32 chunk ) const
+    {
+        if ( team >= mTeams.size() || chunk >= mTeams[ team ].chunkSerials.size() )
+            return 0;
+        return mTeams[ team ].chunkSerials[ chunk ];
+    }
+
+} // namespace PGE
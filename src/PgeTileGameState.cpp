@@ -14,6 +14,7 @@
 #include "PgeTypes.h"
 #include "PgeArchiveManager.h"
 #include "PgeXmlArchiveFile.h"
+#include "PgeTileMapFile.h"
 //#include "PgeStringUtil.h"
 
 #include "tinyxml.h"
@@ -101,6 +102,13 @@ namespace PGE
     //LoadTileStudioXML
     void TileGameState::LoadTileStudioXML( const String& fileName )
     {
+        // Use the compiled map if there is one, since it doesn't need to be
+        // parsed
+        String mapBase, ext;
+        StringUtil::SplitFileExtension( fileName, mapBase, ext );
+        if ( ArchiveManager::GetSingleton().Exists( mapBase + ".pgemap" ) && LoadTileMapFile( mapBase + ".pgemap" ) )
+            return;
+
         // Get a pointer to the archive file so we can start reading
         String baseDir, fileTitle;
         StringUtil::SplitFilename( fileName, baseDir, fileTitle );
@@ -113,9 +121,39 @@ namespace PGE
                 ReadProject( node, baseDir );
                 node = node->NextSibling( "project" );
             }
+            PrepareScene( fileName );
         }
     }
 
+    //LoadTileMapFile
+    bool TileGameState::LoadTileMapFile( const String& fileName )
+    {
+        TileMapFile file;
+        if ( !file.Load( fileName ) )
+            return false;
+
+        String baseDir, fileTitle;
+        StringUtil::SplitFilename( fileName, baseDir, fileTitle );
+        mTileMapScene.ReadTileMapFile( file, baseDir );
+        PrepareScene( fileName );
+        return true;
+    }
+
+    //PrepareScene
+    void TileGameState::PrepareScene( const String& fileName )
+    {
+        mTileMapScene.LogMapStats();
+
+        // Draw all layers from one texture atlas.  If one was built ahead
+        // of time with the atlas builder, use it, otherwise pack the
+        // tileset images now.
+        String atlasBase, ext;
+        StringUtil::SplitFileExtension( fileName, atlasBase, ext );
+        atlasBase += ".atlas";
+        if ( !ArchiveManager::GetSingleton().Exists( atlasBase + ".xml" ) || !mTileMapScene.LoadAtlas( atlasBase + ".xml" ) )
+            mTileMapScene.BuildAtlas( atlasBase );
+    }
+
     //ReadProject
     void TileGameState::ReadProject( TiXmlNode* projNode, const String& baseDir )
     {
@@ -0,0 +1,481 @@
+/*! $Id$
+ *  @file   PgeTileLightMap.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeTileLightMap.h"
+#include "PgeMath.h"
+
+namespace PGE
+{
+    const UInt32 TileLightMap::NO_LIGHT = 0xFFFFFFFF;
+
+    /** Remove a light from the lights of a cell */
+    static void EraseCellLight( std::multimap< UInt32, UInt32 >& cellLights, UInt32 cell, UInt32 light )
+    {
+        std::pair< std::multimap< UInt32, UInt32 >::iterator, std::multimap< UInt32, UInt32 >::iterator > range = cellLights.equal_range( cell );
+        for ( std::multimap< UInt32, UInt32 >::iterator iter = range.first; iter != range.second; iter++ )
+        {
+            if ( iter->second == light )
+            {
+                cellLights.erase( iter );
+                return;
+            }
+        }
+    }
+
+    //Constructor
+    TileLightMap::TileLightMap()
+        : mGridSize( 0, 0 ),
+          mChunkGridSize( 0, 0 ),
+          mFalloff( 16 ),
+          mAmbient( 0, 0, 0, 255 ),
+          mSerial( 1 )
+    {
+    }
+
+    //_markCell-----------------------------------------------------------------
+    void TileLightMap::_markCell( UInt32 cell )
+    {
+        UInt8& flags = mFlags[ cell ];
+        if ( flags & CELL_PENDING )
+            return;
+        flags |= CELL_PENDING;
+        if ( flags & CELL_SOLID )
+            flags |= CELL_WAS_SOLID;
+        mPending.push_back( cell );
+    }
+
+    //_markLight----------------------------------------------------------------
+    void TileLightMap::_markLight( const LightSource& light )
+    {
+        if ( light.cell.x >= 0 && light.cell.y >= 0 && light.cell.x < mGridSize.x && light.cell.y < mGridSize.y )
+            _markCell( light.cell.y * mGridSize.x + light.cell.x );
+    }
+
+    //_setCell------------------------------------------------------------------
+    void TileLightMap::_setCell( Int x, Int y, SInt32 boundsCode )
+    {
+        UInt32 cell = y * mGridSize.x + x;
+        bool isSolid = ( boundsCode & 15 ) == 15;
+        if ( isSolid == ( ( mFlags[ cell ] & CELL_SOLID ) != 0 ) )
+            return;
+        _markCell( cell );
+        if ( isSolid )
+            mFlags[ cell ] |= CELL_SOLID;
+        else
+            mFlags[ cell ] &= ~CELL_SOLID;
+    }
+
+    //_setLevel-----------------------------------------------------------------
+    void TileLightMap::_setLevel( std::vector< UInt8 >& levels, UInt32 cell, UInt8 level )
+    {
+        levels[ cell ] = level;
+
+        // The cell is averaged into the corners it shares with its neighbours,
+        // which may lie in the neighbouring chunks
+        Int x = cell % mGridSize.x;
+        Int y = cell / mGridSize.x;
+        Int startX = Math::IMax( x - 1, 0 ) / TileSet::CHUNK_SIZE;
+        Int startY = Math::IMax( y - 1, 0 ) / TileSet::CHUNK_SIZE;
+        Int endX   = Math::IMin( x + 1, mGridSize.x - 1 ) / TileSet::CHUNK_SIZE;
+        Int endY   = Math::IMin( y + 1, mGridSize.y - 1 ) / TileSet::CHUNK_SIZE;
+        for ( Int chunkY = startY; chunkY <= endY; chunkY++ )
+        {
+            for ( Int chunkX = startX; chunkX <= endX; chunkX++ )
+            {
+                UInt32 chunk = chunkY * mChunkGridSize.x + chunkX;
+                if ( !mChunkTouched[ chunk ] )
+                {
+                    mChunkTouched[ chunk ] = 1;
+                    mTouchedChunks.push_back( chunk );
+                }
+            }
+        }
+    }
+
+    //_propagateChannel---------------------------------------------------------
+    void TileLightMap::_propagateChannel( UInt32 channel )
+    {
+        std::vector< UInt8 >& levels = mLevels[ channel ];
+        std::vector< UInt8 >& emitted = mEmitted[ channel ];
+        mDarkenQueue.clear();
+        mSpreadQueue.clear();
+
+        // A cell which now gives off less light, or has become solid, has its
+        // light removed; the light it spread is removed below.  Any other
+        // change can only add light.
+        for ( UInt32 i = 0; i < mPending.size(); i++ )
+        {
+            UInt32 cell = mPending[ i ];
+            UInt8 level = mPendingLevels[ i * 3 + channel ];
+            UInt8 flags = mFlags[ cell ];
+            bool isDarker = level < emitted[ cell ] || ( ( flags & CELL_SOLID ) && !( flags & CELL_WAS_SOLID ) );
+            emitted[ cell ] = level;
+            if ( isDarker && levels[ cell ] )
+            {
+                DarkenEntry entry = { cell, levels[ cell ] };
+                mDarkenQueue.push_back( entry );
+                _setLevel( levels, cell, 0 );
+            }
+            mSpreadQueue.push_back( cell );
+        }
+
+        // Remove the light outwards.  A neighbour dimmer than the cell was
+        // lit by it, and is darkened in turn; a neighbour as bright or
+        // brighter was lit from elsewhere, and spreads its light back into
+        // the darkened cells.  Solid cells never spread light, so their
+        // neighbours only need to spread back into them.
+        for ( UInt32 head = 0; head < mDarkenQueue.size(); head++ )
+        {
+            DarkenEntry entry = mDarkenQueue[ head ];
+            bool isSpreading = !( mFlags[ entry.cell ] & CELL_SOLID ) || ( mFlags[ entry.cell ] & CELL_PENDING );
+            Int x = entry.cell % mGridSize.x;
+            Int y = entry.cell / mGridSize.x;
+            UInt32 next[ 4 ];
+            UInt32 nextCount = 0;
+            if ( x > 0 )
+                next[ nextCount++ ] = entry.cell - 1;
+            if ( x < mGridSize.x - 1 )
+                next[ nextCount++ ] = entry.cell + 1;
+            if ( y > 0 )
+                next[ nextCount++ ] = entry.cell - mGridSize.x;
+            if ( y < mGridSize.y - 1 )
+                next[ nextCount++ ] = entry.cell + mGridSize.x;
+            for ( UInt32 i = 0; i < nextCount; i++ )
+            {
+                UInt32 cell = next[ i ];
+                UInt8 level = levels[ cell ];
+                if ( !level )
+                    continue;
+                if ( isSpreading && level < entry.level )
+                {
+                    DarkenEntry darken = { cell, level };
+                    mDarkenQueue.push_back( darken );
+                    _setLevel( levels, cell, 0 );
+                    if ( emitted[ cell ] )
+                        mSpreadQueue.push_back( cell );
+                }
+                else
+                    mSpreadQueue.push_back( cell );
+            }
+        }
+
+        // Light the cells holding lights, then spread the light outwards
+        for ( UInt32 i = 0; i < mSpreadQueue.size(); i++ )
+        {
+            UInt32 cell = mSpreadQueue[ i ];
+            if ( emitted[ cell ] > levels[ cell ] )
+                _setLevel( levels, cell, emitted[ cell ] );
+        }
+        for ( UInt32 head = 0; head < mSpreadQueue.size(); head++ )
+        {
+            UInt32 cell = mSpreadQueue[ head ];
+            UInt8 level = levels[ cell ];
+            if ( ( mFlags[ cell ] & CELL_SOLID ) || level <= mFalloff )
+                continue;
+            level -= mFalloff;
+
+            Int x = cell % mGridSize.x;
+            Int y = cell / mGridSize.x;
+            UInt32 next[ 4 ];
+            UInt32 nextCount = 0;
+            if ( x > 0 )
+                next[ nextCount++ ] = cell - 1;
+            if ( x < mGridSize.x - 1 )
+                next[ nextCount++ ] = cell + 1;
+            if ( y > 0 )
+                next[ nextCount++ ] = cell - mGridSize.x;
+            if ( y < mGridSize.y - 1 )
+                next[ nextCount++ ] = cell + mGridSize.x;
+            for ( UInt32 i = 0; i < nextCount; i++ )
+            {
+                if ( levels[ next[ i ] ] < level )
+                {
+                    _setLevel( levels, next[ i ], level );
+                    mSpreadQueue.push_back( next[ i ] );
+                }
+            }
+        }
+    }
+
+    //_relightAll---------------------------------------------------------------
+    void TileLightMap::_relightAll()
+    {
+        for ( UInt32 channel = 0; channel < 3; channel++ )
+        {
+            mLevels[ channel ].assign( mGridSize.x * mGridSize.y, 0 );
+            mEmitted[ channel ].assign( mGridSize.x * mGridSize.y, 0 );
+        }
+        for ( UInt32 i = 0; i < mPending.size(); i++ )
+            mFlags[ mPending[ i ] ] &= ~( CELL_PENDING | CELL_WAS_SOLID );
+        mPending.clear();
+
+        mCellLights.clear();
+        for ( UInt32 light = 0; light < mLights.size(); light++ )
+        {
+            const LightSource& source = mLights[ light ];
+            if ( !source.isActive )
+                continue;
+            if ( source.cell.x >= 0 && source.cell.y >= 0 && source.cell.x < mGridSize.x && source.cell.y < mGridSize.y )
+                mCellLights.insert( std::make_pair( UInt32( source.cell.y * mGridSize.x + source.cell.x ), light ) );
+            _markLight( source );
+        }
+
+        ++mSerial;
+        mChunkSerials.assign( mChunkGridSize.x * mChunkGridSize.y, mSerial );
+        Propagate();
+    }
+
+    //Build---------------------------------------------------------------------
+    void TileLightMap::Build( const TileSet& tileSet )
+    {
+        mGridSize = tileSet.GetMapGridSize();
+        if ( mGridSize.x <= 0 || mGridSize.y <= 0 )
+            mGridSize = Point2D( 0, 0 );
+        mChunkGridSize = Point2D( ( mGridSize.x + TileSet::CHUNK_SIZE - 1 ) / TileSet::CHUNK_SIZE,
+                                  ( mGridSize.y + TileSet::CHUNK_SIZE - 1 ) / TileSet::CHUNK_SIZE );
+
+        mFlags.assign( mGridSize.x * mGridSize.y, 0 );
+        for ( Int row = 0; row < mGridSize.y; row++ )
+        {
+            for ( Int col = 0; col < mGridSize.x; col++ )
+            {
+                if ( ( tileSet.GetCell( col, row ).boundsCode & 15 ) == 15 )
+                    mFlags[ row * mGridSize.x + col ] = CELL_SOLID;
+            }
+        }
+        mPending.clear();
+        mChunkTouched.assign( mChunkGridSize.x * mChunkGridSize.y, 0 );
+        mTouchedChunks.clear();
+        _relightAll();
+    }
+
+    //Update--------------------------------------------------------------------
+    void TileLightMap::Update( const TileSet& tileSet, Int x, Int y, Int w, Int h )
+    {
+        Int startX = Math::IMax( x, 0 );
+        Int startY = Math::IMax( y, 0 );
+        Int endX   = Math::IMin( x + w, mGridSize.x );
+        Int endY   = Math::IMin( y + h, mGridSize.y );
+        for ( Int row = startY; row < endY; row++ )
+        {
+            for ( Int col = startX; col < endX; col++ )
+                _setCell( col, row, tileSet.GetCell( col, row ).boundsCode );
+        }
+    }
+
+    //ApplyEdits----------------------------------------------------------------
+    void TileLightMap::ApplyEdits( const TileSet::CellEdit* edits, UInt32 count )
+    {
+        for ( const TileSet::CellEdit* edit = edits; edit != edits + count; edit++ )
+        {
+            if ( edit->x >= 0 && edit->y >= 0 && edit->x < mGridSize.x && edit->y < mGridSize.y )
+                _setCell( edit->x, edit->y, edit->cell.boundsCode );
+        }
+    }
+
+    //Clear---------------------------------------------------------------------
+    void TileLightMap::Clear()
+    {
+        for ( UInt32 channel = 0; channel < 3; channel++ )
+        {
+            std::vector< UInt8 >().swap( mLevels[ channel ] );
+            std::vector< UInt8 >().swap( mEmitted[ channel ] );
+        }
+        std::vector< UInt8 >().swap( mFlags );
+        mLights.clear();
+        mFreeLights.clear();
+        mCellLights.clear();
+        mPending.clear();
+        mChunkSerials.clear();
+        mChunkTouched.clear();
+        mTouchedChunks.clear();
+        std::vector< DarkenEntry >().swap( mDarkenQueue );
+        std::vector< UInt32 >().swap( mSpreadQueue );
+        mPendingLevels.clear();
+        mGridSize = Point2D( 0, 0 );
+        mChunkGridSize = Point2D( 0, 0 );
+    }
+
+    //SetFalloff----------------------------------------------------------------
+    void TileLightMap::SetFalloff( UInt8 falloff )
+    {
+        falloff = Math::IMax( falloff, 1 );
+        if ( falloff == mFalloff )
+            return;
+        mFalloff = falloff;
+        _relightAll();
+    }
+
+    //SetAmbient----------------------------------------------------------------
+    void TileLightMap::SetAmbient( const Color& ambient )
+    {
+        mAmbient = Color( ambient.r, ambient.g, ambient.b, 255 );
+        ++mSerial;
+        mChunkSerials.assign( mChunkSerials.size(), mSerial );
+    }
+
+    //AddLight------------------------------------------------------------------
+    UInt32 TileLightMap::AddLight( const Point2D& cell, const Color& color )
+    {
+        UInt32 light = mLights.size();
+        if ( !mFreeLights.empty() )
+        {
+            light = mFreeLights.back();
+            mFreeLights.pop_back();
+        }
+        else
+            mLights.resize( light + 1 );
+
+        LightSource& source = mLights[ light ];
+        source.cell     = cell;
+        source.color    = color;
+        source.isActive = true;
+        if ( cell.x >= 0 && cell.y >= 0 && cell.x < mGridSize.x && cell.y < mGridSize.y )
+        {
+            mCellLights.insert( std::make_pair( UInt32( cell.y * mGridSize.x + cell.x ), light ) );
+            _markLight( source );
+        }
+        return light;
+    }
+
+    //MoveLight-----------------------------------------------------------------
+    void TileLightMap::MoveLight( UInt32 light, const Point2D& cell )
+    {
+        if ( light >= mLights.size() || !mLights[ light ].isActive )
+            return;
+        LightSource& source = mLights[ light ];
+        if ( source.cell.x == cell.x && source.cell.y == cell.y )
+            return;
+
+        if ( source.cell.x >= 0 && source.cell.y >= 0 && source.cell.x < mGridSize.x && source.cell.y < mGridSize.y )
+        {
+            EraseCellLight( mCellLights, source.cell.y * mGridSize.x + source.cell.x, light );
+            _markLight( source );
+        }
+        source.cell = cell;
+        if ( cell.x >= 0 && cell.y >= 0 && cell.x < mGridSize.x && cell.y < mGridSize.y )
+        {
+            mCellLights.insert( std::make_pair( UInt32( cell.y * mGridSize.x + cell.x ), light ) );
+            _markLight( source );
+        }
+    }
+
+    //SetLightColor-------------------------------------------------------------
+    void TileLightMap::SetLightColor( UInt32 light, const Color& color )
+    {
+        if ( light >= mLights.size() || !mLights[ light ].isActive )
+            return;
+        LightSource& source = mLights[ light ];
+        source.color = color;
+        _markLight( source );
+    }
+
+    //RemoveLight---------------------------------------------------------------
+    void TileLightMap::RemoveLight( UInt32 light )
+    {
+        if ( light >= mLights.size() || !mLights[ light ].isActive )
+            return;
+        LightSource& source = mLights[ light ];
+        if ( source.cell.x >= 0 && source.cell.y >= 0 && source.cell.x < mGridSize.x && source.cell.y < mGridSize.y )
+        {
+            EraseCellLight( mCellLights, source.cell.y * mGridSize.x + source.cell.x, light );
+            _markLight( source );
+        }
+        source.isActive = false;
+        mFreeLights.push_back( light );
+    }
+
+    //Propagate-----------------------------------------------------------------
+    void TileLightMap::Propagate()
+    {
+        if ( mPending.empty() )
+            return;
+
+        // Find what each changed cell now gives off; where several lights
+        // share a cell, each channel takes the brightest
+        mPendingLevels.assign( mPending.size() * 3, 0 );
+        for ( UInt32 i = 0; i < mPending.size(); i++ )
+        {
+            UInt8* level = &mPendingLevels[ i * 3 ];
+            std::pair< CellLightMap::const_iterator, CellLightMap::const_iterator > range = mCellLights.equal_range( mPending[ i ] );
+            for ( CellLightMap::const_iterator iter = range.first; iter != range.second; iter++ )
+            {
+                const Color& color = mLights[ iter->second ].color;
+                level[ 0 ] = Math::IMax( level[ 0 ], color.r );
+                level[ 1 ] = Math::IMax( level[ 1 ], color.g );
+                level[ 2 ] = Math::IMax( level[ 2 ], color.b );
+            }
+        }
+
+        for ( UInt32 channel = 0; channel < 3; channel++ )
+            _propagateChannel( channel );
+
+        for ( UInt32 i = 0; i < mPending.size(); i++ )
+            mFlags[ mPending[ i ] ] &= ~( CELL_PENDING | CELL_WAS_SOLID );
+        mPending.clear();
+
+        if ( !mTouchedChunks.empty() )
+        {
+            ++mSerial;
+            for ( UInt32 i = 0; i < mTouchedChunks.size(); i++ )
+            {
+                mChunkSerials[ mTouchedChunks[ i ] ] = mSerial;
+                mChunkTouched[ mTouchedChunks[ i ] ] = 0;
+            }
+            mTouchedChunks.clear();
+        }
+    }
+
+    //GetLight------------------------------------------------------------------
+    Color TileLightMap::GetLight( Int x, Int y ) const
+    {
+        Color light( mAmbient );
+        if ( x < 0 || y < 0 || x >= mGridSize.x || y >= mGridSize.y )
+            return light;
+        UInt32 cell = y * mGridSize.x + x;
+        light.r = Math::IMax( light.r, mLevels[ 0 ][ cell ] );
+        light.g = Math::IMax( light.g, mLevels[ 1 ][ cell ] );
+        light.b = Math::IMax( light.b, mLevels[ 2 ][ cell ] );
+        return light;
+    }
+
+    //GetCornerLights-----------------------------------------------------------
+    void TileLightMap::GetCornerLights( const Point2D& origin, const Point2D& size, std::vector< Color >& corners ) const
+    {
+        corners.resize( ( size.x + 1 ) * ( size.y + 1 ) );
+        std::vector< Color >::iterator corner = corners.begin();
+        for ( Int cornerY = origin.y; cornerY <= origin.y + size.y; cornerY++ )
+        {
+            for ( Int cornerX = origin.x; cornerX <= origin.x + size.x; cornerX++, corner++ )
+            {
+                // Average the cells inside the map around the corner
+                UInt32 sum[ 3 ] = { 0, 0, 0 };
+                UInt32 count = 0;
+                for ( Int y = Math::IMax( cornerY - 1, 0 ); y <= Math::IMin( cornerY, mGridSize.y - 1 ); y++ )
+                {
+                    for ( Int x = Math::IMax( cornerX - 1, 0 ); x <= Math::IMin( cornerX, mGridSize.x - 1 ); x++ )
+                    {
+                        UInt32 cell = y * mGridSize.x + x;
+                        sum[ 0 ] += mLevels[ 0 ][ cell ];
+                        sum[ 1 ] += mLevels[ 1 ][ cell ];
+                        sum[ 2 ] += mLevels[ 2 ][ cell ];
+                        ++count;
+                    }
+                }
+
+                *corner = mAmbient;
+                if ( count )
+                {
+                    corner->r = Math::IMax( corner->r, sum[ 0 ] / count );
+                    corner->g = Math::IMax( corner->g, sum[ 1 ] / count );
+                    corner->b = Math::IMax( corner->b, sum[ 2 ] / count );
+                }
+            }
+        }
+    }
+
+} // namespace PGE
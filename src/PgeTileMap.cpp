@@ -26,6 +26,11 @@
 #include "cmd/StringUtil.h"
 using cmd::StringUtil;
 
+#include <sstream>
+
+#include "cmd/LogFileManager.h"
+using cmd::LogFileManager;
+
 namespace PGE
 {
     ////////////////////////////////////////////////////////////////////////////
@@ -71,6 +76,19 @@ namespace PGE
     }
 
 
+    ////////////////////////////////////////////////////////////////////////////
+    // TileMap::Tile
+    ////////////////////////////////////////////////////////////////////////////
+
+    //Set
+    bool TileMap::Tile::Set( SInt32 tile, SInt32 bounds, SInt32 map )
+    {
+        tileIndex   = SInt16( Math::IClamp( tile, -32768, 32767 ) );
+        boundsCode  = UInt8( Math::IClamp( bounds, 0, 255 ) );
+        mapCode     = UInt8( Math::IClamp( map, 0, 255 ) );
+        return ( tileIndex == tile && boundsCode == bounds && mapCode == map );
+    }
+
     ////////////////////////////////////////////////////////////////////////////
     // TileMap
     ////////////////////////////////////////////////////////////////////////////
@@ -160,6 +178,7 @@ namespace PGE
 
         // Generate the remaining tiles
         UInt32 count = 0;
+        bool isPacked = true;
         for ( Int y = 0; y < mTileCount.y; y++ )
         {
             leftColor = mColorGrid[ 0 ].Lerp( mColorGrid[ 1 ], y / Real( mTileCount.y ) );
@@ -172,7 +191,8 @@ namespace PGE
                 {
                     // Add the tile:
                     Tile newTile;
-                    newTile.tileIndex = y * mTileCount.x + x;
+                    if ( !newTile.Set( y * mTileCount.x + x, 0, 0 ) )
+                        isPacked = false;
                     mTileMap.at( y * mTileCount.x + x ) = newTile;
 
                     Colorf color = leftColor.Lerp( rightColor, x / Real( mTileCount.x ) );
@@ -211,6 +231,12 @@ namespace PGE
                 ++count;
             }
         }
+        if ( !isPacked )
+        {
+            std::stringstream msg;
+            msg << "Map " << mIdentifier << ": more tiles than can be stored, so the tile indices were clamped";
+            LogFileManager::getInstance().LogMessage( msg.str(), cmd::LogFile::Warning );
+        }
     }
 
     //SetTileSize
@@ -243,6 +269,7 @@ namespace PGE
         {
             cellNode = cellNode->FirstChild( "cell" );
             int curCell = 0;
+            bool isPacked = true;
             while ( cellNode )
             {
                 int tileNum = StringUtil::ToInt( XmlArchiveFile::GetItemValue( cellNode->FirstChild( "tileNumber" ) ) );
@@ -253,13 +280,18 @@ namespace PGE
 
                 // Add the tile:
                 Tile newTile;
-                newTile.tileIndex = tileNum;
-                newTile.boundsCode = boundsCode;
-                newTile.mapCode = mapCode;
+                if ( !newTile.Set( tileNum, boundsCode, mapCode ) )
+                    isPacked = false;
                 mTileMap.at( curCell++ ) = newTile;
 
                 cellNode = cellNode->NextSibling( "cell" );
             }
+            if ( !isPacked )
+            {
+                std::stringstream msg;
+                msg << "Map " << mIdentifier << ": some cells have a tile or code too large to store, and were clamped";
+                LogFileManager::getInstance().LogMessage( msg.str(), cmd::LogFile::Warning );
+            }
         }
     }
 
@@ -0,0 +1,486 @@
+/*! $Id$
+ *  @file   PgeTileMapFile.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeTileMapFile.h"
+#include "PgeArchiveFile.h"
+#include "PgeArchiveManager.h"
+#include "PgeXmlArchiveFile.h"
+#include "PgeStringUtil.h"
+#include "PgeMath.h"
+
+#include <fstream>
+#include <string.h>
+
+namespace PGE
+{
+    const UInt32 TileMapFile::MAGIC     = 0x4D454750;   // "PGEM"
+    const UInt32 TileMapFile::VERSION   = 3;
+
+    /** Builds the contents of a compiled map file in memory.  Blocks are
+        padded to 4 bytes, and written by offset, since the buffer moves as it
+        grows.
+    */
+    struct TileMapFileWriter
+    {
+        std::vector< UInt8 > data;
+
+        UInt32 Reserve( UInt32 size )
+        {
+            UInt32 offset = data.size();
+            data.resize( offset + ( ( size + 3 ) & ~3 ), 0 );
+            return offset;
+        }
+
+        void Write( UInt32 offset, const void* src, UInt32 size )
+        {
+            if ( size )
+                memcpy( &data[ offset ], src, size );
+        }
+
+        UInt32 Append( const void* src, UInt32 size )
+        {
+            UInt32 offset = Reserve( size );
+            Write( offset, src, size );
+            return offset;
+        }
+
+        template < class T >
+        UInt32 AppendArray( const std::vector< T >& items )
+        {
+            return Append( items.empty() ? 0 : &items[ 0 ], items.size() * sizeof( T ) );
+        }
+
+        UInt32 AppendString( const String& str )
+        {
+            UInt32 length = str.size();
+            UInt32 offset = Reserve( sizeof( length ) + length + 1 );
+            Write( offset, &length, sizeof( length ) );
+            Write( offset + sizeof( length ), str.c_str(), length + 1 );
+            return offset;
+        }
+    };
+
+    /** The runs and cells of a map or page, stored a row at a time (see
+        TileSet::EncodeRow)
+    */
+    struct EncodedCells
+    {
+        TileSet::TileCellArray  cells;
+        TileSet::TileSpanArray  spans;
+        std::vector< UInt32 >   rowSpans;
+        TileMapStats            stats;
+    };
+
+    /** Read the next row of cells from a cell list of the xml.  Cells missing
+        from the end of the list are empty.
+    */
+    static void ReadCellRow( TiXmlNode*& cellNode, TileSet::TileMap& row )
+    {
+        for ( UInt32 x = 0; x < row.size(); x++ )
+        {
+            TileSet::TileMapItem& tile = row[ x ];
+            tile = TileSet::TileMapItem();
+            if ( !cellNode )
+                continue;
+            tile.tileIndex  = StringUtil::ToInt( XmlArchiveFile::GetItemValue( cellNode->FirstChild( "tileNumber" ) ) );
+            tile.boundsCode = StringUtil::ToInt( XmlArchiveFile::GetItemValue( cellNode->FirstChild( "bounds" ) ) );
+            tile.mapCode    = StringUtil::ToInt( XmlArchiveFile::GetItemValue( cellNode->FirstChild( "mapCode" ) ) );
+            cellNode = cellNode->NextSibling( "cell" );
+        }
+    }
+
+    //Constructor
+    TileMapFile::TileMapFile()
+        : mHeader( 0 )
+    {
+    }
+
+    //Destructor
+    TileMapFile::~TileMapFile()
+    {
+        Close();
+    }
+
+    //Load----------------------------------------------------------------------
+    bool TileMapFile::Load( const String& fileName )
+    {
+        Close();
+        if ( !ArchiveManager::GetSingleton().Exists( fileName ) )
+            return false;
+
+        // Check the header before opening the file, so that when it can't be
+        // mapped, only the index needs to be read.
+        Header header;
+        ArchiveFile* file = ArchiveManager::GetSingleton().CreateArchiveFile( fileName );
+        UInt32 length = file->Length();
+        bool isValid = ( file->Read( &header, sizeof( header ) ) == sizeof( header ) );
+        delete file;
+        if ( !isValid || header.magic != MAGIC || header.version != VERSION || header.fileSize != length ||
+             header.indexSize < sizeof( Header ) || header.indexSize > header.fileSize ||
+             header.cellSize != sizeof( SInt16 ) + sizeof( UInt16 ) || header.spanSize != sizeof( TileSet::TileSpan ) )
+            return false;
+
+        mFile.Bind( new MappedFile() );
+        if ( !mFile->Open( fileName, header.indexSize ) || mFile->GetSize() < header.indexSize )
+        {
+            Close();
+            return false;
+        }
+        mHeader = reinterpret_cast< const Header* >( mFile->GetData() );
+        mFileName = fileName;
+
+        if ( !_getArray< TileSetRecord >( mHeader->tileSetOffset, mHeader->tileSetCount ) )
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    //Close---------------------------------------------------------------------
+    void TileMapFile::Close()
+    {
+        mHeader = 0;
+        mFile.SetNull();
+        mFileName = StringUtil::BLANK;
+    }
+
+    //GetTileSetCount-----------------------------------------------------------
+    UInt32 TileMapFile::GetTileSetCount() const
+    {
+        return mHeader ? mHeader->tileSetCount : 0;
+    }
+
+    //GetTileSet----------------------------------------------------------------
+    const TileMapFile::TileSetRecord* TileMapFile::GetTileSet( UInt32 tileSetNum ) const
+    {
+        if ( tileSetNum >= GetTileSetCount() )
+            return 0;
+        return _getArray< TileSetRecord >( mHeader->tileSetOffset, mHeader->tileSetCount ) + tileSetNum;
+    }
+
+    //GetSequences--------------------------------------------------------------
+    const TileMapFile::SequenceRecord* TileMapFile::GetSequences( const TileSetRecord& tileSet ) const
+    {
+        return _getArray< SequenceRecord >( tileSet.sequenceOffset, tileSet.sequenceListCount );
+    }
+
+    //GetFrames-----------------------------------------------------------------
+    const TileMapFile::FrameRecord* TileMapFile::GetFrames( const SequenceRecord& seq ) const
+    {
+        return _getArray< FrameRecord >( seq.frameOffset, seq.frameCount );
+    }
+
+    //GetMap--------------------------------------------------------------------
+    const TileMapFile::MapRecord* TileMapFile::GetMap( const TileSetRecord& tileSet, UInt32 mapIndex ) const
+    {
+        const MapRecord* maps = _getArray< MapRecord >( tileSet.mapOffset, tileSet.mapCount );
+        if ( !maps || mapIndex >= tileSet.mapCount )
+            return 0;
+        const MapRecord& map = maps[ mapIndex ];
+
+        // The pages are checked as they are loaded; here, just make sure they
+        // are where they should be.  A chunk of the tileset reads its cells
+        // from a single page, so pages must hold whole chunks.
+        if ( map.pageSize > 0 )
+        {
+            if ( map.pageSize % TileSet::CHUNK_SIZE )
+                return 0;
+            const PageRecord* pages = GetPages( map );
+            if ( !pages )
+                return 0;
+            Point2D pageGrid = GetPageGridSize( map );
+            for ( Int i = 0; i < pageGrid.x * pageGrid.y; i++ )
+            {
+                UInt32 rows = Math::IMin( map.pageSize, map.height - ( i / pageGrid.x ) * map.pageSize );
+                UInt32 size = GetPageLayout( rows, pages[ i ] ).size;
+                if ( pages[ i ].dataSize != size || pages[ i ].dataOffset % 4 || pages[ i ].dataOffset < mHeader->indexSize ||
+                     pages[ i ].dataOffset > mHeader->fileSize || size > mHeader->fileSize - pages[ i ].dataOffset )
+                    return 0;
+            }
+            return &map;
+        }
+
+        // The tileset uses the runs without any checks, so make sure they stay
+        // inside the map and the cell array.  There are few runs compared to
+        // the number of cells, so this is cheap.
+        const UInt32* rowSpans = GetRowSpans( map );
+        const TileSet::TileSpan* spans = GetSpans( map );
+        if ( !rowSpans || !spans || ( map.cellCount > 0 && !GetCells( map ).tiles ) ||
+             !ValidateRuns( rowSpans, Point2D( map.width, map.height ), spans, map.spanCount, map.cellCount ) )
+            return 0;
+        return &map;
+    }
+
+    //GetPageGridSize-----------------------------------------------------------
+    Point2D TileMapFile::GetPageGridSize( const MapRecord& map )
+    {
+        if ( map.pageSize == 0 )
+            return Point2D( 0, 0 );
+        return Point2D( ( map.width + map.pageSize - 1 ) / map.pageSize,
+                        ( map.height + map.pageSize - 1 ) / map.pageSize );
+    }
+
+    //GetPages------------------------------------------------------------------
+    const TileMapFile::PageRecord* TileMapFile::GetPages( const MapRecord& map ) const
+    {
+        Point2D pageGrid = GetPageGridSize( map );
+        return _getArray< PageRecord >( map.pageOffset, pageGrid.x * pageGrid.y );
+    }
+
+    //GetPageLayout-------------------------------------------------------------
+    TileMapFile::PageLayout TileMapFile::GetPageLayout( UInt32 rows, const PageRecord& page )
+    {
+        // Each block is padded to 4 bytes, as the file writer does
+        PageLayout layout;
+        layout.spanOffset   = ( rows + 1 ) * sizeof( UInt32 );
+        layout.tileOffset   = layout.spanOffset + page.spanCount * sizeof( TileSet::TileSpan );
+        layout.codeOffset   = layout.tileOffset + ( ( page.cellCount * sizeof( SInt16 ) + 3 ) & ~3 );
+        layout.size         = layout.codeOffset + ( ( page.cellCount * sizeof( UInt16 ) + 3 ) & ~3 );
+        return layout;
+    }
+
+    //ValidateRuns--------------------------------------------------------------
+    bool TileMapFile::ValidateRuns( const UInt32* rowSpans, const Point2D& size, const TileSet::TileSpan* spans, UInt32 spanCount, UInt32 cellCount )
+    {
+        if ( rowSpans[ 0 ] != 0 || rowSpans[ size.y ] != spanCount )
+            return false;
+        for ( Int row = 0; row < size.y; row++ )
+        {
+            if ( rowSpans[ row ] > rowSpans[ row + 1 ] )
+                return false;
+        }
+        for ( UInt32 i = 0; i < spanCount; i++ )
+        {
+            const TileSet::TileSpan& span = spans[ i ];
+            if ( span.start + span.count > UInt32( size.x ) || span.firstCell + span.count > cellCount )
+                return false;
+        }
+        return true;
+    }
+
+    //GetRowSpans---------------------------------------------------------------
+    const UInt32* TileMapFile::GetRowSpans( const MapRecord& map ) const
+    {
+        return _getArray< UInt32 >( map.rowSpanOffset, map.height + 1 );
+    }
+
+    //GetSpans------------------------------------------------------------------
+    const TileSet::TileSpan* TileMapFile::GetSpans( const MapRecord& map ) const
+    {
+        return _getArray< TileSet::TileSpan >( map.spanOffset, map.spanCount );
+    }
+
+    //GetCells------------------------------------------------------------------
+    TileSet::TileCellList TileMapFile::GetCells( const MapRecord& map ) const
+    {
+        const SInt16* tiles = _getArray< SInt16 >( map.tileOffset, map.cellCount );
+        const UInt16* codes = _getArray< UInt16 >( map.codeOffset, map.cellCount );
+        if ( !tiles || !codes )
+            return TileSet::TileCellList();
+        return TileSet::TileCellList( tiles, codes );
+    }
+
+    //GetString-----------------------------------------------------------------
+    String TileMapFile::GetString( UInt32 offset ) const
+    {
+        const UInt32* length = _getArray< UInt32 >( offset, 1 );
+        if ( !length || *length > mHeader->indexSize - offset - sizeof( UInt32 ) )
+            return StringUtil::BLANK;
+        return String( reinterpret_cast< const char* >( length + 1 ), *length );
+    }
+
+    //ConvertTileStudioXML------------------------------------------------------
+    bool TileMapFile::ConvertTileStudioXML( const String& xmlFileName, const String& outFileName, UInt32 pageSize )
+    {
+        pageSize = ( ( pageSize + TileSet::CHUNK_SIZE - 1 ) / TileSet::CHUNK_SIZE ) * TileSet::CHUNK_SIZE;
+
+        XmlArchiveFile doc( ArchiveManager::GetSingleton().CreateArchiveFile( xmlFileName ) );
+        if ( !doc.LoadFile() )
+            return false;
+
+        // The tilesets of all projects are written as one list, in the order
+        // TileGameState would read them.
+        std::vector< TiXmlNode* > tilesetNodes;
+        TiXmlNode* projNode = doc.FirstChild( "project" );
+        for ( projNode; projNode; projNode = projNode->NextSibling( "project" ) )
+        {
+            TiXmlNode* listNode = projNode->FirstChild( "tileSetList" );
+            TiXmlNode* tilesetNode = listNode ? listNode->FirstChild( "tileset" ) : 0;
+            for ( tilesetNode; tilesetNode; tilesetNode = tilesetNode->NextSibling( "tileset" ) )
+                tilesetNodes.push_back( tilesetNode );
+        }
+
+        // Page data is collected separately, and goes after everything else
+        TileMapFileWriter writer, pageWriter;
+        std::vector< UInt32 > pageRecordOffsets;
+        UInt32 headerOffset  = writer.Reserve( sizeof( Header ) );
+        UInt32 tileSetOffset = writer.Reserve( tilesetNodes.size() * sizeof( TileSetRecord ) );
+        for ( UInt32 i = 0; i < tilesetNodes.size(); i++ )
+        {
+            TiXmlNode* tilesetNode = tilesetNodes[ i ];
+            TileSetRecord tileSet;
+            tileSet.index           = StringUtil::ToInt( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "index" ) ) );
+            tileSet.identifierOffset = writer.AppendString( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "identifier" ) ) );
+            tileSet.imageNameOffset = writer.AppendString( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "tileBitmap" ) ) );
+            tileSet.tileWidth       = StringUtil::ToInt( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "tileWidth" ) ) );
+            tileSet.tileHeight      = StringUtil::ToInt( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "tileHeight" ) ) );
+            tileSet.gridWidth       = StringUtil::ToInt( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "horizontalTileCount" ) ) );
+            tileSet.gridHeight      = StringUtil::ToInt( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "verticalTileCount" ) ) );
+            tileSet.overlap         = StringUtil::ToInt( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "overlap" ) ) );
+            tileSet.tileCount       = StringUtil::ToInt( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "tileCount" ) ) );
+            tileSet.sequenceCount   = StringUtil::ToInt( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "sequenceCount" ) ) );
+
+            // Sequences
+            std::vector< SequenceRecord > sequences;
+            TiXmlNode* listNode = tilesetNode->FirstChild( "sequenceList" );
+            TiXmlNode* seqNode = listNode ? listNode->FirstChild( "sequence" ) : 0;
+            for ( seqNode; seqNode; seqNode = seqNode->NextSibling( "sequence" ) )
+            {
+                std::vector< FrameRecord > frames;
+                TiXmlNode* frameListNode = seqNode->FirstChild( "frameList" );
+                TiXmlNode* frameNode = frameListNode ? frameListNode->FirstChild( "frame" ) : 0;
+                for ( frameNode; frameNode; frameNode = frameNode->NextSibling( "frame" ) )
+                {
+                    FrameRecord frame;
+                    frame.delay         = StringUtil::ToInt( XmlArchiveFile::GetItemValue( frameNode->FirstChild( "frameDelay" ) ) );
+                    frame.tileNumber    = StringUtil::ToInt( XmlArchiveFile::GetItemValue( frameNode->FirstChild( "tileNumber" ) ) );
+                    frames.push_back( frame );
+                }
+
+                SequenceRecord seq;
+                seq.index       = StringUtil::ToInt( XmlArchiveFile::GetItemValue( seqNode->FirstChild( "index" ) ) );
+                seq.frameCount  = frames.size();
+                seq.frameOffset = writer.AppendArray( frames );
+                sequences.push_back( seq );
+            }
+            tileSet.sequenceListCount   = sequences.size();
+            tileSet.sequenceOffset      = writer.AppendArray( sequences );
+
+            // Maps, stored as runs
+            std::vector< MapRecord > maps;
+            listNode = tilesetNode->FirstChild( "mapList" );
+            TiXmlNode* mapNode = listNode ? listNode->FirstChild( "map" ) : 0;
+            for ( mapNode; mapNode; mapNode = mapNode->NextSibling( "map" ) )
+            {
+                Point2D size( StringUtil::ToInt( XmlArchiveFile::GetItemValue( mapNode->FirstChild( "width" ) ) ),
+                              StringUtil::ToInt( XmlArchiveFile::GetItemValue( mapNode->FirstChild( "height" ) ) ) );
+                size.x = Math::IMax( size.x, 0 );
+                size.y = Math::IMax( size.y, 0 );
+                TiXmlNode* cellNode = mapNode->FirstChild( "cellList" );
+                cellNode = cellNode ? cellNode->FirstChild( "cell" ) : 0;
+
+                // The cells are encoded as each row is read, so only one row
+                // of the grid is ever held
+                TileSet::TileMap row( size.x );
+                const TileSet::TileMapItem* rowCells = row.empty() ? 0 : &row[ 0 ];
+
+                MapRecord map;
+                memset( &map, 0, sizeof( map ) );
+                map.width           = size.x;
+                map.height          = size.y;
+                if ( pageSize == 0 || ( size.x <= Int( pageSize ) && size.y <= Int( pageSize ) ) )
+                {
+                    EncodedCells encoded;
+                    encoded.rowSpans.reserve( size.y + 1 );
+                    for ( Int y = 0; y < size.y; y++ )
+                    {
+                        ReadCellRow( cellNode, row );
+                        if ( !TileSet::EncodeRow( rowCells, size.x, encoded.cells, encoded.spans, encoded.rowSpans, encoded.stats ) )
+                            return false;
+                    }
+                    TileSet::FinishEncoding( encoded.cells, encoded.spans, encoded.rowSpans, encoded.stats );
+                    map.emptyCells      = encoded.stats.emptyCells;
+                    map.rowSpanOffset   = writer.AppendArray( encoded.rowSpans );
+                    map.spanCount       = encoded.spans.size();
+                    map.spanOffset      = writer.AppendArray( encoded.spans );
+                    map.cellCount       = encoded.cells.Size();
+                    map.tileOffset      = writer.AppendArray( encoded.cells.tiles );
+                    map.codeOffset      = writer.AppendArray( encoded.cells.codes );
+                    maps.push_back( map );
+                    continue;
+                }
+
+                // Encode each page as if it were a map of its own.  The pages
+                // of one band of rows are filled together, and written out
+                // once their last row has been read.
+                map.pageSize = pageSize;
+                Point2D pageGrid = GetPageGridSize( map );
+                std::vector< PageRecord > pages( pageGrid.x * pageGrid.y );
+                std::vector< EncodedCells > band( pageGrid.x );
+                for ( Int y = 0; y < size.y; y++ )
+                {
+                    ReadCellRow( cellNode, row );
+                    for ( Int pageX = 0; pageX < pageGrid.x; pageX++ )
+                    {
+                        Int originX = pageX * pageSize;
+                        Int width = Math::IMin( pageSize, size.x - originX );
+                        EncodedCells& encoded = band[ pageX ];
+                        if ( !TileSet::EncodeRow( rowCells + originX, width, encoded.cells, encoded.spans, encoded.rowSpans, encoded.stats ) )
+                            return false;
+                    }
+                    if ( ( y + 1 ) % pageSize != 0 && y != size.y - 1 )
+                        continue;
+
+                    for ( Int pageX = 0; pageX < pageGrid.x; pageX++ )
+                    {
+                        EncodedCells& encoded = band[ pageX ];
+                        TileSet::FinishEncoding( encoded.cells, encoded.spans, encoded.rowSpans, encoded.stats );
+                        map.emptyCells += encoded.stats.emptyCells;
+
+                        PageRecord& page = pages[ ( y / pageSize ) * pageGrid.x + pageX ];
+                        page.dataOffset = pageWriter.AppendArray( encoded.rowSpans );
+                        pageWriter.AppendArray( encoded.spans );
+                        pageWriter.AppendArray( encoded.cells.tiles );
+                        pageWriter.AppendArray( encoded.cells.codes );
+                        page.dataSize   = pageWriter.data.size() - page.dataOffset;
+                        page.spanCount  = encoded.spans.size();
+                        page.cellCount  = encoded.cells.Size();
+                        encoded = EncodedCells();
+                    }
+                }
+                map.pageOffset = writer.AppendArray( pages );
+                for ( UInt32 page = 0; page < pages.size(); page++ )
+                    pageRecordOffsets.push_back( map.pageOffset + page * sizeof( PageRecord ) );
+                maps.push_back( map );
+            }
+            tileSet.mapCount    = maps.size();
+            tileSet.mapOffset   = writer.AppendArray( maps );
+
+            writer.Write( tileSetOffset + i * sizeof( TileSetRecord ), &tileSet, sizeof( tileSet ) );
+        }
+
+        // Move the page data to the end
+        UInt32 indexSize = writer.data.size();
+        for ( UInt32 i = 0; i < pageRecordOffsets.size(); i++ )
+        {
+            PageRecord page;
+            memcpy( &page, &writer.data[ pageRecordOffsets[ i ] ], sizeof( page ) );
+            page.dataOffset += indexSize;
+            writer.Write( pageRecordOffsets[ i ], &page, sizeof( page ) );
+        }
+        writer.data.insert( writer.data.end(), pageWriter.data.begin(), pageWriter.data.end() );
+
+        Header header;
+        header.magic            = MAGIC;
+        header.version          = VERSION;
+        header.fileSize         = writer.data.size();
+        header.indexSize        = indexSize;
+        header.cellSize         = sizeof( SInt16 ) + sizeof( UInt16 );
+        header.spanSize         = sizeof( TileSet::TileSpan );
+        header.tileSetCount     = tilesetNodes.size();
+        header.tileSetOffset    = tileSetOffset;
+        writer.Write( headerOffset, &header, sizeof( header ) );
+
+        std::ofstream out( outFileName.c_str(), std::ios::out | std::ios::binary );
+        if ( !out )
+            return false;
+        out.write( reinterpret_cast< const char* >( &writer.data[ 0 ] ), writer.data.size() );
+        return out.good();
+    }
+
+} // namespace PGE
@@ -0,0 +1,234 @@
+/*! $Id$
+ *  @file   PgeTileMapPager.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeTileMapPager.h"
+#include "PgeArchiveFile.h"
+#include "PgeArchiveManager.h"
+#include "PgeMath.h"
+
+#include <algorithm>
+
+namespace PGE
+{
+    ////////////////////////////////////////////////////////////////////////////
+    // class TileMapPager::PageLoadJob
+    ////////////////////////////////////////////////////////////////////////////
+
+    //Execute
+    void TileMapPager::PageLoadJob::Execute()
+    {
+        isValid = false;
+        ArchiveFile* file = ArchiveManager::GetSingleton().CreateArchiveFile( fileName );
+        if ( !file )
+            return;
+
+        std::vector< UInt8 > data( record.dataSize );
+        bool isRead = !data.empty() && file->Seek( record.dataOffset, ArchiveFile::Begin ) &&
+                      file->Read( &data[ 0 ], data.size() ) == data.size();
+        delete file;
+        if ( !isRead )
+            return;
+
+        // The layout was checked against the record when the map was opened,
+        // but the contents of the runs still need checking.
+        TileMapFile::PageLayout layout = TileMapFile::GetPageLayout( page.size.y, record );
+        const UInt32* rowSpans = reinterpret_cast< const UInt32* >( &data[ 0 ] );
+        const TileSet::TileSpan* spans = reinterpret_cast< const TileSet::TileSpan* >( &data[ 0 ] + layout.spanOffset );
+        const SInt16* tiles = reinterpret_cast< const SInt16* >( &data[ 0 ] + layout.tileOffset );
+        const UInt16* codes = reinterpret_cast< const UInt16* >( &data[ 0 ] + layout.codeOffset );
+        if ( !TileMapFile::ValidateRuns( rowSpans, page.size, spans, record.spanCount, record.cellCount ) )
+            return;
+
+        page.rowSpans.assign( rowSpans, rowSpans + page.size.y + 1 );
+        page.spans.assign( spans, spans + record.spanCount );
+        page.cells.tiles.assign( tiles, tiles + record.cellCount );
+        page.cells.codes.assign( codes, codes + record.cellCount );
+        isValid = true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // class TileMapPager
+    ////////////////////////////////////////////////////////////////////////////
+
+    //Constructor
+    TileMapPager::TileMapPager( const TileMapFile& file, const TileMapFile::MapRecord& map )
+        : mFileName( file.GetFileName() ),
+          mMapSize( map.width, map.height ),
+          mPageSize( map.pageSize ),
+          mPageGridSize( TileMapFile::GetPageGridSize( map ) ),
+          mNextSerial( 0 ),
+          mLoadRadius( 1 ),
+          mHysteresis( 1 ),
+          mResidentBytes( 0 )
+    {
+        const TileMapFile::PageRecord* pages = file.GetPages( map );
+        UInt32 pageCount = mPageGridSize.x * mPageGridSize.y;
+        if ( pages )
+            mRecords.assign( pages, pages + pageCount );
+
+        PageSlot empty = { 0, 0, 0 };
+        mSlots.resize( mRecords.size(), empty );
+    }
+
+    //Destructor
+    TileMapPager::~TileMapPager()
+    {
+        while ( !mActivePages.empty() )
+            _releasePage( mActivePages.back() );
+    }
+
+    //_collectJob---------------------------------------------------------------
+    void TileMapPager::_collectJob( UInt32 pageIndex )
+    {
+        PageSlot& slot = mSlots[ pageIndex ];
+        PageLoadJob* job = slot.job;
+        slot.job = 0;
+
+        // A page which could not be read is left empty, rather than being
+        // requested again every frame
+        slot.page = new TilePage();
+        if ( job->isValid )
+        {
+            slot.page->cells.Swap( job->page.cells );
+            slot.page->spans.swap( job->page.spans );
+            slot.page->rowSpans.swap( job->page.rowSpans );
+        }
+        slot.page->origin   = job->page.origin;
+        slot.page->size     = job->page.size;
+        slot.serial         = ++mNextSerial;
+        mResidentBytes     += job->record.dataSize;
+        delete job;
+    }
+
+    //_releasePage--------------------------------------------------------------
+    void TileMapPager::_releasePage( UInt32 pageIndex )
+    {
+        PageSlot& slot = mSlots[ pageIndex ];
+        if ( slot.job )
+        {
+            WorkQueue* queue = WorkQueue::GetSingletonPtr();
+            if ( queue && slot.job->IsBusy() && !queue->Cancel( slot.job ) )
+                queue->Wait( slot.job );
+            delete slot.job;
+            slot.job = 0;
+        }
+        if ( slot.page )
+        {
+            mResidentBytes -= mRecords[ pageIndex ].dataSize;
+            delete slot.page;
+            slot.page = 0;
+        }
+        slot.serial = 0;
+
+        std::vector< UInt32 >::iterator iter = std::find( mActivePages.begin(), mActivePages.end(), pageIndex );
+        if ( iter != mActivePages.end() )
+        {
+            *iter = mActivePages.back();
+            mActivePages.pop_back();
+        }
+    }
+
+    //SetRadius-----------------------------------------------------------------
+    void TileMapPager::SetRadius( UInt32 loadRadius, UInt32 hysteresis )
+    {
+        mLoadRadius = loadRadius;
+        mHysteresis = hysteresis;
+    }
+
+    //Update--------------------------------------------------------------------
+    void TileMapPager::Update( const Point2D& firstCell, const Point2D& lastCell )
+    {
+        if ( mSlots.empty() )
+            return;
+
+        Point2D firstPage( Math::IClamp( firstCell.x, 0, mMapSize.x - 1 ) / mPageSize,
+                           Math::IClamp( firstCell.y, 0, mMapSize.y - 1 ) / mPageSize );
+        Point2D lastPage( Math::IClamp( lastCell.x, 0, mMapSize.x - 1 ) / mPageSize,
+                          Math::IClamp( lastCell.y, 0, mMapSize.y - 1 ) / mPageSize );
+
+        // Release the pages which are beyond the hysteresis, and pick up the
+        // loads which have finished
+        Int keep = mLoadRadius + mHysteresis;
+        for ( UInt32 i = 0; i < mActivePages.size(); )
+        {
+            UInt32 pageIndex = mActivePages[ i ];
+            Int pageX = pageIndex % mPageGridSize.x;
+            Int pageY = pageIndex / mPageGridSize.x;
+            if ( pageX < firstPage.x - keep || pageX > lastPage.x + keep ||
+                 pageY < firstPage.y - keep || pageY > lastPage.y + keep )
+            {
+                // The last page takes this one's place in the list
+                _releasePage( pageIndex );
+                continue;
+            }
+
+            PageSlot& slot = mSlots[ pageIndex ];
+            if ( slot.job && !slot.job->IsBusy() )
+                _collectJob( pageIndex );
+            i++;
+        }
+
+        // Request the pages within the load radius, nearest the view first
+        WorkQueue* queue = WorkQueue::GetSingletonPtr();
+        for ( UInt32 ring = 0; ring <= mLoadRadius; ring++ )
+        {
+            Int startX = Math::IMax( firstPage.x - Int( ring ), 0 );
+            Int startY = Math::IMax( firstPage.y - Int( ring ), 0 );
+            Int endX   = Math::IMin( lastPage.x + Int( ring ), mPageGridSize.x - 1 );
+            Int endY   = Math::IMin( lastPage.y + Int( ring ), mPageGridSize.y - 1 );
+            for ( Int pageY = startY; pageY <= endY; pageY++ )
+            {
+                for ( Int pageX = startX; pageX <= endX; pageX++ )
+                {
+                    UInt32 pageIndex = pageY * mPageGridSize.x + pageX;
+                    PageSlot& slot = mSlots[ pageIndex ];
+                    if ( slot.page || slot.job )
+                        continue;
+
+                    PageLoadJob* job = new PageLoadJob();
+                    job->fileName       = mFileName;
+                    job->record         = mRecords[ pageIndex ];
+                    job->page.origin    = Point2D( pageX * mPageSize, pageY * mPageSize );
+                    job->page.size      = Point2D( Math::IMin( mPageSize, mMapSize.x - job->page.origin.x ),
+                                                   Math::IMin( mPageSize, mMapSize.y - job->page.origin.y ) );
+                    job->isValid        = false;
+                    slot.job = job;
+                    mActivePages.push_back( pageIndex );
+
+                    // Without worker threads, the page is loaded right away
+                    if ( queue )
+                        queue->Submit( job );
+                    else
+                        job->Execute();
+                    if ( !job->IsBusy() )
+                        _collectJob( pageIndex );
+                }
+            }
+        }
+    }
+
+    //GetPageIndex--------------------------------------------------------------
+    UInt32 TileMapPager::GetPageIndex( Int x, Int y ) const
+    {
+        return ( y / mPageSize ) * mPageGridSize.x + ( x / mPageSize );
+    }
+
+    //GetPage-------------------------------------------------------------------
+    const TileMapPager::TilePage* TileMapPager::GetPage( UInt32 pageIndex, UInt32* serial ) const
+    {
+        if ( pageIndex >= mSlots.size() )
+        {
+            if ( serial )
+                *serial = 0;
+            return 0;
+        }
+        if ( serial )
+            *serial = mSlots[ pageIndex ].serial;
+        return mSlots[ pageIndex ].page;
+    }
+
+} // namespace PGE
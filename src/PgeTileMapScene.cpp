@@ -11,6 +11,8 @@
 #include "PgeViewport.h"
 #include "PgeMath.h"
 #include "PgeTextureManager.h"
+#include "PgeTextureAtlas.h"
+#include "PgeTileMapFile.h"
 #include "PgeArchiveFile.h"
 #include "PgeArchiveManager.h"
 #include "PgeXmlArchiveFile.h"
@@ -21,9 +23,13 @@
 
 #include <gl/gl.h>
 #include <gl/glu.h>
+#include <sstream>
+#include <algorithm>
 
 #include "cmd/StringUtil.h"
 using cmd::StringUtil;
+#include "cmd/LogFileManager.h"
+using cmd::LogFileManager;
 
 namespace PGE
 {
@@ -40,6 +46,16 @@ namespace PGE
     {
     }
 
+    //Destructor
+    TileMapScene::~TileMapScene()
+    {
+        TileSetMap::iterator iter = mTileSets.begin();
+        for ( iter; iter != mTileSets.end(); iter++ )
+            iter->second.SetNull();
+        mTileSets.clear();
+        mPrimaryTileSet = 0;
+    }
+
     //ReadScene
     void TileMapScene::ReadScene( TiXmlNode* setListNode, const String& baseDir, UInt32 mapNum )
     {
@@ -59,6 +75,8 @@ namespace PGE
                 {
                     // Read the tileset and get the desired map.
                     ReadTileset( tilesetNode, baseDir, mapNum );
+
+                    tilesetNode = tilesetNode->NextSibling( "tileset" );
                 }
             }
         }
@@ -68,10 +86,10 @@ namespace PGE
     void TileMapScene::Update( PGE::Real32 elapsedMS )
     {
         // Update the tilesets
-        TileSetMultiSet::iterator iter = mTileSets.begin();
+        TileSetMap::iterator iter = mTileSets.begin();
         for ( iter; iter != mTileSets.end(); iter++ )
         {
-            iter->Update( elapsedMS );
+            iter->second->Update( elapsedMS );
         }
     }
 
@@ -82,46 +100,112 @@ namespace PGE
         // and pretend the developer had other plans.  We'll give the developer
         // the benefit of the doubt, and just return from this method without
         // doing anything...
+        mRenderStats.Reset();
         if ( mPrimaryTileSet == 0 )
             return;
         glEnable( GL_TEXTURE_2D );
+        TextureManager::GetSingleton().ResetBinding();
 
-        // Go over the tile maps and calculate their offsets, then render the map.
-        TileSetMultiSet::const_iterator mapIter = mTileSets.begin();
         Point2D viewSize = viewport.GetSize();
         Point2D primaryMapSize = mPrimaryTileSet->GetMapSize();
         offset.x = Math::Clamp( offset.x, viewSize.x - primaryMapSize.x, 0 );
         offset.y = Math::Clamp( offset.y, viewSize.y - primaryMapSize.y, 0 );
+
+        // Bring the caches of the cached layers up to date first.  They are
+        // drawn through the back buffer, so it is cleared again before the
+        // frame is drawn if any of them had to be redrawn.
+        TileSetMap::const_iterator mapIter = mTileSets.begin();
+        bool isCacheDrawn = false;
         for ( mapIter; mapIter != mTileSets.end(); mapIter++ )
         {
-            // Calculate the ratio between the current map and the primary map
-            Point2D curMapSize = mapIter->GetMapSize();
-            Real ratioX = 1.0, ratioY = 1.0;
-            if ( curMapSize.x != viewSize.x && primaryMapSize.x != viewSize.x )
-                ratioX = ( primaryMapSize.x - viewSize.x ) / Real( curMapSize.x - viewSize.x );
-            if ( curMapSize.y != viewSize.y && primaryMapSize.y != viewSize.y )
-                ratioY = ( primaryMapSize.y - viewSize.y ) / Real( curMapSize.y - viewSize.y );
-
-            // Calculate the offset of the current map using the offset for the
-            // primary map and the ratios
-            Point2Df curOffset( offset.x / ratioX, offset.y / ratioY );
-            curOffset.y = Math::Clamp( curOffset.y, viewSize.y - curMapSize.y, 0 );
-
-            mapIter->Render( curOffset, viewport );
+            const TileSet& layer = *mapIter->second;
+            if ( layer.IsRenderCached() &&
+                 layer.RefreshRenderCache( _getLayerOffset( layer, offset, viewport ), viewport ) )
+                isCacheDrawn = true;
+        }
+        if ( isCacheDrawn )
+        {
+            glClear( GL_COLOR_BUFFER_BIT );
+            TextureManager::GetSingleton().ResetBinding();
+        }
+
+        // Go over the tile maps and calculate their offsets, then render the map.
+        for ( mapIter = mTileSets.begin(); mapIter != mTileSets.end(); mapIter++ )
+        {
+            const TileSet& layer = *mapIter->second;
+            Point2Df curOffset = _getLayerOffset( layer, offset, viewport );
+            layer.Render( curOffset, viewport );
+            mRenderStats += layer.GetRenderStats();
         }
 
         glDisable( GL_TEXTURE_2D );
     }
 
+    //_getLayerOffset
+    Point2Df TileMapScene::_getLayerOffset( const TileSet& layer, const Point2Df& offset, const Viewport& viewport ) const
+    {
+        // Calculate the ratio between the current map and the primary map
+        Point2D viewSize = viewport.GetSize();
+        Point2D primaryMapSize = mPrimaryTileSet->GetMapSize();
+        Point2D curMapSize = layer.GetMapSize();
+        Real ratioX = 1.0, ratioY = 1.0;
+        if ( curMapSize.x != viewSize.x && primaryMapSize.x != viewSize.x )
+            ratioX = ( primaryMapSize.x - viewSize.x ) / Real( curMapSize.x - viewSize.x );
+        if ( curMapSize.y != viewSize.y && primaryMapSize.y != viewSize.y )
+            ratioY = ( primaryMapSize.y - viewSize.y ) / Real( curMapSize.y - viewSize.y );
+
+        // Calculate the offset of the current map using the offset for the
+        // primary map and the ratios
+        Point2Df curOffset( offset.x / ratioX, offset.y / ratioY );
+        curOffset.y = Math::Clamp( curOffset.y, viewSize.y - curMapSize.y, 0 );
+        return curOffset;
+    }
+
     //ReadTileset
-    void TileMapScene::ReadTileset( TiXmlNode* tilesetNode, const String& baseDir, UInt32 mapNum )
+    TileSet* TileMapScene::ReadTileset( TiXmlNode* tilesetNode, const String& baseDir, UInt32 mapNum )
     {
         if ( !tilesetNode )
-            return;
+            return 0;
+
+        // Read the tileset straight into its layer, so it is never copied
+        TileSet* set = new TileSet();
+        if ( !set->ReadTileSet( tilesetNode, baseDir, mapNum ) )
+        {
+            delete set;
+            return 0;
+        }
+        return _insertTileSet( set );
+    }
+
+    //ReadTileMapFile
+    void TileMapScene::ReadTileMapFile( const TileMapFile& file, const String& baseDir, UInt32 mapNum )
+    {
+        for ( UInt32 i = 0; i < file.GetTileSetCount(); i++ )
+        {
+            TileSet* set = new TileSet();
+            if ( set->ReadTileSet( file, i, baseDir, mapNum ) )
+                _insertTileSet( set );
+            else
+                delete set;
+        }
+    }
 
-        // Read the tilesets and add them to the scene:
-        TileSet set( tilesetNode, baseDir, mapNum );
-        AddTileSet( set );
+    //SelectMap
+    void TileMapScene::SelectMap( UInt32 mapNum )
+    {
+        TileSetMap::iterator iter = mTileSets.begin();
+        for ( iter; iter != mTileSets.end(); iter++ )
+            iter->second->SelectMap( mapNum );
+    }
+
+    //GetMapCount
+    UInt32 TileMapScene::GetMapCount() const
+    {
+        UInt32 count = 0;
+        TileSetMap::const_iterator iter = mTileSets.begin();
+        for ( iter; iter != mTileSets.end(); iter++ )
+            count = Math::IMax( count, iter->second->GetMapCount() );
+        return count;
     }
 
     void TileMapScene::GenerateDefaultTileset( const String& textureName, const Point2Df& tileSize, const Point2D& tileCount )
@@ -147,18 +231,181 @@ namespace PGE
         //AddTileMap( tileMap );
     }
 
-    void TileMapScene::AddTileSet( TileSet& set )
+    //AddTileSet
+    TileSet* TileMapScene::AddTileSet( TileSet& set )
+    {
+        TileSet* layer = new TileSet();
+        layer->Swap( set );
+        return _insertTileSet( layer );
+    }
+
+    //AddTileSet
+    void TileMapScene::AddTileSet( const TileSetPtr& set )
+    {
+        if ( set.IsNull() )
+            return;
+
+        // Layers at the same depth are drawn in the order they were added.
+        // The handle is assigned where it lies in the map, so no temporary
+        // copy is left holding a reference.
+        TileSetMap::iterator iter = mTileSets.insert( mTileSets.upper_bound( set->mIndex ),
+                                                      TileSetMap::value_type( set->mIndex, TileSetPtr() ) );
+        iter->second = set;
+        _updatePrimaryTileSet( set.Get() );
+    }
+
+    //_insertTileSet
+    TileSet* TileMapScene::_insertTileSet( TileSet* set )
+    {
+        // The handle is bound where it lies in the map, so its use count only
+        // includes the scene
+        TileSetMap::iterator iter = mTileSets.insert( mTileSets.upper_bound( set->mIndex ),
+                                                      TileSetMap::value_type( set->mIndex, TileSetPtr() ) );
+        iter->second.Bind( set );
+        _updatePrimaryTileSet( set );
+        return set;
+    }
+
+    //RemoveTileSet
+    bool TileMapScene::RemoveTileSet( const TileSet* set )
     {
-        // Add the map to the set:
-        mTileSets.insert( set );
+        if ( !set )
+            return false;
+        TileSetMap::iterator iter = mTileSets.lower_bound( set->mIndex );
+        while ( iter != mTileSets.end() && iter->first == set->mIndex && iter->second.Get() != set )
+            iter++;
+        if ( iter == mTileSets.end() || iter->second.Get() != set )
+            return false;
 
-        if ( !mPrimaryTileSet )
+        if ( mPrimaryTileSet == set )
+            mPrimaryTileSet = 0;
+        iter->second.SetNull();
+        mTileSets.erase( iter );
+
+        for ( iter = mTileSets.begin(); iter != mTileSets.end(); iter++ )
+            _updatePrimaryTileSet( iter->second.Get() );
+        return true;
+    }
+
+    //_updatePrimaryTileSet
+    void TileMapScene::_updatePrimaryTileSet( TileSet* added )
+    {
+        if ( mPrimaryTileSet == 0 )
+            mPrimaryTileSet = added;
+        else if ( added->mIndex == 0 && mPrimaryTileSet->mIndex != 0 )
+            mPrimaryTileSet = added;
+    }
+
+    //GetTileSetCount
+    UInt32 TileMapScene::GetTileSetCount() const
+    {
+        return mTileSets.size();
+    }
+
+    //GetTileSet
+    TileSet* TileMapScene::GetTileSet( UInt32 layerIndex ) const
+    {
+        if ( layerIndex >= mTileSets.size() )
+            return 0;
+        TileSetMap::const_iterator iter = mTileSets.begin();
+        std::advance( iter, layerIndex );
+        return iter->second.Get();
+    }
+
+    //GetPrimaryTileSet
+    TileSet* TileMapScene::GetPrimaryTileSet() const
+    {
+        return mPrimaryTileSet;
+    }
+
+    //BuildAtlas
+    bool TileMapScene::BuildAtlas( const String& atlasName, UInt32 pageSize, UInt32 gutter )
+    {
+        TextureAtlas atlas( atlasName, pageSize, gutter );
+        TileSetMap::const_iterator iter = mTileSets.begin();
+        for ( iter; iter != mTileSets.end(); iter++ )
+        {
+            const TileSet& layer = *iter->second;
+            if ( atlas.FindBlock( layer.GetImageName() ) >= 0 )
+                continue;
+
+            ImageData image;
+            if ( TextureItem::Decode( layer.GetImageName(), image ) )
+                atlas.AddTileGrid( layer.GetImageName(), image, layer.GetTileSize(), layer.GetTileGridSize() );
+        }
+
+        if ( !atlas.Build() || !atlas.Upload() )
+            return false;
+        ApplyAtlas( atlas );
+        return true;
+    }
+
+    //LoadAtlas
+    bool TileMapScene::LoadAtlas( const String& descriptorFileName )
+    {
+        TextureAtlas atlas;
+        if ( !atlas.Load( descriptorFileName ) || !atlas.Upload() )
+            return false;
+        ApplyAtlas( atlas );
+        return true;
+    }
+
+    //ApplyAtlas
+    void TileMapScene::ApplyAtlas( const TextureAtlas& atlas )
+    {
+        TileTexCoordArray texCoords;
+        TileSetMap::iterator iter = mTileSets.begin();
+        for ( iter; iter != mTileSets.end(); iter++ )
+        {
+            TileSet& layer = *iter->second;
+            if ( atlas.GetTileTexCoords( layer.GetImageName(), texCoords ) )
+                layer.SetAtlas( atlas.GetBlockPageName( layer.GetImageName() ), texCoords );
+        }
+    }
+
+    //SetStreamingRadius
+    void TileMapScene::SetStreamingRadius( UInt32 loadRadius, UInt32 hysteresis )
+    {
+        TileSetMap::iterator iter = mTileSets.begin();
+        for ( iter; iter != mTileSets.end(); iter++ )
+            iter->second->SetStreamingRadius( loadRadius, hysteresis );
+    }
+
+    //SetLayerCache
+    void TileMapScene::SetLayerCache( UInt32 layerIndex, bool enable, UInt32 margin )
+    {
+        if ( layerIndex >= mTileSets.size() )
+            return;
+        TileSetMap::iterator iter = mTileSets.begin();
+        std::advance( iter, layerIndex );
+        iter->second->SetRenderCache( enable, margin );
+    }
+
+    //GetRenderStats
+    const TileRenderStats& TileMapScene::GetRenderStats() const
+    {
+        return mRenderStats;
+    }
+
+    //LogMapStats
+    void TileMapScene::LogMapStats() const
+    {
+        LogFileManager& lfm = LogFileManager::getInstance();
+        TileSetMap::const_iterator iter = mTileSets.begin();
+        for ( iter; iter != mTileSets.end(); iter++ )
         {
-            mPrimaryTileSet = new TileSet();
-            *mPrimaryTileSet = set;
+            const TileSet& layer = *iter->second;
+            const TileMapStats& stats = layer.GetMapStats();
+            std::stringstream msg;
+            if ( layer.IsStreaming() )
+                msg << "Streamed ";
+            msg << "Layer " << layer.mIndex << " (" << layer.GetImageName() << "): "
+                << stats.cellCount << " cells, "
+                << int( stats.GetEmptyRatio() * 100.0f + 0.5f ) << "% empty, "
+                << stats.storedCells << " stored in " << stats.spanCount << " runs, "
+                << stats.memoryBytes << " bytes";
+            lfm.LogMessage( msg.str() );
         }
-        else if ( set.mIndex == 0 && mPrimaryTileSet->mIndex != 0 )
-            *mPrimaryTileSet = set;
     }
 
 } // namespace PGE
@@ -0,0 +1,240 @@
+/*! $Id$
+ *  @file   PgeTileMinimap.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeTileMinimap.h"
+#include "PgeMath.h"
+
+namespace PGE
+{
+    //Constructor
+    TileMinimap::TileMinimap()
+        : mGridSize( 0, 0 ),
+          mChunkGridSize( 0, 0 ),
+          mScale( 4 ),
+          mHasChanges( false ),
+          mChangeStart( 0, 0 ),
+          mChangeEnd( 0, 0 ),
+          mTexture( 0 )
+    {
+    }
+
+    //Destructor
+    TileMinimap::~TileMinimap()
+    {
+        Clear();
+    }
+
+    //_markCell-----------------------------------------------------------------
+    void TileMinimap::_markCell( Int x, Int y )
+    {
+        UInt32 chunk = ( y / TileSet::CHUNK_SIZE ) * mChunkGridSize.x + x / TileSet::CHUNK_SIZE;
+        if ( !mDirty[ chunk ] )
+        {
+            mDirty[ chunk ] = 1;
+            mDirtyChunks.push_back( chunk );
+        }
+    }
+
+    //_drawPixels---------------------------------------------------------------
+    void TileMinimap::_drawPixels( const TileSet& tileSet, Int startX, Int startY, Int endX, Int endY )
+    {
+        startX = Math::IMax( startX, 0 );
+        startY = Math::IMax( startY, 0 );
+        endX   = Math::IMin( endX, Int( mImage.width ) - 1 );
+        endY   = Math::IMin( endY, Int( mImage.height ) - 1 );
+        if ( startX > endX || startY > endY )
+            return;
+
+        Int scale = mScale;
+        for ( Int pixelY = startY; pixelY <= endY; pixelY++ )
+        {
+            Int cellEndY = Math::IMin( ( pixelY + 1 ) * scale, mGridSize.y );
+            for ( Int pixelX = startX; pixelX <= endX; pixelX++ )
+            {
+                // Average the cells under the pixel, with the colors weighted
+                // by their alpha
+                Int cellEndX = Math::IMin( ( pixelX + 1 ) * scale, mGridSize.x );
+                UInt32 red = 0, green = 0, blue = 0, alpha = 0, count = 0;
+                for ( Int y = pixelY * scale; y < cellEndY; y++ )
+                {
+                    for ( Int x = pixelX * scale; x < cellEndX; x++, count++ )
+                    {
+                        SInt32 tile = tileSet.GetStillTile( tileSet.GetCell( x, y ).tileIndex );
+                        if ( tile <= 0 || tile >= SInt32( mTileColors.size() ) )
+                            continue;
+                        const Color& color = mTileColors[ tile ];
+                        red     += color.r * color.a;
+                        green   += color.g * color.a;
+                        blue    += color.b * color.a;
+                        alpha   += color.a;
+                    }
+                }
+
+                UInt8* pixel = mImage.GetPixel( pixelX, pixelY );
+                if ( alpha )
+                {
+                    pixel[ 0 ] = ( red + alpha / 2 ) / alpha;
+                    pixel[ 1 ] = ( green + alpha / 2 ) / alpha;
+                    pixel[ 2 ] = ( blue + alpha / 2 ) / alpha;
+                    pixel[ 3 ] = ( alpha + count / 2 ) / count;
+                }
+                else
+                    pixel[ 0 ] = pixel[ 1 ] = pixel[ 2 ] = pixel[ 3 ] = 0;
+            }
+        }
+
+        if ( !mHasChanges )
+        {
+            mHasChanges = true;
+            mChangeStart = Point2D( startX, startY );
+            mChangeEnd = Point2D( endX, endY );
+        }
+        else
+        {
+            mChangeStart = Point2D( Math::IMin( mChangeStart.x, startX ), Math::IMin( mChangeStart.y, startY ) );
+            mChangeEnd = Point2D( Math::IMax( mChangeEnd.x, endX ), Math::IMax( mChangeEnd.y, endY ) );
+        }
+    }
+
+    //Build---------------------------------------------------------------------
+    void TileMinimap::Build( const TileSet& tileSet )
+    {
+        mGridSize = tileSet.GetMapGridSize();
+        if ( mGridSize.x <= 0 || mGridSize.y <= 0 )
+            mGridSize = Point2D( 0, 0 );
+        mChunkGridSize = Point2D( ( mGridSize.x + TileSet::CHUNK_SIZE - 1 ) / TileSet::CHUNK_SIZE,
+                                  ( mGridSize.y + TileSet::CHUNK_SIZE - 1 ) / TileSet::CHUNK_SIZE );
+        mImage.Resize( ( mGridSize.x + mScale - 1 ) / mScale, ( mGridSize.y + mScale - 1 ) / mScale );
+        mDirty.assign( mChunkGridSize.x * mChunkGridSize.y, 0 );
+        mDirtyChunks.clear();
+        ReadTileColors( tileSet );
+    }
+
+    //ReadTileColors------------------------------------------------------------
+    void TileMinimap::ReadTileColors( const TileSet& tileSet )
+    {
+        const TileTexCoordArray& texCoords = tileSet.GetTileTexCoords();
+        const TextureItem* texture = tileSet.GetTextureItem();
+        mTileColors.assign( texCoords.size(), Color( 0, 0, 0, 0 ) );
+        for ( UInt32 tile = 1; texture && tile < texCoords.size(); tile++ )
+        {
+            const TileTexCoords& tex = texCoords[ tile ];
+            mTileColors[ tile ] = texture->GetAverageColor( tex.u0, tex.v0, tex.u1, tex.v1 );
+        }
+        _drawPixels( tileSet, 0, 0, Int( mImage.width ) - 1, Int( mImage.height ) - 1 );
+    }
+
+    //Update--------------------------------------------------------------------
+    void TileMinimap::Update( const TileSet& tileSet, Int x, Int y, Int w, Int h )
+    {
+        Int startX = Math::IMax( x, 0 );
+        Int startY = Math::IMax( y, 0 );
+        Int endX   = Math::IMin( x + w, mGridSize.x );
+        Int endY   = Math::IMin( y + h, mGridSize.y );
+        if ( startX < endX && startY < endY )
+            _drawPixels( tileSet, startX / mScale, startY / mScale, ( endX - 1 ) / mScale, ( endY - 1 ) / mScale );
+    }
+
+    //ApplyEdits----------------------------------------------------------------
+    void TileMinimap::ApplyEdits( const TileSet::CellEdit* edits, UInt32 count )
+    {
+        for ( const TileSet::CellEdit* edit = edits; edit != edits + count; edit++ )
+        {
+            if ( edit->x >= 0 && edit->y >= 0 && edit->x < mGridSize.x && edit->y < mGridSize.y )
+                _markCell( edit->x, edit->y );
+        }
+    }
+
+    //Refresh-------------------------------------------------------------------
+    void TileMinimap::Refresh( const TileSet& tileSet )
+    {
+        for ( UInt32 i = 0; i < mDirtyChunks.size(); i++ )
+        {
+            UInt32 chunk = mDirtyChunks[ i ];
+            Int originX = ( chunk % mChunkGridSize.x ) * TileSet::CHUNK_SIZE;
+            Int originY = ( chunk / mChunkGridSize.x ) * TileSet::CHUNK_SIZE;
+            Update( tileSet, originX, originY, TileSet::CHUNK_SIZE, TileSet::CHUNK_SIZE );
+            mDirty[ chunk ] = 0;
+        }
+        mDirtyChunks.clear();
+    }
+
+    //Clear---------------------------------------------------------------------
+    void TileMinimap::Clear()
+    {
+        if ( mTexture && TextureManager::GetSingletonPtr() )
+        {
+            TextureManager::GetSingleton().RemoveImage( mTextureName );
+            TextureManager::GetSingleton().ResetBinding();
+        }
+        mTexture = 0;
+        mTextureName.clear();
+        mImage = ImageData();
+        std::vector< Color >().swap( mTileColors );
+        mDirty.clear();
+        mDirtyChunks.clear();
+        mHasChanges = false;
+        mGridSize = Point2D( 0, 0 );
+        mChunkGridSize = Point2D( 0, 0 );
+    }
+
+    //SetScale------------------------------------------------------------------
+    void TileMinimap::SetScale( UInt32 scale )
+    {
+        mScale = Math::IClamp( scale, 1, TileSet::CHUNK_SIZE );
+    }
+
+    //GetTileColor--------------------------------------------------------------
+    Color TileMinimap::GetTileColor( SInt32 tileIndex ) const
+    {
+        if ( tileIndex <= 0 || tileIndex >= SInt32( mTileColors.size() ) )
+            return Color( 0, 0, 0, 0 );
+        return mTileColors[ tileIndex ];
+    }
+
+    //Upload--------------------------------------------------------------------
+    bool TileMinimap::Upload( const String& textureName )
+    {
+        if ( mImage.pixels.empty() )
+            return false;
+
+        // The texture is created the first time, or again if the image has
+        // outgrown it
+        if ( !mTexture || textureName != mTextureName ||
+             mImage.width > mTexture->GetWidth() || mImage.height > mTexture->GetHeight() )
+        {
+            if ( mTexture )
+                TextureManager::GetSingleton().RemoveImage( mTextureName );
+            mTexture = 0;
+
+            ImageData canvas;
+            canvas.Resize( Math::FindNextPowerOf2( mImage.width ), Math::FindNextPowerOf2( mImage.height ) );
+            for ( UInt32 y = 0; y < mImage.height; y++ )
+                std::copy( mImage.GetPixel( 0, y ), mImage.GetPixel( 0, y ) + mImage.width * 4, canvas.GetPixel( 0, y ) );
+            if ( !TextureManager::GetSingleton().CreateTexture( textureName, canvas ) )
+                return false;
+            mTextureName = textureName;
+            mTexture = TextureManager::GetSingleton().GetTextureItemPtr( textureName );
+            mHasChanges = false;
+            return mTexture != 0;
+        }
+
+        // Copy the changed pixels straight from the rows of the image
+        if ( mHasChanges )
+        {
+            TextureManager::GetSingleton().BindTexture( mTexture->GetID() );
+            glPixelStorei( GL_UNPACK_ROW_LENGTH, mImage.width );
+            glTexSubImage2D( GL_TEXTURE_2D, 0, mChangeStart.x, mChangeStart.y,
+                             mChangeEnd.x - mChangeStart.x + 1, mChangeEnd.y - mChangeStart.y + 1,
+                             GL_RGBA, GL_UNSIGNED_BYTE, mImage.GetPixel( mChangeStart.x, mChangeStart.y ) );
+            glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+            mHasChanges = false;
+        }
+        return true;
+    }
+
+} // namespace PGE
@@ -0,0 +1,995 @@
+/*! $Id$
+ *  @file   PgeTilePathfinder.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeTilePathfinder.h"
+#include "PgeMath.h"
+
+#include <algorithm>
+
+namespace PGE
+{
+    /** Shortest run of open cells along a border which is given an entrance
+        at each end, rather than one in the middle
+    */
+    static const Int WIDE_ENTRANCE = 6;
+
+    /** Index of the lower and right borders in TilePathfinder::mBorders */
+    static const UInt32 BORDER_BOTTOM   = 0;
+    static const UInt32 BORDER_RIGHT    = 1;
+
+    /** Offsets of the neighbours of a cell, straight ones first */
+    static const Int NEIGHBOUR_X[ 8 ] = { 0, -1, 0, 1, -1, 1, -1, 1 };
+    static const Int NEIGHBOUR_Y[ 8 ] = { -1, 0, 1, 0, -1, -1, 1, 1 };
+
+    /** Get the octile distance covered by a move */
+    static inline UInt32 Octile( Int dx, Int dy, UInt32 straight, UInt32 diagonal )
+    {
+        dx = ( dx < 0 ) ? -dx : dx;
+        dy = ( dy < 0 ) ? -dy : dy;
+        return ( dx < dy ) ? dx * diagonal + ( dy - dx ) * straight : dy * diagonal + ( dx - dy ) * straight;
+    }
+
+    /** Get the sign of a value */
+    static inline Int Sign( Int value )
+    {
+        return ( value > 0 ) - ( value < 0 );
+    }
+
+    const UInt32 TilePathfinder::STRAIGHT_COST = 10;
+    const UInt32 TilePathfinder::DIAGONAL_COST = 14;
+    const UInt32 TilePathfinder::NO_PATH       = 0xFFFFFFFF;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // class TilePathfinder::PathJob
+    ////////////////////////////////////////////////////////////////////////////
+
+    //Execute
+    void TilePathfinder::PathJob::Execute()
+    {
+        SearchContext context;
+        pathfinder->_prepareContext( context );
+        for ( UInt32 i = first; i < first + count; i++ )
+            pathfinder->_findPath( context, batch->mRequests[ i ], batch->mResults[ i ] );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // class TilePathfinder::PathBatch
+    ////////////////////////////////////////////////////////////////////////////
+
+    //Destructor
+    TilePathfinder::PathBatch::~PathBatch()
+    {
+        WorkQueue* queue = WorkQueue::GetSingletonPtr();
+        for ( UInt32 i = 0; i < mJobs.size(); i++ )
+        {
+            if ( queue && mJobs[ i ]->IsBusy() )
+                queue->Wait( mJobs[ i ] );
+            delete mJobs[ i ];
+        }
+    }
+
+    //IsComplete----------------------------------------------------------------
+    bool TilePathfinder::PathBatch::IsComplete() const
+    {
+        for ( UInt32 i = 0; i < mJobs.size(); i++ )
+        {
+            if ( mJobs[ i ]->IsBusy() )
+                return false;
+        }
+        return true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // class TilePathfinder
+    ////////////////////////////////////////////////////////////////////////////
+
+    //Constructor
+    TilePathfinder::TilePathfinder( UInt32 clusterSize )
+        : mClusterSize( Math::IClamp( clusterSize, 4, 256 ) ),
+          mGridSize( 0, 0 ),
+          mClusterGridSize( 0, 0 )
+    {
+        mContext.cellSerial = 0;
+        mContext.nodeSerial = 0;
+    }
+
+    //Destructor
+    TilePathfinder::~TilePathfinder()
+    {
+        Clear();
+    }
+
+    //_distance-----------------------------------------------------------------
+    UInt32 TilePathfinder::_distance( const Point2D& a, const Point2D& b )
+    {
+        return Octile( a.x - b.x, a.y - b.y, STRAIGHT_COST, DIAGONAL_COST );
+    }
+
+    //_isOpen-------------------------------------------------------------------
+    bool TilePathfinder::_isOpen( const Cluster& cluster, Int x, Int y ) const
+    {
+        if ( x < cluster.origin.x || y < cluster.origin.y ||
+             x >= cluster.origin.x + cluster.size.x || y >= cluster.origin.y + cluster.size.y )
+            return false;
+        return !mSolid[ y * mGridSize.x + x ];
+    }
+
+    //_getCluster---------------------------------------------------------------
+    UInt32 TilePathfinder::_getCluster( const Point2D& cell ) const
+    {
+        return ( cell.y / mClusterSize ) * mClusterGridSize.x + ( cell.x / mClusterSize );
+    }
+
+    //_getNeighbour-------------------------------------------------------------
+    Int TilePathfinder::_getNeighbour( UInt32 cluster, Side side ) const
+    {
+        Int x = cluster % mClusterGridSize.x;
+        Int y = cluster / mClusterGridSize.x;
+        switch ( side )
+        {
+        case SIDE_TOP:      return ( y > 0 ) ? Int( cluster ) - mClusterGridSize.x : -1;
+        case SIDE_LEFT:     return ( x > 0 ) ? Int( cluster ) - 1 : -1;
+        case SIDE_BOTTOM:   return ( y < mClusterGridSize.y - 1 ) ? Int( cluster ) + mClusterGridSize.x : -1;
+        case SIDE_RIGHT:    return ( x < mClusterGridSize.x - 1 ) ? Int( cluster ) + 1 : -1;
+        default:            return -1;
+        }
+    }
+
+    //_getBorder----------------------------------------------------------------
+    const TilePathfinder::TransitionArray* TilePathfinder::_getBorder( UInt32 cluster, Side side ) const
+    {
+        Int neighbour = _getNeighbour( cluster, side );
+        if ( neighbour < 0 )
+            return 0;
+
+        // Each border is kept by the cluster above or to the left of it
+        switch ( side )
+        {
+        case SIDE_TOP:      return &mBorders[ BORDER_BOTTOM ][ neighbour ];
+        case SIDE_LEFT:     return &mBorders[ BORDER_RIGHT ][ neighbour ];
+        case SIDE_BOTTOM:   return &mBorders[ BORDER_BOTTOM ][ cluster ];
+        default:            return &mBorders[ BORDER_RIGHT ][ cluster ];
+        }
+    }
+
+    //_getSideCell--------------------------------------------------------------
+    Point2D TilePathfinder::_getSideCell( const Cluster& cluster, Side side, UInt32 offset ) const
+    {
+        switch ( side )
+        {
+        case SIDE_TOP:      return Point2D( cluster.origin.x + offset, cluster.origin.y );
+        case SIDE_LEFT:     return Point2D( cluster.origin.x, cluster.origin.y + offset );
+        case SIDE_BOTTOM:   return Point2D( cluster.origin.x + offset, cluster.origin.y + cluster.size.y - 1 );
+        default:            return Point2D( cluster.origin.x + cluster.size.x - 1, cluster.origin.y + offset );
+        }
+    }
+
+    //_getNodeCell--------------------------------------------------------------
+    Point2D TilePathfinder::_getNodeCell( UInt32 node ) const
+    {
+        return Point2D( mNodes[ node ].x, mNodes[ node ].y );
+    }
+
+    //_buildBorder--------------------------------------------------------------
+    bool TilePathfinder::_buildBorder( UInt32 cluster, Side side )
+    {
+        const Cluster& inside = mClusters[ cluster ];
+        Int neighbour = _getNeighbour( cluster, side );
+        TransitionArray& border = mBorders[ ( side == SIDE_BOTTOM ) ? BORDER_BOTTOM : BORDER_RIGHT ][ cluster ];
+        TransitionArray transitions;
+        if ( neighbour >= 0 )
+        {
+            // Find each run of cells which are open on both sides of the border
+            const Cluster& outside = mClusters[ neighbour ];
+            Side facing = ( side == SIDE_BOTTOM ) ? SIDE_TOP : SIDE_LEFT;
+            Int length = ( side == SIDE_BOTTOM ) ? inside.size.x : inside.size.y;
+            Int runStart = -1;
+            for ( Int offset = 0; offset <= length; offset++ )
+            {
+                bool isOpen = false;
+                if ( offset < length )
+                {
+                    Point2D a = _getSideCell( inside, side, offset );
+                    Point2D b = _getSideCell( outside, facing, offset );
+                    isOpen = !mSolid[ a.y * mGridSize.x + a.x ] && !mSolid[ b.y * mGridSize.x + b.x ];
+                }
+
+                if ( isOpen && runStart < 0 )
+                    runStart = offset;
+                else if ( !isOpen && runStart >= 0 )
+                {
+                    if ( offset - runStart >= WIDE_ENTRANCE )
+                    {
+                        transitions.push_back( runStart );
+                        transitions.push_back( offset - 1 );
+                    }
+                    else
+                        transitions.push_back( ( runStart + offset - 1 ) / 2 );
+                    runStart = -1;
+                }
+            }
+        }
+
+        if ( transitions == border )
+            return false;
+        border.swap( transitions );
+        return true;
+    }
+
+    //_buildNodes---------------------------------------------------------------
+    void TilePathfinder::_buildNodes( UInt32 cluster )
+    {
+        Cluster& target = mClusters[ cluster ];
+        target.nodeCells.clear();
+        for ( UInt32 side = 0; side < SIDE_COUNT; side++ )
+        {
+            target.sideStart[ side ] = target.nodeCells.size();
+            const TransitionArray* border = _getBorder( cluster, Side( side ) );
+            if ( !border )
+                continue;
+            for ( UInt32 i = 0; i < border->size(); i++ )
+            {
+                Point2D cell = _getSideCell( target, Side( side ), ( *border )[ i ] );
+                target.nodeCells.push_back( cell.y * mGridSize.x + cell.x );
+            }
+        }
+        UInt32 count = target.nodeCells.size();
+        target.sideStart[ SIDE_COUNT ] = count;
+
+        // Paths are the same both ways, so each pair only needs one flood
+        target.costs.assign( count * count, NO_PATH );
+        for ( UInt32 i = 0; i < count; i++ )
+        {
+            target.costs[ i * count + i ] = 0;
+            if ( i + 1 == count )
+                break;
+            _flood( mContext, target, Point2D( target.nodeCells[ i ] % mGridSize.x, target.nodeCells[ i ] / mGridSize.x ) );
+            for ( UInt32 j = i + 1; j < count; j++ )
+            {
+                UInt32 local = ( target.nodeCells[ j ] / mGridSize.x - target.origin.y ) * target.size.x +
+                               ( target.nodeCells[ j ] % mGridSize.x - target.origin.x );
+                UInt32 cost = ( mContext.cellSeen[ local ] == mContext.cellSerial ) ? mContext.cellCost[ local ] : NO_PATH;
+                target.costs[ i * count + j ] = cost;
+                target.costs[ j * count + i ] = cost;
+            }
+        }
+    }
+
+    //_indexNodes---------------------------------------------------------------
+    void TilePathfinder::_indexNodes()
+    {
+        mNodeBase.resize( mClusters.size() + 1 );
+        mNodes.clear();
+        for ( UInt32 cluster = 0; cluster < mClusters.size(); cluster++ )
+        {
+            mNodeBase[ cluster ] = mNodes.size();
+            const std::vector< UInt32 >& cells = mClusters[ cluster ].nodeCells;
+            for ( UInt32 i = 0; i < cells.size(); i++ )
+            {
+                GraphNode node = { Int( cells[ i ] % mGridSize.x ), Int( cells[ i ] / mGridSize.x ), cluster };
+                mNodes.push_back( node );
+            }
+        }
+        mNodeBase.back() = mNodes.size();
+        _prepareContext( mContext );
+    }
+
+    //_repair-------------------------------------------------------------------
+    void TilePathfinder::_repair()
+    {
+        if ( mDirtyClusters.empty() )
+            return;
+
+        // Every border of a changed cluster is placed again.  Where a border
+        // changes, the cluster on the other side gathers its entrances again.
+        for ( UInt32 i = 0; i < mDirtyClusters.size(); i++ )
+        {
+            UInt32 cluster = mDirtyClusters[ i ];
+            for ( UInt32 side = 0; side < SIDE_COUNT; side++ )
+            {
+                Int neighbour = _getNeighbour( cluster, Side( side ) );
+                if ( neighbour < 0 )
+                    continue;
+                bool isChanged = ( side == SIDE_TOP || side == SIDE_LEFT ) ?
+                                 _buildBorder( neighbour, Side( side + 2 ) ) :
+                                 _buildBorder( cluster, Side( side ) );
+                if ( isChanged && !mDirty[ neighbour ] )
+                {
+                    mDirty[ neighbour ] = 1;
+                    mDirtyClusters.push_back( neighbour );
+                }
+            }
+        }
+
+        for ( UInt32 i = 0; i < mDirtyClusters.size(); i++ )
+        {
+            _buildNodes( mDirtyClusters[ i ] );
+            mDirty[ mDirtyClusters[ i ] ] = 0;
+        }
+        mDirtyClusters.clear();
+        _indexNodes();
+    }
+
+    //_markCell-----------------------------------------------------------------
+    void TilePathfinder::_markCell( Int x, Int y )
+    {
+        UInt32 cluster = _getCluster( Point2D( x, y ) );
+        if ( !mDirty[ cluster ] )
+        {
+            mDirty[ cluster ] = 1;
+            mDirtyClusters.push_back( cluster );
+        }
+    }
+
+    //_waitForBatches-----------------------------------------------------------
+    void TilePathfinder::_waitForBatches()
+    {
+        WorkQueue* queue = WorkQueue::GetSingletonPtr();
+        if ( !queue )
+            return;
+        for ( UInt32 i = 0; i < mBatches.size(); i++ )
+        {
+            std::vector< PathJob* >& jobs = mBatches[ i ]->mJobs;
+            for ( UInt32 j = 0; j < jobs.size(); j++ )
+            {
+                if ( jobs[ j ]->IsBusy() )
+                    queue->Wait( jobs[ j ] );
+            }
+        }
+    }
+
+    //_prepareContext-----------------------------------------------------------
+    void TilePathfinder::_prepareContext( SearchContext& context ) const
+    {
+        UInt32 cellCount = mClusterSize * mClusterSize;
+        if ( context.cellSeen.size() != cellCount )
+        {
+            context.cellCost.assign( cellCount, 0 );
+            context.cellParent.assign( cellCount, 0 );
+            context.cellSeen.assign( cellCount, 0 );
+            context.cellDone.assign( cellCount, 0 );
+            context.cellSerial = 0;
+        }
+
+        // The graph may have grown or shrunk since the last search, so the
+        // serials start over
+        UInt32 nodeCount = mNodes.size() + 2;
+        context.nodeCost.assign( nodeCount, 0 );
+        context.nodeParent.assign( nodeCount, 0 );
+        context.nodeSeen.assign( nodeCount, 0 );
+        context.nodeSerial = 0;
+    }
+
+    //_beginCellSearch----------------------------------------------------------
+    void TilePathfinder::_beginCellSearch( SearchContext& context )
+    {
+        if ( ++context.cellSerial == 0 )
+        {
+            std::fill( context.cellSeen.begin(), context.cellSeen.end(), 0 );
+            std::fill( context.cellDone.begin(), context.cellDone.end(), 0 );
+            context.cellSerial = 1;
+        }
+        context.open.clear();
+    }
+
+    //_flood--------------------------------------------------------------------
+    void TilePathfinder::_flood( SearchContext& context, const Cluster& cluster, const Point2D& from ) const
+    {
+        _beginCellSearch( context );
+        UInt32 serial = context.cellSerial;
+        UInt32 startLocal = ( from.y - cluster.origin.y ) * cluster.size.x + ( from.x - cluster.origin.x );
+        context.cellCost[ startLocal ] = 0;
+        context.cellSeen[ startLocal ] = serial;
+        OpenEntry entry = { 0, 0, startLocal };
+        context.open.push_back( entry );
+
+        while ( !context.open.empty() )
+        {
+            std::pop_heap( context.open.begin(), context.open.end() );
+            OpenEntry current = context.open.back();
+            context.open.pop_back();
+            if ( context.cellDone[ current.index ] == serial )
+                continue;
+            context.cellDone[ current.index ] = serial;
+
+            Int x = cluster.origin.x + current.index % cluster.size.x;
+            Int y = cluster.origin.y + current.index / cluster.size.x;
+            for ( UInt32 i = 0; i < 8; i++ )
+            {
+                Int nx = x + NEIGHBOUR_X[ i ];
+                Int ny = y + NEIGHBOUR_Y[ i ];
+                if ( !_isOpen( cluster, nx, ny ) )
+                    continue;
+                if ( i >= 4 && ( !_isOpen( cluster, nx, y ) || !_isOpen( cluster, x, ny ) ) )
+                    continue;
+
+                UInt32 local = ( ny - cluster.origin.y ) * cluster.size.x + ( nx - cluster.origin.x );
+                UInt32 cost = current.cost + ( ( i >= 4 ) ? DIAGONAL_COST : STRAIGHT_COST );
+                if ( context.cellSeen[ local ] == serial && context.cellCost[ local ] <= cost )
+                    continue;
+                context.cellSeen[ local ] = serial;
+                context.cellCost[ local ] = cost;
+                OpenEntry next = { cost, cost, local };
+                context.open.push_back( next );
+                std::push_heap( context.open.begin(), context.open.end() );
+            }
+        }
+    }
+
+    //_jump---------------------------------------------------------------------
+    bool TilePathfinder::_jump( const Cluster& cluster, Int x, Int y, Int dx, Int dy, const Point2D& goal, Point2D& result ) const
+    {
+        while ( true )
+        {
+            if ( !_isOpen( cluster, x, y ) )
+                return false;
+            if ( x == goal.x && y == goal.y )
+            {
+                result = goal;
+                return true;
+            }
+
+            if ( dx && dy )
+            {
+                // A diagonal move stops where either straight move would
+                Point2D found;
+                if ( _jump( cluster, x + dx, y, dx, 0, goal, found ) || _jump( cluster, x, y + dy, 0, dy, goal, found ) )
+                {
+                    result = Point2D( x, y );
+                    return true;
+                }
+            }
+            else if ( dx )
+            {
+                // Stop beside a cell which could only be reached from here
+                if ( ( _isOpen( cluster, x, y - 1 ) && !_isOpen( cluster, x - dx, y - 1 ) ) ||
+                     ( _isOpen( cluster, x, y + 1 ) && !_isOpen( cluster, x - dx, y + 1 ) ) )
+                {
+                    result = Point2D( x, y );
+                    return true;
+                }
+            }
+            else
+            {
+                if ( ( _isOpen( cluster, x - 1, y ) && !_isOpen( cluster, x - 1, y - dy ) ) ||
+                     ( _isOpen( cluster, x + 1, y ) && !_isOpen( cluster, x + 1, y - dy ) ) )
+                {
+                    result = Point2D( x, y );
+                    return true;
+                }
+            }
+
+            // Corners may not be cut
+            if ( !_isOpen( cluster, x + dx, y ) || !_isOpen( cluster, x, y + dy ) )
+                return false;
+            x += dx;
+            y += dy;
+        }
+    }
+
+    //_jumpSearch---------------------------------------------------------------
+    bool TilePathfinder::_jumpSearch( SearchContext& context, const Cluster& cluster, const Point2D& start, const Point2D& goal, std::vector< Point2D >& points ) const
+    {
+        _beginCellSearch( context );
+        UInt32 serial = context.cellSerial;
+        UInt32 startLocal = ( start.y - cluster.origin.y ) * cluster.size.x + ( start.x - cluster.origin.x );
+        UInt32 goalLocal  = ( goal.y - cluster.origin.y ) * cluster.size.x + ( goal.x - cluster.origin.x );
+        context.cellCost[ startLocal ]   = 0;
+        context.cellParent[ startLocal ] = startLocal;
+        context.cellSeen[ startLocal ]   = serial;
+        OpenEntry entry = { _distance( start, goal ), 0, startLocal };
+        context.open.push_back( entry );
+
+        bool isFound = false;
+        while ( !context.open.empty() )
+        {
+            std::pop_heap( context.open.begin(), context.open.end() );
+            OpenEntry current = context.open.back();
+            context.open.pop_back();
+            if ( context.cellDone[ current.index ] == serial )
+                continue;
+            context.cellDone[ current.index ] = serial;
+            if ( current.index == goalLocal )
+            {
+                isFound = true;
+                break;
+            }
+
+            Int x = cluster.origin.x + current.index % cluster.size.x;
+            Int y = cluster.origin.y + current.index / cluster.size.x;
+
+            // Gather the directions worth searching: every open neighbour
+            // from the start, otherwise only those which the move from the
+            // parent does not reach more cheaply some other way
+            Int dirX[ 8 ], dirY[ 8 ];
+            UInt32 dirCount = 0;
+            if ( current.index == startLocal )
+            {
+                for ( UInt32 i = 0; i < 8; i++ )
+                {
+                    Int nx = x + NEIGHBOUR_X[ i ];
+                    Int ny = y + NEIGHBOUR_Y[ i ];
+                    if ( !_isOpen( cluster, nx, ny ) )
+                        continue;
+                    if ( i >= 4 && ( !_isOpen( cluster, nx, y ) || !_isOpen( cluster, x, ny ) ) )
+                        continue;
+                    dirX[ dirCount ] = NEIGHBOUR_X[ i ];
+                    dirY[ dirCount ] = NEIGHBOUR_Y[ i ];
+                    dirCount++;
+                }
+            }
+            else
+            {
+                UInt32 parent = context.cellParent[ current.index ];
+                Int dx = Sign( x - Int( cluster.origin.x + parent % cluster.size.x ) );
+                Int dy = Sign( y - Int( cluster.origin.y + parent / cluster.size.x ) );
+                if ( dx && dy )
+                {
+                    bool isOpenY = _isOpen( cluster, x, y + dy );
+                    bool isOpenX = _isOpen( cluster, x + dx, y );
+                    if ( isOpenY )
+                    {
+                        dirX[ dirCount ] = 0;   dirY[ dirCount ] = dy;  dirCount++;
+                    }
+                    if ( isOpenX )
+                    {
+                        dirX[ dirCount ] = dx;  dirY[ dirCount ] = 0;   dirCount++;
+                    }
+                    if ( isOpenX && isOpenY )
+                    {
+                        dirX[ dirCount ] = dx;  dirY[ dirCount ] = dy;  dirCount++;
+                    }
+                }
+                else if ( dx )
+                {
+                    bool isOpenNext  = _isOpen( cluster, x + dx, y );
+                    bool isOpenAbove = _isOpen( cluster, x, y - 1 );
+                    bool isOpenBelow = _isOpen( cluster, x, y + 1 );
+                    if ( isOpenNext )
+                    {
+                        dirX[ dirCount ] = dx;  dirY[ dirCount ] = 0;   dirCount++;
+                        if ( isOpenAbove )
+                        {
+                            dirX[ dirCount ] = dx;  dirY[ dirCount ] = -1;  dirCount++;
+                        }
+                        if ( isOpenBelow )
+                        {
+                            dirX[ dirCount ] = dx;  dirY[ dirCount ] = 1;   dirCount++;
+                        }
+                    }
+                    if ( isOpenAbove )
+                    {
+                        dirX[ dirCount ] = 0;   dirY[ dirCount ] = -1;  dirCount++;
+                    }
+                    if ( isOpenBelow )
+                    {
+                        dirX[ dirCount ] = 0;   dirY[ dirCount ] = 1;   dirCount++;
+                    }
+                }
+                else
+                {
+                    bool isOpenNext  = _isOpen( cluster, x, y + dy );
+                    bool isOpenLeft  = _isOpen( cluster, x - 1, y );
+                    bool isOpenRight = _isOpen( cluster, x + 1, y );
+                    if ( isOpenNext )
+                    {
+                        dirX[ dirCount ] = 0;   dirY[ dirCount ] = dy;  dirCount++;
+                        if ( isOpenLeft )
+                        {
+                            dirX[ dirCount ] = -1;  dirY[ dirCount ] = dy;  dirCount++;
+                        }
+                        if ( isOpenRight )
+                        {
+                            dirX[ dirCount ] = 1;   dirY[ dirCount ] = dy;  dirCount++;
+                        }
+                    }
+                    if ( isOpenLeft )
+                    {
+                        dirX[ dirCount ] = -1;  dirY[ dirCount ] = 0;   dirCount++;
+                    }
+                    if ( isOpenRight )
+                    {
+                        dirX[ dirCount ] = 1;   dirY[ dirCount ] = 0;   dirCount++;
+                    }
+                }
+            }
+
+            for ( UInt32 i = 0; i < dirCount; i++ )
+            {
+                Point2D jumpPoint;
+                if ( !_jump( cluster, x + dirX[ i ], y + dirY[ i ], dirX[ i ], dirY[ i ], goal, jumpPoint ) )
+                    continue;
+
+                UInt32 local = ( jumpPoint.y - cluster.origin.y ) * cluster.size.x + ( jumpPoint.x - cluster.origin.x );
+                UInt32 cost = current.cost + _distance( Point2D( x, y ), jumpPoint );
+                if ( context.cellDone[ local ] == serial ||
+                     ( context.cellSeen[ local ] == serial && context.cellCost[ local ] <= cost ) )
+                    continue;
+                context.cellSeen[ local ]   = serial;
+                context.cellCost[ local ]   = cost;
+                context.cellParent[ local ] = current.index;
+                OpenEntry next = { cost + _distance( jumpPoint, goal ), cost, local };
+                context.open.push_back( next );
+                std::push_heap( context.open.begin(), context.open.end() );
+            }
+        }
+
+        if ( !isFound )
+            return false;
+
+        // Walk back from the goal, then put the points in order
+        UInt32 first = points.size();
+        for ( UInt32 local = goalLocal; local != startLocal; local = context.cellParent[ local ] )
+            points.push_back( Point2D( cluster.origin.x + local % cluster.size.x, cluster.origin.y + local / cluster.size.x ) );
+        std::reverse( points.begin() + first, points.end() );
+        return true;
+    }
+
+    //_findPath-----------------------------------------------------------------
+    void TilePathfinder::_findPath( SearchContext& context, const PathRequest& request, PathResult& result ) const
+    {
+        result.isFound = false;
+        result.cost = 0;
+        result.waypoints.clear();
+
+        const Point2D& start = request.start;
+        const Point2D& goal = request.goal;
+        if ( IsSolid( start.x, start.y ) || IsSolid( goal.x, goal.y ) )
+            return;
+        if ( !mRegions.IsReachable( start, goal ) )
+            return;
+        if ( start.x == goal.x && start.y == goal.y )
+        {
+            result.isFound = true;
+            result.waypoints.push_back( start );
+            return;
+        }
+
+        // Join the start and goal to the entrances of their clusters
+        UInt32 startCluster = _getCluster( start );
+        UInt32 goalCluster = _getCluster( goal );
+        const Cluster& first = mClusters[ startCluster ];
+        const Cluster& last = mClusters[ goalCluster ];
+        UInt32 directCost = NO_PATH;
+        _flood( context, first, start );
+        context.startCosts.resize( first.nodeCells.size() );
+        for ( UInt32 i = 0; i < first.nodeCells.size(); i++ )
+        {
+            UInt32 cell = first.nodeCells[ i ];
+            UInt32 local = ( cell / mGridSize.x - first.origin.y ) * first.size.x + ( cell % mGridSize.x - first.origin.x );
+            context.startCosts[ i ] = ( context.cellSeen[ local ] == context.cellSerial ) ? context.cellCost[ local ] : NO_PATH;
+        }
+        if ( startCluster == goalCluster )
+        {
+            UInt32 local = ( goal.y - first.origin.y ) * first.size.x + ( goal.x - first.origin.x );
+            if ( context.cellSeen[ local ] == context.cellSerial )
+                directCost = context.cellCost[ local ];
+        }
+        _flood( context, last, goal );
+        context.goalCosts.resize( last.nodeCells.size() );
+        for ( UInt32 i = 0; i < last.nodeCells.size(); i++ )
+        {
+            UInt32 cell = last.nodeCells[ i ];
+            UInt32 local = ( cell / mGridSize.x - last.origin.y ) * last.size.x + ( cell % mGridSize.x - last.origin.x );
+            context.goalCosts[ i ] = ( context.cellSeen[ local ] == context.cellSerial ) ? context.cellCost[ local ] : NO_PATH;
+        }
+
+        // Search the graph of entrances, with the start and goal as two extra
+        // nodes at the end
+        UInt32 startNode = mNodes.size();
+        UInt32 goalNode = startNode + 1;
+        if ( ++context.nodeSerial == 0 )
+        {
+            std::fill( context.nodeSeen.begin(), context.nodeSeen.end(), 0 );
+            context.nodeSerial = 1;
+        }
+        UInt32 serial = context.nodeSerial;
+        context.open.clear();
+        context.nodeCost[ startNode ]   = 0;
+        context.nodeParent[ startNode ] = startNode;
+        context.nodeSeen[ startNode ]   = serial;
+        OpenEntry entry = { _distance( start, goal ), 0, startNode };
+        context.open.push_back( entry );
+
+        bool isFound = false;
+        while ( !context.open.empty() )
+        {
+            std::pop_heap( context.open.begin(), context.open.end() );
+            OpenEntry current = context.open.back();
+            context.open.pop_back();
+            if ( current.cost > context.nodeCost[ current.index ] )
+                continue;
+            if ( current.index == goalNode )
+            {
+                isFound = true;
+                break;
+            }
+
+            // Gather the edges of the node as pairs of node and cost
+            UInt32 edges[ 2 ][ 2 ];
+            UInt32 edgeCount = 0;
+            const UInt32* costs = 0;
+            UInt32 costCount = 0;
+            UInt32 costBase = 0;
+            if ( current.index == startNode )
+            {
+                costs = &context.startCosts[ 0 ];
+                costCount = context.startCosts.size();
+                costBase = mNodeBase[ startCluster ];
+                if ( directCost != NO_PATH )
+                {
+                    edges[ edgeCount ][ 0 ] = goalNode;
+                    edges[ edgeCount ][ 1 ] = directCost;
+                    edgeCount++;
+                }
+            }
+            else
+            {
+                UInt32 clusterIndex = mNodes[ current.index ].cluster;
+                const Cluster& cluster = mClusters[ clusterIndex ];
+                UInt32 local = current.index - mNodeBase[ clusterIndex ];
+                costCount = cluster.nodeCells.size();
+                costs = &cluster.costs[ local * costCount ];
+                costBase = mNodeBase[ clusterIndex ];
+
+                // The entrance on the other side of the border
+                UInt32 side = 0;
+                while ( local >= cluster.sideStart[ side + 1 ] )
+                    side++;
+                Int neighbour = _getNeighbour( clusterIndex, Side( side ) );
+                UInt32 facing = ( side + 2 ) % SIDE_COUNT;
+                edges[ edgeCount ][ 0 ] = mNodeBase[ neighbour ] + mClusters[ neighbour ].sideStart[ facing ] + local - cluster.sideStart[ side ];
+                edges[ edgeCount ][ 1 ] = STRAIGHT_COST;
+                edgeCount++;
+
+                if ( clusterIndex == goalCluster && context.goalCosts[ local ] != NO_PATH )
+                {
+                    edges[ edgeCount ][ 0 ] = goalNode;
+                    edges[ edgeCount ][ 1 ] = context.goalCosts[ local ];
+                    edgeCount++;
+                }
+            }
+
+            for ( UInt32 i = 0; i < costCount + edgeCount; i++ )
+            {
+                UInt32 node, cost;
+                if ( i < costCount )
+                {
+                    if ( costs[ i ] == NO_PATH || costBase + i == current.index )
+                        continue;
+                    node = costBase + i;
+                    cost = current.cost + costs[ i ];
+                }
+                else
+                {
+                    node = edges[ i - costCount ][ 0 ];
+                    cost = current.cost + edges[ i - costCount ][ 1 ];
+                }
+                if ( context.nodeSeen[ node ] == serial && context.nodeCost[ node ] <= cost )
+                    continue;
+                context.nodeSeen[ node ]   = serial;
+                context.nodeCost[ node ]   = cost;
+                context.nodeParent[ node ] = current.index;
+                UInt32 estimate = ( node == goalNode ) ? 0 :
+                                  Octile( mNodes[ node ].x - goal.x, mNodes[ node ].y - goal.y, STRAIGHT_COST, DIAGONAL_COST );
+                OpenEntry next = { cost + estimate, cost, node };
+                context.open.push_back( next );
+                std::push_heap( context.open.begin(), context.open.end() );
+            }
+        }
+        if ( !isFound )
+            return;
+
+        // Refine each step through a cluster into cells.  Steps between
+        // clusters are a single move across the border.
+        std::vector< Point2D >& points = context.points;
+        points.clear();
+        points.push_back( goal );
+        for ( UInt32 node = context.nodeParent[ goalNode ]; node != startNode; node = context.nodeParent[ node ] )
+            points.push_back( _getNodeCell( node ) );
+        points.push_back( start );
+        std::reverse( points.begin(), points.end() );
+
+        std::vector< Point2D > cells;
+        cells.push_back( start );
+        for ( UInt32 i = 1; i < points.size(); i++ )
+        {
+            const Point2D& from = cells.back();
+            const Point2D& to = points[ i ];
+            if ( from.x == to.x && from.y == to.y )
+                continue;
+            UInt32 fromCluster = _getCluster( from );
+            if ( fromCluster != _getCluster( to ) )
+                cells.push_back( to );
+            else if ( !_jumpSearch( context, mClusters[ fromCluster ], from, to, cells ) )
+                return;
+        }
+
+        // Keep only the cells where the direction changes
+        result.isFound = true;
+        result.waypoints.push_back( cells[ 0 ] );
+        for ( UInt32 i = 1; i < cells.size(); i++ )
+        {
+            result.cost += _distance( cells[ i - 1 ], cells[ i ] );
+            if ( i + 1 < cells.size() &&
+                 Sign( cells[ i ].x - cells[ i - 1 ].x ) == Sign( cells[ i + 1 ].x - cells[ i ].x ) &&
+                 Sign( cells[ i ].y - cells[ i - 1 ].y ) == Sign( cells[ i + 1 ].y - cells[ i ].y ) )
+                continue;
+            result.waypoints.push_back( cells[ i ] );
+        }
+    }
+
+    //Build---------------------------------------------------------------------
+    void TilePathfinder::Build( const TileSet& tileSet )
+    {
+        Clear();
+        Point2D gridSize = tileSet.GetMapGridSize();
+        if ( gridSize.x <= 0 || gridSize.y <= 0 )
+            return;
+
+        mGridSize = gridSize;
+        mClusterGridSize = Point2D( ( mGridSize.x + mClusterSize - 1 ) / mClusterSize,
+                                    ( mGridSize.y + mClusterSize - 1 ) / mClusterSize );
+        mSolid.assign( mGridSize.x * mGridSize.y, 0 );
+        for ( Int row = 0; row < mGridSize.y; row++ )
+        {
+            for ( Int col = 0; col < mGridSize.x; col++ )
+                mSolid[ row * mGridSize.x + col ] = ( tileSet.GetCell( col, row ).boundsCode & 15 ) == 15;
+        }
+
+        UInt32 clusterCount = mClusterGridSize.x * mClusterGridSize.y;
+        mClusters.resize( clusterCount );
+        for ( UInt32 cluster = 0; cluster < clusterCount; cluster++ )
+        {
+            Cluster& target = mClusters[ cluster ];
+            target.origin = Point2D( ( cluster % mClusterGridSize.x ) * mClusterSize, ( cluster / mClusterGridSize.x ) * mClusterSize );
+            target.size = Point2D( Math::IMin( mClusterSize, mGridSize.x - target.origin.x ),
+                                   Math::IMin( mClusterSize, mGridSize.y - target.origin.y ) );
+        }
+        mBorders[ BORDER_BOTTOM ].resize( clusterCount );
+        mBorders[ BORDER_RIGHT ].resize( clusterCount );
+        mDirty.assign( clusterCount, 0 );
+        _prepareContext( mContext );
+
+        for ( UInt32 cluster = 0; cluster < clusterCount; cluster++ )
+        {
+            _buildBorder( cluster, SIDE_BOTTOM );
+            _buildBorder( cluster, SIDE_RIGHT );
+        }
+        for ( UInt32 cluster = 0; cluster < clusterCount; cluster++ )
+            _buildNodes( cluster );
+        _indexNodes();
+        mRegions.Build( tileSet );
+    }
+
+    //Update--------------------------------------------------------------------
+    void TilePathfinder::Update( const TileSet& tileSet, Int x, Int y, Int w, Int h )
+    {
+        _waitForBatches();
+        Int startX = Math::IMax( x, 0 );
+        Int startY = Math::IMax( y, 0 );
+        Int endX   = Math::IMin( x + w, mGridSize.x );
+        Int endY   = Math::IMin( y + h, mGridSize.y );
+        for ( Int row = startY; row < endY; row++ )
+        {
+            for ( Int col = startX; col < endX; col++ )
+            {
+                UInt8 solid = ( tileSet.GetCell( col, row ).boundsCode & 15 ) == 15;
+                if ( mSolid[ row * mGridSize.x + col ] == solid )
+                    continue;
+                mSolid[ row * mGridSize.x + col ] = solid;
+                _markCell( col, row );
+            }
+        }
+        mRegions.Update( tileSet, x, y, w, h );
+    }
+
+    //ApplyEdits----------------------------------------------------------------
+    void TilePathfinder::ApplyEdits( const TileSet::CellEdit* edits, UInt32 count )
+    {
+        _waitForBatches();
+        for ( const TileSet::CellEdit* edit = edits; edit != edits + count; edit++ )
+        {
+            if ( edit->x < 0 || edit->y < 0 || edit->x >= mGridSize.x || edit->y >= mGridSize.y )
+                continue;
+            UInt8 solid = ( edit->cell.boundsCode & 15 ) == 15;
+            if ( mSolid[ edit->y * mGridSize.x + edit->x ] == solid )
+                continue;
+            mSolid[ edit->y * mGridSize.x + edit->x ] = solid;
+            _markCell( edit->x, edit->y );
+        }
+        mRegions.ApplyEdits( edits, count );
+    }
+
+    //Clear---------------------------------------------------------------------
+    void TilePathfinder::Clear()
+    {
+        while ( !mBatches.empty() )
+            ReleaseBatch( mBatches.back() );
+
+        std::vector< UInt8 >().swap( mSolid );
+        std::vector< Cluster >().swap( mClusters );
+        std::vector< TransitionArray >().swap( mBorders[ BORDER_BOTTOM ] );
+        std::vector< TransitionArray >().swap( mBorders[ BORDER_RIGHT ] );
+        mNodeBase.clear();
+        mNodes.clear();
+        mDirty.clear();
+        mDirtyClusters.clear();
+        mRegions.Clear();
+        mGridSize = Point2D( 0, 0 );
+        mClusterGridSize = Point2D( 0, 0 );
+    }
+
+    //IsSolid-------------------------------------------------------------------
+    bool TilePathfinder::IsSolid( Int x, Int y ) const
+    {
+        if ( x < 0 || y < 0 || x >= mGridSize.x || y >= mGridSize.y )
+            return true;
+        return mSolid[ y * mGridSize.x + x ] != 0;
+    }
+
+    //FindPath------------------------------------------------------------------
+    bool TilePathfinder::FindPath( const Point2D& start, const Point2D& goal, PathResult& result )
+    {
+        _repair();
+        PathRequest request = { start, goal };
+        _findPath( mContext, request, result );
+        return result.isFound;
+    }
+
+    //SubmitBatch---------------------------------------------------------------
+    TilePathfinder::PathBatch* TilePathfinder::SubmitBatch( const PathRequest* requests, UInt32 count )
+    {
+        // Edits wait for the running batches, so none are running while the
+        // clusters are repaired
+        _repair();
+
+        PathBatch* batch = new PathBatch();
+        batch->mRequests.assign( requests, requests + count );
+        batch->mResults.resize( count );
+        mBatches.push_back( batch );
+
+        // Split the requests across the workers, with enough in each job to
+        // be worth its working storage
+        static const UInt32 MIN_JOB_REQUESTS = 16;
+        WorkQueue* queue = WorkQueue::GetSingletonPtr();
+        UInt32 jobCount = queue ? Math::IMax( queue->GetThreadCount(), 1 ) : 1;
+        jobCount = Math::IClamp( ( count + MIN_JOB_REQUESTS - 1 ) / MIN_JOB_REQUESTS, 1, jobCount );
+        UInt32 first = 0;
+        for ( UInt32 i = 0; i < jobCount; i++ )
+        {
+            PathJob* job = new PathJob();
+            job->pathfinder = this;
+            job->batch      = batch;
+            job->first      = first;
+            job->count      = ( count - first ) / ( jobCount - i );
+            first          += job->count;
+            batch->mJobs.push_back( job );
+        }
+
+        // Without worker threads, the requests are answered right away
+        for ( UInt32 i = 0; i < jobCount; i++ )
+        {
+            if ( queue )
+                queue->Submit( batch->mJobs[ i ] );
+            else
+                batch->mJobs[ i ]->Execute();
+        }
+        return batch;
+    }
+
+    //ReleaseBatch--------------------------------------------------------------
+    void TilePathfinder::ReleaseBatch( PathBatch* batch )
+    {
+        BatchArray::iterator iter = std::find( mBatches.begin(), mBatches.end(), batch );
+        if ( iter == mBatches.end() )
+            return;
+        mBatches.erase( iter );
+        delete batch;
+    }
+
+} // namespace PGE
@@ -0,0 +1,523 @@
+/*! $Id$
+ *  @file   PgeTileRegionMap.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeTileRegionMap.h"
+#include "PgeMath.h"
+
+#include <algorithm>
+
+namespace PGE
+{
+    /** Find the root of a set, halving the path along the way */
+    static inline UInt32 FindRoot( std::vector< UInt32 >& parents, UInt32 index )
+    {
+        while ( parents[ index ] != index )
+        {
+            parents[ index ] = parents[ parents[ index ] ];
+            index = parents[ index ];
+        }
+        return index;
+    }
+
+    /** Join the sets of two pieces */
+    static inline void JoinSets( std::vector< UInt32 >& parents, UInt32 a, UInt32 b )
+    {
+        a = FindRoot( parents, a );
+        b = FindRoot( parents, b );
+        if ( a < b )
+            parents[ b ] = a;
+        else if ( b < a )
+            parents[ a ] = b;
+    }
+
+    //Constructor
+    TileRegionMap::TileRegionMap()
+        : mGridSize( 0, 0 ),
+          mChunkGridSize( 0, 0 ),
+          mRegionCount( 0 )
+    {
+    }
+
+    //_newPiece-----------------------------------------------------------------
+    UInt32 TileRegionMap::_newPiece( UInt32 chunk )
+    {
+        UInt32 piece;
+        if ( !mFreePieces.empty() )
+        {
+            piece = mFreePieces.back();
+            mFreePieces.pop_back();
+        }
+        else
+        {
+            piece = mPieceSizes.size();
+            mPieceSizes.push_back( 0 );
+            mPieceChunks.push_back( 0 );
+            mPieceRegions.push_back( 0 );
+            mPieceSlots.push_back( 0 );
+            mParents.push_back( 0 );
+        }
+        mPieceSizes[ piece ] = 0;
+        mPieceChunks[ piece ] = chunk;
+        mPieceRegions[ piece ] = 0;
+        return piece;
+    }
+
+    //_newRegion----------------------------------------------------------------
+    UInt32 TileRegionMap::_newRegion()
+    {
+        UInt32 region;
+        if ( !mFreeRegions.empty() )
+        {
+            region = mFreeRegions.back();
+            mFreeRegions.pop_back();
+        }
+        else
+        {
+            region = mRegionSizes.size();
+            mRegionSizes.push_back( 0 );
+            mRegionPieces.push_back( PieceList() );
+            mRegionFlags.push_back( 0 );
+        }
+        mRegionFlags[ region ] = 0;
+        mRegionCount++;
+        return region;
+    }
+
+    //_freeRegion---------------------------------------------------------------
+    void TileRegionMap::_freeRegion( UInt32 region )
+    {
+        PieceList().swap( mRegionPieces[ region ] );
+        mRegionSizes[ region ] = 0;
+        mRegionFlags[ region ] = REGION_FREE;
+        mFreeRegions.push_back( region );
+        mRegionCount--;
+    }
+
+    //_addPiece-----------------------------------------------------------------
+    void TileRegionMap::_addPiece( UInt32 region, UInt32 piece )
+    {
+        PieceList& pieces = mRegionPieces[ region ];
+        mPieceRegions[ piece ] = region;
+        mPieceSlots[ piece ] = pieces.size();
+        pieces.push_back( piece );
+        mRegionSizes[ region ] += mPieceSizes[ piece ];
+    }
+
+    //_removePiece--------------------------------------------------------------
+    void TileRegionMap::_removePiece( UInt32 piece )
+    {
+        UInt32 region = mPieceRegions[ piece ];
+        if ( !region )
+            return;
+
+        // Move the last piece of the region into the slot
+        PieceList& pieces = mRegionPieces[ region ];
+        UInt32 slot = mPieceSlots[ piece ];
+        pieces[ slot ] = pieces.back();
+        mPieceSlots[ pieces[ slot ] ] = slot;
+        pieces.pop_back();
+        mRegionSizes[ region ] -= mPieceSizes[ piece ];
+        mPieceRegions[ piece ] = 0;
+    }
+
+    //_joinRegions--------------------------------------------------------------
+    UInt32 TileRegionMap::_joinRegions( UInt32 a, UInt32 b )
+    {
+        if ( mRegionPieces[ a ].size() < mRegionPieces[ b ].size() )
+            std::swap( a, b );
+
+        PieceList& pieces = mRegionPieces[ a ];
+        const PieceList& oldPieces = mRegionPieces[ b ];
+        for ( UInt32 i = 0; i < oldPieces.size(); i++ )
+        {
+            mPieceRegions[ oldPieces[ i ] ] = a;
+            mPieceSlots[ oldPieces[ i ] ] = pieces.size();
+            pieces.push_back( oldPieces[ i ] );
+        }
+        mRegionSizes[ a ] += mRegionSizes[ b ];
+        _freeRegion( b );
+        return a;
+    }
+
+    //_labelChunk---------------------------------------------------------------
+    void TileRegionMap::_labelChunk( UInt32 chunk, PieceList& newPieces )
+    {
+        Int originX = ( chunk % mChunkGridSize.x ) * TileSet::CHUNK_SIZE;
+        Int originY = ( chunk / mChunkGridSize.x ) * TileSet::CHUNK_SIZE;
+        Int endX = Math::IMin( originX + TileSet::CHUNK_SIZE, mGridSize.x );
+        Int endY = Math::IMin( originY + TileSet::CHUNK_SIZE, mGridSize.y );
+        for ( Int y = originY; y < endY; y++ )
+        {
+            for ( Int x = originX; x < endX; x++ )
+                mPieces[ y * mGridSize.x + x ] = 0;
+        }
+
+        // Flood each piece from its first cell, through the horizontal and
+        // vertical neighbours inside the chunk
+        PieceList& pieces = mChunkPieces[ chunk ];
+        pieces.clear();
+        std::vector< UInt32 > stack;
+        for ( Int y = originY; y < endY; y++ )
+        {
+            for ( Int x = originX; x < endX; x++ )
+            {
+                UInt32 seed = y * mGridSize.x + x;
+                if ( !mOpen[ seed ] || mPieces[ seed ] )
+                    continue;
+
+                UInt32 index = _newPiece( chunk );
+                pieces.push_back( index );
+                UInt16 piece = pieces.size();
+                UInt32 size = 0;
+                mPieces[ seed ] = piece;
+                stack.push_back( seed );
+                while ( !stack.empty() )
+                {
+                    UInt32 cell = stack.back();
+                    stack.pop_back();
+                    size++;
+
+                    Int cellX = cell % mGridSize.x;
+                    Int cellY = cell / mGridSize.x;
+                    UInt32 next[ 4 ];
+                    UInt32 nextCount = 0;
+                    if ( cellX > originX )
+                        next[ nextCount++ ] = cell - 1;
+                    if ( cellX < endX - 1 )
+                        next[ nextCount++ ] = cell + 1;
+                    if ( cellY > originY )
+                        next[ nextCount++ ] = cell - mGridSize.x;
+                    if ( cellY < endY - 1 )
+                        next[ nextCount++ ] = cell + mGridSize.x;
+                    for ( UInt32 i = 0; i < nextCount; i++ )
+                    {
+                        if ( mOpen[ next[ i ] ] && !mPieces[ next[ i ] ] )
+                        {
+                            mPieces[ next[ i ] ] = piece;
+                            stack.push_back( next[ i ] );
+                        }
+                    }
+                }
+                mPieceSizes[ index ] = size;
+                newPieces.push_back( index );
+            }
+        }
+    }
+
+    //_getContacts--------------------------------------------------------------
+    void TileRegionMap::_getContacts( UInt32 chunk, std::vector< UInt32 >& contacts ) const
+    {
+        Int chunkX = chunk % mChunkGridSize.x;
+        Int chunkY = chunk / mChunkGridSize.x;
+        Int originX = chunkX * TileSet::CHUNK_SIZE;
+        Int originY = chunkY * TileSet::CHUNK_SIZE;
+        Int endX = Math::IMin( originX + TileSet::CHUNK_SIZE, mGridSize.x );
+        Int endY = Math::IMin( originY + TileSet::CHUNK_SIZE, mGridSize.y );
+        for ( Int y = originY; y < endY; y++ )
+        {
+            UInt32 left = y * mGridSize.x + originX;
+            UInt32 right = y * mGridSize.x + endX - 1;
+            if ( chunkX > 0 && mPieces[ left ] && mPieces[ left - 1 ] )
+                contacts.push_back( left );
+            if ( chunkX < mChunkGridSize.x - 1 && mPieces[ right ] && mPieces[ right + 1 ] )
+                contacts.push_back( right );
+        }
+        for ( Int x = originX; x < endX; x++ )
+        {
+            UInt32 top = originY * mGridSize.x + x;
+            UInt32 bottom = ( endY - 1 ) * mGridSize.x + x;
+            if ( chunkY > 0 && mPieces[ top ] && mPieces[ top - mGridSize.x ] )
+                contacts.push_back( top );
+            if ( chunkY < mChunkGridSize.y - 1 && mPieces[ bottom ] && mPieces[ bottom + mGridSize.x ] )
+                contacts.push_back( bottom );
+        }
+    }
+
+    //_joinAcross---------------------------------------------------------------
+    void TileRegionMap::_joinAcross( UInt32 chunk, UInt32 cell, UInt32 nextChunk, UInt32 nextCell, PieceLinkArray& links )
+    {
+        if ( !mPieces[ cell ] || !mPieces[ nextCell ] )
+            return;
+        UInt32 piece = _getPiece( chunk, cell );
+        if ( mPieceRegions[ piece ] )
+            return;
+
+        // A piece which keeps its region links the set to that region
+        UInt32 nextPiece = _getPiece( nextChunk, nextCell );
+        if ( mPieceRegions[ nextPiece ] )
+            links.push_back( std::make_pair( piece, nextPiece ) );
+        else
+            JoinSets( mParents, piece, nextPiece );
+    }
+
+    //_repair-------------------------------------------------------------------
+    void TileRegionMap::_repair()
+    {
+        // Label the dirty chunks again, noting the regions which had pieces
+        // in them.  Closing cells may split those regions, unless the cells
+        // where each old piece touched the chunks around it are still joined
+        // inside the chunk.  That can only be told while the chunks around
+        // it keep their pieces.
+        std::vector< UInt32 > touched;
+        PieceList joining;
+        std::vector< UInt32 > regions;
+        std::vector< UInt32 > contacts;
+        std::vector< UInt16 > oldPieces;
+        std::vector< UInt16 > newPieces;
+        for ( UInt32 i = 0; i < mDirtyChunks.size(); i++ )
+        {
+            UInt32 chunk = mDirtyChunks[ i ];
+            Int chunkX = chunk % mChunkGridSize.x;
+            Int chunkY = chunk / mChunkGridSize.x;
+            bool isClosed = ( mDirty[ chunk ] & CHUNK_CLOSED ) != 0;
+            bool canCheck = isClosed &&
+                            ( chunkX == 0 || !mDirty[ chunk - 1 ] ) &&
+                            ( chunkX == mChunkGridSize.x - 1 || !mDirty[ chunk + 1 ] ) &&
+                            ( chunkY == 0 || !mDirty[ chunk - mChunkGridSize.x ] ) &&
+                            ( chunkY == mChunkGridSize.y - 1 || !mDirty[ chunk + mChunkGridSize.x ] );
+            contacts.clear();
+            oldPieces.clear();
+            if ( canCheck )
+            {
+                _getContacts( chunk, contacts );
+                for ( UInt32 j = 0; j < contacts.size(); j++ )
+                    oldPieces.push_back( mPieces[ contacts[ j ] ] );
+            }
+
+            PieceList& pieces = mChunkPieces[ chunk ];
+            regions.clear();
+            newPieces.assign( pieces.size() + 1, 0 );
+            for ( UInt32 j = 0; j < pieces.size(); j++ )
+            {
+                UInt32 region = mPieceRegions[ pieces[ j ] ];
+                regions.push_back( region );
+                if ( !( mRegionFlags[ region ] & REGION_TOUCHED ) )
+                {
+                    mRegionFlags[ region ] |= REGION_TOUCHED;
+                    touched.push_back( region );
+                }
+                _removePiece( pieces[ j ] );
+                mFreePieces.push_back( pieces[ j ] );
+            }
+            _labelChunk( chunk, joining );
+
+            bool isSplit = isClosed && !canCheck;
+            for ( UInt32 j = 0; j < contacts.size() && !isSplit; j++ )
+            {
+                UInt16 piece = mPieces[ contacts[ j ] ];
+                if ( !piece || ( newPieces[ oldPieces[ j ] ] && newPieces[ oldPieces[ j ] ] != piece ) )
+                    isSplit = true;
+                newPieces[ oldPieces[ j ] ] = piece;
+            }
+            if ( isSplit )
+            {
+                for ( UInt32 j = 0; j < regions.size(); j++ )
+                    mRegionFlags[ regions[ j ] ] |= REGION_SPLIT;
+            }
+        }
+
+        // Take the pieces left in the regions which may have been split, so
+        // that they are joined again along with the new pieces
+        for ( UInt32 i = 0; i < touched.size(); i++ )
+        {
+            UInt32 region = touched[ i ];
+            if ( !( mRegionFlags[ region ] & REGION_SPLIT ) )
+                continue;
+            const PieceList& pieces = mRegionPieces[ region ];
+            for ( UInt32 j = 0; j < pieces.size(); j++ )
+            {
+                mPieceRegions[ pieces[ j ] ] = 0;
+                joining.push_back( pieces[ j ] );
+            }
+            _freeRegion( region );
+        }
+
+        // Start a set for each piece, and join the sets across the borders of
+        // the chunks holding them.  While joining, the slot of a piece holds
+        // its position in the list.
+        std::vector< UInt32 > chunks;
+        for ( UInt32 i = 0; i < joining.size(); i++ )
+        {
+            UInt32 piece = joining[ i ];
+            mParents[ piece ] = piece;
+            mPieceSlots[ piece ] = i;
+            UInt32 chunk = mPieceChunks[ piece ];
+            if ( !( mDirty[ chunk ] & CHUNK_SCANNED ) )
+            {
+                mDirty[ chunk ] |= CHUNK_SCANNED;
+                chunks.push_back( chunk );
+            }
+        }
+        PieceLinkArray links;
+        for ( UInt32 i = 0; i < chunks.size(); i++ )
+        {
+            UInt32 chunk = chunks[ i ];
+            Int chunkX = chunk % mChunkGridSize.x;
+            Int chunkY = chunk / mChunkGridSize.x;
+            Int originX = chunkX * TileSet::CHUNK_SIZE;
+            Int originY = chunkY * TileSet::CHUNK_SIZE;
+            Int endX = Math::IMin( originX + TileSet::CHUNK_SIZE, mGridSize.x );
+            Int endY = Math::IMin( originY + TileSet::CHUNK_SIZE, mGridSize.y );
+            for ( Int y = originY; y < endY; y++ )
+            {
+                UInt32 left = y * mGridSize.x + originX;
+                UInt32 right = y * mGridSize.x + endX - 1;
+                if ( chunkX > 0 )
+                    _joinAcross( chunk, left, chunk - 1, left - 1, links );
+                if ( chunkX < mChunkGridSize.x - 1 )
+                    _joinAcross( chunk, right, chunk + 1, right + 1, links );
+            }
+            for ( Int x = originX; x < endX; x++ )
+            {
+                UInt32 top = originY * mGridSize.x + x;
+                UInt32 bottom = ( endY - 1 ) * mGridSize.x + x;
+                if ( chunkY > 0 )
+                    _joinAcross( chunk, top, chunk - mChunkGridSize.x, top - mGridSize.x, links );
+                if ( chunkY < mChunkGridSize.y - 1 )
+                    _joinAcross( chunk, bottom, chunk + mChunkGridSize.x, bottom + mGridSize.x, links );
+            }
+        }
+
+        // Each set goes into the region of a piece it links to, joining the
+        // regions of the other pieces it links to.  Sets without links become
+        // new regions.
+        const UInt32 NO_PIECE = ~0u;
+        std::vector< UInt32 > targets( joining.size(), NO_PIECE );
+        for ( UInt32 i = 0; i < links.size(); i++ )
+        {
+            UInt32 root = mPieceSlots[ FindRoot( mParents, links[ i ].first ) ];
+            UInt32 piece = links[ i ].second;
+            if ( targets[ root ] == NO_PIECE )
+                targets[ root ] = piece;
+            else if ( mPieceRegions[ targets[ root ] ] != mPieceRegions[ piece ] )
+                _joinRegions( mPieceRegions[ targets[ root ] ], mPieceRegions[ piece ] );
+        }
+        std::vector< UInt32 > roots( joining.size() );
+        for ( UInt32 i = 0; i < joining.size(); i++ )
+            roots[ i ] = mPieceSlots[ FindRoot( mParents, joining[ i ] ) ];
+        for ( UInt32 i = 0; i < joining.size(); i++ )
+        {
+            if ( roots[ i ] == i )
+                targets[ i ] = ( targets[ i ] == NO_PIECE ) ? _newRegion() : mPieceRegions[ targets[ i ] ];
+        }
+        for ( UInt32 i = 0; i < joining.size(); i++ )
+            _addPiece( targets[ roots[ i ] ], joining[ i ] );
+
+        // Release the regions whose cells were all in the dirty chunks
+        for ( UInt32 i = 0; i < touched.size(); i++ )
+        {
+            UInt32 region = touched[ i ];
+            if ( !( mRegionFlags[ region ] & REGION_FREE ) && mRegionPieces[ region ].empty() )
+                _freeRegion( region );
+            mRegionFlags[ region ] &= REGION_FREE;
+        }
+        for ( UInt32 i = 0; i < mDirtyChunks.size(); i++ )
+            mDirty[ mDirtyChunks[ i ] ] = 0;
+        for ( UInt32 i = 0; i < chunks.size(); i++ )
+            mDirty[ chunks[ i ] ] = 0;
+        mDirtyChunks.clear();
+    }
+
+    //_setCell------------------------------------------------------------------
+    void TileRegionMap::_setCell( Int x, Int y, SInt32 boundsCode )
+    {
+        UInt8 isOpen = ( boundsCode & 15 ) != 15;
+        UInt32 cell = y * mGridSize.x + x;
+        if ( mOpen[ cell ] == isOpen )
+            return;
+        mOpen[ cell ] = isOpen;
+
+        UInt32 chunk = _getChunk( x, y );
+        if ( !mDirty[ chunk ] )
+            mDirtyChunks.push_back( chunk );
+        mDirty[ chunk ] |= CHUNK_DIRTY;
+        if ( !isOpen )
+            mDirty[ chunk ] |= CHUNK_CLOSED;
+    }
+
+    //Build---------------------------------------------------------------------
+    void TileRegionMap::Build( const TileSet& tileSet )
+    {
+        Clear();
+        Point2D gridSize = tileSet.GetMapGridSize();
+        if ( gridSize.x <= 0 || gridSize.y <= 0 )
+            return;
+
+        mGridSize = gridSize;
+        mChunkGridSize = Point2D( ( mGridSize.x + TileSet::CHUNK_SIZE - 1 ) / TileSet::CHUNK_SIZE,
+                                  ( mGridSize.y + TileSet::CHUNK_SIZE - 1 ) / TileSet::CHUNK_SIZE );
+        mOpen.resize( mGridSize.x * mGridSize.y );
+        mPieces.assign( mGridSize.x * mGridSize.y, 0 );
+        for ( Int row = 0; row < mGridSize.y; row++ )
+        {
+            for ( Int col = 0; col < mGridSize.x; col++ )
+                mOpen[ row * mGridSize.x + col ] = ( tileSet.GetCell( col, row ).boundsCode & 15 ) != 15;
+        }
+
+        UInt32 chunkCount = mChunkGridSize.x * mChunkGridSize.y;
+        mChunkPieces.resize( chunkCount );
+        mRegionSizes.assign( 1, 0 );
+        mRegionPieces.resize( 1 );
+        mRegionFlags.assign( 1, 0 );
+        mDirty.assign( chunkCount, CHUNK_DIRTY );
+        for ( UInt32 chunk = 0; chunk < chunkCount; chunk++ )
+            mDirtyChunks.push_back( chunk );
+        _repair();
+    }
+
+    //Update--------------------------------------------------------------------
+    void TileRegionMap::Update( const TileSet& tileSet, Int x, Int y, Int w, Int h )
+    {
+        Int startX = Math::IMax( x, 0 );
+        Int startY = Math::IMax( y, 0 );
+        Int endX   = Math::IMin( x + w, mGridSize.x );
+        Int endY   = Math::IMin( y + h, mGridSize.y );
+        for ( Int row = startY; row < endY; row++ )
+        {
+            for ( Int col = startX; col < endX; col++ )
+                _setCell( col, row, tileSet.GetCell( col, row ).boundsCode );
+        }
+        if ( !mDirtyChunks.empty() )
+            _repair();
+    }
+
+    //ApplyEdits----------------------------------------------------------------
+    void TileRegionMap::ApplyEdits( const TileSet::CellEdit* edits, UInt32 count )
+    {
+        for ( const TileSet::CellEdit* edit = edits; edit != edits + count; edit++ )
+        {
+            if ( edit->x >= 0 && edit->y >= 0 && edit->x < mGridSize.x && edit->y < mGridSize.y )
+                _setCell( edit->x, edit->y, edit->cell.boundsCode );
+        }
+        if ( !mDirtyChunks.empty() )
+            _repair();
+    }
+
+    //Clear---------------------------------------------------------------------
+    void TileRegionMap::Clear()
+    {
+        std::vector< UInt8 >().swap( mOpen );
+        std::vector< UInt16 >().swap( mPieces );
+        std::vector< PieceList >().swap( mChunkPieces );
+        std::vector< UInt32 >().swap( mPieceSizes );
+        std::vector< UInt32 >().swap( mPieceChunks );
+        std::vector< UInt32 >().swap( mPieceRegions );
+        std::vector< UInt32 >().swap( mPieceSlots );
+        std::vector< UInt32 >().swap( mParents );
+        mFreePieces.clear();
+        std::vector< PieceList >().swap( mRegionPieces );
+        mRegionSizes.clear();
+        mRegionFlags.clear();
+        mFreeRegions.clear();
+        mRegionCount = 0;
+        mDirty.clear();
+        mDirtyChunks.clear();
+        mGridSize = Point2D( 0, 0 );
+        mChunkGridSize = Point2D( 0, 0 );
+    }
+
+} // namespace PGE
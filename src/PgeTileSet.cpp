@@ -12,7 +12,16 @@
 #include "PgeArchiveFile.h"
 #include "PgeArchiveManager.h"
 #include "PgeXmlArchiveFile.h"
+#include "PgeTileMapFile.h"
+#include "PgeTileMapPager.h"
+#include "PgeTileLightMap.h"
+#include "PgeTileFogOfWar.h"
 
+#include <algorithm>
+#include <sstream>
+
+#include "cmd/LogFileManager.h"
+using cmd::LogFileManager;
 
 namespace PGE
 {
@@ -23,7 +32,10 @@ namespace PGE
 
     //Constructor
     TileSet::Sequence::Sequence( Real fps )
-        : frameRate( fps )
+        : frameRate( fps ),
+          curFrame( 0 ),
+          frameTime( 0 ),
+          index( 0 )
     {
         SetFrameRate( frameRate );
     }
@@ -86,37 +98,234 @@ namespace PGE
     //Prepare
     void TileSet::Sequence::Prepare( Real32 elapsedMS )
     {
-        frameTime += elapsedMS;
+        frameTime += elapsedMS * 0.001f;
         Int frameOffset = frameTime / secondsPerFrame;
         frameTime = Math::Mod( frameTime, secondsPerFrame );
         curFrame  = Math::IModRange( curFrame + frameOffset, 0, mSequence.size() );
         //curFrame = Math::ModRange( curFrame + 1, 0, mSequence.size() );
     }
 
-    //Render
-    void TileSet::Sequence::Render( UInt32 displayListBase )
+    //Restart
+    void TileSet::Sequence::Restart()
+    {
+        curFrame    = 0;
+        frameTime   = 0;
+    }
+
+    //AdvanceFrames
+    void TileSet::Sequence::AdvanceFrames( Int count )
+    {
+        if ( !mSequence.empty() )
+            curFrame = Math::IModRange( curFrame + count, 0, mSequence.size() );
+    }
+
+    //GetCurrentTile
+    Int TileSet::Sequence::GetCurrentTile() const
     {
+        if ( mSequence.empty() )
+            return 0;
         assert( curFrame >= 0 && curFrame < mSequence.size() );
 
         // Index of the tile used for the current frame:
-        Int frameTileIndex = mSequence[ curFrame ].tileNumber;
+        return mSequence[ curFrame ].tileNumber;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // class TileSet::ChunkBuildJob
+    ////////////////////////////////////////////////////////////////////////////
+
+    /** Orders animated cells by the index of their sequence */
+    struct AnimatedCellLess
+    {
+        template < typename Cell >
+        bool operator()( const Cell& a, const Cell& b ) const   { return a.seqIndex < b.seqIndex; }
+        template < typename Cell >
+        bool operator()( const Cell& a, UInt32 b ) const        { return a.seqIndex < b; }
+        template < typename Cell >
+        bool operator()( UInt32 a, const Cell& b ) const        { return a < b.seqIndex; }
+    };
+
+    //Execute
+    void TileSet::ChunkBuildJob::Execute()
+    {
+        geometry.Clear();
+        geometry.Reserve( tiles.size() );
+        animated.clear();
+        quadCells.clear();
+        quadCells.reserve( tiles.size() );
+
+        // Only the stored cells are visited; the gaps between the spans are
+        // empty, so there is nothing to draw for them.
+        const Int texCoordCount = texCoords->size();
+        const UInt32 exploredWords = ( size.x + 31 ) / 32;
+        for ( Int y = 0; y < size.y; y++ )
+        {
+            for ( UInt32 spanIndex = rowSpans[ y ]; spanIndex < rowSpans[ y + 1 ]; spanIndex++ )
+            {
+                const TileSpan& span = spans[ spanIndex ];
+                std::vector< SInt16 >::const_iterator tileIter = tiles.begin() + span.firstCell;
+                for ( Int x = span.start; x < Int( span.start + span.count ); x++, tileIter++ )
+                {
+                    // Cells hidden by the fog of war are not drawn
+                    if ( !explored.empty() && !( ( explored[ y * exploredWords + x / 32 ] >> ( x % 32 ) ) & 1 ) )
+                        continue;
+
+                    Int tileIndex = *tileIter;
+                    if ( tileIndex < 0 )
+                    {
+                        // Negative values indicate a sequence.  The cell gets
+                        // an empty quad, which is filled in with the current
+                        // frame once the geometry is collected.
+                        AnimatedCell cell;
+                        cell.x = x;
+                        cell.y = y;
+                        cell.seqIndex = Math::IAbs( tileIndex );
+                        cell.quad = geometry.GetQuadCount();
+                        animated.push_back( cell );
+                        geometry.AddQuad( x * tileSize.x, y * tileSize.y, 0, 0, TileTexCoords() );
+                        quadCells.push_back( y * CHUNK_SIZE + x );
+                    }
+                    else if ( tileIndex > 0 && tileIndex < texCoordCount )
+                    {
+                        // (Tile 0 is empty, so there is nothing to draw for it)
+                        geometry.AddQuad( x * tileSize.x, y * tileSize.y, tileSize.x, tileSize.y, ( *texCoords )[ tileIndex ] );
+                        quadCells.push_back( y * CHUNK_SIZE + x );
+                    }
+                }
+            }
+        }
+
+        // Group the cells by sequence, so the cells of one sequence can be
+        // found quickly when it changes frames
+        std::stable_sort( animated.begin(), animated.end(), AnimatedCellLess() );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // struct TileSet::TileChunk
+    ////////////////////////////////////////////////////////////////////////////
 
-        // Render the tile:
-        glCallList( displayListBase + frameTileIndex );
+    //Constructor
+    TileSet::TileChunk::TileChunk()
+        : index( 0 ),
+          isDirty( true ),
+          isBuilt( false ),
+          isResident( false ),
+          lastFrame( 0 ),
+          pageSerial( 0 ),
+          lightSerial( 0 ),
+          fogSerial( 0 ),
+          job( 0 )
+    {
     }
 
+    //Copy constructor
+    TileSet::TileChunk::TileChunk( const TileSet::TileChunk& src )
+        : job( 0 )
+    {
+        *this = src;
+    }
+
+    //operator=
+    TileSet::TileChunk& TileSet::TileChunk::operator=( const TileSet::TileChunk& src )
+    {
+        assert( job == 0 );
+        index       = src.index;
+        origin      = src.origin;
+        size        = src.size;
+        geometry    = src.geometry;
+        animated    = src.animated;
+        quadCells   = src.quadCells;
+        isDirty     = src.isDirty || ( src.job != 0 );
+        isBuilt     = src.isBuilt;
+        isResident  = src.isResident;
+        lastFrame   = src.lastFrame;
+        pageSerial  = src.pageSerial;
+        lightSerial = src.lightSerial;
+        fogSerial   = src.fogSerial;
+        return *this;
+    }
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // struct TileSet::TileCellArray
+    ////////////////////////////////////////////////////////////////////////////
+
+    //Append
+    bool TileSet::TileCellArray::Append( const TileMapItem& item )
+    {
+        tiles.push_back( 0 );
+        codes.push_back( 0 );
+        return Set( tiles.size() - 1, item );
+    }
+
+    //Set
+    bool TileSet::TileCellArray::Set( UInt32 index, const TileMapItem& item )
+    {
+        SInt32 tile     = Math::IClamp( item.tileIndex, -32768, 32767 );
+        SInt32 bounds   = Math::IClamp( item.boundsCode, 0, MAX_CELL_CODE );
+        SInt32 mapCode  = Math::IClamp( item.mapCode, 0, MAX_CELL_CODE );
+        tiles[ index ] = SInt16( tile );
+        codes[ index ] = UInt16( bounds | ( mapCode << 8 ) );
+        return ( tile == item.tileIndex && bounds == item.boundsCode && mapCode == item.mapCode );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // struct TileSet::TileCellList
+    ////////////////////////////////////////////////////////////////////////////
+
+    //GetItem
+    TileSet::TileMapItem TileSet::TileCellList::GetItem( UInt32 index ) const
+    {
+        TileMapItem item;
+        item.tileIndex  = tiles[ index ];
+        item.boundsCode = codes[ index ] & MAX_CELL_CODE;
+        item.mapCode    = codes[ index ] >> 8;
+        return item;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // struct TileSet::RenderCache
+    ////////////////////////////////////////////////////////////////////////////
+
+    //Constructor
+    TileSet::RenderCache::RenderCache()
+        : isEnabled( false ),
+          margin( 256 ),
+          texture( 0 ),
+          size( 0, 0 ),
+          origin( 0, 0 ),
+          area( 0, 0 ),
+          isValid( false )
+    {
+    }
 
     ////////////////////////////////////////////////////////////////////////////
     // class TileSet
     ////////////////////////////////////////////////////////////////////////////
 
+    const UInt32 TileSet::CHUNK_SIZE            = 32;
+    const UInt32 TileSet::MAX_RESIDENT_CHUNKS   = 256;
+    const SInt32 TileSet::MAX_CELL_CODE         = 255;
+
     //Constructor
     TileSet::TileSet()
         : mIdentifier( "" ),
           mImageName( "" ),
           mTileCount( 0 ),
           mOverlap( 0 ),
-          mDisplayListBase( 0 )
+          mTextureItem( 0 ),
+          mIsTexturePending( false ),
+          mSpanList( 0 ),
+          mRowSpanList( 0 ),
+          mRowSpanEndList( 0 ),
+          mSourceRecord( 0 ),
+          mMapIndex( 0 ),
+          mIsSharedMap( false ),
+          mSequenceTime( 0 ),
+          mFrameCount( 0 ),
+          mLightMap( 0 ),
+          mFogOfWar( 0 ),
+          mFogTeam( 0 )
     {
     }
 
@@ -126,11 +335,46 @@ namespace PGE
           mImageName( "" ),
           mTileCount( 0 ),
           mOverlap( 0 ),
-          mDisplayListBase( 0 )
+          mTextureItem( 0 ),
+          mIsTexturePending( false ),
+          mSpanList( 0 ),
+          mRowSpanList( 0 ),
+          mRowSpanEndList( 0 ),
+          mSourceRecord( 0 ),
+          mMapIndex( 0 ),
+          mIsSharedMap( false ),
+          mSequenceTime( 0 ),
+          mFrameCount( 0 ),
+          mLightMap( 0 ),
+          mFogOfWar( 0 ),
+          mFogTeam( 0 )
     {
         ReadTileSet( tilesetNode, baseDir, mapIndex );
     }
 
+    //Copy constructor
+    TileSet::TileSet( const TileSet& src )
+        : mTileCount( 0 ),
+          mOverlap( 0 ),
+          mTextureItem( 0 ),
+          mIsTexturePending( false ),
+          mSpanList( 0 ),
+          mRowSpanList( 0 ),
+          mRowSpanEndList( 0 ),
+          mSourceRecord( 0 ),
+          mMapIndex( 0 ),
+          mIsSharedMap( false ),
+          mSequenceTime( 0 ),
+          mFrameCount( 0 ),
+          mLightMap( 0 ),
+          mFogOfWar( 0 ),
+          mFogTeam( 0 )
+    {
+        // The run pointers must refer to the copy's own arrays, so this can't
+        // be a member-wise copy
+        *this = src;
+    }
+
     //Destructor
     TileSet::~TileSet()
     {
@@ -140,30 +384,47 @@ namespace PGE
     //_generateTiles
     bool TileSet::_generateTiles()
     {
-        // Make sure the texture is loaded
-        TextureManager::GetSingleton().LoadImage( mImageName, GL_NEAREST, GL_NEAREST, false, true );
-        TextureItem* textureItem = TextureManager::GetSingleton().GetTextureItemPtr( mImageName );
+        // Make sure the texture is loaded.  Tilesets which share an image
+        // share the texture, so it is only decoded the first time.
+        // When the manager loads in the background, the tiles are drawn with
+        // its placeholder until the texture arrives.
+        TextureManager& manager = TextureManager::GetSingleton();
+        TextureItem* textureItem = manager.GetTextureItemPtr( mImageName );
+        if ( !textureItem || ( !textureItem->IsLoaded() && !textureItem->IsPending() ) )
+        {
+            if ( manager.IsAsyncLoading() )
+                manager.LoadImageAsync( mImageName, GL_NEAREST, GL_NEAREST, false, true );
+            else
+                manager.LoadImage( mImageName, GL_NEAREST, GL_NEAREST, false, true );
+            textureItem = manager.GetTextureItemPtr( mImageName );
+        }
         if ( !textureItem )
             return false;
+        mTextureName = mImageName;
+        _setTextureItem( textureItem );
+        mIsTexturePending = textureItem->IsPending();
+        _generateTexCoords();
 
-        // Generate the display list
-        // NOTE: The tile created at index 0 is empty, and is essentially a 100% transparent tile.
-        mDisplayListBase = glGenLists( mTileCount );
-        if ( mDisplayListBase == 0 )
-            return false;
+        return true;
+    }
 
-        // Generate tile 0:
-        glNewList( mDisplayListBase, GL_COMPILE );
-        glTranslatef( mTileSize.x, 0, 0 );
-        glEndList();
+    //_generateTexCoords
+    void TileSet::_generateTexCoords() const
+    {
+        // NOTE: The tile at index 0 is empty, and is essentially a 100% transparent
+        //       tile.  It is never drawn, so its coordinates are left at zero.
+        mTileTexCoords.clear();
+        mTileTexCoords.resize( mGridSize.x * mGridSize.y + 1 );
+        if ( !mTextureItem || !mTextureItem->IsLoaded() )
+            return;
 
         // Ratios for the texture coordinates
-        Real texCoordMaxX = ( mTileSize.x * mGridSize.x ) / Real( textureItem->GetWidth() );
-        Real texCoordMaxY = ( mTileSize.y * mGridSize.y ) / Real( textureItem->GetHeight() );
+        Real texCoordMaxX = ( mTileSize.x * mGridSize.x ) / Real( mTextureItem->GetWidth() );
+        Real texCoordMaxY = ( mTileSize.y * mGridSize.y ) / Real( mTextureItem->GetHeight() );
         Real texCoordXDiff = texCoordMaxX / Real( mGridSize.x );
         Real texCoordYDiff = texCoordMaxY / Real( mGridSize.y );
 
-        // Generate the remaining tiles
+        // Calculate the texture coordinates of each tile.
         UInt32 count = 1;
         Real texCoordY = 0;
         for ( Int y = 0; y < mGridSize.y; y++ )
@@ -171,104 +432,848 @@ namespace PGE
             Real texCoordX = 0;
             for ( Int x = 0; x < mGridSize.x; x++ )
             {
-                glNewList( mDisplayListBase + count, GL_COMPILE );
-                glBegin( GL_QUADS );
-                {
-                    glColor4f( 1.0f, 1.0f, 1.0f, 1.0f );
+                TileTexCoords& tex = mTileTexCoords[ count ];
+                tex.u0 = texCoordX;
+                tex.v0 = texCoordY;
+                tex.u1 = texCoordX + texCoordXDiff;
+                tex.v1 = texCoordY + texCoordYDiff;
+
+                ++count;
+                texCoordX += texCoordXDiff;
+            }
+            texCoordY += texCoordYDiff;
+        }
+    }
+
+    //_setTextureItem
+    void TileSet::_setTextureItem( TextureItem* textureItem )
+    {
+        if ( textureItem == mTextureItem )
+            return;
+        TextureManager* manager = TextureManager::GetSingletonPtr();
+        if ( manager )
+        {
+            if ( textureItem )
+                manager->AddTextureRef( textureItem->GetHandle() );
+            if ( mTextureItem )
+                manager->ReleaseTexture( mTextureItem->GetHandle() );
+        }
+        mTextureItem = textureItem;
+    }
+
+    //_refreshTexCoords
+    void TileSet::_refreshTexCoords() const
+    {
+        if ( !mIsTexturePending || !mTextureItem || mTextureItem->IsPending() )
+            return;
+
+        // Rebuilds in progress read the coordinates, so they are finished
+        // before the coordinates are replaced
+        WorkQueue* queue = WorkQueue::GetSingletonPtr();
+        ChunkMap::iterator chunkIter = mChunks.begin();
+        for ( chunkIter; chunkIter != mChunks.end(); chunkIter++ )
+        {
+            TileChunk& chunk = chunkIter->second;
+            if ( chunk.job )
+            {
+                if ( queue && chunk.job->IsBusy() )
+                    queue->Wait( chunk.job );
+                _collectChunkJob( chunk, chunk.job );
+                chunk.job = 0;
+            }
+        }
+
+        mIsTexturePending = false;
+        _generateTexCoords();
+
+        // Every chunk is rebuilt as it is drawn
+        for ( chunkIter = mChunks.begin(); chunkIter != mChunks.end(); chunkIter++ )
+        {
+            chunkIter->second.isDirty = true;
+            _touchCache( chunkIter->second );
+        }
+    }
 
-                    //glTexCoord2f( x * texCoordXDiff, y * texCoordYDiff );
-                    glTexCoord2f( texCoordX, texCoordY );
-                    glVertex3f( 0.0f, 0.0f, 0.0f );
+    //_createChunks
+    void TileSet::_createChunks()
+    {
+        _releaseChunks();
+
+        mChunkGridSize.x = ( mTileMapSize.x + CHUNK_SIZE - 1 ) / CHUNK_SIZE;
+        mChunkGridSize.y = ( mTileMapSize.y + CHUNK_SIZE - 1 ) / CHUNK_SIZE;
+        if ( mChunkGridSize.x <= 0 || mChunkGridSize.y <= 0 )
+        {
+            mChunkGridSize = Point2D( 0, 0 );
+            return;
+        }
 
-                    //glTexCoord2f( x * texCoordXDiff, ( y + 1 ) * texCoordYDiff );
-                    glTexCoord2f( texCoordX, texCoordY + texCoordYDiff );
-                    glVertex3f( 0.0f, mTileSize.y, 0.0f );
+        _indexSequenceCells();
+    }
+
+    //_getChunk
+    TileSet::TileChunk& TileSet::_getChunk( UInt32 chunkIndex ) const
+    {
+        ChunkMap::iterator iter = mChunks.lower_bound( chunkIndex );
+        if ( iter != mChunks.end() && iter->first == chunkIndex )
+            return iter->second;
+
+        iter = mChunks.insert( iter, ChunkMap::value_type( chunkIndex, TileChunk() ) );
+        TileChunk& chunk = iter->second;
+        chunk.index     = chunkIndex;
+        chunk.origin.x  = ( chunkIndex % mChunkGridSize.x ) * CHUNK_SIZE;
+        chunk.origin.y  = ( chunkIndex / mChunkGridSize.x ) * CHUNK_SIZE;
+        chunk.size.x    = Math::IMin( CHUNK_SIZE, mTileMapSize.x - chunk.origin.x );
+        chunk.size.y    = Math::IMin( CHUNK_SIZE, mTileMapSize.y - chunk.origin.y );
+        return chunk;
+    }
 
-                    //glTexCoord2f( ( x + 1 ) * texCoordXDiff, ( y + 1 ) * texCoordYDiff );
-                    glTexCoord2f( texCoordX + texCoordXDiff, texCoordY + texCoordYDiff );
-                    glVertex3f( mTileSize.x, mTileSize.y, 0.0f );
+    //_findChunk
+    TileSet::TileChunk* TileSet::_findChunk( UInt32 chunkIndex ) const
+    {
+        ChunkMap::iterator iter = mChunks.find( chunkIndex );
+        return ( iter != mChunks.end() ) ? &iter->second : 0;
+    }
 
-                    //glTexCoord2f( ( x + 1 ) * texCoordXDiff, y * texCoordYDiff );
-                    glTexCoord2f( texCoordX + texCoordXDiff, texCoordY );
-                    glVertex3f( mTileSize.x, 0.0f, 0.0f );
+    //_releaseChunks
+    void TileSet::_releaseChunks()
+    {
+        WorkQueue* queue = WorkQueue::GetSingletonPtr();
+        ChunkMap::iterator chunkIter = mChunks.begin();
+        for ( chunkIter; chunkIter != mChunks.end(); chunkIter++ )
+        {
+            TileChunk& chunk = chunkIter->second;
+            if ( chunk.job )
+            {
+                if ( queue && chunk.job->IsBusy() && !queue->Cancel( chunk.job ) )
+                    queue->Wait( chunk.job );
+                delete chunk.job;
+                chunk.job = 0;
+            }
+        }
+        mChunks.clear();
+        mResidentChunks.clear();
+        mChunkGridSize = Point2D( 0, 0 );
+    }
+
+    //_prepareChunk
+    void TileSet::_prepareChunk( UInt32 chunkIndex ) const
+    {
+        TileChunk& chunk = _getChunk( chunkIndex );
+
+        // Pick up the result of a rebuild that has finished
+        if ( chunk.job && !chunk.job->IsBusy() )
+        {
+            _collectChunkJob( chunk, chunk.job );
+            chunk.job = 0;
+        }
+
+        // A chunk of a streamed map is rebuilt whenever its page is loaded
+        // or released
+        const TileMapPager::TilePage* page = 0;
+        if ( !mPager.IsNull() )
+        {
+            UInt32 serial = 0;
+            page = mPager->GetPage( mPager->GetPageIndex( chunk.origin.x, chunk.origin.y ), &serial );
+            if ( serial != chunk.pageSerial )
+            {
+                chunk.pageSerial = serial;
+                chunk.isDirty = true;
+            }
+        }
+
+        // A chunk hiding unexplored cells is rebuilt whenever more of them
+        // are seen
+        bool hasFog = _hasFog();
+        if ( hasFog )
+        {
+            UInt32 serial = mFogOfWar->GetChunkSerial( mFogTeam, chunkIndex );
+            if ( serial != chunk.fogSerial )
+            {
+                chunk.fogSerial = serial;
+                chunk.isDirty = true;
+            }
+        }
+
+        if ( !chunk.isDirty || chunk.job )
+            return;
+
+        ChunkBuildJob* job = new ChunkBuildJob();
+        job->size       = chunk.size;
+        job->tileSize   = mTileSize;
+        job->texCoords  = &mTileTexCoords;
+        if ( mPager.IsNull() )
+            _copyChunkCells( job, chunk, mRowSpanList, mRowSpanEndList, mSpanList, mCells.tiles, Point2D( 0, 0 ) );
+        else if ( page && !page->spans.empty() )
+            _copyChunkCells( job, chunk, &page->rowSpans[ 0 ], &page->rowSpans[ 1 ], &page->spans[ 0 ],
+                             TileCellList( page->cells ).tiles, page->origin );
+        else
+            _copyChunkCells( job, chunk, 0, 0, 0, 0, Point2D( 0, 0 ) );
+        if ( hasFog )
+            mFogOfWar->GetExploredBits( mFogTeam, chunk.origin, chunk.size, job->explored );
+        chunk.isDirty = false;
+
+        // If the chunk has stale geometry, and there are worker threads, keep
+        // drawing the stale geometry until the rebuild is done.  Otherwise,
+        // build it now so that there is never a hole in the map.
+        WorkQueue* queue = WorkQueue::GetSingletonPtr();
+        if ( chunk.isBuilt && queue && queue->GetThreadCount() > 0 )
+        {
+            chunk.job = job;
+            queue->Submit( job );
+        }
+        else
+        {
+            job->Execute();
+            _collectChunkJob( chunk, job );
+        }
+
+        if ( !chunk.isResident )
+        {
+            chunk.isResident = true;
+            mResidentChunks.push_back( chunkIndex );
+        }
+    }
+
+    //_copyChunkCells
+    void TileSet::_copyChunkCells( ChunkBuildJob* job, const TileChunk& chunk, const UInt32* rowSpans, const UInt32* rowEnds,
+                                   const TileSpan* spans, const SInt16* tiles, const Point2D& origin ) const
+    {
+        // Copy the tiles of the chunk's stored cells for the job, clipping the
+        // spans to the chunk.  Empty runs are skipped entirely.
+        job->rowSpans.reserve( chunk.size.y + 1 );
+        Int chunkStart = chunk.origin.x - origin.x;
+        Int chunkEnd = chunkStart + chunk.size.x;
+        for ( Int y = 0; y < chunk.size.y; y++ )
+        {
+            job->rowSpans.push_back( job->spans.size() );
+            if ( !rowSpans )
+                continue;
+
+            Int row = chunk.origin.y - origin.y + y;
+            for ( UInt32 spanIndex = _findSpan( rowSpans, rowEnds, spans, row, chunkStart ); spanIndex < rowEnds[ row ]; spanIndex++ )
+            {
+                const TileSpan& span = spans[ spanIndex ];
+                if ( Int( span.start ) >= chunkEnd )
+                    break;
+
+                Int start = Math::IMax( span.start, chunkStart );
+                Int end   = Math::IMin( span.start + span.count, chunkEnd );
+                TileSpan clipped;
+                clipped.start       = start - chunkStart;
+                clipped.count       = end - start;
+                clipped.firstCell   = job->tiles.size();
+                job->spans.push_back( clipped );
+
+                const SInt16* tileIter = tiles + span.firstCell + ( start - span.start );
+                job->tiles.insert( job->tiles.end(), tileIter, tileIter + clipped.count );
+            }
+        }
+        job->rowSpans.push_back( job->spans.size() );
+    }
+
+    //_collectChunkJob
+    void TileSet::_collectChunkJob( TileChunk& chunk, ChunkBuildJob* job ) const
+    {
+        chunk.geometry.Swap( job->geometry );
+        chunk.animated.swap( job->animated );
+        chunk.quadCells.swap( job->quadCells );
+        chunk.isBuilt = true;
+        chunk.lightSerial = 0;
+        delete job;
+
+        // The cells of a streamed map are only seen as their pages arrive, so
+        // the chunks using each sequence are recorded as they are built.
+        if ( !mPager.IsNull() )
+        {
+            UInt32 chunkIndex = chunk.index;
+            AnimatedCellArray::const_iterator cellIter = chunk.animated.begin();
+            for ( cellIter; cellIter != chunk.animated.end(); cellIter++ )
+            {
+                if ( cellIter->seqIndex >= mSequenceChunks.size() )
+                    continue;
+                std::vector< UInt32 >& chunks = mSequenceChunks[ cellIter->seqIndex ];
+                std::vector< UInt32 >::iterator pos = std::lower_bound( chunks.begin(), chunks.end(), chunkIndex );
+                if ( pos == chunks.end() || *pos != chunkIndex )
+                    chunks.insert( pos, chunkIndex );
+            }
+        }
+
+        // The sequences may have changed frames while the job was running
+        _patchAnimatedCells( chunk, chunk.animated.begin(), chunk.animated.end() );
+        _touchCache( chunk );
+    }
+
+    //_patchAnimatedCells
+    void TileSet::_patchAnimatedCells( TileChunk& chunk, AnimatedCellArray::const_iterator begin, AnimatedCellArray::const_iterator end ) const
+    {
+        static const TileTexCoords emptyTile;
+        if ( begin != end )
+            _touchCache( chunk );
+        for ( begin; begin != end; begin++ )
+        {
+            Int tileIndex = 0;
+            if ( begin->seqIndex < mSequences.size() )
+                tileIndex = mSequences[ begin->seqIndex ].GetCurrentTile();
+
+            // Frames showing the empty tile are collapsed to nothing
+            if ( tileIndex > 0 && tileIndex < Int( mTileTexCoords.size() ) )
+                chunk.geometry.SetQuad( begin->quad, begin->x * mTileSize.x, begin->y * mTileSize.y, mTileSize.x, mTileSize.y, mTileTexCoords[ tileIndex ] );
+            else
+                chunk.geometry.SetQuad( begin->quad, begin->x * mTileSize.x, begin->y * mTileSize.y, 0, 0, emptyTile );
+        }
+    }
+
+    //_indexSequenceCells
+    void TileSet::_indexSequenceCells()
+    {
+        mSequenceChunks.clear();
+        mSequenceChunks.resize( mSequences.size() );
+        if ( mChunkGridSize.x <= 0 || !mRowSpanList )
+            return;
+
+        for ( Int y = 0; y < mTileMapSize.y; y++ )
+        {
+            UInt32 chunkRow = ( y / CHUNK_SIZE ) * mChunkGridSize.x;
+            for ( UInt32 spanIndex = mRowSpanList[ y ]; spanIndex < mRowSpanEndList[ y ]; spanIndex++ )
+            {
+                const TileSpan& span = mSpanList[ spanIndex ];
+                const SInt16* tileIter = mCells.tiles + span.firstCell;
+                for ( UInt32 x = span.start; x < span.start + span.count; x++, tileIter++ )
+                {
+                    UInt32 seqIndex = Math::IAbs( *tileIter );
+                    if ( *tileIter >= 0 || seqIndex >= mSequenceChunks.size() )
+                        continue;
+
+                    std::vector< UInt32 >& chunks = mSequenceChunks[ seqIndex ];
+                    UInt32 chunkIndex = chunkRow + x / CHUNK_SIZE;
+                    if ( chunks.empty() || chunks.back() != chunkIndex )
+                        chunks.push_back( chunkIndex );
                 }
-                glEnd();
-                glTranslatef( mTileSize.x, 0, 0 );
-                glEndList();
-                ++count;
-                texCoordX += texCoordXDiff;
             }
-            texCoordY += texCoordYDiff;
         }
 
-        return true;
+        // The rows were visited in order, so a chunk may have been added once
+        // for each of its rows
+        SequenceChunkArray::iterator iter = mSequenceChunks.begin();
+        for ( iter; iter != mSequenceChunks.end(); iter++ )
+        {
+            std::sort( iter->begin(), iter->end() );
+            iter->erase( std::unique( iter->begin(), iter->end() ), iter->end() );
+        }
     }
 
-    //_readTileMap
-    bool TileSet::_readTileMap( TiXmlNode* mapNode )
+    //_scheduleSequences
+    void TileSet::_scheduleSequences()
     {
-        // Get the map dimensions
-        mTileMapSize.x = StringUtil::ToInt( XmlArchiveFile::GetItemValue( mapNode->FirstChild( "width" ) ) );
-        mTileMapSize.y = StringUtil::ToInt( XmlArchiveFile::GetItemValue( mapNode->FirstChild( "height" ) ) );
+        mSequenceTime = 0;
+        mSchedule = SequenceSchedule();
+        for ( UInt32 i = 0; i < mSequences.size(); i++ )
+        {
+            // Sequences with a single frame never change, so they are never
+            // scheduled
+            Sequence& seq = mSequences[ i ];
+            seq.Restart();
+            if ( seq.GetFrameCount() > 1 && seq.GetFrameDuration() > 0 )
+            {
+                ScheduledSequence next;
+                next.time       = seq.GetFrameDuration();
+                next.seqIndex   = i;
+                mSchedule.push( next );
+            }
+        }
+    }
 
-        // Set the map size:
-        mTileMap.resize( mTileMapSize.x * mTileMapSize.y );
+    //_evictChunks
+    void TileSet::_evictChunks() const
+    {
+        // The chunks of a streamed map whose pages have been released are
+        // dropped however few chunks there are, so only the chunks around
+        // the view are ever held
+        bool isStreamed = !mPager.IsNull();
+        UInt32 excess = ( mResidentChunks.size() > MAX_RESIDENT_CHUNKS ) ? mResidentChunks.size() - MAX_RESIDENT_CHUNKS : 0;
+        if ( !excess && !isStreamed )
+            return;
+
+        // Look up the age of each resident chunk once, rather than in the
+        // sort, so the least recently drawn come first
+        typedef std::pair< UInt32, UInt32 > ChunkAge;
+        std::vector< ChunkAge > ages;
+        ages.reserve( mResidentChunks.size() );
+        std::vector< UInt32 >::const_iterator indexIter = mResidentChunks.begin();
+        for ( indexIter; indexIter != mResidentChunks.end(); indexIter++ )
+            ages.push_back( ChunkAge( _getChunk( *indexIter ).lastFrame, *indexIter ) );
+        if ( excess )
+            std::sort( ages.begin(), ages.end() );
+
+        // Release the oldest chunks.  Chunks drawn this frame, or which are
+        // being rebuilt, are kept.
+        mResidentChunks.clear();
+        std::vector< ChunkAge >::const_iterator ageIter = ages.begin();
+        for ( ageIter; ageIter != ages.end(); ageIter++ )
+        {
+            ChunkMap::iterator chunkIter = mChunks.find( ageIter->second );
+            TileChunk& chunk = chunkIter->second;
+            bool isReleased = ( excess > 0 );
+            if ( !isReleased && isStreamed )
+                isReleased = !mPager->GetPage( mPager->GetPageIndex( chunk.origin.x, chunk.origin.y ) );
+            if ( isReleased && chunk.lastFrame != mFrameCount && !chunk.job )
+            {
+                mChunks.erase( chunkIter );
+                if ( excess > 0 )
+                    --excess;
+            }
+            else
+                mResidentChunks.push_back( ageIter->second );
+        }
+    }
 
+    //_readTileMap
+    bool TileSet::_readTileMap( TiXmlNode* mapNode, SourceMap& map )
+    {
+        // Get the map dimensions
+        map.size.x = StringUtil::ToInt( XmlArchiveFile::GetItemValue( mapNode->FirstChild( "width" ) ) );
+        map.size.y = StringUtil::ToInt( XmlArchiveFile::GetItemValue( mapNode->FirstChild( "height" ) ) );
+        map.size.x = Math::IMax( map.size.x, 0 );
+        map.size.y = Math::IMax( map.size.y, 0 );
+
+        // Read the grid a row at a time, keeping only the cells which aren't
+        // empty.  Cells missing from the end of the list are empty.
+        bool isPacked = true;
+        TileMap row( map.size.x );
+        map.rowSpans.reserve( map.size.y + 1 );
         TiXmlNode* cellNode = mapNode->FirstChild( "cellList" );
-        if ( cellNode )
+        cellNode = cellNode ? cellNode->FirstChild( "cell" ) : 0;
+        for ( Int y = 0; y < map.size.y; y++ )
         {
-            int curTile = 0;
-            cellNode = cellNode->FirstChild( "cell" );
-            while ( cellNode )
+            for ( Int x = 0; x < map.size.x; x++ )
             {
-                TileMapItem tile;
+                TileMapItem& tile = row[ x ];
+                tile = TileMapItem();
+                if ( !cellNode )
+                    continue;
                 tile.tileIndex  = StringUtil::ToInt( XmlArchiveFile::GetItemValue( cellNode->FirstChild( "tileNumber" ) ) );
                 tile.boundsCode = StringUtil::ToInt( XmlArchiveFile::GetItemValue( cellNode->FirstChild( "bounds" ) ) );
                 tile.mapCode    = StringUtil::ToInt( XmlArchiveFile::GetItemValue( cellNode->FirstChild( "mapCode" ) ) );
-                mTileMap[ curTile++ ] = tile;
 
                 cellNode = cellNode->NextSibling( "cell" );
             }
+            if ( !EncodeRow( row.empty() ? 0 : &row[ 0 ], map.size.x, map.cells, map.spans, map.rowSpans, map.stats ) )
+                isPacked = false;
+        }
+        FinishEncoding( map.cells, map.spans, map.rowSpans, map.stats );
+        return isPacked;
+    }
+
+    //EncodeCells
+    bool TileSet::EncodeCells( const TileMap& cells, const Point2D& size, TileCellArray& outCells, TileSpanArray& outSpans,
+                               std::vector< UInt32 >& outRowSpans, TileMapStats& outStats )
+    {
+        bool isPacked = true;
+        outCells.Clear();
+        outSpans.clear();
+        outRowSpans.clear();
+        outRowSpans.reserve( size.y + 1 );
+        outStats = TileMapStats();
+        for ( Int y = 0; y < size.y; y++ )
+        {
+            const TileMapItem* row = cells.empty() ? 0 : &cells[ y * size.x ];
+            if ( !EncodeRow( row, size.x, outCells, outSpans, outRowSpans, outStats ) )
+                isPacked = false;
+        }
+        FinishEncoding( outCells, outSpans, outRowSpans, outStats );
+        return isPacked;
+    }
+
+    //EncodeRow
+    bool TileSet::EncodeRow( const TileMapItem* cells, Int width, TileCellArray& outCells, TileSpanArray& outSpans,
+                             std::vector< UInt32 >& outRowSpans, TileMapStats& outStats )
+    {
+        bool isPacked = true;
+        outRowSpans.push_back( outSpans.size() );
+        outStats.cellCount += width;
+
+        bool inSpan = false;
+        for ( Int x = 0; x < width; x++ )
+        {
+            const TileMapItem& cell = cells[ x ];
+            if ( cell.tileIndex == 0 )
+                ++outStats.emptyCells;
+
+            // A cell without a tile may still hold collision information,
+            // so it is only dropped if there is nothing in it at all.
+            if ( cell.tileIndex == 0 && cell.boundsCode == 0 && cell.mapCode == 0 )
+            {
+                inSpan = false;
+                continue;
+            }
+
+            if ( inSpan )
+                ++outSpans.back().count;
+            else
+            {
+                TileSpan span;
+                span.start      = x;
+                span.count      = 1;
+                span.firstCell  = outCells.Size();
+                outSpans.push_back( span );
+                inSpan = true;
+            }
+            if ( !outCells.Append( cell ) )
+                isPacked = false;
         }
+        return isPacked;
+    }
 
-        return true;
+    //FinishEncoding
+    void TileSet::FinishEncoding( TileCellArray& outCells, TileSpanArray& outSpans, std::vector< UInt32 >& outRowSpans,
+                                  TileMapStats& outStats )
+    {
+        outRowSpans.push_back( outSpans.size() );
+
+        // Trim the excess capacity
+        std::vector< SInt16 >( outCells.tiles ).swap( outCells.tiles );
+        std::vector< UInt16 >( outCells.codes ).swap( outCells.codes );
+        TileSpanArray( outSpans ).swap( outSpans );
+
+        outStats.storedCells    = outCells.Size();
+        outStats.spanCount      = outSpans.size();
+        outStats.memoryBytes    = outCells.Size() * ( sizeof( SInt16 ) + sizeof( UInt16 ) ) +
+                                  outSpans.size() * sizeof( TileSpan ) +
+                                  outRowSpans.size() * sizeof( UInt32 );
     }
 
-    //_readSequence
-    bool TileSet::_readSequence( TiXmlNode* seqNode )
+    //_useOwnedCells
+    void TileSet::_useOwnedCells()
     {
-        // Read the sequence:
-        Sequence seq;
-        seq.ReadSequence( seqNode );
+        mIsSharedMap    = false;
+        mCells          = TileCellList( mTileMap );
+        mSpanList       = mSpans.empty() ? 0 : &mSpans[ 0 ];
+        mRowSpanList    = mRowSpans.empty() ? 0 : &mRowSpans[ 0 ];
+        mRowSpanEndList = mRowSpanEnds.empty() ? 0 : &mRowSpanEnds[ 0 ];
+    }
 
-        // Make sure the sequence array is big enough:
-        if ( seq.index < mSequences.size() )
-            mSequences[ seq.index ] = seq;
+    //_clearMap
+    void TileSet::_clearMap()
+    {
+        _releaseChunks();
+        _releaseCache();
+        mPager.SetNull();
+
+        mTileMap.Clear();
+        mSpans.clear();
+        mRowSpans.clear();
+        mRowSpanEnds.clear();
+        mCells          = TileCellList();
+        mSpanList       = 0;
+        mRowSpanList    = 0;
+        mRowSpanEndList = 0;
+        mTileMapSize    = Point2D( 0, 0 );
+        mMapStats       = TileMapStats();
+        mIsSharedMap    = false;
+    }
 
-        return true;
+    //_makeCellsEditable
+    void TileSet::_makeCellsEditable()
+    {
+        if ( !mIsSharedMap )
+            return;
+
+        // The shared map stays as it is for the other copies of the tileset,
+        // and for selecting the map again.
+        if ( mRowSpanList )
+        {
+            mRowSpans.assign( mRowSpanList, mRowSpanList + mTileMapSize.y );
+            mRowSpanEnds.assign( mRowSpanEndList, mRowSpanEndList + mTileMapSize.y );
+            mSpans.assign( mSpanList, mSpanList + mRowSpanList[ mTileMapSize.y ] );
+            UInt32 cellCount = mSpans.empty() ? 0 : mSpans.back().firstCell + mSpans.back().count;
+            mTileMap.tiles.assign( mCells.tiles, mCells.tiles + cellCount );
+            mTileMap.codes.assign( mCells.codes, mCells.codes + cellCount );
+        }
+        else
+        {
+            mRowSpans.assign( mTileMapSize.y, 0 );
+            mRowSpanEnds.assign( mTileMapSize.y, 0 );
+            mSpans.clear();
+            mTileMap.Clear();
+        }
+        _useOwnedCells();
+    }
+
+    //_indexSequenceCell
+    void TileSet::_indexSequenceCell( Int x, Int y, SInt32 tileIndex )
+    {
+        UInt32 seqIndex = Math::IAbs( tileIndex );
+        if ( tileIndex >= 0 || seqIndex >= mSequenceChunks.size() || mChunkGridSize.x <= 0 )
+            return;
+
+        // A chunk left in the list after its last cell for the sequence is
+        // removed only costs a search of its animated cells.
+        std::vector< UInt32 >& chunks = mSequenceChunks[ seqIndex ];
+        UInt32 chunkIndex = ( y / CHUNK_SIZE ) * mChunkGridSize.x + x / CHUNK_SIZE;
+        std::vector< UInt32 >::iterator iter = std::lower_bound( chunks.begin(), chunks.end(), chunkIndex );
+        if ( iter == chunks.end() || *iter != chunkIndex )
+            chunks.insert( iter, chunkIndex );
     }
 
-    void TileSet::_renderTileSpan( TileMap::const_iterator& tileIter, const UInt32& displayListBase, UInt32 count ) const
+    //_insertCells
+    void TileSet::_insertCells( CellEditArray& edits )
     {
-        Int curTile = count;
-        while ( tileIter != mTileMap.end() && curTile >= 0 )
+        std::stable_sort( edits.begin(), edits.end(), CellEditLess() );
+
+        CellEditArray row;
+        CellEditArray::const_iterator editIter = edits.begin();
+        while ( editIter != edits.end() )
         {
-            if ( tileIter->tileIndex < 0 )
+            // Merge the stored cells of the row with the new ones, by column.
+            // The new cells were not stored, so the two never share a column.
+            // Storing a row may move the arrays, so they are looked up again.
+            Int y = editIter->y;
+            TileCellList storedCells( mTileMap );
+            row.clear();
+            for ( UInt32 spanIndex = mRowSpans[ y ]; spanIndex < mRowSpanEnds[ y ]; spanIndex++ )
             {
-                // Negative values indicate a sequence...
-                Int seqIndex = Math::Abs( tileIter->tileIndex );
-                if ( seqIndex < mSequences.size() )
+                const TileSpan& span = mSpans[ spanIndex ];
+                for ( UInt32 i = 0; i < span.count; i++ )
                 {
-                    mSequences[ seqIndex ].Render( displayListBase );
+                    CellEdit stored;
+                    stored.x    = span.start + i;
+                    stored.y    = y;
+                    stored.cell = storedCells.GetItem( span.firstCell + i );
+                    row.push_back( stored );
                 }
             }
+            UInt32 storedCount = row.size();
+            for ( ; editIter != edits.end() && editIter->y == y; editIter++ )
+            {
+                // Only the last edit of a cell counts, and a cell which ends
+                // up empty stays out of the runs
+                CellEditArray::const_iterator next = editIter + 1;
+                if ( next != edits.end() && next->y == y && next->x == editIter->x )
+                    continue;
+                const TileMapItem& cell = editIter->cell;
+                if ( cell.tileIndex == 0 && cell.boundsCode == 0 && cell.mapCode == 0 )
+                    continue;
+                if ( cell.tileIndex != 0 )
+                    --mMapStats.emptyCells;
+                row.push_back( *editIter );
+            }
+            if ( row.size() == storedCount )
+                continue;
+            std::inplace_merge( row.begin(), row.begin() + storedCount, row.end(), CellEditLess() );
+            _storeRow( y, row );
+        }
+
+        // Once the runs left behind by moved rows take more room than the
+        // map itself, the arrays are put back in order.
+        if ( mTileMap.Size() > 2 * mMapStats.storedCells || mSpans.size() > 2 * mMapStats.spanCount )
+            _compactCells();
+        _useOwnedCells();
+        _countOwnedMemory();
+    }
+
+    //_storeRow
+    void TileSet::_storeRow( Int y, const CellEditArray& cells )
+    {
+        // If the row is already at the end of the arrays, it is replaced
+        // there.  Otherwise its old runs are left unused.
+        UInt32 firstSpan = mRowSpans[ y ];
+        UInt32 endSpan = mRowSpanEnds[ y ];
+        UInt32 firstCell = ( firstSpan < endSpan ) ? mSpans[ firstSpan ].firstCell : mTileMap.Size();
+        UInt32 endCell = ( firstSpan < endSpan ) ? mSpans[ endSpan - 1 ].firstCell + mSpans[ endSpan - 1 ].count : mTileMap.Size();
+        mMapStats.storedCells   -= endCell - firstCell;
+        mMapStats.spanCount     -= endSpan - firstSpan;
+        if ( endSpan == mSpans.size() && endCell == mTileMap.Size() )
+        {
+            mSpans.resize( firstSpan );
+            mTileMap.tiles.resize( firstCell );
+            mTileMap.codes.resize( firstCell );
+        }
+
+        mRowSpans[ y ] = mSpans.size();
+        CellEditArray::const_iterator cellIter = cells.begin();
+        for ( ; cellIter != cells.end(); cellIter++ )
+        {
+            if ( mRowSpans[ y ] < mSpans.size() &&
+                 Int( mSpans.back().start + mSpans.back().count ) == cellIter->x )
+                ++mSpans.back().count;
             else
-                glCallList( displayListBase + tileIter->tileIndex );
+            {
+                TileSpan span;
+                span.start      = cellIter->x;
+                span.count      = 1;
+                span.firstCell  = mTileMap.Size();
+                mSpans.push_back( span );
+            }
+            mTileMap.Append( cellIter->cell );
+        }
+        mRowSpanEnds[ y ] = mSpans.size();
+
+        mMapStats.storedCells   += cells.size();
+        mMapStats.spanCount     += mSpans.size() - mRowSpans[ y ];
+    }
 
-            // Increment the tile iterator and decrement the count
-            ++tileIter;
-            --curTile;
+    //_compactCells
+    void TileSet::_compactCells()
+    {
+        TileCellArray cells;
+        TileSpanArray spans;
+        cells.Reserve( mMapStats.storedCells );
+        spans.reserve( mMapStats.spanCount );
+        for ( Int y = 0; y < mTileMapSize.y; y++ )
+        {
+            UInt32 firstSpan = spans.size();
+            for ( UInt32 spanIndex = mRowSpans[ y ]; spanIndex < mRowSpanEnds[ y ]; spanIndex++ )
+            {
+                TileSpan span = mSpans[ spanIndex ];
+                std::vector< SInt16 >::const_iterator tileIter = mTileMap.tiles.begin() + span.firstCell;
+                std::vector< UInt16 >::const_iterator codeIter = mTileMap.codes.begin() + span.firstCell;
+                cells.tiles.insert( cells.tiles.end(), tileIter, tileIter + span.count );
+                cells.codes.insert( cells.codes.end(), codeIter, codeIter + span.count );
+                span.firstCell = cells.Size() - span.count;
+                spans.push_back( span );
+            }
+            mRowSpans[ y ]      = firstSpan;
+            mRowSpanEnds[ y ]   = spans.size();
         }
+
+        mTileMap.Swap( cells );
+        mSpans.swap( spans );
+    }
+
+    //_countOwnedMemory
+    void TileSet::_countOwnedMemory()
+    {
+        mMapStats.memoryBytes   = mTileMap.Size() * ( sizeof( SInt16 ) + sizeof( UInt16 ) ) +
+                                  mSpans.size() * sizeof( TileSpan ) +
+                                  ( mRowSpans.size() + mRowSpanEnds.size() ) * sizeof( UInt32 );
+    }
+
+    //_findSpan
+    UInt32 TileSet::_findSpan( Int row, Int column ) const
+    {
+        return _findSpan( mRowSpanList, mRowSpanEndList, mSpanList, row, column );
+    }
+
+    //_findSpan
+    UInt32 TileSet::_findSpan( const UInt32* rowSpans, const UInt32* rowEnds, const TileSpan* spans, Int row, Int column )
+    {
+        // Binary search for the first span which ends after the column
+        UInt32 low  = rowSpans[ row ];
+        UInt32 high = rowEnds[ row ];
+        while ( low < high )
+        {
+            UInt32 mid = ( low + high ) / 2;
+            if ( Int( spans[ mid ].start + spans[ mid ].count ) <= column )
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return low;
+    }
+
+    //_findCell
+    bool TileSet::_findCell( const UInt32* rowSpans, const UInt32* rowEnds, const TileSpan* spans, const TileCellList& cells,
+                             Int row, Int column, TileMapItem& cell )
+    {
+        UInt32 spanIndex = _findSpan( rowSpans, rowEnds, spans, row, column );
+        if ( spanIndex >= rowEnds[ row ] || Int( spans[ spanIndex ].start ) > column )
+        {
+            cell = TileMapItem();
+            return false;
+        }
+        cell = cells.GetItem( spans[ spanIndex ].firstCell + ( column - spans[ spanIndex ].start ) );
+        return true;
+    }
+
+    //_findCell
+    bool TileSet::_findCell( Int x, Int y, TileMapItem& cell ) const
+    {
+        cell = TileMapItem();
+        if ( x < 0 || y < 0 || x >= mTileMapSize.x || y >= mTileMapSize.y )
+            return false;
+
+        if ( mPager.IsNull() )
+            return mRowSpanList && _findCell( mRowSpanList, mRowSpanEndList, mSpanList, mCells, y, x, cell );
+
+        const TileMapPager::TilePage* page = mPager->GetPage( mPager->GetPageIndex( x, y ) );
+        if ( !page || page->spans.empty() )
+            return false;
+        return _findCell( &page->rowSpans[ 0 ], &page->rowSpans[ 1 ], &page->spans[ 0 ], TileCellList( page->cells ),
+                          y - page->origin.y, x - page->origin.x, cell );
+    }
+
+    //GetCell
+    TileSet::TileMapItem TileSet::GetCell( Int x, Int y ) const
+    {
+        TileMapItem cell;
+        _findCell( x, y, cell );
+        return cell;
+    }
+
+    //SetCell
+    bool TileSet::SetCell( Int x, Int y, SInt32 tileIndex, SInt32 boundsCode, SInt32 mapCode )
+    {
+        CellEdit edit;
+        edit.x              = x;
+        edit.y              = y;
+        edit.cell.tileIndex = tileIndex;
+        edit.cell.boundsCode = boundsCode;
+        edit.cell.mapCode   = mapCode;
+        return ApplyEdits( &edit, 1 ) == 1;
+    }
+
+    //ApplyEdits
+    UInt32 TileSet::ApplyEdits( const CellEdit* edits, UInt32 count )
+    {
+        // Pages of a streamed map are read again each time they come back
+        // into view, so changes to them would be lost.
+        if ( !mPager.IsNull() || count == 0 )
+            return 0;
+        _makeCellsEditable();
+
+        CellEditArray inserts;
+        UInt32 applied = 0;
+        for ( const CellEdit* edit = edits; edit != edits + count; edit++ )
+        {
+            if ( edit->x < 0 || edit->y < 0 || edit->x >= mTileMapSize.x || edit->y >= mTileMapSize.y )
+                continue;
+            ++applied;
+
+            UInt32 spanIndex = _findSpan( edit->y, edit->x );
+            if ( spanIndex < mRowSpanEnds[ edit->y ] && Int( mSpans[ spanIndex ].start ) <= edit->x )
+            {
+                UInt32 cellIndex = mSpans[ spanIndex ].firstCell + ( edit->x - mSpans[ spanIndex ].start );
+                bool wasEmpty = ( mTileMap.tiles[ cellIndex ] == 0 );
+                mTileMap.Set( cellIndex, edit->cell );
+                if ( wasEmpty && mTileMap.tiles[ cellIndex ] != 0 )
+                    --mMapStats.emptyCells;
+                else if ( !wasEmpty && mTileMap.tiles[ cellIndex ] == 0 )
+                    ++mMapStats.emptyCells;
+            }
+            else
+                inserts.push_back( *edit );
+
+            _indexSequenceCell( edit->x, edit->y, edit->cell.tileIndex );
+            InvalidateCells( edit->x, edit->y, 1, 1 );
+        }
+
+        if ( !inserts.empty() )
+            _insertCells( inserts );
+        return applied;
+    }
+
+    //_readSequence
+    bool TileSet::_readSequence( TiXmlNode* seqNode )
+    {
+        // Read the sequence:
+        Sequence seq;
+        seq.ReadSequence( seqNode );
+
+        // Make sure the sequence array is big enough:
+        if ( seq.index < mSequences.size() )
+            mSequences[ seq.index ] = seq;
+
+        return true;
     }
 
     //operator=
@@ -282,16 +1287,129 @@ namespace PGE
         mGridSize   = src.mGridSize;
         mOverlap    = src.mOverlap;
         mTileCount  = src.mTileCount;
-        mDisplayListBase = src.mDisplayListBase;
-
-        mTileMap.assign( src.mTileMap.begin(), src.mTileMap.end() );
+        mTileTexCoords = src.mTileTexCoords;
+        mTextureName = src.mTextureName;
+        _setTextureItem( src.mTextureItem );
+        mIsTexturePending = src.mIsTexturePending;
+
+        // The maps read with the tileset, or from a compiled file, are shared
+        // rather than making a copy of the cells.
+        // A map which has been edited belongs to the tileset, and is copied.
+        mTileMap    = src.mTileMap;
+        mSpans      = src.mSpans;
+        mRowSpans   = src.mRowSpans;
+        mRowSpanEnds = src.mRowSpanEnds;
+        _useOwnedCells();
+        if ( src.mIsSharedMap )
+        {
+            mIsSharedMap    = true;
+            mCells          = src.mCells;
+            mSpanList       = src.mSpanList;
+            mRowSpanList    = src.mRowSpanList;
+            mRowSpanEndList = src.mRowSpanEndList;
+        }
+        mSourceMaps     = src.mSourceMaps;
+        mSourceFile     = src.mSourceFile;
+        mSourceRecord   = src.mSourceRecord;
+        mMapIndex       = src.mMapIndex;
+
+        // A streamed map gets a pager of its own, so that the copies do not
+        // release the pages the others are drawing.  Only the file is shared.
+        if ( !src.mPager.IsNull() )
+        {
+            const TileMapFile& file = *src.mSourceFile;
+            TileMapPager* pager = new TileMapPager( file, *file.GetMap( *file.GetTileSet( src.mSourceRecord ), src.mMapIndex ) );
+            pager->SetRadius( src.mPager->GetLoadRadius(), src.mPager->GetHysteresis() );
+            mPager.SetNull();
+            mPager.Bind( pager );
+        }
+        else
+            mPager.SetNull();
+        mLightMap   = src.mLightMap;
+        mFogOfWar   = src.mFogOfWar;
+        mFogTeam    = src.mFogTeam;
         mTileMapSize = src.mTileMapSize;
+        mMapStats   = src.mMapStats;
+
+        // The cached geometry is rebuilt for the copy, rather than sharing any
+        // rebuilds that are in progress.
+        _releaseChunks();
+        _createChunks();
+
+        // The copy draws into its own cache
+        _releaseCache();
+        mCache.isEnabled = src.mCache.isEnabled;
+        mCache.margin    = src.mCache.margin;
 
         mSequences.assign( src.mSequences.begin(), src.mSequences.end() );
+        mSchedule       = src.mSchedule;
+        mSequenceTime   = src.mSequenceTime;
+        mSequenceChunks = src.mSequenceChunks;
 
         return *this;
     }
 
+    //Swap
+    void TileSet::Swap( TileSet& src )
+    {
+        if ( &src == this )
+            return;
+
+        // Rebuilds in progress refer to the texture coordinates of their own
+        // tileset, so they are finished before anything moves.  The caches
+        // are simply drawn again.
+        _releaseChunks();
+        src._releaseChunks();
+        _releaseCache();
+        src._releaseCache();
+
+        std::swap( mIndex, src.mIndex );
+        mIdentifier.swap( src.mIdentifier );
+        std::swap( mTileSize, src.mTileSize );
+        mImageName.swap( src.mImageName );
+        std::swap( mImageSize, src.mImageSize );
+        std::swap( mGridSize, src.mGridSize );
+        std::swap( mOverlap, src.mOverlap );
+        std::swap( mTileCount, src.mTileCount );
+        mTileTexCoords.swap( src.mTileTexCoords );
+        mTextureName.swap( src.mTextureName );
+        std::swap( mTextureItem, src.mTextureItem );
+        std::swap( mIsTexturePending, src.mIsTexturePending );
+        std::swap( mRenderStats, src.mRenderStats );
+
+        // Swapping the arrays keeps their storage, so the run pointers stay
+        // valid when they are swapped along with them.
+        mTileMap.Swap( src.mTileMap );
+        mSpans.swap( src.mSpans );
+        mRowSpans.swap( src.mRowSpans );
+        mRowSpanEnds.swap( src.mRowSpanEnds );
+        std::swap( mCells, src.mCells );
+        std::swap( mSpanList, src.mSpanList );
+        std::swap( mRowSpanList, src.mRowSpanList );
+        std::swap( mRowSpanEndList, src.mRowSpanEndList );
+        mSourceMaps.Swap( src.mSourceMaps );
+        mSourceFile.Swap( src.mSourceFile );
+        std::swap( mSourceRecord, src.mSourceRecord );
+        std::swap( mMapIndex, src.mMapIndex );
+        std::swap( mIsSharedMap, src.mIsSharedMap );
+        mPager.Swap( src.mPager );
+        std::swap( mLightMap, src.mLightMap );
+        std::swap( mFogOfWar, src.mFogOfWar );
+        std::swap( mFogTeam, src.mFogTeam );
+        std::swap( mTileMapSize, src.mTileMapSize );
+        std::swap( mMapStats, src.mMapStats );
+
+        mSequences.swap( src.mSequences );
+        std::swap( mSchedule, src.mSchedule );
+        std::swap( mSequenceTime, src.mSequenceTime );
+        std::swap( mFrameCount, src.mFrameCount );
+        std::swap( mCache.isEnabled, src.mCache.isEnabled );
+        std::swap( mCache.margin, src.mCache.margin );
+
+        _createChunks();
+        src._createChunks();
+    }
+
     //operator<
     bool TileSet::operator<( const TileSet& src ) const
     {
@@ -322,11 +1440,62 @@ namespace PGE
         return mTileMapSize;
     }
 
+    //GetImageName
+    const String& TileSet::GetImageName() const
+    {
+        return mImageName;
+    }
+
+    //GetTileGridSize
+    const Point2D& TileSet::GetTileGridSize() const
+    {
+        return mGridSize;
+    }
+
+    //SetAtlas
+    void TileSet::SetAtlas( const String& textureName, const TileTexCoordArray& texCoords )
+    {
+        // Rebuilds in progress refer to the current coordinates, so they need
+        // to be finished before the coordinates are replaced.
+        _releaseChunks();
+
+        mTextureName    = textureName;
+        _setTextureItem( TextureManager::GetSingleton().GetTextureItemPtr( textureName ) );
+        mTileTexCoords  = texCoords;
+        mIsTexturePending = false;
+
+        _createChunks();
+    }
+
+    //GetTextureItem
+    TextureItem* TileSet::GetTextureItem() const
+    {
+        return mTextureItem;
+    }
+
+    //GetTileTexCoords
+    const TileTexCoordArray& TileSet::GetTileTexCoords() const
+    {
+        return mTileTexCoords;
+    }
+
+    //GetStillTile
+    SInt32 TileSet::GetStillTile( SInt32 tileIndex ) const
+    {
+        if ( tileIndex >= 0 )
+            return tileIndex;
+        UInt32 seqIndex = Math::IAbs( tileIndex );
+        if ( seqIndex >= mSequences.size() || mSequences[ seqIndex ].mSequence.empty() )
+            return 0;
+        return mSequences[ seqIndex ].mSequence[ 0 ].tileNumber;
+    }
+
     //Read a tileset
     bool TileSet::ReadTileSet( TiXmlNode* tilesetNode, const String& baseDir, UInt32 mapIndex )
     {
         if ( !tilesetNode )
             return false;
+        Release();
 
         // Read some configuration settings regarding the tileset
 
@@ -369,58 +1538,266 @@ namespace PGE
             {
                 _readSequence( seqNode );
 
-                seqNode = seqlistNode->NextSibling( "sequence" );
+                seqNode = seqNode->NextSibling( "sequence" );
             }
         }
-
-        // Map data
-        int mapCount = StringUtil::ToInt( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "mapCount" ) ) );
+        _scheduleSequences();
+
+        // Map data.  Every map is read now, so that copies of the tileset can
+        // use the others without coming back to the xml.
+        UInt32 mapCount = StringUtil::ToInt( XmlArchiveFile::GetItemValue( tilesetNode->FirstChild( "mapCount" ) ) );
+        SourceMapArray* maps = new SourceMapArray();
+        maps->reserve( mapCount );
+        bool isPacked = true;
         TiXmlNode* maplistNode = tilesetNode->FirstChild( "mapList" );
-        if ( maplistNode && mapIndex < mapCount )
+        if ( maplistNode )
         {
             TiXmlNode* mapNode = maplistNode->FirstChild( "map" );
-            int curMap = 0;
-            while ( mapNode && curMap < mapIndex )
+            while ( mapNode && maps->size() < mapCount )
             {
+                maps->push_back( SourceMap() );
+                if ( !_readTileMap( mapNode, maps->back() ) )
+                    isPacked = false;
+
                 mapNode = mapNode->NextSibling( "map" );
             }
+        }
+        if ( !isPacked )
+        {
+            std::stringstream msg;
+            msg << "Tileset " << mIndex << " (" << mImageName << "): some cells have a tile or code too large to store, "
+                << "and were clamped";
+            LogFileManager::getInstance().LogMessage( msg.str(), cmd::LogFile::Warning );
+        }
+
+        // The shared pointer is bound rather than assigned, so that its use
+        // count only includes the tilesets holding it
+        mSourceMaps.Bind( maps );
+        SelectMap( mapIndex );
+        return true;
+    }
+
+    //Read a tileset from a compiled map file
+    bool TileSet::ReadTileSet( const TileMapFile& file, UInt32 tileSetNum, const String& baseDir, UInt32 mapIndex )
+    {
+        const TileMapFile::TileSetRecord* record = file.GetTileSet( tileSetNum );
+        if ( !record )
+            return false;
+        Release();
 
-            if ( mapNode && curMap == mapIndex )
+        mIndex      = record->index;
+        mIdentifier = file.GetString( record->identifierOffset );
+        mTileSize   = Point2D( record->tileWidth, record->tileHeight );
+        mImageName  = StringUtil::FixPath( baseDir + "/" + file.GetString( record->imageNameOffset ) );
+        mGridSize   = Point2D( record->gridWidth, record->gridHeight );
+        mOverlap    = record->overlap;
+        mTileCount  = record->tileCount;
+
+        if ( ArchiveManager::GetSingleton().Exists( mImageName ) )
+            mIdentifier = mImageName;
+        if ( !_generateTiles() )
+            return false;
+
+        // Sequence data
+        mSequences.clear();
+        mSequences.resize( record->sequenceCount + 1 );
+        const TileMapFile::SequenceRecord* seqRecords = file.GetSequences( *record );
+        for ( UInt32 i = 0; seqRecords && i < record->sequenceListCount; i++ )
+        {
+            const TileMapFile::FrameRecord* frames = file.GetFrames( seqRecords[ i ] );
+            if ( !frames || seqRecords[ i ].index >= mSequences.size() )
+                continue;
+
+            Sequence& seq = mSequences[ seqRecords[ i ].index ];
+            seq.index = seqRecords[ i ].index;
+            seq.mSequence.resize( seqRecords[ i ].frameCount );
+            for ( UInt32 frame = 0; frame < seqRecords[ i ].frameCount; frame++ )
             {
-                _readTileMap( mapNode );
+                seq.mSequence[ frame ].delay        = frames[ frame ].delay;
+                seq.mSequence[ frame ].tileNumber   = frames[ frame ].tileNumber;
             }
         }
+        _scheduleSequences();
 
+        mSourceFile.Bind( new TileMapFile( file ) );
+        mSourceRecord   = tileSetNum;
+        SelectMap( mapIndex );
         return true;
     }
 
+    //GetMapCount
+    UInt32 TileSet::GetMapCount() const
+    {
+        if ( !mSourceMaps.IsNull() )
+            return mSourceMaps->size();
+        if ( !mSourceFile.IsNull() )
+        {
+            const TileMapFile::TileSetRecord* record = mSourceFile->GetTileSet( mSourceRecord );
+            return record ? record->mapCount : 0;
+        }
+        return mTileMapSize.x > 0 ? 1 : 0;
+    }
+
+    //GetMapIndex
+    UInt32 TileSet::GetMapIndex() const
+    {
+        return mMapIndex;
+    }
+
+    //SelectMap
+    bool TileSet::SelectMap( UInt32 mapIndex )
+    {
+        if ( mSourceMaps.IsNull() && mSourceFile.IsNull() )
+            return mapIndex == mMapIndex;
+
+        _clearMap();
+        mMapIndex       = mapIndex;
+        mIsSharedMap    = true;
+
+        if ( !mSourceMaps.IsNull() )
+        {
+            if ( mapIndex >= mSourceMaps->size() )
+                return false;
+
+            const SourceMap& map = ( *mSourceMaps )[ mapIndex ];
+            mCells          = TileCellList( map.cells );
+            mSpanList       = map.spans.empty() ? 0 : &map.spans[ 0 ];
+            mRowSpanList    = map.rowSpans.empty() ? 0 : &map.rowSpans[ 0 ];
+            mRowSpanEndList = map.rowSpans.empty() ? 0 : &map.rowSpans[ 1 ];
+            mTileMapSize    = map.size;
+            mMapStats       = map.stats;
+            _createChunks();
+            return true;
+        }
+
+        // Map data.  The runs and cells are used straight from the file, or
+        // for a paged map, streamed in around the view.
+        const TileMapFile& file = *mSourceFile;
+        const TileMapFile::TileSetRecord* record = file.GetTileSet( mSourceRecord );
+        const TileMapFile::MapRecord* map = record ? file.GetMap( *record, mapIndex ) : 0;
+        if ( map && map->pageSize > 0 )
+        {
+            mPager.Bind( new TileMapPager( file, *map ) );
+            mTileMapSize    = Point2D( map->width, map->height );
+
+            mMapStats = TileMapStats();
+            mMapStats.cellCount     = map->width * map->height;
+            mMapStats.emptyCells    = map->emptyCells;
+            const TileMapFile::PageRecord* pages = file.GetPages( *map );
+            Point2D pageGrid = TileMapFile::GetPageGridSize( *map );
+            for ( Int i = 0; i < pageGrid.x * pageGrid.y; i++ )
+            {
+                mMapStats.storedCells   += pages[ i ].cellCount;
+                mMapStats.spanCount     += pages[ i ].spanCount;
+                mMapStats.memoryBytes   += pages[ i ].dataSize;
+            }
+            _createChunks();
+        }
+        else if ( map )
+        {
+            mCells          = file.GetCells( *map );
+            mSpanList       = file.GetSpans( *map );
+            mRowSpanList    = file.GetRowSpans( *map );
+            mRowSpanEndList = mRowSpanList ? mRowSpanList + 1 : 0;
+            mTileMapSize    = Point2D( map->width, map->height );
+
+            mMapStats = TileMapStats();
+            mMapStats.cellCount     = map->width * map->height;
+            mMapStats.emptyCells    = map->emptyCells;
+            mMapStats.storedCells   = map->cellCount;
+            mMapStats.spanCount     = map->spanCount;
+            mMapStats.memoryBytes   = map->cellCount * ( sizeof( SInt16 ) + sizeof( UInt16 ) ) +
+                                      map->spanCount * sizeof( TileSpan ) +
+                                      ( map->height + 1 ) * sizeof( UInt32 );
+            _createChunks();
+        }
+
+        return map != 0;
+    }
+
     //Release
     void TileSet::Release()
     {
+        _releaseChunks();
+        _releaseCache();
+        _setTextureItem( 0 );
+        mPager.SetNull();
+        mSourceMaps.SetNull();
+        mSourceFile.SetNull();
     }
 
-    //Update
-    void TileSet::Update( Real32 elapsedMS ) const
+    //InvalidateCells
+    void TileSet::InvalidateCells( Int x, Int y, Int w, Int h )
     {
-        // Prepare the sequences
-        SequenceArray::iterator iter = mSequences.begin();
-        for ( iter; iter != mSequences.end(); iter++ )
+        if ( mChunks.empty() || w <= 0 || h <= 0 )
+            return;
+
+        // Chunks which do not exist are built from the current cells when
+        // they are drawn
+
+        Int startX = Math::IClamp( x, 0, mTileMapSize.x - 1 ) / CHUNK_SIZE;
+        Int startY = Math::IClamp( y, 0, mTileMapSize.y - 1 ) / CHUNK_SIZE;
+        Int endX   = Math::IClamp( x + w - 1, 0, mTileMapSize.x - 1 ) / CHUNK_SIZE;
+        Int endY   = Math::IClamp( y + h - 1, 0, mTileMapSize.y - 1 ) / CHUNK_SIZE;
+        for ( Int chunkY = startY; chunkY <= endY; chunkY++ )
         {
-            iter->Prepare( elapsedMS );
+            for ( Int chunkX = startX; chunkX <= endX; chunkX++ )
+            {
+                TileChunk* chunk = _findChunk( chunkY * mChunkGridSize.x + chunkX );
+                if ( chunk )
+                    chunk->isDirty = true;
+            }
         }
     }
 
-    //Render
-    void TileSet::Render( const Point2Df& offset, const Viewport& viewport ) const
+    //Update
+    void TileSet::Update( Real32 elapsedMS ) const
     {
-        // Check that a texture image has been loaded, and then bind the texture
-        // to the current context
-        TextureItem* textureItem = TextureManager::GetSingleton().GetTextureItemPtr( mImageName );
-        if ( textureItem )
+        // Only the sequences whose next frame change has come due are touched.
+        // On most frames, this is just a look at the top of the schedule.
+        // Frame durations are in seconds, so the elapsed time is converted.
+        mSequenceTime += elapsedMS * 0.001f;
+        while ( !mSchedule.empty() && mSchedule.top().time <= mSequenceTime )
         {
-            UInt32 texID = textureItem->GetID();
-            glBindTexture( GL_TEXTURE_2D, texID );
+            ScheduledSequence next = mSchedule.top();
+            mSchedule.pop();
+
+            // Catch up on any frames that were skipped by a long update
+            Sequence& seq = mSequences[ next.seqIndex ];
+            Real32 duration = seq.GetFrameDuration();
+            Int frames = 1 + Int( ( mSequenceTime - next.time ) / duration );
+            seq.AdvanceFrames( frames );
+            next.time += frames * duration;
+            mSchedule.push( next );
+
+            // Patch the quads of the cells using the sequence, in each chunk
+            // which currently has geometry.  Chunks built later pick up the
+            // current frame when they are collected.  Until a map has been
+            // given chunks, no cells are indexed.
+            if ( next.seqIndex >= mSequenceChunks.size() )
+                continue;
+            const std::vector< UInt32 >& chunks = mSequenceChunks[ next.seqIndex ];
+            std::vector< UInt32 >::const_iterator chunkIter = chunks.begin();
+            for ( chunkIter; chunkIter != chunks.end(); chunkIter++ )
+            {
+                TileChunk* chunk = _findChunk( *chunkIter );
+                if ( !chunk || !chunk->isBuilt )
+                    continue;
+                std::pair< AnimatedCellArray::const_iterator, AnimatedCellArray::const_iterator > cells =
+                    std::equal_range( chunk->animated.begin(), chunk->animated.end(), next.seqIndex, AnimatedCellLess() );
+                _patchAnimatedCells( *chunk, cells.first, cells.second );
+            }
         }
+    }
+
+    //_renderChunks
+    void TileSet::_renderChunks( const Point2Df& offset, const Viewport& viewport ) const
+    {
+        // Bind the texture to the current context.  When the tilesets of a
+        // scene share an atlas page, it will already be bound.  Going through
+        // the handle loads the texture again if it was evicted.
+        if ( mTextureItem && TextureManager::GetSingleton().UseTexture( mTextureItem->GetHandle() ) )
+            ++mRenderStats.textureBinds;
 
         Point2D displayTiles( Math::Ceil( viewport.GetSize().x / mTileSize.x ),
                               Math::Ceil( viewport.GetSize().y / mTileSize.y ) );
@@ -437,8 +1814,6 @@ namespace PGE
         endTile.x = Math::Clamp( endTile.x, 0, mTileMapSize.x - 1 );
         endTile.y = Math::Clamp( endTile.y, 0, mTileMapSize.y - 1 );
 
-        // Iterate over the tile rows and render spans of tiles
-        UInt32 spanCount = ( endTile.x - startTile.x );
         Point2Df rowPosition = offset;
         Point2Df mapSize = mTileMapSize * mTileSize;
         if ( mapSize.x < viewport.GetSize().x )
@@ -446,24 +1821,353 @@ namespace PGE
         if ( mapSize.y < viewport.GetSize().y )
             rowPosition.y = ( viewport.GetSize().y - mapSize.y ) / 2.0;
 
-        UInt32 startIndex = startTile.y * mTileMapSize.x + startTile.x;
-        glPushMatrix();
-        Point2D offsetInt( rowPosition.x + startTile.x * mTileSize.x, rowPosition.y + startTile.y * mTileSize.y );
-        glTranslatef( offsetInt.x, offsetInt.y, 0 );
-        for ( int tileY = startTile.y; tileY <= endTile.y; tileY++ )
+        if ( mChunkGridSize.x <= 0 || endTile.x < startTile.x || endTile.y < startTile.y )
+            return;
+
+        // Draw each of the chunks overlapping the visible tiles straight from
+        // their cached geometry.  Animated tiles are part of the geometry, and
+        // are patched by Update when their sequences change frames.
+        Point2D mapOrigin( rowPosition.x, rowPosition.y );
+        Point2D startChunk( startTile.x / CHUNK_SIZE, startTile.y / CHUNK_SIZE );
+        Point2D endChunk( endTile.x / CHUNK_SIZE, endTile.y / CHUNK_SIZE );
+        bool hasFog = _hasFog();
+        for ( Int chunkY = startChunk.y; chunkY <= endChunk.y; chunkY++ )
+        {
+            for ( Int chunkX = startChunk.x; chunkX <= endChunk.x; chunkX++ )
+            {
+                // Chunks the team has seen none of are not even built
+                UInt32 chunkIndex = chunkY * mChunkGridSize.x + chunkX;
+                if ( hasFog && !mFogOfWar->GetChunkSerial( mFogTeam, chunkIndex ) )
+                    continue;
+
+                _prepareChunk( chunkIndex );
+                if ( mLightMap )
+                    _lightChunk( chunkIndex );
+
+                TileChunk& chunk = _getChunk( chunkIndex );
+                chunk.lastFrame = mFrameCount;
+                Point2D chunkPosition( mapOrigin.x + chunk.origin.x * mTileSize.x,
+                                       mapOrigin.y + chunk.origin.y * mTileSize.y );
+                if ( !chunk.geometry.IsEmpty() )
+                {
+                    glPushMatrix();
+                    glTranslatef( chunkPosition.x, chunkPosition.y, 0 );
+                    chunk.geometry.Render( &mRenderStats );
+                    glPopMatrix();
+                }
+            }
+        }
+    }
+
+    //_lightChunk
+    void TileSet::_lightChunk( UInt32 chunkIndex ) const
+    {
+        TileChunk& chunk = _getChunk( chunkIndex );
+        const Point2D& lightSize = mLightMap->GetGridSize();
+        UInt32 serial = 0;
+        if ( lightSize.x == mTileMapSize.x && lightSize.y == mTileMapSize.y )
+            serial = mLightMap->GetChunkSerial( chunkIndex );
+        if ( !chunk.isBuilt || serial == chunk.lightSerial )
+            return;
+
+        chunk.lightSerial = serial;
+        _touchCache( chunk );
+        if ( !serial )
+        {
+            chunk.geometry.ClearColors();
+            return;
+        }
+
+        // Each quad takes the light of the corners of its cell
+        mLightMap->GetCornerLights( chunk.origin, chunk.size, mCornerLights );
+        UInt32 stride = chunk.size.x + 1;
+        for ( UInt32 quad = 0; quad < chunk.quadCells.size(); quad++ )
+        {
+            UInt32 x = chunk.quadCells[ quad ] % CHUNK_SIZE;
+            UInt32 y = chunk.quadCells[ quad ] / CHUNK_SIZE;
+            const Color* corner = &mCornerLights[ y * stride + x ];
+            chunk.geometry.SetQuadColors( quad, corner[ 0 ], corner[ stride ], corner[ stride + 1 ], corner[ 1 ] );
+        }
+    }
+
+    //Render
+    void TileSet::Render( const Point2Df& offset, const Viewport& viewport ) const
+    {
+        mRenderStats.Reset();
+        ++mFrameCount;
+        _refreshTexCoords();
+
+        // Keep the pages around the view resident
+        if ( !mPager.IsNull() && mTileSize.x > 0 && mTileSize.y > 0 )
+        {
+            Point2D firstTile( -offset.x / mTileSize.x, -offset.y / mTileSize.y );
+            Point2D lastTile( ( viewport.GetSize().x - offset.x ) / mTileSize.x,
+                              ( viewport.GetSize().y - offset.y ) / mTileSize.y );
+            mPager->Update( firstTile, lastTile );
+        }
+
+        if ( !_renderCache( offset, viewport ) )
+            _renderChunks( offset, viewport );
+        _evictChunks();
+    }
+
+    //_cacheCovers
+    bool TileSet::_cacheCovers( const Point2Df& offset, const Viewport& viewport ) const
+    {
+        if ( !mCache.isValid )
+            return false;
+
+        // The part of the map in view must lie inside the cached area
+        Point2D mapSize = GetMapSize();
+        Int left    = Math::IClamp( Int( -offset.x ), 0, mapSize.x );
+        Int top     = Math::IClamp( Int( -offset.y ), 0, mapSize.y );
+        Int right   = Math::IClamp( Int( Math::Ceil( viewport.GetSize().x - offset.x ) ), 0, mapSize.x );
+        Int bottom  = Math::IClamp( Int( Math::Ceil( viewport.GetSize().y - offset.y ) ), 0, mapSize.y );
+        return ( left >= mCache.origin.x && top >= mCache.origin.y &&
+                 right <= mCache.origin.x + mCache.area.x && bottom <= mCache.origin.y + mCache.area.y );
+    }
+
+    //_renderCache
+    bool TileSet::_renderCache( const Point2Df& offset, const Viewport& viewport ) const
+    {
+        if ( !mCache.isEnabled || !mCache.texture || !_cacheCovers( offset, viewport ) )
+            return false;
+
+        if ( TextureManager::GetSingleton().BindTexture( mCache.texture->GetID() ) )
+            ++mRenderStats.textureBinds;
+
+        // The texture was copied from the frame buffer, so its rows run from
+        // the bottom of the cached area up.  Positions are truncated the same
+        // way as the chunks, so the copy lines up with the tiles exactly.
+        TileTexCoords tex;
+        tex.u0 = 0;
+        tex.v0 = 1;
+        tex.u1 = mCache.area.x / Real( mCache.size.x );
+        tex.v1 = 1 - mCache.area.y / Real( mCache.size.y );
+        Point2D position( Int( offset.x ) + mCache.origin.x, Int( offset.y ) + mCache.origin.y );
+        mCache.quad.Clear();
+        mCache.quad.AddQuad( position.x, position.y, mCache.area.x, mCache.area.y, tex );
+        mCache.quad.Render( &mRenderStats );
+        return true;
+    }
+
+    //_touchCache
+    void TileSet::_touchCache( const TileChunk& chunk ) const
+    {
+        if ( !mCache.isValid )
+            return;
+
+        Point2D start( chunk.origin.x * mTileSize.x, chunk.origin.y * mTileSize.y );
+        Point2D end( start.x + chunk.size.x * mTileSize.x, start.y + chunk.size.y * mTileSize.y );
+        if ( start.x < mCache.origin.x + mCache.area.x && end.x > mCache.origin.x &&
+             start.y < mCache.origin.y + mCache.area.y && end.y > mCache.origin.y )
+            mCache.isValid = false;
+    }
+
+    //_releaseCache
+    void TileSet::_releaseCache() const
+    {
+        if ( mCache.texture )
+        {
+            TextureManager::GetSingleton().RemoveImage( mCache.textureName );
+            TextureManager::GetSingleton().ResetBinding();
+        }
+        mCache.texture = 0;
+        mCache.size = Point2D( 0, 0 );
+        mCache.isValid = false;
+    }
+
+    //SetRenderCache
+    void TileSet::SetRenderCache( bool enable, UInt32 margin )
+    {
+        mCache.isEnabled    = enable;
+        mCache.margin       = margin;
+        _releaseCache();
+    }
+
+    //IsRenderCached
+    bool TileSet::IsRenderCached() const
+    {
+        return mCache.isEnabled;
+    }
+
+    //RefreshRenderCache
+    bool TileSet::RefreshRenderCache( const Point2Df& offset, const Viewport& viewport ) const
+    {
+        // Small maps are centered in the view rather than scrolled, so they
+        // are simply drawn from their tiles
+        Point2D mapSize = GetMapSize();
+        Point2D viewSize = viewport.GetSize();
+        if ( !mCache.isEnabled || mChunkGridSize.x <= 0 || viewSize.x <= 0 || viewSize.y <= 0 ||
+             mapSize.x < viewSize.x || mapSize.y < viewSize.y )
+            return false;
+
+        // Pick up changes to the chunks in the cached area.  They are marked
+        // as drawn in the coming frame, which keeps them from being released
+        // while the layer is drawn from the cache, since they are needed to
+        // redraw it.
+        if ( mCache.isValid )
+        {
+            Int startX = mCache.origin.x / mTileSize.x / CHUNK_SIZE;
+            Int startY = mCache.origin.y / mTileSize.y / CHUNK_SIZE;
+            Int endX   = Math::IMin( ( mCache.origin.x + mCache.area.x - 1 ) / mTileSize.x / CHUNK_SIZE, mChunkGridSize.x - 1 );
+            Int endY   = Math::IMin( ( mCache.origin.y + mCache.area.y - 1 ) / mTileSize.y / CHUNK_SIZE, mChunkGridSize.y - 1 );
+            for ( Int chunkY = startY; chunkY <= endY; chunkY++ )
+            {
+                for ( Int chunkX = startX; chunkX <= endX; chunkX++ )
+                {
+                    UInt32 chunkIndex = chunkY * mChunkGridSize.x + chunkX;
+                    _getChunk( chunkIndex ).lastFrame = mFrameCount + 1;
+                    _prepareChunk( chunkIndex );
+                }
+            }
+        }
+        if ( _cacheCovers( offset, viewport ) )
+            return false;
+
+        // Size the cache to the view plus the margin on each side, within the
+        // limits of the video card
+        GLint maxSize = 0;
+        glGetIntegerv( GL_MAX_TEXTURE_SIZE, &maxSize );
+        Point2D size( Math::IMin( Math::FindNextPowerOf2( viewSize.x + 2 * mCache.margin ), maxSize ),
+                      Math::IMin( Math::FindNextPowerOf2( viewSize.y + 2 * mCache.margin ), maxSize ) );
+        if ( size.x < viewSize.x || size.y < viewSize.y )
+            return false;
+        if ( !mCache.texture || size.x != mCache.size.x || size.y != mCache.size.y )
+        {
+            _releaseCache();
+            static UInt32 cacheCount = 0;
+            mCache.textureName = "TileSetCache" + StringUtil::ToString( ++cacheCount );
+            ImageData blank;
+            blank.Resize( size.x, size.y );
+            if ( !TextureManager::GetSingleton().CreateTexture( mCache.textureName, blank ) )
+                return false;
+            mCache.texture  = TextureManager::GetSingleton().GetTextureItemPtr( mCache.textureName );
+            mCache.size     = size;
+        }
+
+        // Center the cached area on the view, keeping it inside the map
+        mCache.area.x   = Math::IMin( size.x, mapSize.x );
+        mCache.area.y   = Math::IMin( size.y, mapSize.y );
+        mCache.origin.x = Math::IClamp( Int( -offset.x ) - ( mCache.area.x - viewSize.x ) / 2, 0, mapSize.x - mCache.area.x );
+        mCache.origin.y = Math::IClamp( Int( -offset.y ) - ( mCache.area.y - viewSize.y ) / 2, 0, mapSize.y - mCache.area.y );
+
+        // Draw the area in blocks the size of the view, copying each block
+        // into the texture.  The back buffer is cleared to transparent, so
+        // that the empty cells stay transparent in the copy (this relies on
+        // the frame buffer having an alpha channel.)  A chunk which finishes
+        // building part way through marks the cache invalid again, so it is
+        // redrawn on the next frame.
+        mCache.isValid = true;
+        GLint glViewport[ 4 ];
+        glGetIntegerv( GL_VIEWPORT, glViewport );
+        GLfloat clearColor[ 4 ];
+        glGetFloatv( GL_COLOR_CLEAR_VALUE, clearColor );
+        glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
+        for ( Int blockY = 0; blockY < mCache.area.y; blockY += viewSize.y )
+        {
+            for ( Int blockX = 0; blockX < mCache.area.x; blockX += viewSize.x )
+            {
+                Point2D block( Math::IMin( viewSize.x, mCache.area.x - blockX ), Math::IMin( viewSize.y, mCache.area.y - blockY ) );
+                glClear( GL_COLOR_BUFFER_BIT );
+                _renderChunks( Point2Df( -( mCache.origin.x + blockX ), -( mCache.origin.y + blockY ) ), viewport );
+
+                // The top of the view is the top of the GL viewport, while
+                // the frame buffer rows start at the bottom
+                TextureManager::GetSingleton().BindTexture( mCache.texture->GetID() );
+                glCopyTexSubImage2D( GL_TEXTURE_2D, 0, blockX, mCache.size.y - blockY - block.y,
+                                     glViewport[ 0 ], glViewport[ 1 ] + glViewport[ 3 ] - block.y, block.x, block.y );
+            }
+        }
+        glClearColor( clearColor[ 0 ], clearColor[ 1 ], clearColor[ 2 ], clearColor[ 3 ] );
+        return true;
+    }
+
+    //GetRenderStats
+    const TileRenderStats& TileSet::GetRenderStats() const
+    {
+        return mRenderStats;
+    }
+
+    //GetMapStats
+    const TileMapStats& TileSet::GetMapStats() const
+    {
+        return mMapStats;
+    }
+
+    //IsStreaming
+    bool TileSet::IsStreaming() const
+    {
+        return !mPager.IsNull();
+    }
+
+    //GetPager
+    const TileMapPager* TileSet::GetPager() const
+    {
+        return mPager.Get();
+    }
+
+    //SetStreamingRadius
+    void TileSet::SetStreamingRadius( UInt32 loadRadius, UInt32 hysteresis )
+    {
+        if ( !mPager.IsNull() )
+            mPager->SetRadius( loadRadius, hysteresis );
+    }
+
+    //SetLightMap
+    void TileSet::SetLightMap( const TileLightMap* lightMap )
+    {
+        if ( lightMap == mLightMap )
+            return;
+        mLightMap = lightMap;
+
+        // Every chunk is colored again as it is drawn
+        ChunkMap::iterator chunkIter = mChunks.begin();
+        for ( chunkIter; chunkIter != mChunks.end(); chunkIter++ )
         {
-            // Get the iterator:
-            TileMap::const_iterator tileIter = mTileMap.begin() + startIndex;
+            chunkIter->second.geometry.ClearColors();
+            chunkIter->second.lightSerial = 0;
+            _touchCache( chunkIter->second );
+        }
+    }
 
-            // Render the tile span:
-            glPushMatrix();
-                _renderTileSpan( tileIter, mDisplayListBase, spanCount );
-            glPopMatrix();
-            glTranslatef( 0, mTileSize.y, 0 );
+    //GetLightMap
+    const TileLightMap* TileSet::GetLightMap() const
+    {
+        return mLightMap;
+    }
 
-            startIndex += mTileMapSize.x;
+    //_hasFog
+    bool TileSet::_hasFog() const
+    {
+        if ( !mFogOfWar )
+            return false;
+        const Point2D& fogSize = mFogOfWar->GetGridSize();
+        return fogSize.x == mTileMapSize.x && fogSize.y == mTileMapSize.y;
+    }
+
+    //SetFogOfWar
+    void TileSet::SetFogOfWar( const TileFogOfWar* fogOfWar, UInt32 team )
+    {
+        if ( fogOfWar == mFogOfWar && team == mFogTeam )
+            return;
+        mFogOfWar = fogOfWar;
+        mFogTeam = team;
+
+        // Every chunk is rebuilt as it is drawn
+        ChunkMap::iterator chunkIter = mChunks.begin();
+        for ( chunkIter; chunkIter != mChunks.end(); chunkIter++ )
+        {
+            chunkIter->second.isDirty = true;
+            chunkIter->second.fogSerial = 0;
+            _touchCache( chunkIter->second );
         }
-        glPopMatrix();
+    }
+
+    //GetFogOfWar
+    const TileFogOfWar* TileSet::GetFogOfWar() const
+    {
+        return mFogOfWar;
     }
 
 } // namespace PGE
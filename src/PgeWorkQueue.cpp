@@ -0,0 +1,209 @@
+/*! $Id$
+ *  @file   PgeWorkQueue.cpp
+ *  @author agent
+ *  @date   October 17, 2026
+ *
+ */
+
+#include "PgeWorkQueue.h"
+#include <algorithm>
+
+namespace PGE
+{
+    ////////////////////////////////////////////////////////////////////////////
+    // WorkItem
+    ////////////////////////////////////////////////////////////////////////////
+
+    WorkItem::WorkItem()
+        : mState( Idle )
+    {
+    }
+
+    WorkItem::~WorkItem()
+    {
+    }
+
+    //_setState-----------------------------------------------------------------
+    void WorkItem::_setState( State state )
+    {
+        MutexLock lock( mMutex );
+        mState = state;
+    }
+
+    //GetState------------------------------------------------------------------
+    WorkItem::State WorkItem::GetState() const
+    {
+        MutexLock lock( mMutex );
+        return mState;
+    }
+
+    //IsBusy--------------------------------------------------------------------
+    bool WorkItem::IsBusy() const
+    {
+        State state = GetState();
+        return ( state == Pending || state == Running );
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // WorkQueue::WorkerThread
+    ////////////////////////////////////////////////////////////////////////////
+
+    void WorkQueue::WorkerThread::Run()
+    {
+        WorkItem* item = mQueue->_nextItem();
+        while ( item )
+        {
+            item->Execute();
+            item->_setState( WorkItem::Complete );
+            item = mQueue->_nextItem();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // WorkQueue
+    ////////////////////////////////////////////////////////////////////////////
+
+    // Instantiate the singleton instance
+    template<> WorkQueue* Singleton< WorkQueue >::mInstance = 0;
+
+    WorkQueue& WorkQueue::GetSingleton()
+    {
+        assert( mInstance );
+        return *mInstance;
+    }
+    WorkQueue* WorkQueue::GetSingletonPtr()
+    {
+        return mInstance;
+    }
+
+    WorkQueue::WorkQueue( Int threadCount )
+        : mQuit( false )
+    {
+        if ( threadCount < 0 )
+            threadCount = Int( Thread::GetProcessorCount() ) - 1;
+
+        for ( Int i = 0; i < threadCount; i++ )
+        {
+            WorkerThread* thread = new WorkerThread( this );
+            if ( thread->Start() )
+                mThreads.push_back( thread );
+            else
+                delete thread;
+        }
+    }
+
+    WorkQueue::~WorkQueue()
+    {
+        // Discard anything which hasn't been started
+        {
+            MutexLock lock( mMutex );
+            mQuit = true;
+            ItemQueue::iterator iter = mPending.begin();
+            for ( iter; iter != mPending.end(); iter++ )
+                ( *iter )->_setState( WorkItem::Idle );
+            mPending.clear();
+        }
+
+        // Wake each of the threads so that they see the quit flag
+        ThreadArray::iterator iter = mThreads.begin();
+        for ( iter; iter != mThreads.end(); iter++ )
+            mSignal.Post();
+        for ( iter = mThreads.begin(); iter != mThreads.end(); iter++ )
+        {
+            ( *iter )->Join();
+            delete *iter;
+        }
+        mThreads.clear();
+    }
+
+    //_nextItem-----------------------------------------------------------------
+    WorkItem* WorkQueue::_nextItem()
+    {
+        while ( true )
+        {
+            mSignal.Wait();
+
+            MutexLock lock( mMutex );
+            if ( mQuit )
+                return 0;
+
+            // The item for this signal may have been cancelled, in which case
+            // the queue can be empty; just go back to waiting.
+            if ( !mPending.empty() )
+            {
+                WorkItem* item = mPending.front();
+                mPending.pop_front();
+                item->_setState( WorkItem::Running );
+                return item;
+            }
+        }
+    }
+
+    //_removePending------------------------------------------------------------
+    bool WorkQueue::_removePending( WorkItem* item )
+    {
+        ItemQueue::iterator iter = std::find( mPending.begin(), mPending.end(), item );
+        if ( iter == mPending.end() )
+            return false;
+        mPending.erase( iter );
+        return true;
+    }
+
+    //Submit--------------------------------------------------------------------
+    void WorkQueue::Submit( WorkItem* item )
+    {
+        assert( item && !item->IsBusy() );
+
+        // Without any worker threads, just do the work now
+        if ( mThreads.empty() )
+        {
+            item->_setState( WorkItem::Running );
+            item->Execute();
+            item->_setState( WorkItem::Complete );
+            return;
+        }
+
+        {
+            MutexLock lock( mMutex );
+            item->_setState( WorkItem::Pending );
+            mPending.push_back( item );
+        }
+        mSignal.Post();
+    }
+
+    //Cancel--------------------------------------------------------------------
+    bool WorkQueue::Cancel( WorkItem* item )
+    {
+        MutexLock lock( mMutex );
+        if ( !_removePending( item ) )
+            return false;
+        item->_setState( WorkItem::Idle );
+        return true;
+    }
+
+    //Wait----------------------------------------------------------------------
+    void WorkQueue::Wait( WorkItem* item )
+    {
+        // If no worker has picked up the item yet, execute it here rather than
+        // waiting for one to become free.
+        bool runHere = false;
+        {
+            MutexLock lock( mMutex );
+            if ( _removePending( item ) )
+            {
+                item->_setState( WorkItem::Running );
+                runHere = true;
+            }
+        }
+        if ( runHere )
+        {
+            item->Execute();
+            item->_setState( WorkItem::Complete );
+            return;
+        }
+
+        while ( item->GetState() == WorkItem::Running )
+            Thread::Sleep( 0 );
+    }
+
+} // namespace PGE